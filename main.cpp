@@ -1,6 +1,6 @@
-// snake_smooth_mt_optimized.cpp
+// main.cpp
 // Smooth-interpolated Snake + multithreaded renderer (Win32 GDI) - OPTIMIZED
-// Compile: g++ snake_smooth_mt_optimized.cpp -std=c++17 -lgdi32 -o snake.exe
+// Compile: g++ main.cpp -std=c++20 -O2 -municode -mwindows -lgdi32 -lmsimg32 -o snake.exe
 
 #include <windows.h>
 #include <vector>
@@ -12,6 +12,17 @@
 #include <atomic>
 #include <chrono>
 #include <algorithm>
+#include <cwchar>
+#include <cstdio>
+#include <cstring>
+
+#include "snake_coro.h"
+#include "snake_dataset.h"
+#include "snake_game_loop.h"
+#include "snake_jobs.h"
+#include "snake_pipeline.h"
+#include "snake_queue.h"
+#include "snake_scene.h"
 
 //
 // Config
@@ -48,7 +59,12 @@ enum Direction { UP, DOWN, LEFT, RIGHT };
 enum GameState { MENU, SETTINGS, PLAYING };
 
 //
-// Shared game state
+// Shared state, laid out by who writes it. The window thread writes the game state and
+// settings below (WndProc and the game's coroutines), at most a few times a tick; the
+// build, autosave and telemetry jobs read them under stateMtx. What is written more often
+// than that, or by another thread - the lock, the mouse, frame latency, the build
+// stage's cache - is CachePadded (snake_queue.h) so that those stores never invalidate a
+// line another thread is reading for something else.
 //
 static GameState gameState = MENU;
 static int menuSelection = 0; // 0=Play, 1=Settings, 2=Exit
@@ -63,14 +79,43 @@ static bool gameOver = false;
 static bool gameWon = false;
 static bool paused = false;
 static bool started = false; // NEW: game hasn't started yet
+static bool dying = false; // hit something; gameOver once the death animation is over
+static bool snakeHidden = false; // the death animation's blink
+static int countdownValue = 0; // 3, 2, 1 after resuming, else 0
+static int screenFade = 0; // 255 down to 0 after a change of screen
 static int score = 0;
 
 static std::chrono::steady_clock::time_point lastTickTime = std::chrono::steady_clock::now();
 static std::chrono::milliseconds tickDuration = std::chrono::milliseconds(TICK_INTERVAL_MS_VALUE);
 
-static std::mutex stateMtx;
+static CachePadded<std::mutex> stateMtx; // window thread and jobs
 static std::mutex rngMtx; // FIXED: separate mutex for RNG
-static std::atomic_bool running{ true };
+static CachePadded<std::atomic_bool> running{ true }; // read by every job, cleared once on the way out
+
+// The render stages, autosave, telemetry and the game logic's wake-ups are jobs on
+// wWinMain's JobSystem (snake_jobs.h); those for the window thread run when WM_APP_JOBS
+// arrives
+static JobSystem* jobs = nullptr;
+static constexpr UINT WM_APP_JOBS = WM_APP + 1;
+
+// The game logic's coroutines (snake_coro.h, snake_game_loop.h) and what they wait on;
+// window thread only. WindowGame is the game loop's view of the state below; each of its
+// calls takes stateMtx itself.
+struct WindowGame {
+    CoroTime tickPeriod();
+    bool pausedNow();
+    TickResult tick();
+    void ticksStarted();
+    bool showCountdown(int n);
+    void blink(bool hidden);
+    void endGame();
+};
+static CoroExecutor coro;
+static WindowGame windowGame;
+static GameLoop<WindowGame> gameLoop(coro, windowGame);
+static CoroTaskId fadeTask;
+static const std::chrono::steady_clock::time_point coroEpoch = std::chrono::steady_clock::now();
+static CoroTime coroWake = CORO_NEVER; // when the last window-thread job asked for runs
 
 // RNG - now protected by rngMtx
 static std::mt19937 rng((unsigned)std::random_device{}());
@@ -78,8 +123,15 @@ static std::uniform_int_distribution<int> distW(0, GRID_W - 1);
 static std::uniform_int_distribution<int> distH(0, GRID_H - 1);
 
 static HWND g_hwnd = nullptr;
-static int mouseX = 0;
-static int mouseY = 0;
+
+// The pointer as WM_MOUSEMOVE's lParam packs it (x low, y high): one store, so the build
+// job never samples an x from one move and a y from the next
+static CachePadded<std::atomic<uint32_t>> mousePos;
+
+// Imitation-learning recording (--record <file>): one (state, action) sample per tick,
+// packed and written on the recorder's own thread
+static DatasetWriter recorder;
+static uint32_t recordEpisode = 0;
 
 //
 // Resize window to match current grid settings
@@ -218,104 +270,172 @@ static void resetGameLocked() {
     gameWon = false;
     paused = false;
     started = false;
+    dying = false;
+    snakeHidden = false;
+    countdownValue = 0;
     score = 0;
+    recordEpisode++;
     placeFoodLocked();
     lastTickTime = std::chrono::steady_clock::now();
     tickDuration = std::chrono::milliseconds(TICK_INTERVAL_MS_VALUE);
+
+    // A new game loop, waiting for the first arrow key
+    gameLoop.restart();
+}
+
+// State before the tick plus the direction about to be applied; only copies into the queue
+static void recordTickLocked() {
+    static DatasetSample sample;
+    datasetBegin(sample, GRID_W, GRID_H, recordEpisode, dir, nextDir);
+    for (auto& p : currSnake) datasetPushSegment(sample, (uint32_t)(p.y * GRID_W + p.x));
+    for (auto& f : food) datasetPushFood(sample, (uint32_t)(f.y * GRID_W + f.x));
+    recorder.submit(sample);
 }
 
 //
-// Game tick
+// Game logic: the game loop (snake_game_loop.h, on the state here through WindowGame) and
+// the screen fade, coroutines on a single-threaded executor (snake_coro.h) whose clock is
+// the steady clock since startup. They run on the window thread, in pumpGame(), which asks
+// for a window-thread job when the next of them is due; while every one of them waits
+// for the player (to start, to resume, to pick a button) none is due and nothing runs.
+// The executor's clock then stands where it last ran, so WndProc brings it up to now
+// before input sets an event or spawns a task; their wake-ups and the tick grid count
+// from there, not from the last pump.
 //
-static void gameThreadFunc() {
-    using clock = std::chrono::steady_clock;
-    auto nextTick = clock::now() + std::chrono::milliseconds(TICK_INTERVAL_MS_VALUE);
+static void pumpGame();
 
-    while (running) {
-        auto now = clock::now();
+// One step of the snake
+static TickResult tickLocked() {
+    if (recorder.isOpen()) recordTickLocked();
+
+    // Apply queued direction at start of tick
+    dir = nextDir;
 
-        // Check if we should tick
-        bool shouldTick = false;
-        {
-            std::lock_guard<std::mutex> lk(stateMtx);
-            shouldTick = started && !paused && !gameOver && !gameWon;
+    Pt head = currSnake.front();
+    Pt newHead = moveHead(head, dir);
 
-            // If not active, reset the next tick time to prevent accumulated time
-            if (!shouldTick) {
-                nextTick = now + std::chrono::milliseconds(TICK_INTERVAL_MS_VALUE);
-                prevSnake = currSnake; // Keep in sync for rendering
+    // collision check
+    bool collided = false;
+    if (newHead.x < 0 || newHead.x >= GRID_W || newHead.y < 0 || newHead.y >= GRID_H) {
+        collided = true;
+    }
+    else {
+        for (auto& s : currSnake) {
+            if (s.x == newHead.x && s.y == newHead.y) {
+                collided = true;
+                break;
             }
         }
+    }
 
-        // Perform game tick if it's time
-        if (shouldTick && now >= nextTick) {
-            nextTick += std::chrono::milliseconds(TICK_INTERVAL_MS_VALUE);
+    // snapshot prevSnake before modifying currSnake
+    prevSnake = currSnake;
+    lastTickTime = std::chrono::steady_clock::now();
+    tickDuration = std::chrono::milliseconds(TICK_INTERVAL_MS_VALUE);
 
-            std::lock_guard<std::mutex> lk(stateMtx);
-            if (started && !paused && !gameOver && !gameWon) {
-                // Apply queued direction at start of tick
-                dir = nextDir;
+    if (collided) {
+        dying = true; // gameOver once the death animation has played
+        return TICK_DIED;
+    }
 
-                Pt head = currSnake.front();
-                Pt newHead = moveHead(head, dir);
+    currSnake.push_front(newHead);
 
-                // collision check
-                bool collided = false;
-                if (newHead.x < 0 || newHead.x >= GRID_W || newHead.y < 0 || newHead.y >= GRID_H) {
-                    collided = true;
-                }
-                else {
-                    for (auto& s : currSnake) {
-                        if (s.x == newHead.x && s.y == newHead.y) {
-                            collided = true;
-                            break;
-                        }
-                    }
-                }
+    // Check if ate any food
+    bool ateFood = false;
+    for (auto it = food.begin(); it != food.end(); ++it) {
+        if (newHead.x == it->x && newHead.y == it->y) {
+            score += 10;
+            food.erase(it);
+            ateFood = true;
+            break;
+        }
+    }
 
-                // snapshot prevSnake before modifying currSnake
-                prevSnake = currSnake;
+    if (ateFood) {
+        // Check if won (snake fills entire grid)
+        if (currSnake.size() >= (size_t)(GRID_W * GRID_H)) {
+            gameWon = true;
+            return TICK_WON;
+        }
+        // Place only ONE new fruit to replace the eaten one
+        placeOneFoodLocked();
+    }
+    else {
+        currSnake.pop_back();
+    }
+    return TICK_MOVED;
+}
 
-                if (collided) {
-                    gameOver = true;
-                }
-                else {
-                    currSnake.push_front(newHead);
-
-                    // Check if ate any food
-                    bool ateFood = false;
-                    for (auto it = food.begin(); it != food.end(); ++it) {
-                        if (newHead.x == it->x && newHead.y == it->y) {
-                            score += 10;
-                            food.erase(it);
-                            ateFood = true;
-                            break;
-                        }
-                    }
+CoroTime WindowGame::tickPeriod() {
+    return coroMs(TICK_INTERVAL_MS_VALUE);
+}
 
-                    if (ateFood) {
-                        // Check if won (snake fills entire grid)
-                        if (currSnake.size() >= (size_t)(GRID_W * GRID_H)) {
-                            gameWon = true;
-                        }
-                        else {
-                            // Place only ONE new fruit to replace the eaten one
-                            placeOneFoodLocked();
-                        }
-                    }
-                    else {
-                        currSnake.pop_back();
-                    }
-                }
+bool WindowGame::pausedNow() {
+    std::lock_guard<std::mutex> lk(stateMtx);
+    return paused;
+}
 
-                lastTickTime = clock::now();
-                tickDuration = std::chrono::milliseconds(TICK_INTERVAL_MS_VALUE);
-            }
-        }
+TickResult WindowGame::tick() {
+    std::lock_guard<std::mutex> lk(stateMtx);
+    return tickLocked();
+}
+
+void WindowGame::ticksStarted() {
+    std::lock_guard<std::mutex> lk(stateMtx);
+    prevSnake = currSnake; // nothing to slide in from after a pause
+    lastTickTime = std::chrono::steady_clock::now();
+}
 
-        // Short sleep to prevent busy waiting
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+bool WindowGame::showCountdown(int n) {
+    std::lock_guard<std::mutex> lk(stateMtx);
+    if (n > 0 && paused) return false;
+    countdownValue = n;
+    return true;
+}
+
+void WindowGame::blink(bool hidden) {
+    std::lock_guard<std::mutex> lk(stateMtx);
+    snakeHidden = hidden;
+}
+
+void WindowGame::endGame() {
+    std::lock_guard<std::mutex> lk(stateMtx);
+    snakeHidden = false;
+    dying = false;
+    gameOver = true;
+}
+
+// A fade in from the background after every change of screen
+static CoroTask screenFadeIn() {
+    for (int a = 224; a > 0; a -= 32) {
+        co_await coro.sleepFor(coroMs(16));
+        std::lock_guard<std::mutex> lk(stateMtx);
+        screenFade = a;
     }
+    std::lock_guard<std::mutex> lk(stateMtx);
+    screenFade = 0;
+}
+
+static void setScreenLocked(GameState s) {
+    gameState = s;
+    screenFade = 255;
+    coro.cancel(fadeTask);
+    fadeTask = coro.spawn(screenFadeIn());
+}
+
+static CoroTime coroNow() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - coroEpoch).count();
+}
+
+static void pumpGame() {
+    coro.runUntil(coroNow());
+    CoroTime next = coro.nextWake();
+    if (!running || next == CORO_NEVER || next >= coroWake) return;
+    coroWake = next; // an earlier wake already asked for still runs, and finds this one due or not
+    jobs->addAt(coroEpoch + std::chrono::microseconds(next), [next] {
+        if (coroWake == next) coroWake = CORO_NEVER;
+        pumpGame();
+    }, {}, JOB_MAIN);
 }
 
 //
@@ -337,6 +457,9 @@ struct RenderSnapshot {
     bool gameWon;
     bool paused;
     bool started;
+    bool snakeHidden;
+    int countdown;
+    int fade;
     GameState state;
     int menuSelection;
     int pauseSelection;
@@ -350,759 +473,595 @@ struct RenderSnapshot {
     int speedIndex;
     int mouseX;
     int mouseY;
+    int gridW, gridH, cell; // the board in play (GRID_W, GRID_H, CELL)
+    int targetFps;
     std::chrono::steady_clock::time_point tickTime;
     std::chrono::milliseconds tickDur;
 };
 
 //
-// GDI Resource cache to avoid recreating every frame
+// GDI backend: plays render commands (snake_render.h, built by snake_scene.h) into a DC.
+// Brushes, pens and fonts are made the first time a state is seen and then kept, as are
+// the surfaces that blits copy from. Used by one raster job at a time.
 //
-struct GDICache {
-    HBRUSH bgBrush;
-    HBRUSH foodBrush;
-    HBRUSH headBrush;
-    HBRUSH bodyBrush1;
-    HBRUSH bodyBrush2;
-    HBRUSH overBrush;
-    HPEN gridPen;
-    HPEN headPen;
-    HPEN bodyPen;
-    HFONT scoreFont;
-    HFONT gameOverFont;
-    HFONT menuTitleFont;
-    HFONT menuButtonFont;
-
-    GDICache() {
-        bgBrush = CreateSolidBrush(RGB(22, 26, 30));
-        foodBrush = CreateSolidBrush(RGB(255, 70, 70));
-        headBrush = CreateSolidBrush(RGB(90, 220, 90));
-        bodyBrush1 = CreateSolidBrush(RGB(40, 170, 40));
-        bodyBrush2 = CreateSolidBrush(RGB(30, 140, 30));
-        overBrush = CreateSolidBrush(RGB(0, 0, 0));
-
-        gridPen = CreatePen(PS_SOLID, 1, RGB(40, 40, 48));
-        headPen = CreatePen(PS_SOLID, 1, RGB(0, 110, 0));
-        bodyPen = CreatePen(PS_SOLID, 1, RGB(0, 90, 0));
-
-        scoreFont = CreateFontW(20, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
-            DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-            DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
+class GDIBackend {
+public:
+    ~GDIBackend() {
+        for (auto& b : brushes) DeleteObject(b.obj);
+        for (auto& p : pens) DeleteObject(p.obj);
+        for (auto& f : fonts) DeleteObject(f.obj);
+        for (Surface& s : surfaces) releaseSurface(s);
+        if (blendDC) {
+            SelectObject(blendDC, blendOld);
+            DeleteObject(blendBM);
+            DeleteDC(blendDC);
+        }
+    }
 
-        gameOverFont = CreateFontW(48, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
-            DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-            DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
+    // Everything, or only what touches clip
+    void play(HDC dc, const RenderCommands& rc, const RenderRect* clip) {
+        int saved = 0;
+        if (clip) {
+            saved = SaveDC(dc);
+            IntersectClipRect(dc, clip->left, clip->top, clip->right, clip->bottom);
+        }
+        SetBkMode(dc, TRANSPARENT);
+        HGDIOBJ oldBrush = SelectObject(dc, GetStockObject(NULL_BRUSH));
+        HGDIOBJ oldPen = nullptr, oldFont = nullptr;
+        HPEN curPen = nullptr;
+        HFONT curFont = nullptr;
+        uint32_t curText = UINT32_MAX;
+
+        for (const RenderCmd& c : rc.cmds) {
+            if (clip && !renderIntersects(renderBounds(c), *clip)) continue;
+            RECT r = { c.rect.left, c.rect.top, c.rect.right, c.rect.bottom };
+            switch (c.op) {
+            case RENDER_FILL:
+                FillRect(dc, &r, brush(c.color));
+                break;
+            case RENDER_OUTLINE: {
+                HPEN p = pen(c.param, c.color);
+                if (p != curPen) {
+                    HGDIOBJ o = SelectObject(dc, p);
+                    if (!oldPen) oldPen = o;
+                    curPen = p;
+                }
+                Rectangle(dc, r.left, r.top, r.right, r.bottom);
+                break;
+            }
+            case RENDER_TEXT: {
+                HFONT f = font(c.param, (c.flags & RENDER_TEXT_BOLD) != 0);
+                if (f != curFont) {
+                    HGDIOBJ o = SelectObject(dc, f);
+                    if (!oldFont) oldFont = o;
+                    curFont = f;
+                }
+                if (c.color != curText) {
+                    SetTextColor(dc, c.color);
+                    curText = c.color;
+                }
+                int align = c.flags & RENDER_TEXT_ALIGN;
+                UINT format = align == RENDER_TEXT_LEFT ? DT_LEFT | DT_TOP | DT_SINGLELINE
+                    : align == RENDER_TEXT_RIGHT ? DT_RIGHT | DT_TOP | DT_SINGLELINE
+                    : DT_CENTER | DT_VCENTER | DT_SINGLELINE;
+                DrawTextW(dc, rc.textOf(c), c.textLen, &r, format);
+                break;
+            }
+            case RENDER_BLEND: {
+                // One pixel of the colour, stretched over the rect at the command's alpha
+                if (!blendDC) {
+                    blendDC = CreateCompatibleDC(dc);
+                    blendBM = CreateCompatibleBitmap(dc, 1, 1);
+                    blendOld = SelectObject(blendDC, blendBM);
+                }
+                RECT one = { 0, 0, 1, 1 };
+                FillRect(blendDC, &one, brush(c.color));
+                BLENDFUNCTION bf = { AC_SRC_OVER, 0, c.param, 0 };
+                GdiAlphaBlend(dc, r.left, r.top, r.right - r.left, r.bottom - r.top, blendDC, 0, 0, 1, 1, bf);
+                break;
+            }
+            case RENDER_BLIT: {
+                HDC src = surface(dc, c);
+                if (src) BitBlt(dc, r.left, r.top, r.right - r.left, r.bottom - r.top, src, 0, 0, SRCCOPY);
+                break;
+            }
+            }
+        }
 
-        menuTitleFont = CreateFontW(64, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
-            DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-            DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
+        if (oldPen) SelectObject(dc, oldPen);
+        if (oldFont) SelectObject(dc, oldFont);
+        SelectObject(dc, oldBrush);
+        if (clip) RestoreDC(dc, saved);
+    }
 
-        menuButtonFont = CreateFontW(28, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+private:
+    template <typename T>
+    struct Cached {
+        uint64_t key;
+        T obj;
+    };
+
+    struct Surface {
+        uint32_t id = 0, key = 0;
+        int w = 0, h = 0;
+        HDC dc = nullptr;
+        HBITMAP bm = nullptr;
+        HGDIOBJ old = nullptr;
+    };
+
+    HBRUSH brush(uint32_t color) {
+        for (auto& b : brushes) {
+            if (b.key == color) return b.obj;
+        }
+        brushes.push_back({ color, CreateSolidBrush(color) });
+        return brushes.back().obj;
+    }
+
+    HPEN pen(int width, uint32_t color) {
+        uint64_t key = (uint64_t)width << 32 | color;
+        for (auto& p : pens) {
+            if (p.key == key) return p.obj;
+        }
+        pens.push_back({ key, CreatePen(PS_SOLID, width, color) });
+        return pens.back().obj;
+    }
+
+    HFONT font(int height, bool bold) {
+        uint64_t key = (uint64_t)height << 1 | (bold ? 1 : 0);
+        for (auto& f : fonts) {
+            if (f.key == key) return f.obj;
+        }
+        HFONT f = CreateFontW(height, 0, 0, 0, bold ? FW_BOLD : FW_NORMAL, FALSE, FALSE, FALSE,
             DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
             DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
+        fonts.push_back({ key, f });
+        return f;
     }
 
-    ~GDICache() {
-        DeleteObject(bgBrush);
-        DeleteObject(foodBrush);
-        DeleteObject(headBrush);
-        DeleteObject(bodyBrush1);
-        DeleteObject(bodyBrush2);
-        DeleteObject(overBrush);
-        DeleteObject(gridPen);
-        DeleteObject(headPen);
-        DeleteObject(bodyPen);
-        DeleteObject(scoreFont);
-        DeleteObject(gameOverFont);
-        DeleteObject(menuTitleFont);
-        DeleteObject(menuButtonFont);
+    static void releaseSurface(Surface& s) {
+        if (!s.dc) return;
+        SelectObject(s.dc, s.old);
+        DeleteObject(s.bm);
+        DeleteDC(s.dc);
+        s.dc = nullptr;
+    }
+
+    // The surface a blit names, drawn again if what it holds or its size changed
+    HDC surface(HDC like, const RenderCmd& c) {
+        int w = c.rect.right - c.rect.left, h = c.rect.bottom - c.rect.top;
+        if (w <= 0 || h <= 0) return nullptr;
+        Surface* s = nullptr;
+        for (Surface& k : surfaces) {
+            if (k.id == c.arg) s = &k;
+        }
+        if (!s) {
+            surfaces.emplace_back();
+            s = &surfaces.back();
+            s->id = c.arg;
+        }
+        if (!s->dc || s->key != c.color || s->w != w || s->h != h) {
+            releaseSurface(*s);
+            s->dc = CreateCompatibleDC(like);
+            s->bm = CreateCompatibleBitmap(like, w, h);
+            s->old = SelectObject(s->dc, s->bm);
+            s->key = c.color;
+            s->w = w;
+            s->h = h;
+            RenderCommands sc;
+            sceneSurface(c.arg, c.color, sc);
+            HDC dc = s->dc;
+            play(dc, sc, nullptr);
+        }
+        return s->dc;
     }
+
+    std::vector<Cached<HBRUSH>> brushes;
+    std::vector<Cached<HPEN>> pens;
+    std::vector<Cached<HFONT>> fonts;
+    std::vector<Surface> surfaces;
+    HDC blendDC = nullptr;
+    HBITMAP blendBM = nullptr;
+    HGDIOBJ blendOld = nullptr;
 };
 
 //
-// Render thread
+// Render frame: one frame's sampled state, its scene as render commands and its
+// off-screen bitmap. Built, rasterized and presented in turn, either by one window-thread
+// job a frame (--serial-render) or by one job a stage (FrameJobs below).
 //
-static void renderThreadFunc() {
-    using clock = std::chrono::steady_clock;
+struct alignas(CACHE_LINE) RenderFrame { // the stages work on neighbouring slots at once
     RenderSnapshot snap;
-    GDICache cache; // OPTIMIZED: reuse GDI objects
-
-    // Pre-reserve vectors to reduce allocations
-    snap.prev.reserve(100);
-    snap.curr.reserve(100);
-
-    while (running) {
-        auto frameStart = clock::now();
-
-        // Copy state under lock
-        {
-            std::lock_guard<std::mutex> lk(stateMtx);
-            snap.prev.clear();
-            snap.curr.clear();
-            snap.food.clear();
-
-            for (auto& p : prevSnake) snap.prev.push_back({ float(p.x), float(p.y) });
-            for (auto& p : currSnake) snap.curr.push_back({ float(p.x), float(p.y) });
-            for (auto& f : food) snap.food.push_back({ float(f.x), float(f.y) });
-
-            snap.score = score;
-            snap.gameOver = gameOver;
-            snap.gameWon = gameWon;
-            snap.paused = paused;
-            snap.started = started;
-            snap.state = gameState;
-            snap.menuSelection = menuSelection;
-            snap.pauseSelection = pauseSelection;
-            snap.gameOverSelection = gameOverSelection;
-            snap.settingSelection = settingSelection;
-            snap.fpsIndex = fpsIndex;
-            snap.cellSize = cellSize;
-            snap.gridWidth = gridWidth;
-            snap.gridHeight = gridHeight;
-            snap.fruitCount = fruitCount;
-            snap.speedIndex = speedIndex;
-            snap.mouseX = mouseX;
-            snap.mouseY = mouseY;
-            snap.tickTime = lastTickTime;
-            snap.tickDur = tickDuration;
-        }
+    SceneInput scene;
+    RenderCommands cmds;
+    RenderOptimizeStats stats;
+    bool cached = false;   // cmds came from the scene cache
+    RenderCommands drawn;  // what the bitmap holds, to diff the next frame in this slot against
+    HDC memDC = nullptr;
+    HBITMAP memBM = nullptr;
+    HBITMAP oldBM = nullptr;
+    int bmW = 0, bmH = 0;
+    FrameTimes times;
+};
 
-        // Compute interpolation alpha
-        float alpha = 1.0f;
-        {
-            auto now = clock::now();
-            auto elapsed = now - snap.tickTime;
-            float a = float(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()) /
-                float(std::chrono::duration_cast<std::chrono::microseconds>(snap.tickDur).count());
-            alpha = std::clamp(a, 0.0f, 1.0f); // FIXED: use clamp
-        }
+static bool serialRender = false;   // --serial-render: every stage in one window-thread job, for comparison
+static bool showFrameStats = false; // --frame-stats: frame rate, latency and commands in the corner
+static CachePadded<FrameLatency> frameLatency; // present job writes, build and telemetry jobs read
+static CachePadded<SceneCache> sceneCache;     // build stage only
+
+// Copy state under lock
+static void takeSnapshot(RenderSnapshot& snap) {
+    std::lock_guard<std::mutex> lk(stateMtx);
+    snap.prev.clear();
+    snap.curr.clear();
+    snap.food.clear();
+
+    for (auto& p : prevSnake) snap.prev.push_back({ float(p.x), float(p.y) });
+    for (auto& p : currSnake) snap.curr.push_back({ float(p.x), float(p.y) });
+    for (auto& f : food) snap.food.push_back({ float(f.x), float(f.y) });
+
+    snap.score = score;
+    snap.gameOver = gameOver;
+    snap.gameWon = gameWon;
+    snap.paused = paused;
+    snap.started = started;
+    snap.snakeHidden = snakeHidden;
+    snap.countdown = countdownValue;
+    snap.fade = screenFade;
+    snap.state = gameState;
+    snap.menuSelection = menuSelection;
+    snap.pauseSelection = pauseSelection;
+    snap.gameOverSelection = gameOverSelection;
+    snap.settingSelection = settingSelection;
+    snap.fpsIndex = fpsIndex;
+    snap.cellSize = cellSize;
+    snap.gridWidth = gridWidth;
+    snap.gridHeight = gridHeight;
+    snap.fruitCount = fruitCount;
+    snap.speedIndex = speedIndex;
+    uint32_t pos = mousePos.load(std::memory_order_relaxed);
+    snap.mouseX = LOWORD(pos);
+    snap.mouseY = HIWORD(pos);
+    snap.gridW = GRID_W;
+    snap.gridH = GRID_H;
+    snap.cell = CELL;
+    snap.targetFps = TARGET_FPS;
+    snap.tickTime = lastTickTime;
+    snap.tickDur = tickDuration;
+}
+
+// --frame-stats: what the last frames cost, how old they were when shown, and what this
+// one's commands came to
+static void addFrameStats(RenderFrame& f) {
+    wchar_t txt[256];
+    int n = swprintf(txt, 256, L"%ls %.0f fps, %.1f ms old: build %.1f + raster %.1f + present %.1f + queued %.1f | "
+        L"%u cmds of %u, %u state switches of %u%ls",
+        serialRender ? L"serial" : L"pipelined", frameLatency.fps(), frameLatency.latency(), frameLatency.stage(FRAME_BUILD),
+        frameLatency.stage(FRAME_RASTER), frameLatency.stage(FRAME_PRESENT), frameLatency.queued(), f.stats.merged,
+        f.stats.commands, f.stats.changesAfter, f.stats.changesBefore, f.cached ? L", cached" : L"");
+    if (n <= 0) return;
+    const RenderRect& c = f.scene.client;
+    f.cmds.textRun({ c.left, c.top + 4, c.right - 8, c.top + 24 }, txt, n, RGB(230, 230, 120), 16, RENDER_TEXT_RIGHT);
+}
+
+//
+// Build stage: sample the state, lay out what moves and turn the scene into commands
+//
+static void buildFrame(RenderFrame& f) {
+    using clock = std::chrono::steady_clock;
+    f.times.begin[FRAME_BUILD] = clock::now();
+    const RenderSnapshot& snap = f.snap;
+    takeSnapshot(f.snap);
+
+    // Compute interpolation alpha
+    float alpha = 1.0f;
+    {
+        auto now = clock::now();
+        auto elapsed = now - snap.tickTime;
+        float a = float(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()) /
+            float(std::chrono::duration_cast<std::chrono::microseconds>(snap.tickDur).count());
+        alpha = std::clamp(a, 0.0f, 1.0f); // FIXED: use clamp
+    }
+
+    SceneInput& in = f.scene;
+    RECT client;
+    GetClientRect(g_hwnd, &client);
+    in.client = { (int32_t)client.left, (int32_t)client.top, (int32_t)client.right, (int32_t)client.bottom };
+    in.screen = snap.state == MENU ? SCENE_MENU : snap.state == SETTINGS ? SCENE_SETTINGS : SCENE_PLAYING;
+    in.gridW = snap.gridW;
+    in.gridH = snap.gridH;
+    in.cell = snap.cell;
+    in.mouseX = snap.mouseX;
+    in.mouseY = snap.mouseY;
+    in.menuSelection = snap.menuSelection;
+    in.pauseSelection = snap.pauseSelection;
+    in.gameOverSelection = snap.gameOverSelection;
+    in.settingSelection = snap.settingSelection;
+    in.fps = fpsOptions[snap.fpsIndex];
+    in.cellSize = snap.cellSize;
+    in.gridWidth = snap.gridWidth;
+    in.gridHeight = snap.gridHeight;
+    in.fruitCount = snap.fruitCount;
+    in.speedName = speedNames[snap.speedIndex];
+    in.score = snap.score;
+    in.gameOver = snap.gameOver;
+    in.gameWon = snap.gameWon;
+    in.paused = snap.paused;
+    in.started = snap.started;
+    in.snakeHidden = snap.snakeHidden;
+    in.countdown = snap.countdown;
+    in.fade = snap.fade;
+
+    int cell = snap.cell;
+    in.fruits.clear();
+    for (auto& p : snap.food) {
+        in.fruits.push_back({ int(p.x * cell), int(p.y * cell), int(p.x * cell + cell), int(p.y * cell + cell) });
+    }
 
-        // Render
+    // Snake with interpolation
+    in.segments.clear();
+    size_t nSegments = snap.curr.size();
+    for (size_t i = 0; i < nSegments; ++i) {
+        FPt a = (i < snap.prev.size()) ? snap.prev[i] : snap.curr[i];
+        FPt b = snap.curr[i];
+        FPt ip = lerp(a, b, alpha);
+
+        in.segments.push_back({
+            int(ip.x * cell) + 1,
+            int(ip.y * cell) + 1,
+            int(ip.x * cell + cell) - 1,
+            int(ip.y * cell + cell) - 1
+        });
+    }
+
+    f.cached = sceneCache.build(in, f.cmds, f.stats);
+    if (showFrameStats) addFrameStats(f);
+}
+
+static void releaseFrameBitmap(RenderFrame& f) {
+    if (!f.memDC) return;
+    SelectObject(f.memDC, f.oldBM);
+    DeleteObject(f.memBM);
+    DeleteDC(f.memDC);
+    f.memDC = nullptr;
+    f.memBM = nullptr;
+    f.bmW = f.bmH = 0;
+}
+
+//
+// Raster stage: the commands into the frame's off-screen bitmap. The bitmap still holds
+// the last frame drawn in this slot, so only the area the commands changed is redrawn,
+// and nothing at all on a screen that stood still.
+//
+static void rasterFrame(RenderFrame& f, GDIBackend& gdi) {
+    int winW = f.scene.client.right - f.scene.client.left;
+    int winH = f.scene.client.bottom - f.scene.client.top;
+
+    // Double buffer, kept with the frame until the window changes size
+    if (!f.memDC || f.bmW != winW || f.bmH != winH) {
         HDC hdc = GetDC(g_hwnd);
-        if (hdc) {
-            RECT client;
-            GetClientRect(g_hwnd, &client);
-            int winW = client.right - client.left;
-            int winH = client.bottom - client.top;
-
-            // Double buffer
-            HDC memDC = CreateCompatibleDC(hdc);
-            HBITMAP memBM = CreateCompatibleBitmap(hdc, winW, winH);
-            HBITMAP oldBM = (HBITMAP)SelectObject(memDC, memBM);
-
-            // Background
-            FillRect(memDC, &client, cache.bgBrush);
-
-            // Render menu if in menu state
-            if (snap.state == MENU) {
-                // Title - scale font with window
-                int titleFontSize = max(32, min(64, (GRID_W * CELL) / 8));
-                HFONT titleFont = CreateFontW(titleFontSize, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
-                    DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                    DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                HFONT oldTitle = (HFONT)SelectObject(memDC, titleFont);
-                SetBkMode(memDC, TRANSPARENT);
-                SetTextColor(memDC, RGB(90, 220, 90));
-                int titleY = max(60, GRID_H * CELL / 6);
-                RECT titleRect = { 0, titleY, GRID_W * CELL, titleY + titleFontSize + 20 };
-                DrawTextW(memDC, L"SNAKE", -1, &titleRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-                SelectObject(memDC, oldTitle);
-                DeleteObject(titleFont);
-
-                // Menu buttons - scale font
-                int buttonFontSize = max(18, min(28, (GRID_W * CELL) / 16));
-                HFONT buttonFont = CreateFontW(buttonFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                    DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                    DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                HFONT oldButton = (HFONT)SelectObject(memDC, buttonFont);
-
-                // Calculate button positions - scale with grid size
-                int buttonWidth = max(140, min(220, GRID_W * CELL - 100));
-                int buttonHeight = max(35, min(55, GRID_H * CELL / 9));
-                int centerX = (GRID_W * CELL) / 2;
-                int startY = max(140, (GRID_H * CELL - (3 * buttonHeight + 2 * 65)) / 2);
-                int buttonSpacing = max(55, buttonHeight + 15);
-
-                // Play button
-                RECT playRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
-                bool playHover = (snap.mouseX >= playRect.left && snap.mouseX <= playRect.right &&
-                    snap.mouseY >= playRect.top && snap.mouseY <= playRect.bottom);
-                HBRUSH playBrush = CreateSolidBrush((snap.menuSelection == 0 || playHover) ? RGB(50, 200, 50) : RGB(40, 170, 40));
-                FillRect(memDC, &playRect, playBrush);
-                DeleteObject(playBrush);
-                HPEN buttonPen = CreatePen(PS_SOLID, (snap.menuSelection == 0 || playHover) ? 3 : 2, RGB(90, 220, 90));
-                HPEN oldButtonPen = (HPEN)SelectObject(memDC, buttonPen);
-                SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                Rectangle(memDC, playRect.left, playRect.top, playRect.right, playRect.bottom);
-                SelectObject(memDC, oldButtonPen);
-                DeleteObject(buttonPen);
-                SetTextColor(memDC, RGB(220, 220, 220));
-                DrawTextW(memDC, L"Play", -1, &playRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                // Settings button
-                startY += buttonSpacing;
-                RECT settingsRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
-                bool settingsHover = (snap.mouseX >= settingsRect.left && snap.mouseX <= settingsRect.right &&
-                    snap.mouseY >= settingsRect.top && snap.mouseY <= settingsRect.bottom);
-                HBRUSH settingsBrush = CreateSolidBrush((snap.menuSelection == 1 || settingsHover) ? RGB(50, 200, 50) : RGB(40, 170, 40));
-                FillRect(memDC, &settingsRect, settingsBrush);
-                DeleteObject(settingsBrush);
-                buttonPen = CreatePen(PS_SOLID, (snap.menuSelection == 1 || settingsHover) ? 3 : 2, RGB(90, 220, 90));
-                oldButtonPen = (HPEN)SelectObject(memDC, buttonPen);
-                SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                Rectangle(memDC, settingsRect.left, settingsRect.top, settingsRect.right, settingsRect.bottom);
-                SelectObject(memDC, oldButtonPen);
-                DeleteObject(buttonPen);
-                SetTextColor(memDC, RGB(220, 220, 220));
-                DrawTextW(memDC, L"Settings", -1, &settingsRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                // Exit button
-                startY += buttonSpacing;
-                RECT exitRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
-                bool exitHover = (snap.mouseX >= exitRect.left && snap.mouseX <= exitRect.right &&
-                    snap.mouseY >= exitRect.top && snap.mouseY <= exitRect.bottom);
-                HBRUSH exitBrush = CreateSolidBrush((snap.menuSelection == 2 || exitHover) ? RGB(200, 50, 50) : RGB(170, 40, 40));
-                FillRect(memDC, &exitRect, exitBrush);
-                DeleteObject(exitBrush);
-                buttonPen = CreatePen(PS_SOLID, (snap.menuSelection == 2 || exitHover) ? 3 : 2, RGB(220, 90, 90));
-                oldButtonPen = (HPEN)SelectObject(memDC, buttonPen);
-                SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                Rectangle(memDC, exitRect.left, exitRect.top, exitRect.right, exitRect.bottom);
-                SelectObject(memDC, oldButtonPen);
-                DeleteObject(buttonPen);
-                SetTextColor(memDC, RGB(220, 220, 220));
-                DrawTextW(memDC, L"Exit", -1, &exitRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                SelectObject(memDC, oldButton);
-                DeleteObject(buttonFont);
-            }
-            // Render settings screen
-            else if (snap.state == SETTINGS) {
-                // Title - scale font
-                int titleFontSize = max(32, min(64, (GRID_W * CELL) / 8));
-                HFONT titleFont = CreateFontW(titleFontSize, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
-                    DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                    DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                HFONT oldTitle = (HFONT)SelectObject(memDC, titleFont);
-                SetBkMode(memDC, TRANSPARENT);
-                SetTextColor(memDC, RGB(90, 220, 90));
-                RECT titleRect = { 0, 40, GRID_W * CELL, 100 };
-                DrawTextW(memDC, L"SETTINGS", -1, &titleRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-                SelectObject(memDC, oldTitle);
-                DeleteObject(titleFont);
-
-                int settingsFontSize = max(16, min(22, (GRID_W * CELL) / 20));
-                HFONT settingsFont = CreateFontW(settingsFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                    DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                    DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                HFONT oldSettings = (HFONT)SelectObject(memDC, settingsFont);
-
-                int leftCol = max(30, GRID_W * CELL / 10);
-                int rightCol = max(200, GRID_W * CELL / 2);
-                int startY = max(120, GRID_H * CELL / 4);
-                int rowHeight = max(35, min(50, GRID_H * CELL / 10));
-                int arrowLeftX = rightCol - 30;
-                int arrowRightX = rightCol + 50;
-                int arrowWidth = 20;
-
-                // FPS
-                SetTextColor(memDC, snap.settingSelection == 0 ? RGB(90, 220, 90) : RGB(180, 180, 180));
-                TextOutW(memDC, leftCol, startY, L"FPS:", 4);
-
-                // Left arrow with hover
-                bool fpsLeftHover = (snap.mouseX >= arrowLeftX && snap.mouseX <= arrowLeftX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, fpsLeftHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowLeftX, startY, L"<", 1);
-
-                // Value
-                std::wstring fpsVal = std::to_wstring(fpsOptions[snap.fpsIndex]);
-                SetTextColor(memDC, snap.settingSelection == 0 ? RGB(220, 220, 220) : RGB(150, 150, 150));
-                TextOutW(memDC, rightCol, startY, fpsVal.c_str(), (int)fpsVal.size());
-
-                // Right arrow with hover
-                bool fpsRightHover = (snap.mouseX >= arrowRightX && snap.mouseX <= arrowRightX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, fpsRightHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowRightX, startY, L">", 1);
-
-                // Cell Size
-                startY += rowHeight;
-                SetTextColor(memDC, snap.settingSelection == 1 ? RGB(90, 220, 90) : RGB(180, 180, 180));
-                TextOutW(memDC, leftCol, startY, L"Cell Size:", 10);
-
-                // Left arrow with hover
-                bool cellLeftHover = (snap.mouseX >= arrowLeftX && snap.mouseX <= arrowLeftX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, cellLeftHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowLeftX, startY, L"<", 1);
-
-                // Value
-                std::wstring cellVal = std::to_wstring(snap.cellSize);
-                SetTextColor(memDC, snap.settingSelection == 1 ? RGB(220, 220, 220) : RGB(150, 150, 150));
-                TextOutW(memDC, rightCol, startY, cellVal.c_str(), (int)cellVal.size());
-
-                // Right arrow with hover
-                bool cellRightHover = (snap.mouseX >= arrowRightX && snap.mouseX <= arrowRightX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, cellRightHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowRightX, startY, L">", 1);
-
-                // Grid Width
-                startY += rowHeight;
-                SetTextColor(memDC, snap.settingSelection == 2 ? RGB(90, 220, 90) : RGB(180, 180, 180));
-                TextOutW(memDC, leftCol, startY, L"Grid Width:", 11);
-
-                // Left arrow with hover
-                bool widthLeftHover = (snap.mouseX >= arrowLeftX && snap.mouseX <= arrowLeftX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, widthLeftHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowLeftX, startY, L"<", 1);
-
-                // Value
-                std::wstring widthVal = std::to_wstring(snap.gridWidth);
-                SetTextColor(memDC, snap.settingSelection == 2 ? RGB(220, 220, 220) : RGB(150, 150, 150));
-                TextOutW(memDC, rightCol, startY, widthVal.c_str(), (int)widthVal.size());
-
-                // Right arrow with hover
-                bool widthRightHover = (snap.mouseX >= arrowRightX && snap.mouseX <= arrowRightX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, widthRightHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowRightX, startY, L">", 1);
-
-                // Grid Height
-                startY += rowHeight;
-                SetTextColor(memDC, snap.settingSelection == 3 ? RGB(90, 220, 90) : RGB(180, 180, 180));
-                TextOutW(memDC, leftCol, startY, L"Grid Height:", 12);
-
-                // Left arrow with hover
-                bool heightLeftHover = (snap.mouseX >= arrowLeftX && snap.mouseX <= arrowLeftX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, heightLeftHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowLeftX, startY, L"<", 1);
-
-                // Value
-                std::wstring heightVal = std::to_wstring(snap.gridHeight);
-                SetTextColor(memDC, snap.settingSelection == 3 ? RGB(220, 220, 220) : RGB(150, 150, 150));
-                TextOutW(memDC, rightCol, startY, heightVal.c_str(), (int)heightVal.size());
-
-                // Right arrow with hover
-                bool heightRightHover = (snap.mouseX >= arrowRightX && snap.mouseX <= arrowRightX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, heightRightHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowRightX, startY, L">", 1);
-
-                // Game Speed
-                startY += rowHeight;
-                SetTextColor(memDC, snap.settingSelection == 4 ? RGB(90, 220, 90) : RGB(180, 180, 180));
-                TextOutW(memDC, leftCol, startY, L"Speed:", 6);
-
-                // Left arrow with hover
-                bool speedLeftHover = (snap.mouseX >= arrowLeftX && snap.mouseX <= arrowLeftX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, speedLeftHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowLeftX, startY, L"<", 1);
-
-                // Value
-                SetTextColor(memDC, snap.settingSelection == 4 ? RGB(220, 220, 220) : RGB(150, 150, 150));
-                TextOutW(memDC, rightCol, startY, speedNames[snap.speedIndex], (int)wcslen(speedNames[snap.speedIndex]));
-
-                // Right arrow with hover
-                bool speedRightHover = (snap.mouseX >= arrowRightX && snap.mouseX <= arrowRightX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, speedRightHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowRightX, startY, L">", 1);
-
-                // Fruit Count
-                startY += rowHeight;
-                SetTextColor(memDC, snap.settingSelection == 5 ? RGB(90, 220, 90) : RGB(180, 180, 180));
-                TextOutW(memDC, leftCol, startY, L"Fruit Count:", 12);
-
-                // Left arrow with hover
-                bool fruitLeftHover = (snap.mouseX >= arrowLeftX && snap.mouseX <= arrowLeftX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, fruitLeftHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowLeftX, startY, L"<", 1);
-
-                // Value
-                std::wstring fruitVal = std::to_wstring(snap.fruitCount);
-                SetTextColor(memDC, snap.settingSelection == 5 ? RGB(220, 220, 220) : RGB(150, 150, 150));
-                TextOutW(memDC, rightCol, startY, fruitVal.c_str(), (int)fruitVal.size());
-
-                // Right arrow with hover
-                bool fruitRightHover = (snap.mouseX >= arrowRightX && snap.mouseX <= arrowRightX + arrowWidth &&
-                    snap.mouseY >= startY && snap.mouseY <= startY + rowHeight);
-                SetTextColor(memDC, fruitRightHover ? RGB(120, 255, 120) : RGB(90, 220, 90));
-                TextOutW(memDC, arrowRightX, startY, L">", 1);
-
-                // Back button
-                startY += rowHeight + 20;
-                SetTextColor(memDC, snap.settingSelection == 6 ? RGB(220, 90, 90) : RGB(180, 180, 180));
-                RECT backRect = { 0, startY, GRID_W * CELL, startY + 30 };
-                DrawTextW(memDC, L"< Back to Menu", -1, &backRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                SelectObject(memDC, oldSettings);
-                DeleteObject(settingsFont);
-            }
-            // Render game if playing
-            else {
-                // Grid lines
-                HPEN oldPen = (HPEN)SelectObject(memDC, cache.gridPen);
-                for (int x = 0; x <= GRID_W * CELL; x += CELL) {
-                    MoveToEx(memDC, x, 0, NULL);
-                    LineTo(memDC, x, GRID_H * CELL);
-                }
-                for (int y = 0; y <= GRID_H * CELL; y += CELL) {
-                    MoveToEx(memDC, 0, y, NULL);
-                    LineTo(memDC, GRID_W * CELL, y);
-                }
-                SelectObject(memDC, oldPen);
-
-                // Food - draw all food items
-                HBRUSH foodBrush = CreateSolidBrush(RGB(255, 70, 70));
-                for (auto& f : snap.food) {
-                    RECT fr = {
-                        int(f.x * CELL),
-                        int(f.y * CELL),
-                        int(f.x * CELL + CELL),
-                        int(f.y * CELL + CELL)
-                    };
-                    FillRect(memDC, &fr, foodBrush);
-                }
-                DeleteObject(foodBrush);
-
-                // Snake with interpolation
-                size_t nSegments = snap.curr.size();
-                for (size_t i = 0; i < nSegments; ++i) {
-                    FPt a = (i < snap.prev.size()) ? snap.prev[i] : snap.curr[i];
-                    FPt b = snap.curr[i];
-                    FPt ip = lerp(a, b, alpha);
-
-                    RECT sr = {
-                        int(ip.x * CELL) + 1,
-                        int(ip.y * CELL) + 1,
-                        int(ip.x * CELL + CELL) - 1,
-                        int(ip.y * CELL + CELL) - 1
-                    };
-
-                    if (i == 0) {
-                        // Head
-                        FillRect(memDC, &sr, cache.headBrush);
-                        oldPen = (HPEN)SelectObject(memDC, cache.headPen);
-                        SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                        Rectangle(memDC, sr.left, sr.top, sr.right, sr.bottom);
-                        SelectObject(memDC, oldPen);
-                    }
-                    else {
-                        // Body
-                        HBRUSH bodyBrush = (i % 2 == 0) ? cache.bodyBrush1 : cache.bodyBrush2;
-                        FillRect(memDC, &sr, bodyBrush);
-                        oldPen = (HPEN)SelectObject(memDC, cache.bodyPen);
-                        SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                        Rectangle(memDC, sr.left, sr.top, sr.right, sr.bottom);
-                        SelectObject(memDC, oldPen);
-                    }
-                }
+        if (!hdc) return;
+        releaseFrameBitmap(f);
+        f.memDC = CreateCompatibleDC(hdc);
+        f.memBM = CreateCompatibleBitmap(hdc, winW, winH);
+        f.oldBM = (HBITMAP)SelectObject(f.memDC, f.memBM);
+        f.bmW = winW;
+        f.bmH = winH;
+        ReleaseDC(g_hwnd, hdc);
+        f.drawn.clear();
+    }
 
-                // Score text
-                std::wstring scoreTxt = L"Score: " + std::to_wstring(snap.score);
-                if (snap.gameOver) scoreTxt += L"    (Press R to restart)";
-
-                SetBkMode(memDC, TRANSPARENT);
-                HFONT oldf = (HFONT)SelectObject(memDC, cache.scoreFont);
-
-                // Shadow
-                SetTextColor(memDC, RGB(30, 30, 30));
-                TextOutW(memDC, 13, GRID_H * CELL + 9, scoreTxt.c_str(), (int)scoreTxt.size());
-                // Main text
-                SetTextColor(memDC, RGB(230, 230, 230));
-                TextOutW(memDC, 12, GRID_H * CELL + 8, scoreTxt.c_str(), (int)scoreTxt.size());
-
-                SelectObject(memDC, oldf);
-
-                // Paused overlay (semi-transparent)
-                if (snap.paused && snap.started) {
-                    // Fast semi-transparent overlay
-                    RECT rr = { 0, 0, GRID_W * CELL, GRID_H * CELL };
-                    HBRUSH darkBrush = CreateSolidBrush(RGB(0, 0, 0));
-                    // Draw multiple thin overlays for transparency effect
-                    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 100, 0 };
-                    for (int i = 0; i < 3; i++) {
-                        FillRect(memDC, &rr, darkBrush);
-                    }
-                    DeleteObject(darkBrush);
-
-                    int pauseFontSize = max(32, min(48, (GRID_W * CELL) / 10));
-                    HFONT pauseFont = CreateFontW(pauseFontSize, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
-                        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                        DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                    HFONT oldPause = (HFONT)SelectObject(memDC, pauseFont);
-                    SetTextColor(memDC, RGB(220, 220, 220));
-                    int pauseY = max(60, GRID_H * CELL / 6);
-                    RECT tr = { 0, pauseY, GRID_W * CELL, pauseY + pauseFontSize + 20 };
-                    DrawTextW(memDC, L"PAUSED", -1, &tr, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-                    SelectObject(memDC, oldPause);
-                    DeleteObject(pauseFont);
-
-                    // Pause menu buttons
-                    int buttonFontSize = max(18, min(24, (GRID_W * CELL) / 18));
-                    HFONT buttonFont = CreateFontW(buttonFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                        DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                    HFONT oldButton = (HFONT)SelectObject(memDC, buttonFont);
-
-                    int buttonWidth = max(140, min(200, GRID_W * CELL - 100));
-                    int buttonHeight = max(35, min(50, GRID_H * CELL / 9));
-                    int centerX = (GRID_W * CELL) / 2;
-                    int startY = max(140, pauseY + pauseFontSize + 60);
-                    int buttonSpacing = max(50, buttonHeight + 15);
-
-                    // Resume button
-                    RECT resumeRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
-                    HBRUSH resumeBrush = CreateSolidBrush(snap.pauseSelection == 0 ? RGB(50, 200, 50) : RGB(40, 170, 40));
-                    FillRect(memDC, &resumeRect, resumeBrush);
-                    DeleteObject(resumeBrush);
-                    HPEN buttonPen = CreatePen(PS_SOLID, snap.pauseSelection == 0 ? 3 : 2, RGB(90, 220, 90));
-                    HPEN oldPen = (HPEN)SelectObject(memDC, buttonPen);
-                    SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                    Rectangle(memDC, resumeRect.left, resumeRect.top, resumeRect.right, resumeRect.bottom);
-                    SelectObject(memDC, oldPen);
-                    DeleteObject(buttonPen);
-                    SetTextColor(memDC, RGB(220, 220, 220));
-                    DrawTextW(memDC, L"Resume", -1, &resumeRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                    // Menu button
-                    startY += buttonSpacing;
-                    RECT menuRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
-                    HBRUSH menuBrush = CreateSolidBrush(snap.pauseSelection == 1 ? RGB(200, 50, 50) : RGB(170, 40, 40));
-                    FillRect(memDC, &menuRect, menuBrush);
-                    DeleteObject(menuBrush);
-                    buttonPen = CreatePen(PS_SOLID, snap.pauseSelection == 1 ? 3 : 2, RGB(220, 90, 90));
-                    oldPen = (HPEN)SelectObject(memDC, buttonPen);
-                    SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                    Rectangle(memDC, menuRect.left, menuRect.top, menuRect.right, menuRect.bottom);
-                    SelectObject(memDC, oldPen);
-                    DeleteObject(buttonPen);
-                    SetTextColor(memDC, RGB(220, 220, 220));
-                    DrawTextW(memDC, L"Main Menu", -1, &menuRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                    SelectObject(memDC, oldButton);
-                    DeleteObject(buttonFont);
-                }
+    if (f.drawn.cmds.empty()) gdi.play(f.memDC, f.cmds, nullptr);
+    else {
+        RenderRect dirty;
+        if (renderDiff(f.drawn, f.cmds, dirty)) gdi.play(f.memDC, f.cmds, &dirty);
+    }
+    std::swap(f.drawn, f.cmds); // the next build refills cmds
+    GdiFlush(); // GDI batches calls per thread; the bitmap is read next by the present job
+}
 
-                // Not started overlay (semi-transparent)
-                if (!snap.started) {
-                    // Fast semi-transparent overlay
-                    RECT rr = { 0, 0, GRID_W * CELL, GRID_H * CELL };
-                    HBRUSH darkBrush = CreateSolidBrush(RGB(0, 0, 0));
-                    // Draw overlay twice for lighter darkness
-                    for (int i = 0; i < 2; i++) {
-                        FillRect(memDC, &rr, darkBrush);
-                    }
-                    DeleteObject(darkBrush);
-
-                    int startFontSize = max(24, min(36, (GRID_W * CELL) / 12));
-                    HFONT startFont = CreateFontW(startFontSize, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
-                        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                        DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                    HFONT oldStart = (HFONT)SelectObject(memDC, startFont);
-                    SetTextColor(memDC, RGB(220, 220, 220));
-                    RECT tr = { 0, GRID_H * CELL / 2 - 60, GRID_W * CELL, GRID_H * CELL / 2 };
-                    DrawTextW(memDC, L"SNAKE", -1, &tr, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                    int instructionFontSize = max(14, min(20, (GRID_W * CELL) / 22));
-                    HFONT smallFont = CreateFontW(instructionFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                        DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                    SelectObject(memDC, smallFont);
-                    RECT tr2 = { 0, GRID_H * CELL / 2 + 10, GRID_W * CELL, GRID_H * CELL / 2 + 50 };
-                    DrawTextW(memDC, L"Press any arrow key to start", -1, &tr2, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                    SelectObject(memDC, oldStart);
-                    DeleteObject(startFont);
-                    DeleteObject(smallFont);
-                }
+//
+// Present stage: blit to screen
+//
+static void presentFrame(RenderFrame& f) {
+    if (!f.memDC) return;
+    HDC hdc = GetDC(g_hwnd);
+    if (hdc) {
+        BitBlt(hdc, 0, 0, f.bmW, f.bmH, f.memDC, 0, 0, SRCCOPY);
+        ReleaseDC(g_hwnd, hdc);
+    }
+}
 
-                // Game over overlay
-                if (snap.gameOver) {
-                    RECT rr = { 0, 0, GRID_W * CELL, GRID_H * CELL };
-                    // Semi-transparent effect (simple overlay)
-                    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 128, 0 };
-                    HBRUSH tempOver = CreateSolidBrush(RGB(0, 0, 0));
-                    FillRect(memDC, &rr, tempOver);
-                    DeleteObject(tempOver);
-
-                    int gameOverFontSize = max(32, min(48, (GRID_W * CELL) / 10));
-                    HFONT gameOverFont = CreateFontW(gameOverFontSize, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
-                        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                        DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                    HFONT oldg = (HFONT)SelectObject(memDC, gameOverFont);
-                    SetTextColor(memDC, RGB(220, 220, 220));
-                    int titleY = max(40, GRID_H * CELL / 8);
-                    RECT tr = { 0, titleY, GRID_W * CELL, titleY + gameOverFontSize + 20 };
-                    DrawTextW(memDC, L"GAME OVER", -1, &tr, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                    // Show score
-                    int scoreFontSize = max(18, min(24, (GRID_W * CELL) / 18));
-                    HFONT scoreTextFont = CreateFontW(scoreFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                        DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                    SelectObject(memDC, scoreTextFont);
-                    std::wstring scoreTxt = L"Score: " + std::to_wstring(snap.score);
-                    int scoreY = titleY + gameOverFontSize + 40;
-                    RECT scoreRect = { 0, scoreY, GRID_W * CELL, scoreY + 30 };
-                    DrawTextW(memDC, scoreTxt.c_str(), -1, &scoreRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-                    DeleteObject(scoreTextFont);
-
-                    // Game over menu buttons
-                    int buttonFontSize = max(18, min(24, (GRID_W * CELL) / 18));
-                    HFONT buttonFont = CreateFontW(buttonFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                        DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                    SelectObject(memDC, buttonFont);
-
-                    int buttonWidth = max(140, min(200, GRID_W * CELL - 100));
-                    int buttonHeight = max(35, min(50, GRID_H * CELL / 9));
-                    int centerX = (GRID_W * CELL) / 2;
-                    int startY = max(140, scoreY + 50);
-                    int buttonSpacing = max(50, buttonHeight + 15);
-
-                    // Restart button
-                    RECT restartRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
-                    HBRUSH restartBrush = CreateSolidBrush(snap.gameOverSelection == 0 ? RGB(50, 200, 50) : RGB(40, 170, 40));
-                    FillRect(memDC, &restartRect, restartBrush);
-                    DeleteObject(restartBrush);
-                    HPEN buttonPen = CreatePen(PS_SOLID, snap.gameOverSelection == 0 ? 3 : 2, RGB(90, 220, 90));
-                    HPEN oldPen = (HPEN)SelectObject(memDC, buttonPen);
-                    SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                    Rectangle(memDC, restartRect.left, restartRect.top, restartRect.right, restartRect.bottom);
-                    SelectObject(memDC, oldPen);
-                    DeleteObject(buttonPen);
-                    SetTextColor(memDC, RGB(220, 220, 220));
-                    DrawTextW(memDC, L"Restart", -1, &restartRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                    // Menu button
-                    startY += buttonSpacing;
-                    RECT menuRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
-                    HBRUSH menuBrush = CreateSolidBrush(snap.gameOverSelection == 1 ? RGB(200, 50, 50) : RGB(170, 40, 40));
-                    FillRect(memDC, &menuRect, menuBrush);
-                    DeleteObject(menuBrush);
-                    buttonPen = CreatePen(PS_SOLID, snap.gameOverSelection == 1 ? 3 : 2, RGB(220, 90, 90));
-                    oldPen = (HPEN)SelectObject(memDC, buttonPen);
-                    SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                    Rectangle(memDC, menuRect.left, menuRect.top, menuRect.right, menuRect.bottom);
-                    SelectObject(memDC, oldPen);
-                    DeleteObject(buttonPen);
-                    SetTextColor(memDC, RGB(220, 220, 220));
-                    DrawTextW(memDC, L"Main Menu", -1, &menuRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                    SelectObject(memDC, oldg);
-                    DeleteObject(gameOverFont);
-                    DeleteObject(buttonFont);
-                }
+// Frame pacing - the next slot on an fps schedule, without bursts to catch up
+static std::chrono::steady_clock::time_point frameTime(std::chrono::steady_clock::time_point& next, int fps) {
+    auto now = std::chrono::steady_clock::now();
+    auto period = std::chrono::microseconds(1000000 / fps);
+    if (next < now - period) next = now;
+    auto at = next;
+    next += period;
+    return at;
+}
 
-                // Win overlay
-                if (snap.gameWon) {
-                    RECT rr = { 0, 0, GRID_W * CELL, GRID_H * CELL };
-                    HBRUSH tempOver = CreateSolidBrush(RGB(0, 0, 0));
-                    FillRect(memDC, &rr, tempOver);
-                    DeleteObject(tempOver);
-
-                    int winFontSize = max(32, min(48, (GRID_W * CELL) / 10));
-                    HFONT winFont = CreateFontW(winFontSize, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
-                        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                        DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                    HFONT oldg = (HFONT)SelectObject(memDC, winFont);
-                    SetTextColor(memDC, RGB(90, 220, 90));
-                    int titleY = max(40, GRID_H * CELL / 8);
-                    RECT tr = { 0, titleY, GRID_W * CELL, titleY + winFontSize + 20 };
-                    DrawTextW(memDC, L"YOU WIN!", -1, &tr, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                    // Show score
-                    int scoreFontSize = max(18, min(24, (GRID_W * CELL) / 18));
-                    HFONT scoreTextFont = CreateFontW(scoreFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                        DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                    SelectObject(memDC, scoreTextFont);
-                    std::wstring scoreTxt = L"Perfect Score: " + std::to_wstring(snap.score);
-                    int scoreY = titleY + winFontSize + 40;
-                    RECT scoreRect = { 0, scoreY, GRID_W * CELL, scoreY + 30 };
-                    SetTextColor(memDC, RGB(220, 220, 220));
-                    DrawTextW(memDC, scoreTxt.c_str(), -1, &scoreRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-                    DeleteObject(scoreTextFont);
-
-                    // Win menu buttons
-                    int buttonFontSize = max(18, min(24, (GRID_W * CELL) / 18));
-                    HFONT buttonFont = CreateFontW(buttonFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                        DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-                    SelectObject(memDC, buttonFont);
-
-                    int buttonWidth = max(140, min(200, GRID_W * CELL - 100));
-                    int buttonHeight = max(35, min(50, GRID_H * CELL / 9));
-                    int centerX = (GRID_W * CELL) / 2;
-                    int startY = max(140, scoreY + 50);
-                    int buttonSpacing = max(50, buttonHeight + 15);
-
-                    // Play Again button
-                    RECT restartRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
-                    HBRUSH restartBrush = CreateSolidBrush(snap.gameOverSelection == 0 ? RGB(50, 200, 50) : RGB(40, 170, 40));
-                    FillRect(memDC, &restartRect, restartBrush);
-                    DeleteObject(restartBrush);
-                    HPEN buttonPen = CreatePen(PS_SOLID, snap.gameOverSelection == 0 ? 3 : 2, RGB(90, 220, 90));
-                    HPEN oldPen = (HPEN)SelectObject(memDC, buttonPen);
-                    SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                    Rectangle(memDC, restartRect.left, restartRect.top, restartRect.right, restartRect.bottom);
-                    SelectObject(memDC, oldPen);
-                    DeleteObject(buttonPen);
-                    SetTextColor(memDC, RGB(220, 220, 220));
-                    DrawTextW(memDC, L"Play Again", -1, &restartRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                    // Menu button
-                    startY += buttonSpacing;
-                    RECT menuRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
-                    HBRUSH menuBrush = CreateSolidBrush(snap.gameOverSelection == 1 ? RGB(200, 50, 50) : RGB(170, 40, 40));
-                    FillRect(memDC, &menuRect, menuBrush);
-                    DeleteObject(menuBrush);
-                    buttonPen = CreatePen(PS_SOLID, snap.gameOverSelection == 1 ? 3 : 2, RGB(220, 90, 90));
-                    oldPen = (HPEN)SelectObject(memDC, buttonPen);
-                    SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                    Rectangle(memDC, menuRect.left, menuRect.top, menuRect.right, menuRect.bottom);
-                    SelectObject(memDC, oldPen);
-                    DeleteObject(buttonPen);
-                    SetTextColor(memDC, RGB(220, 220, 220));
-                    DrawTextW(memDC, L"Main Menu", -1, &menuRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-                    SelectObject(memDC, oldg);
-                    DeleteObject(winFont);
-                    DeleteObject(buttonFont);
-                }
-            } // end of PLAYING state rendering
+//
+// Render jobs. Frame n is built in slot n % FRAME_SLOTS once the frame that last used
+// the slot is on screen, so at most FRAME_SLOTS frames are in flight; it rasters after
+// frame n-1 has (the backend's caches are not shared) and is presented on the window
+// thread after frame n-1 was. Each build adds the stages of its frame and the next
+// build, so frame N+1 is built while frame N rasterizes and frame N-1 is presented.
+//
+static constexpr int FRAME_SLOTS = 3;
+
+struct FrameJobs {
+    alignas(CACHE_LINE) GDIBackend gdi; // raster jobs: brushes, pens, fonts and surfaces kept across frames
+    RenderFrame frames[FRAME_SLOTS];
+    alignas(CACHE_LINE) JobId presented[FRAME_SLOTS]; // build jobs from here on; the last present of each slot
+    JobId lastRaster, lastPresent;
+    uint64_t frame = 0;
+    std::chrono::steady_clock::time_point next;
+    int fps = 240; // TARGET_FPS as the last frame's snapshot saw it
+};
+
+static void scheduleFrame(FrameJobs& fj);
 
-            // Blit to screen
-            BitBlt(hdc, 0, 0, winW, winH, memDC, 0, 0, SRCCOPY);
+static void renderFrameJob(FrameJobs& fj) {
+    using clock = std::chrono::steady_clock;
+    if (!running) return;
+
+    // --serial-render: the whole frame here, on the window thread
+    if (serialRender) {
+        RenderFrame& f = fj.frames[0];
+        buildFrame(f);
+        fj.fps = f.snap.targetFps;
+        f.times.end[FRAME_BUILD] = f.times.begin[FRAME_RASTER] = clock::now();
+        rasterFrame(f, fj.gdi);
+        f.times.end[FRAME_RASTER] = f.times.begin[FRAME_PRESENT] = clock::now();
+        presentFrame(f);
+        f.times.end[FRAME_PRESENT] = clock::now();
+        frameLatency.record(f.times);
+        scheduleFrame(fj);
+        return;
+    }
+
+    int s = (int)(fj.frame++ % FRAME_SLOTS);
+    RenderFrame* f = &fj.frames[s];
+    buildFrame(*f);
+    fj.fps = f->snap.targetFps;
+    f->times.end[FRAME_BUILD] = clock::now();
+
+    FrameJobs* p = &fj;
+    fj.lastRaster = jobs->add([f, p] {
+        f->times.begin[FRAME_RASTER] = clock::now();
+        rasterFrame(*f, p->gdi);
+        f->times.end[FRAME_RASTER] = clock::now();
+    }, { fj.lastRaster });
+    fj.lastPresent = fj.presented[s] = jobs->add([f] {
+        f->times.begin[FRAME_PRESENT] = clock::now();
+        presentFrame(*f);
+        f->times.end[FRAME_PRESENT] = clock::now();
+        frameLatency.record(f->times);
+    }, { fj.lastRaster, fj.lastPresent }, JOB_MAIN);
+    scheduleFrame(fj);
+}
+
+static void scheduleFrame(FrameJobs& fj) {
+    if (!running) return;
+    FrameJobs* p = &fj;
+    JobId slotFree = serialRender ? JobId{} : fj.presented[fj.frame % FRAME_SLOTS];
+    jobs->addAt(frameTime(fj.next, fj.fps), [p] { renderFrameJob(*p); }, { slotFree }, serialRender ? JOB_MAIN : JOB_ANY);
+}
 
-            // Cleanup
-            SelectObject(memDC, oldBM);
-            DeleteObject(memBM);
-            DeleteDC(memDC);
-            ReleaseDC(g_hwnd, hdc);
+//
+// Autosave (--autosave <file>): the settings are loaded at startup and written back by a
+// job every two seconds when they have changed, and once more on the way out
+//
+struct SavedSettings {
+    int fpsIndex, cellSize, gridWidth, gridHeight, fruitCount, speedIndex;
+    bool operator==(const SavedSettings& o) const {
+        return fpsIndex == o.fpsIndex && cellSize == o.cellSize && gridWidth == o.gridWidth && gridHeight == o.gridHeight &&
+            fruitCount == o.fruitCount && speedIndex == o.speedIndex;
+    }
+};
+
+static std::string autosavePath;
+static SavedSettings autosaved; // what the file holds; autosave job only
+
+static SavedSettings currentSettingsLocked() {
+    return { fpsIndex, cellSize, gridWidth, gridHeight, fruitCount, speedIndex };
+}
+
+static void loadSettings() {
+    FILE* f = fopen(autosavePath.c_str(), "r");
+    if (f) {
+        char key[32];
+        int v;
+        std::lock_guard<std::mutex> lk(stateMtx);
+        while (fscanf(f, "%31s %d", key, &v) == 2) {
+            if (!strcmp(key, "fps_index")) fpsIndex = std::clamp(v, 0, 3);
+            else if (!strcmp(key, "cell_size")) cellSize = std::clamp(v, 60, 120);
+            else if (!strcmp(key, "grid_width")) gridWidth = std::clamp(v, 5, 40);
+            else if (!strcmp(key, "grid_height")) gridHeight = std::clamp(v, 5, 40);
+            else if (!strcmp(key, "fruit_count")) fruitCount = std::clamp(v, 1, 15);
+            else if (!strcmp(key, "speed_index")) speedIndex = std::clamp(v, 0, 2);
         }
+        fclose(f);
+    }
+    std::lock_guard<std::mutex> lk(stateMtx);
+    autosaved = currentSettingsLocked();
+}
 
-        // Frame pacing - maintain consistent frame rate
-        auto frameEnd = clock::now();
-        auto frameDuration = std::chrono::duration_cast<std::chrono::milliseconds>(frameEnd - frameStart);
-        int targetFrameTime = 1000 / TARGET_FPS;
-        auto sleepTime = std::chrono::milliseconds(targetFrameTime) - frameDuration;
-        if (sleepTime.count() > 0) {
-            std::this_thread::sleep_for(sleepTime);
+static void autosaveJob() {
+    SavedSettings now;
+    {
+        std::lock_guard<std::mutex> lk(stateMtx);
+        now = currentSettingsLocked();
+    }
+    if (!(now == autosaved)) {
+        FILE* f = fopen(autosavePath.c_str(), "w");
+        if (f) {
+            fprintf(f, "fps_index %d\ncell_size %d\ngrid_width %d\ngrid_height %d\nfruit_count %d\nspeed_index %d\n",
+                now.fpsIndex, now.cellSize, now.gridWidth, now.gridHeight, now.fruitCount, now.speedIndex);
+            if (fclose(f) == 0) autosaved = now;
         }
     }
 }
 
+static void scheduleAutosave(std::chrono::steady_clock::time_point at) {
+    jobs->addAt(at, [at] {
+        autosaveJob();
+        if (running) scheduleAutosave(at + std::chrono::seconds(2));
+    });
+}
+
+//
+// Telemetry (--telemetry <file>): a job samples frame rate, latency, score and the job
+// system's counters once a second into a CSV buffer; every tenth sample, and on the way
+// out, it hands the buffer to a flush job that writes it, after the flush before it
+//
+static FILE* telemetryFile = nullptr;
+static std::string telemetryLines; // telemetry job only
+static JobId telemetryFlushed;
+static int telemetrySamples = 0;
+static std::chrono::steady_clock::time_point telemetryStart;
+
+static void telemetryJob() {
+    using clock = std::chrono::steady_clock;
+    int currentScore;
+    GameState state;
+    {
+        std::lock_guard<std::mutex> lk(stateMtx);
+        currentScore = score;
+        state = gameState;
+    }
+    JobStats js = jobs->statistics();
+    char line[256];
+    int n = snprintf(line, sizeof(line), "%.1f,%.1f,%.2f,%.2f,%.2f,%.2f,%d,%d,%llu,%llu,%llu\n",
+        std::chrono::duration<double>(clock::now() - telemetryStart).count(), frameLatency.fps(), frameLatency.latency(),
+        frameLatency.stage(FRAME_BUILD), frameLatency.stage(FRAME_RASTER), frameLatency.stage(FRAME_PRESENT), currentScore,
+        (int)state, (unsigned long long)js.executed, (unsigned long long)js.stolen, (unsigned long long)js.main);
+    if (n > 0) telemetryLines.append(line, (size_t)(std::min)(n, (int)sizeof(line) - 1));
+
+    if (++telemetrySamples % 10 == 0 || !running) {
+        telemetryFlushed = jobs->add([lines = std::move(telemetryLines)] {
+            fwrite(lines.data(), 1, lines.size(), telemetryFile);
+            fflush(telemetryFile);
+        }, { telemetryFlushed });
+        telemetryLines.clear();
+    }
+}
+
+static void scheduleTelemetry(std::chrono::steady_clock::time_point at) {
+    jobs->addAt(at, [at] {
+        telemetryJob();
+        if (running) scheduleTelemetry(at + std::chrono::seconds(1));
+    });
+}
+
 //
 // Win32 window procedure
 //
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    // Runs whatever is due and moves the game's clock to now, before stateMtx is taken
+    if (msg == WM_KEYDOWN || msg == WM_LBUTTONDOWN) coro.runUntil(coroNow());
+
     switch (msg) {
     case WM_KEYDOWN: {
         std::lock_guard<std::mutex> lk(stateMtx);
@@ -1123,12 +1082,12 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 // Activate selected menu item
                 if (menuSelection == 0) {
                     // Play
-                    gameState = PLAYING;
+                    setScreenLocked(PLAYING);
                     resetGameLocked();
                 }
                 else if (menuSelection == 1) {
                     // Settings
-                    gameState = SETTINGS;
+                    setScreenLocked(SETTINGS);
                     settingSelection = 0;
                 }
                 else if (menuSelection == 2) {
@@ -1198,7 +1157,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             case VK_ESCAPE:
                 // Back to menu
                 if (settingSelection == 6 || wParam == VK_ESCAPE) {
-                    gameState = MENU;
+                    setScreenLocked(MENU);
                     menuSelection = 0;
                 }
                 break;
@@ -1223,11 +1182,11 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     if (pauseSelection == 0) {
                         // Resume
                         paused = false;
-                        lastTickTime = std::chrono::steady_clock::now();
+                        gameLoop.resumed.set(); // play picks up after a countdown
                     }
                     else {
                         // Go to menu
-                        gameState = MENU;
+                        setScreenLocked(MENU);
                         menuSelection = 0;
                         pauseSelection = 0;
                     }
@@ -1255,7 +1214,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     }
                     else {
                         // Go to menu
-                        gameState = MENU;
+                        setScreenLocked(MENU);
                         menuSelection = 0;
                         gameOverSelection = 0;
                     }
@@ -1283,13 +1242,17 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     }
                     else {
                         // Go to menu
-                        gameState = MENU;
+                        setScreenLocked(MENU);
                         menuSelection = 0;
                         gameOverSelection = 0;
                     }
                     break;
                 }
             }
+            else if (dying) {
+                // Only a restart cuts the death animation short
+                if (wParam == 'R') resetGameLocked();
+            }
             else {
                 // Normal game controls
                 switch (wParam) {
@@ -1298,6 +1261,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     if (started) {
                         paused = true;
                         pauseSelection = 0;
+                        gameLoop.resumed.reset();
                     }
                     break;
                 case VK_UP:
@@ -1305,6 +1269,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     if (!started) {
                         started = true;
                         lastTickTime = std::chrono::steady_clock::now();
+                        gameLoop.started.set();
                     }
                     if (dir != DOWN) nextDir = UP;
                     break;
@@ -1313,6 +1278,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     if (!started) {
                         started = true;
                         lastTickTime = std::chrono::steady_clock::now();
+                        gameLoop.started.set();
                     }
                     if (dir != UP) nextDir = DOWN;
                     break;
@@ -1321,6 +1287,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     if (!started) {
                         started = true;
                         lastTickTime = std::chrono::steady_clock::now();
+                        gameLoop.started.set();
                     }
                     if (dir != RIGHT) nextDir = LEFT;
                     break;
@@ -1329,6 +1296,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     if (!started) {
                         started = true;
                         lastTickTime = std::chrono::steady_clock::now();
+                        gameLoop.started.set();
                     }
                     if (dir != LEFT) nextDir = RIGHT;
                     break;
@@ -1341,8 +1309,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         break;
     }
     case WM_MOUSEMOVE: {
-        mouseX = LOWORD(lParam);
-        mouseY = HIWORD(lParam);
+        mousePos.store((uint32_t)lParam, std::memory_order_relaxed);
         break;
     }
     case WM_LBUTTONDOWN: {
@@ -1361,7 +1328,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             // Play button
             RECT playRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
             if (mouseX >= playRect.left && mouseX <= playRect.right && mouseY >= playRect.top && mouseY <= playRect.bottom) {
-                gameState = PLAYING;
+                setScreenLocked(PLAYING);
                 resetGameLocked();
             }
 
@@ -1369,7 +1336,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             startY += buttonSpacing;
             RECT settingsRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
             if (mouseX >= settingsRect.left && mouseX <= settingsRect.right && mouseY >= settingsRect.top && mouseY <= settingsRect.bottom) {
-                gameState = SETTINGS;
+                setScreenLocked(SETTINGS);
                 settingSelection = 0;
             }
 
@@ -1445,7 +1412,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             int startY2 = max(120, GRID_H * CELL / 4) + rowHeight2 * 6 + 20;
             RECT backRect = { 0, startY2, GRID_W * CELL, startY2 + 30 };
             if (mouseY >= backRect.top && mouseY <= backRect.bottom) {
-                gameState = MENU;
+                setScreenLocked(MENU);
                 menuSelection = 0;
             }
         }
@@ -1464,14 +1431,14 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 RECT resumeRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
                 if (mouseX >= resumeRect.left && mouseX <= resumeRect.right && mouseY >= resumeRect.top && mouseY <= resumeRect.bottom) {
                     paused = false;
-                    lastTickTime = std::chrono::steady_clock::now();
+                    gameLoop.resumed.set(); // play picks up after a countdown
                 }
 
                 // Menu button
                 startY += buttonSpacing;
                 RECT menuRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
                 if (mouseX >= menuRect.left && mouseX <= menuRect.right && mouseY >= menuRect.top && mouseY <= menuRect.bottom) {
-                    gameState = MENU;
+                    setScreenLocked(MENU);
                     menuSelection = 0;
                     pauseSelection = 0;
                 }
@@ -1498,7 +1465,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 startY += buttonSpacing;
                 RECT menuRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
                 if (mouseX >= menuRect.left && mouseX <= menuRect.right && mouseY >= menuRect.top && mouseY <= menuRect.bottom) {
-                    gameState = MENU;
+                    setScreenLocked(MENU);
                     menuSelection = 0;
                     gameOverSelection = 0;
                 }
@@ -1525,7 +1492,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 startY += buttonSpacing;
                 RECT menuRect = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
                 if (mouseX >= menuRect.left && mouseX <= menuRect.right && mouseY >= menuRect.top && mouseY <= menuRect.bottom) {
-                    gameState = MENU;
+                    setScreenLocked(MENU);
                     menuSelection = 0;
                     gameOverSelection = 0;
                 }
@@ -1533,10 +1500,13 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         }
         break;
     }
+    case WM_APP_JOBS:
+        if (jobs) jobs->runMain();
+        return 0;
     case WM_PAINT: {
         PAINTSTRUCT ps;
         BeginPaint(hwnd, &ps);
-        // Render thread handles all drawing, just validate
+        // Render jobs handle all drawing, just validate
         EndPaint(hwnd, &ps);
         return 0;
     }
@@ -1550,9 +1520,47 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     default:
         break;
     }
+
+    // Input may have started or woken a coroutine
+    if (msg == WM_KEYDOWN || msg == WM_LBUTTONDOWN) pumpGame();
     return DefWindowProc(hwnd, msg, wParam, lParam);
 }
 
+//
+// Command line: --record <file>, --autosave <file>, --telemetry <file>, --serial-render,
+// --frame-stats
+//
+static bool hasFlag(PWSTR cmdLine, const wchar_t* flag) {
+    return cmdLine && wcsstr(cmdLine, flag) != nullptr;
+}
+
+// The path after flag, quoted or not, or fallback if the flag has none; "" without the flag
+static std::string flagPath(PWSTR cmdLine, const wchar_t* flag, const wchar_t* fallback) {
+    const wchar_t* arg = cmdLine ? wcsstr(cmdLine, flag) : nullptr;
+    if (!arg) return std::string();
+    arg += wcslen(flag);
+    while (*arg == L' ') arg++;
+
+    std::wstring path;
+    if (*arg == L'"') {
+        for (arg++; *arg && *arg != L'"'; arg++) path += *arg;
+    }
+    else if (*arg != L'-') {
+        for (; *arg && *arg != L' '; arg++) path += *arg;
+    }
+    if (path.empty()) path = fallback;
+
+    char narrow[MAX_PATH];
+    if (!WideCharToMultiByte(CP_ACP, 0, path.c_str(), -1, narrow, MAX_PATH, NULL, NULL)) return std::string();
+    return narrow;
+}
+
+static void startRecording(PWSTR cmdLine) {
+    std::string path = flagPath(cmdLine, L"--record", L"snake_human.snkd");
+    if (path.empty()) return;
+    if (recorder.open(path.c_str())) SetWindowTextW(g_hwnd, L"Snake - Smooth MT (Optimized) [REC]");
+}
+
 //
 // Entry point
 //
@@ -1582,15 +1590,45 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInst, PWSTR lpszCmdLine,
     ShowWindow(g_hwnd, nCmdShow);
     UpdateWindow(g_hwnd);
 
+    startRecording(lpszCmdLine);
+    serialRender = hasFlag(lpszCmdLine, L"--serial-render");
+    showFrameStats = hasFlag(lpszCmdLine, L"--frame-stats");
+    autosavePath = flagPath(lpszCmdLine, L"--autosave", L"snake_settings.txt");
+    if (!autosavePath.empty()) loadSettings();
+    std::string telemetryPath = flagPath(lpszCmdLine, L"--telemetry", L"snake_telemetry.csv");
+    if (!telemetryPath.empty() && (telemetryFile = fopen(telemetryPath.c_str(), "w")) != nullptr) {
+        fputs("seconds,fps,latency_ms,build_ms,raster_ms,present_ms,score,screen,jobs,stolen,window_jobs\n", telemetryFile);
+    }
+
     // Initialize game
     {
         std::lock_guard<std::mutex> lk(stateMtx);
         resetGameLocked();
     }
 
-    // Start threads
-    std::thread gameThread(gameThreadFunc);
-    std::thread renderThread(renderThreadFunc);
+    // One worker a core, less the window thread's; window-thread jobs wake it with a message
+    int cores = (int)std::thread::hardware_concurrency();
+    JobSystem jobSystem((std::max)(1, cores - 1), [](void*) { PostMessage(g_hwnd, WM_APP_JOBS, 0, 0); });
+    jobs = &jobSystem;
+
+    auto now = std::chrono::steady_clock::now();
+    pumpGame(); // the game loop that resetGameLocked() spawned, up to its first wait
+
+    FrameJobs frameJobs;
+    for (RenderFrame& f : frameJobs.frames) {
+        // Pre-reserve vectors to reduce allocations
+        f.snap.prev.reserve(100);
+        f.snap.curr.reserve(100);
+    }
+    frameJobs.next = now;
+    frameJobs.fps = TARGET_FPS;
+    scheduleFrame(frameJobs);
+
+    if (!autosavePath.empty()) scheduleAutosave(now + std::chrono::seconds(2));
+    if (telemetryFile) {
+        telemetryStart = now;
+        scheduleTelemetry(now + std::chrono::seconds(1));
+    }
 
     // Message loop
     MSG msg;
@@ -1599,12 +1637,16 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInst, PWSTR lpszCmdLine,
         DispatchMessage(&msg);
     }
 
-    // Signal threads to stop
+    // Jobs stop adding themselves once running is false; the last autosave and telemetry
+    // flush run now, and frames in flight finish here on the window thread
     running = false;
+    jobSystem.drain();
+    for (RenderFrame& f : frameJobs.frames) releaseFrameBitmap(f);
+    jobs = nullptr;
+    if (telemetryFile) fclose(telemetryFile);
 
-    // Wait for threads with timeout (safety measure)
-    if (gameThread.joinable()) gameThread.join();
-    if (renderThread.joinable()) renderThread.join();
+    // Flush the last chunk and write the index
+    recorder.close();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,652 @@
+// snake_arena.h
+// Multi-snake arena: N snakes, human or bot, on one board with every head moving at once.
+// One occupancy grid holds a snake tag or a fruit tag per cell, and each tick the heads
+// claim their next cell in a small hash keyed by cell. Head-to-body is one grid read and
+// head-to-head (including a contested fruit) one hash probe, so a tick costs O(N) plus
+// the length of the snakes that die in it - never O(N x total length).
+// Large arenas can tick on a worker pool with bit-identical results (see "Parallel tick").
+
+#pragma once
+
+#include "snake_queue.h"
+#include "snake_sim.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//
+// Cell tags: 0 empty, snake id + 1, or ARENA_FOOD | fruit index
+//
+static constexpr uint32_t ARENA_EMPTY = 0;
+static constexpr uint32_t ARENA_FOOD = 0x80000000u;
+
+static inline bool arenaIsSnake(uint32_t tag) { return tag != ARENA_EMPTY && !(tag & ARENA_FOOD); }
+
+enum ArenaFate : uint8_t { ARENA_ALIVE, ARENA_WALL, ARENA_BODY, ARENA_HEAD, ARENA_DEAD };
+
+struct ArenaConfig {
+    int width = 1024;
+    int height = 1024;
+    int snakes = 1000;
+    int fruits = 4096;
+    int respawnTicks = 10;   // a dead snake comes back this many ticks later
+    uint64_t seed = 1;
+};
+
+struct ArenaTickStats {
+    uint32_t moved = 0;
+    uint32_t ate = 0;
+    uint32_t wallDeaths = 0;
+    uint32_t bodyDeaths = 0;
+    uint32_t headDeaths = 0; // lost a head-to-head, or tied for it
+    uint32_t spawned = 0;
+};
+
+//
+// One snake. The body is a ring of cell indices with head at body[headPos]; the ring
+// doubles when the snake outgrows it.
+//
+struct ArenaSnake {
+    std::vector<uint32_t> body;
+    uint32_t mask = 0;
+    uint32_t headPos = 0;
+    uint32_t length = 0;
+    SimDir dir = SIM_RIGHT;
+    int action = -1;         // next turn; -1 keeps going
+    bool bot = true;
+    bool alive = false;
+    ArenaFate fate = ARENA_DEAD; // this tick's outcome
+    int score = 0;
+    uint32_t respawnAt = 0;
+    uint32_t nextCell = 0;
+    bool eats = false;
+    uint32_t target = UINT32_MAX; // bot: fruit cell it is heading for
+    SimRng rng;
+
+    uint32_t head() const { return body[headPos]; }
+    uint32_t segment(uint32_t i) const { return body[(headPos - i) & mask]; }
+    uint32_t tail() const { return segment(length - 1); }
+};
+
+//
+// Snapshot of everything a tick reads or writes (see SnakeArena::save)
+//
+struct ArenaState {
+    std::vector<uint32_t> grid;
+    std::vector<uint32_t> food;
+    std::vector<ArenaSnake> snakes;
+    uint32_t ticks = 0;
+    SimRng rng;
+};
+
+//
+// Worker pool for the parallel tick. run() hands out jobs from an atomic counter to the
+// calling thread and the helpers, and returns once every job is done. Helpers spin
+// briefly between phases and then sleep on the generation counter.
+//
+class ArenaWorkers {
+public:
+    explicit ArenaWorkers(int threads) : count(std::max(1, threads)) {
+        for (int t = 1; t < count; t++) helpers.emplace_back([this, t] { loop(t); });
+    }
+
+    ~ArenaWorkers() {
+        stop.store(true, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+        generation.notify_all();
+        for (auto& th : helpers) th.join();
+    }
+
+    ArenaWorkers(const ArenaWorkers&) = delete;
+    ArenaWorkers& operator=(const ArenaWorkers&) = delete;
+
+    int size() const { return count; }
+
+    template <typename Fn>
+    void run(int jobs, Fn&& fn) {
+        if (count == 1 || jobs <= 1) {
+            for (int j = 0; j < jobs; j++) fn(0, j);
+            return;
+        }
+        task = [](void* ctx, int t, int j) { (*(std::remove_reference_t<Fn>*)ctx)(t, j); };
+        taskCtx = (void*)&fn;
+        jobCount = jobs;
+        next.store(0, std::memory_order_relaxed);
+        pending.store(count - 1, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+        generation.notify_all();
+
+        work(0);
+        for (int spin = 0; pending.load(std::memory_order_acquire) != 0; spin++) {
+            if (spin < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            int p = pending.load(std::memory_order_acquire);
+            if (p != 0) pending.wait(p, std::memory_order_acquire);
+        }
+    }
+
+private:
+    void work(int t) {
+        for (int j = next.fetch_add(1, std::memory_order_relaxed); j < jobCount; j = next.fetch_add(1, std::memory_order_relaxed)) {
+            task(taskCtx, t, j);
+        }
+    }
+
+    void loop(int t) {
+        uint32_t seen = 0;
+        for (;;) {
+            uint32_t g = generation.load(std::memory_order_acquire);
+            for (int spin = 0; g == seen; spin++) {
+                if (spin < 64) std::this_thread::yield();
+                else generation.wait(seen, std::memory_order_acquire);
+                g = generation.load(std::memory_order_acquire);
+            }
+            seen = g;
+            if (stop.load(std::memory_order_relaxed)) return;
+            work(t);
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) pending.notify_one();
+        }
+    }
+
+    int count;
+    std::vector<std::thread> helpers;
+    void (*task)(void*, int, int) = nullptr;
+    void* taskCtx = nullptr;
+    int jobCount = 0;
+    alignas(CACHE_LINE) std::atomic<int> next{ 0 };
+    alignas(CACHE_LINE) std::atomic<int> pending{ 0 };
+    alignas(CACHE_LINE) std::atomic<uint32_t> generation{ 0 };
+    std::atomic<bool> stop{ false };
+};
+
+static constexpr int ARENA_BLOCK = 256; // snakes per parallel job
+static constexpr int ARENA_MAX_REGIONS = 64;
+
+class SnakeArena {
+public:
+    explicit SnakeArena(const ArenaConfig& cfg)
+        : cfg(cfg), w(cfg.width), h(cfg.height) {
+        grid.assign((size_t)w * h, ARENA_EMPTY);
+        rng.state = cfg.seed;
+        snakes.resize((size_t)cfg.snakes);
+        for (int i = 0; i < cfg.snakes; i++) {
+            snakes[i].rng.state = rng.next();
+            snakes[i].body.resize(8);
+            snakes[i].mask = 7;
+        }
+
+        regionRows = std::max(1, (h + ARENA_MAX_REGIONS - 1) / ARENA_MAX_REGIONS);
+        regionCount = (h + regionRows - 1) / regionRows;
+        regionClaims.resize((size_t)regionCount);
+        regionEaters.resize((size_t)regionCount);
+
+        for (int i = 0; i < cfg.fruits; i++) placeFood();
+        for (int i = 0; i < cfg.snakes; i++) spawn(i);
+    }
+
+    int width() const { return w; }
+    int height() const { return h; }
+    int snakeCount() const { return (int)snakes.size(); }
+    const ArenaSnake& snake(int id) const { return snakes[id]; }
+    uint32_t cell(uint32_t c) const { return grid[c]; }
+    const std::vector<uint32_t>& fruits() const { return food; }
+    uint32_t tickCount() const { return ticks; }
+
+    // Human control: a direction as in the game, ignored if it reverses
+    void setAction(int id, int action) { snakes[id].action = action; }
+    void setBot(int id, bool bot) { snakes[id].bot = bot; }
+
+    // Bots pick their actions from the current board
+    void think() {
+        for (int i = 0; i < (int)snakes.size(); i++) {
+            if (snakes[i].alive && snakes[i].bot) snakes[i].action = botAction(snakes[i]);
+        }
+    }
+
+    // The cell this snake's head enters with its queued action, or UINT32_MAX into a wall
+    uint32_t intendedCell(const ArenaSnake& s) const {
+        SimDir d = s.dir;
+        if (s.action >= SIM_UP && s.action <= SIM_RIGHT && (SimDir)s.action != simOpposite(d)) d = (SimDir)s.action;
+        return stepCell(s.head(), d);
+    }
+
+    // One simultaneous move of every live snake, on this thread
+    ArenaTickStats tick() {
+        ArenaTickStats st;
+        ticks++;
+
+        // Intents: walls and bodies are read from the board as it stood before the tick
+        // (a tail about to move still counts, as in the game); heads claim their cells
+        claims.prepare((uint32_t)snakes.size());
+        for (int i = 0; i < (int)snakes.size(); i++) {
+            if (intent(i)) claim(claims, snakes[i].nextCell, (uint32_t)i);
+        }
+
+        // Moves. Fruit and snakes are respawned only afterwards, so nothing lands on a
+        // cell a head is entering.
+        int eaten = 0;
+        for (int i = 0; i < (int)snakes.size(); i++) {
+            ArenaSnake& s = snakes[i];
+            if (s.fate == ARENA_DEAD) continue;
+            if (s.fate != ARENA_ALIVE) {
+                countDeath(st, s.fate);
+                kill(i);
+                continue;
+            }
+            uint32_t nc = s.nextCell;
+            s.eats = (grid[nc] & ARENA_FOOD) != 0;
+            if (s.eats) {
+                removeFood(grid[nc] & ~ARENA_FOOD); // before the head overwrites the tag
+                eaten++;
+            }
+            advance(i);
+            st.moved++;
+        }
+        st.ate = (uint32_t)eaten;
+        for (int i = 0; i < eaten; i++) placeFood();
+        for (int i = 0; i < (int)snakes.size(); i++) {
+            if (!snakes[i].alive && ticks >= snakes[i].respawnAt && spawn(i)) st.spawned++;
+        }
+        return st;
+    }
+
+    // The same tick spread over a worker pool; the board, fruit list, RNG and stats come out
+    // bit-identical to tick() for any number of threads. See "Parallel tick" below.
+    ArenaTickStats tick(ArenaWorkers& pool);
+
+    // Bots think in parallel too; each snake draws only from its own RNG
+    void think(ArenaWorkers& pool) {
+        int blocks = ((int)snakes.size() + ARENA_BLOCK - 1) / ARENA_BLOCK;
+        pool.run(blocks, [&](int, int b) {
+            int end = std::min((int)snakes.size(), (b + 1) * ARENA_BLOCK);
+            for (int i = b * ARENA_BLOCK; i < end; i++) {
+                if (snakes[i].alive && snakes[i].bot) snakes[i].action = botAction(snakes[i]);
+            }
+        });
+    }
+
+    // FNV-1a over everything a tick can change, to compare runs. The grid follows from the
+    // snakes and fruit, so per-tick checks on big boards can leave it out.
+    uint64_t stateHash(bool withGrid = true) const {
+        uint64_t hv = 0xCBF29CE484222325ull;
+        auto mix = [&](uint64_t v) {
+            for (int i = 0; i < 8; i++) {
+                hv ^= (v >> (i * 8)) & 0xFF;
+                hv *= 0x100000001B3ull;
+            }
+        };
+        if (withGrid) {
+            for (uint32_t c : grid) mix(c);
+        }
+        for (uint32_t f : food) mix(f);
+        for (const ArenaSnake& sn : snakes) {
+            mix((uint64_t)sn.alive | (uint64_t)sn.dir << 8 | (uint64_t)sn.fate << 16 | (uint64_t)sn.length << 32);
+            mix((uint64_t)(uint32_t)sn.score | (uint64_t)sn.respawnAt << 32);
+            mix(sn.rng.state);
+            if (sn.alive) mix(sn.head());
+        }
+        mix(rng.state);
+        mix(ticks);
+        return hv;
+    }
+
+    // Rollback: restore(s) after save(s) and the same actions replay the same ticks.
+    // Saving into a state that has been used before copies without allocating.
+    void save(ArenaState& out) const {
+        out.grid = grid;
+        out.food = food;
+        out.snakes = snakes;
+        out.ticks = ticks;
+        out.rng = rng;
+    }
+
+    void restore(const ArenaState& in) {
+        grid = in.grid;
+        food = in.food;
+        snakes = in.snakes;
+        ticks = in.ticks;
+        rng = in.rng;
+    }
+
+private:
+    struct Claim {
+        uint32_t cell = 0;
+        uint32_t snake = 0;
+        uint32_t stamp = 0; // use of the table the entry belongs to; older entries read as empty
+    };
+
+    // Open-addressed claims of one tick, never cleared: entries from older uses read as empty.
+    // The stamp counts uses rather than ticks, so a tick replayed after restore() starts clean.
+    struct ClaimTable {
+        std::vector<Claim> slots;
+        uint32_t mask = 0;
+        int shift = 32;
+        uint32_t stamp = 0;
+
+        // Room for count claims at half load
+        void prepare(uint32_t count) {
+            stamp++;
+            uint32_t cap = 16;
+            int bits = 4;
+            while (cap < count * 2) {
+                cap <<= 1;
+                bits++;
+            }
+            if (cap > slots.size()) {
+                slots.assign(cap, Claim{});
+                mask = cap - 1;
+                shift = 32 - bits;
+            }
+        }
+    };
+
+    struct ClaimRecord {
+        uint32_t cell;
+        uint32_t snake;
+    };
+
+    uint32_t stepCell(uint32_t c, SimDir d) const {
+        int x = (int)(c % (uint32_t)w), y = (int)(c / (uint32_t)w);
+        switch (d) {
+        case SIM_UP:    y -= 1; break;
+        case SIM_DOWN:  y += 1; break;
+        case SIM_LEFT:  x -= 1; break;
+        case SIM_RIGHT: x += 1; break;
+        }
+        if (x < 0 || x >= w || y < 0 || y >= h) return UINT32_MAX;
+        return (uint32_t)(y * w + x);
+    }
+
+    // Walls, bodies and the heading for this tick; true if the head still needs its cell
+    bool intent(int i) {
+        ArenaSnake& s = snakes[i];
+        if (!s.alive) {
+            s.fate = ARENA_DEAD;
+            return false;
+        }
+        if (s.action >= SIM_UP && s.action <= SIM_RIGHT && (SimDir)s.action != simOpposite(s.dir)) s.dir = (SimDir)s.action;
+        s.action = -1;
+        s.nextCell = stepCell(s.head(), s.dir);
+        s.fate = ARENA_ALIVE;
+        s.eats = false;
+        if (s.nextCell == UINT32_MAX) s.fate = ARENA_WALL;
+        else if (arenaIsSnake(grid[s.nextCell])) s.fate = ARENA_BODY;
+        return s.fate == ARENA_ALIVE;
+    }
+
+    // Head into nextCell; the tail follows unless the snake eats. Only this snake writes
+    // the cells involved, so different snakes can advance at the same time.
+    void advance(int i) {
+        ArenaSnake& s = snakes[i];
+        uint32_t nc = s.nextCell;
+        if (s.length == s.body.size()) grow(s);
+        s.headPos = (s.headPos + 1) & s.mask;
+        s.body[s.headPos] = nc;
+        grid[nc] = (uint32_t)i + 1;
+        if (s.eats) {
+            s.length++;
+            s.score += 10;
+        }
+        else {
+            grid[s.segment(s.length)] = ARENA_EMPTY; // old tail
+        }
+    }
+
+    static void countDeath(ArenaTickStats& st, ArenaFate fate) {
+        if (fate == ARENA_WALL) st.wallDeaths++;
+        else if (fate == ARENA_BODY) st.bodyDeaths++;
+        else if (fate == ARENA_HEAD) st.headDeaths++;
+    }
+
+    // Head-to-head: the strictly longest snake entering a cell takes it, everyone else
+    // entering it dies (all of them on a tie). The result does not depend on claim order.
+    void claim(ClaimTable& table, uint32_t c, uint32_t i) {
+        uint32_t slot = (c * 0x9E3779B1u) >> table.shift; // Fibonacci hashing: top bits
+        for (;;) {
+            Claim& e = table.slots[slot];
+            if (e.stamp != table.stamp) {
+                e = { c, i, table.stamp };
+                return;
+            }
+            if (e.cell == c) {
+                ArenaSnake& held = snakes[e.snake];
+                ArenaSnake& s = snakes[i];
+                if (s.length > held.length) {
+                    held.fate = ARENA_HEAD;
+                    e.snake = i;
+                }
+                else {
+                    s.fate = ARENA_HEAD;
+                    if (s.length == held.length) held.fate = ARENA_HEAD;
+                }
+                return;
+            }
+            slot = (slot + 1) & table.mask;
+        }
+    }
+
+    void grow(ArenaSnake& s) {
+        std::vector<uint32_t> ring(s.body.size() * 2);
+        for (uint32_t k = 0; k < s.length; k++) ring[s.length - 1 - k] = s.segment(k);
+        s.body.swap(ring);
+        s.mask = (uint32_t)s.body.size() - 1;
+        s.headPos = s.length - 1;
+    }
+
+    void kill(int i) {
+        ArenaSnake& s = snakes[i];
+        for (uint32_t k = 0; k < s.length; k++) grid[s.segment(k)] = ARENA_EMPTY;
+        s.alive = false;
+        s.length = 0;
+        s.respawnAt = ticks + (uint32_t)cfg.respawnTicks;
+    }
+
+    // Three free cells in a row, heading right into a fourth; a few tries, else next tick
+    bool spawn(int i) {
+        ArenaSnake& s = snakes[i];
+        for (int attempt = 0; attempt < 16; attempt++) {
+            uint32_t x = 2 + rng.below((uint32_t)(w - 3)), y = rng.below((uint32_t)h);
+            uint32_t c = y * (uint32_t)w + x;
+            if (grid[c - 2] || grid[c - 1] || grid[c] || grid[c + 1]) continue;
+            s.headPos = 2;
+            s.length = 3;
+            for (uint32_t k = 0; k < 3; k++) {
+                s.body[k] = c - 2 + k;
+                grid[c - 2 + k] = (uint32_t)i + 1;
+            }
+            s.dir = SIM_RIGHT;
+            s.action = -1;
+            s.alive = true;
+            s.score = 0;
+            s.target = UINT32_MAX;
+            return true;
+        }
+        return false;
+    }
+
+    void placeFood() {
+        for (int attempt = 0; attempt < 64; attempt++) {
+            uint32_t c = rng.below((uint32_t)(w * h));
+            if (grid[c] != ARENA_EMPTY) continue;
+            grid[c] = ARENA_FOOD | (uint32_t)food.size();
+            food.push_back(c);
+            return;
+        }
+    }
+
+    // Swap-remove, retagging the fruit that moves into the hole
+    void removeFood(uint32_t index) {
+        uint32_t last = food.back();
+        food[index] = last;
+        grid[last] = ARENA_FOOD | index;
+        food.pop_back();
+    }
+
+    //
+    // Bot: keeps a target fruit (the nearest of a few random picks) and takes the free
+    // step that gets closest to it, with a little noise. Constant work per snake.
+    //
+    int botAction(ArenaSnake& s) {
+        static const int dx[4] = { 0, 0, -1, 1 };
+        static const int dy[4] = { -1, 1, 0, 0 };
+        uint32_t head = s.head();
+        int hx = (int)(head % (uint32_t)w), hy = (int)(head / (uint32_t)w);
+
+        if (s.target == UINT32_MAX || !(grid[s.target] & ARENA_FOOD)) {
+            s.target = UINT32_MAX;
+            int best = INT32_MAX;
+            for (int k = 0; k < 4 && !food.empty(); k++) {
+                uint32_t f = food[s.rng.below((uint32_t)food.size())];
+                int d = std::abs((int)(f % (uint32_t)w) - hx) + std::abs((int)(f / (uint32_t)w) - hy);
+                if (d < best) {
+                    best = d;
+                    s.target = f;
+                }
+            }
+        }
+        int tx = hx, ty = hy;
+        if (s.target != UINT32_MAX) {
+            tx = (int)(s.target % (uint32_t)w);
+            ty = (int)(s.target / (uint32_t)w);
+        }
+
+        int best = s.dir;
+        int bestScore = INT32_MIN;
+        for (int a = 0; a < 4; a++) {
+            if (a == simOpposite(s.dir)) continue;
+            int x = hx + dx[a], y = hy + dy[a];
+            int score = (int)s.rng.below(3);
+            if (x < 0 || x >= w || y < 0 || y >= h || arenaIsSnake(grid[(uint32_t)(y * w + x)])) score -= 1000000;
+            score -= (std::abs(tx - x) + std::abs(ty - y)) * 4;
+            if (score > bestScore) {
+                bestScore = score;
+                best = a;
+            }
+        }
+        return best;
+    }
+
+    ArenaConfig cfg;
+    int w, h;
+    uint32_t ticks = 0;
+    std::vector<uint32_t> grid;
+    std::vector<uint32_t> food;
+    std::vector<ArenaSnake> snakes;
+    ClaimTable claims;
+
+    // Parallel tick: claims are split by horizontal band of the cell claimed
+    int regionRows = 1;
+    int regionCount = 1;
+    std::vector<std::vector<ClaimRecord>> outbox; // [thread][region]
+    std::vector<ClaimTable> regionClaims;
+    std::vector<std::vector<uint32_t>> regionEaters;
+    std::vector<uint32_t> eaters;
+    std::vector<ArenaTickStats> blockStats;
+    std::vector<std::vector<uint32_t>> blockRespawns;
+    SimRng rng;
+};
+
+//
+// Parallel tick
+// Phases run as jobs over fixed snake blocks or board regions, never over threads, and
+// everything that depends on order happens on the calling thread in snake order:
+//  1. intents, by snake block: each head's claim goes into the bucket of the region
+//     (band of rows) that owns the cell it is entering
+//  2. claims, by region: a head crossing a region border is settled with the heads it
+//     meets there; the longest-wins rule does not care in which order claims arrive
+//  3. eaten fruit is swap-removed in snake order, exactly as tick() removes it
+//  4. moves and deaths, by snake block: every cell written belongs to the one snake
+//     writing it (its new head, old tail or dead body), so blocks never overlap
+//  5. fruit placement and respawns draw from the arena RNG in snake order
+//
+inline ArenaTickStats SnakeArena::tick(ArenaWorkers& pool) {
+    int n = (int)snakes.size();
+    int threads = pool.size();
+    int blocks = (n + ARENA_BLOCK - 1) / ARENA_BLOCK;
+    int R = regionCount;
+    ticks++;
+    if ((int)outbox.size() != threads * R) outbox.assign((size_t)threads * R, {});
+    blockStats.assign((size_t)blocks, ArenaTickStats{});
+    blockRespawns.resize((size_t)blocks);
+
+    pool.run(blocks, [&](int t, int b) {
+        int end = std::min(n, (b + 1) * ARENA_BLOCK);
+        for (int i = b * ARENA_BLOCK; i < end; i++) {
+            if (!intent(i)) continue;
+            uint32_t c = snakes[i].nextCell;
+            int r = (int)(c / (uint32_t)w) / regionRows;
+            outbox[(size_t)t * R + r].push_back({ c, (uint32_t)i });
+        }
+    });
+
+    pool.run(R, [&](int, int r) {
+        uint32_t count = 0;
+        for (int t = 0; t < threads; t++) count += (uint32_t)outbox[(size_t)t * R + r].size();
+        ClaimTable& table = regionClaims[r];
+        table.prepare(count);
+        for (int t = 0; t < threads; t++) {
+            for (const ClaimRecord& rec : outbox[(size_t)t * R + r]) claim(table, rec.cell, rec.snake);
+        }
+        std::vector<uint32_t>& eat = regionEaters[r];
+        eat.clear();
+        for (int t = 0; t < threads; t++) {
+            std::vector<ClaimRecord>& box = outbox[(size_t)t * R + r];
+            for (const ClaimRecord& rec : box) {
+                ArenaSnake& s = snakes[rec.snake];
+                if (s.fate == ARENA_ALIVE && (grid[rec.cell] & ARENA_FOOD)) {
+                    s.eats = true;
+                    eat.push_back(rec.snake);
+                }
+            }
+            box.clear();
+        }
+    });
+
+    eaters.clear();
+    for (const auto& eat : regionEaters) eaters.insert(eaters.end(), eat.begin(), eat.end());
+    std::sort(eaters.begin(), eaters.end());
+    for (uint32_t i : eaters) removeFood(grid[snakes[i].nextCell] & ~ARENA_FOOD);
+
+    pool.run(blocks, [&](int, int b) {
+        ArenaTickStats& st = blockStats[b];
+        std::vector<uint32_t>& respawn = blockRespawns[b];
+        respawn.clear();
+        int end = std::min(n, (b + 1) * ARENA_BLOCK);
+        for (int i = b * ARENA_BLOCK; i < end; i++) {
+            ArenaSnake& s = snakes[i];
+            if (s.fate == ARENA_ALIVE) {
+                advance(i);
+                st.moved++;
+            }
+            else if (s.fate != ARENA_DEAD) {
+                countDeath(st, s.fate);
+                kill(i);
+            }
+            if (!s.alive && ticks >= s.respawnAt) respawn.push_back((uint32_t)i);
+        }
+    });
+
+    ArenaTickStats st;
+    for (const ArenaTickStats& b : blockStats) {
+        st.moved += b.moved;
+        st.wallDeaths += b.wallDeaths;
+        st.bodyDeaths += b.bodyDeaths;
+        st.headDeaths += b.headDeaths;
+    }
+    st.ate = (uint32_t)eaters.size();
+    for (uint32_t i = 0; i < st.ate; i++) placeFood();
+    for (const auto& respawn : blockRespawns) {
+        for (uint32_t i : respawn) {
+            if (spawn((int)i)) st.spawned++;
+        }
+    }
+    return st;
+}
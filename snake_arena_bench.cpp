@@ -0,0 +1,211 @@
+// snake_arena_bench.cpp
+// Tick throughput of the multi-snake arena (snake_arena.h), with an optional brute-force
+// cross-check of every collision verdict against an O(N x total length) scan, and thread
+// scaling of the parallel tick checked tick by tick against the serial one.
+// Compile: g++ snake_arena_bench.cpp -std=c++20 -O2 -pthread -o snake_arena_bench
+// Run:     ./snake_arena_bench --snakes 1000 --width 1024 --height 1024 [--check 200]
+//          ./snake_arena_bench --snakes 10000 --width 4096 --height 4096 --threads 1,2,4,8,16,32,64
+
+#include "snake_arena.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//
+// Config
+//
+struct ArenaBenchConfig {
+    ArenaConfig arena;
+    int ticks = 10000;
+    int check = 0; // ticks to verify by brute force
+    std::vector<int> threads; // parallel tick at each count
+};
+
+static std::vector<int> parseList(const char* s) {
+    std::vector<int> v;
+    while (*s) {
+        v.push_back(atoi(s));
+        while (*s && *s != ',') s++;
+        if (*s == ',') s++;
+    }
+    return v;
+}
+
+static ArenaBenchConfig parseArgs(int argc, char** argv) {
+    ArenaBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.arena.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.arena.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--snakes") && i + 1 < argc) cfg.arena.snakes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fruits") && i + 1 < argc) cfg.arena.fruits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--respawn") && i + 1 < argc) cfg.arena.respawnTicks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.arena.seed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--ticks") && i + 1 < argc) cfg.ticks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--check") && i + 1 < argc) cfg.check = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) cfg.threads = parseList(argv[++i]);
+    }
+    return cfg;
+}
+
+using ArenaClock = std::chrono::steady_clock;
+
+static double secondsSince(ArenaClock::time_point t) {
+    return std::chrono::duration<double>(ArenaClock::now() - t).count();
+}
+
+//
+// Brute force: every head against every segment of every snake, and every other head
+//
+static void bruteForceFates(const SnakeArena& a, std::vector<uint8_t>& fate) {
+    int n = a.snakeCount();
+    std::vector<uint32_t> next((size_t)n, UINT32_MAX);
+    fate.assign((size_t)n, ARENA_DEAD);
+    for (int i = 0; i < n; i++) {
+        const ArenaSnake& s = a.snake(i);
+        if (!s.alive) continue;
+        next[i] = a.intendedCell(s);
+        fate[i] = next[i] == UINT32_MAX ? ARENA_WALL : ARENA_ALIVE;
+    }
+    for (int i = 0; i < n; i++) {
+        if (fate[i] != ARENA_ALIVE) continue;
+        for (int j = 0; j < n && fate[i] == ARENA_ALIVE; j++) {
+            const ArenaSnake& o = a.snake(j);
+            if (!o.alive) continue;
+            for (uint32_t k = 0; k < o.length; k++) {
+                if (o.segment(k) == next[i]) {
+                    fate[i] = ARENA_BODY;
+                    break;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        if (fate[i] != ARENA_ALIVE) continue;
+        for (int j = 0; j < n; j++) {
+            if (j == i || (fate[j] != ARENA_ALIVE && fate[j] != ARENA_HEAD) || next[j] != next[i]) continue;
+            if (a.snake(j).length >= a.snake(i).length) {
+                fate[i] = ARENA_HEAD;
+                break;
+            }
+        }
+    }
+}
+
+//
+// Parallel tick at each thread count. The serial arena is recorded first: its state hash
+// after every tick (snakes, fruit and RNG; the full grid at the end) is what every
+// parallel run has to reproduce.
+//
+static int runScaling(const ArenaBenchConfig& cfg) {
+    std::vector<uint64_t> reference((size_t)cfg.ticks);
+    double serialSecs = 0.0;
+    uint64_t finalHash = 0;
+    {
+        SnakeArena arena(cfg.arena);
+        for (int t = 0; t < cfg.ticks; t++) {
+            auto t0 = ArenaClock::now();
+            arena.think();
+            arena.tick();
+            serialSecs += secondsSince(t0);
+            reference[t] = arena.stateHash(false);
+        }
+        finalHash = arena.stateHash();
+        printf("serial      %7.1f us/tick                  final %016llx\n", serialSecs / cfg.ticks * 1e6,
+            (unsigned long long)finalHash);
+    }
+
+    bool allSame = true;
+    for (int threads : cfg.threads) {
+        ArenaWorkers pool(threads);
+        SnakeArena arena(cfg.arena);
+        double secs = 0.0;
+        int firstDiff = -1;
+        for (int t = 0; t < cfg.ticks; t++) {
+            auto t0 = ArenaClock::now();
+            arena.think(pool);
+            arena.tick(pool);
+            secs += secondsSince(t0);
+            if (firstDiff < 0 && arena.stateHash(false) != reference[t]) firstDiff = t;
+        }
+        uint64_t h = arena.stateHash();
+        if (firstDiff < 0 && h != finalHash) firstDiff = cfg.ticks - 1;
+        allSame = allSame && firstDiff < 0;
+        printf("%3d threads %7.1f us/tick  %5.2fx serial  final %016llx  %s", pool.size(), secs / cfg.ticks * 1e6,
+            serialSecs / secs, (unsigned long long)h, firstDiff < 0 ? "identical every tick" : "DIFFERS");
+        if (firstDiff >= 0) printf(" from tick %d", firstDiff);
+        printf("\n");
+    }
+    printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    return allSame ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    ArenaBenchConfig cfg = parseArgs(argc, argv);
+    if (cfg.arena.width < 8 || cfg.arena.height < 8 || cfg.arena.snakes < 1 || cfg.arena.fruits < 0 || cfg.ticks < 1) {
+        printf("invalid settings\n");
+        return 1;
+    }
+    if (!cfg.threads.empty()) {
+        printf("%d snakes on %dx%d, %d fruits, %d ticks\n", cfg.arena.snakes, cfg.arena.width, cfg.arena.height, cfg.arena.fruits, cfg.ticks);
+        return runScaling(cfg);
+    }
+
+    SnakeArena arena(cfg.arena);
+    printf("%d snakes on %dx%d, %d fruits\n", cfg.arena.snakes, cfg.arena.width, cfg.arena.height, cfg.arena.fruits);
+
+    long long moved = 0, ate = 0, wall = 0, body = 0, head = 0;
+    double thinkSecs = 0.0, tickSecs = 0.0, bruteSecs = 0.0;
+    long long lengthSum = 0, maxLength = 0;
+    int mismatches = 0;
+    std::vector<uint8_t> expected;
+
+    for (int t = 0; t < cfg.ticks; t++) {
+        auto t0 = ArenaClock::now();
+        arena.think();
+        thinkSecs += secondsSince(t0);
+
+        bool check = t < cfg.check;
+        if (check) {
+            auto b0 = ArenaClock::now();
+            bruteForceFates(arena, expected);
+            bruteSecs += secondsSince(b0);
+        }
+
+        auto t1 = ArenaClock::now();
+        ArenaTickStats st = arena.tick();
+        tickSecs += secondsSince(t1);
+
+        if (check) {
+            for (int i = 0; i < arena.snakeCount(); i++) {
+                if (arena.snake(i).fate != expected[i] && mismatches++ < 10) {
+                    printf("tick %d snake %d: arena says %d, brute force %d\n", t, i, arena.snake(i).fate, expected[i]);
+                }
+            }
+        }
+
+        moved += st.moved;
+        ate += st.ate;
+        wall += st.wallDeaths;
+        body += st.bodyDeaths;
+        head += st.headDeaths;
+        for (int i = 0; i < arena.snakeCount(); i++) {
+            lengthSum += arena.snake(i).length;
+            if (arena.snake(i).length > maxLength) maxLength = arena.snake(i).length;
+        }
+    }
+
+    double snakeTicks = double(cfg.ticks) * cfg.arena.snakes;
+    printf("%d ticks: tick %.2f us (%.1f ns/snake), bots %.2f us, %.0f ticks/s overall\n", cfg.ticks,
+        tickSecs / cfg.ticks * 1e6, tickSecs / snakeTicks * 1e9, thinkSecs / cfg.ticks * 1e6, cfg.ticks / (tickSecs + thinkSecs));
+    printf("mean length %.1f (max %lld), %lld moves, %lld fruit eaten, deaths: wall %lld  body %lld  head-to-head %lld\n",
+        double(lengthSum) / snakeTicks, maxLength, moved, ate, wall, body, head);
+    if (cfg.check > 0) {
+        int checked = cfg.check < cfg.ticks ? cfg.check : cfg.ticks;
+        printf("brute force over %d ticks: %.1f us/tick (%.0fx the arena tick), %d mismatches\n", checked,
+            bruteSecs / checked * 1e6, bruteSecs / checked / (tickSecs / cfg.ticks), mismatches);
+    }
+    return mismatches ? 1 : 0;
+}
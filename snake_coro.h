@@ -0,0 +1,286 @@
+// snake_coro.h
+// C++20 coroutines on a single-threaded, deterministic executor with a virtual clock.
+// A CoroTask suspends on sleepUntil(), sleepFor(), nextTick() or a CoroEvent and the
+// executor resumes it when runUntil() moves the clock past its wake time, in order of
+// time and then of suspension, so the same inputs give the same run every time. The
+// clock only moves when the owner says: main.cpp maps it to the steady clock and calls
+// runUntil() when nextWake() comes due; a test or bench can run an hour in a loop.
+// Tasks waiting on an event have no wake time at all, so a game nobody is playing costs
+// nothing. That also means nothing moves the clock while they wait: code outside the tasks
+// that sets an event or spawns a task after such a spell calls runUntil(its time) first,
+// or what it wakes runs at the old time and every sleep and tick since falls due at once.
+//
+// Tasks are spawned onto the executor, which owns them from then on; awaiting a CoroTask
+// inside another runs it to completion there (the awaiting one resumes when it returns).
+// cancel() destroys a task wherever it is suspended, with any task it is awaiting.
+
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <utility>
+#include <vector>
+
+using CoroTime = int64_t; // virtual microseconds
+static constexpr CoroTime CORO_NEVER = INT64_MAX;
+
+static constexpr CoroTime coroMs(int64_t ms) { return ms * 1000; }
+
+struct CoroTaskId {
+    uint32_t index = UINT32_MAX; // UINT32_MAX: none
+    uint32_t generation = 0;
+};
+
+//
+// Task
+//
+class CoroTask {
+public:
+    struct promise_type {
+        std::coroutine_handle<> continuation; // the task awaiting this one, if any
+
+        CoroTask get_return_object() { return CoroTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                std::coroutine_handle<> c = h.promise().continuation;
+                return c ? c : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    CoroTask(CoroTask&& o) noexcept : h(std::exchange(o.h, {})) {}
+    CoroTask& operator=(CoroTask&& o) noexcept {
+        if (this != &o) {
+            if (h) h.destroy();
+            h = std::exchange(o.h, {});
+        }
+        return *this;
+    }
+    ~CoroTask() {
+        if (h) h.destroy();
+    }
+
+    // co_await task: run it here, straight through to its end
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        h.promise().continuation = awaiting;
+        return h;
+    }
+    void await_resume() noexcept {}
+
+private:
+    friend class CoroExecutor;
+    explicit CoroTask(std::coroutine_handle<promise_type> h) : h(h) {}
+    std::coroutine_handle<promise_type> h;
+};
+
+//
+// Executor
+//
+class CoroExecutor {
+public:
+    // A suspended coroutine and the spawned task it belongs to
+    struct Waiter {
+        uint32_t task, generation;
+        std::coroutine_handle<> leaf;
+    };
+
+    CoroExecutor() = default;
+    CoroExecutor(const CoroExecutor&) = delete;
+    CoroExecutor& operator=(const CoroExecutor&) = delete;
+
+    ~CoroExecutor() {
+        for (Task& t : tasks) {
+            if (t.root) t.root.destroy();
+        }
+    }
+
+    CoroTime now() const { return clock; }
+
+    // Starts task at the current time, on the next runUntil()
+    CoroTaskId spawn(CoroTask task) {
+        uint32_t idx;
+        if (!freeTasks.empty()) {
+            idx = freeTasks.back();
+            freeTasks.pop_back();
+        }
+        else {
+            idx = (uint32_t)tasks.size();
+            tasks.push_back({});
+        }
+        Task& t = tasks[idx];
+        t.root = std::exchange(task.h, {});
+        t.cancelled = false;
+        wakeAt(clock, { idx, t.generation, t.root });
+        return { idx, t.generation };
+    }
+
+    bool alive(CoroTaskId id) const {
+        return id.index < tasks.size() && tasks[id.index].generation == id.generation && tasks[id.index].root;
+    }
+
+    // A task that is running finishes its current step first
+    void cancel(CoroTaskId id) {
+        if (!alive(id)) return;
+        if ((int)id.index == current) tasks[id.index].cancelled = true;
+        else finish(id.index);
+    }
+
+    // Resumes everything due by t, earliest first, then leaves the clock at t
+    size_t runUntil(CoroTime t) {
+        size_t resumed = 0;
+        while (!heap.empty() && heap[0].at <= t) {
+            Wake w = heap[0];
+            popHeap();
+            if (w.at > clock) clock = w.at;
+            Task& task = tasks[w.waiter.task];
+            if (task.generation != w.waiter.generation || !task.root) continue; // cancelled meanwhile
+
+            current = (int)w.waiter.task;
+            w.waiter.leaf.resume();
+            current = -1;
+            resumed++;
+            if (tasks[w.waiter.task].root.done() || tasks[w.waiter.task].cancelled) finish(w.waiter.task);
+        }
+        if (t > clock) clock = t;
+        resumes += resumed;
+        return resumed;
+    }
+
+    size_t advance(CoroTime d) { return runUntil(clock + d); }
+
+    // The earliest wake time, CORO_NEVER if every task waits on an event (or none is left)
+    CoroTime nextWake() const { return heap.empty() ? CORO_NEVER : heap[0].at; }
+
+    size_t liveTasks() const { return tasks.size() - freeTasks.size(); }
+    uint64_t totalResumes() const { return resumes; }
+
+    // Ticks fall on first, first + period, ...; nextTick() waits for the next one after now
+    void startTicks(CoroTime first, CoroTime period) {
+        tickFirst = first;
+        tickPeriod = period > 0 ? period : 1;
+    }
+
+    CoroTime nextTickTime() const {
+        if (clock < tickFirst) return tickFirst;
+        return tickFirst + ((clock - tickFirst) / tickPeriod + 1) * tickPeriod;
+    }
+
+    //
+    // Awaitables
+    //
+    struct SleepAwaiter {
+        CoroExecutor& ex;
+        CoroTime at;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { ex.wakeAt(at, ex.park(h)); }
+        void await_resume() noexcept {}
+    };
+
+    SleepAwaiter sleepUntil(CoroTime at) { return { *this, at }; }
+    SleepAwaiter sleepFor(CoroTime d) { return { *this, clock + d }; }
+    SleepAwaiter nextTick() { return { *this, nextTickTime() }; }
+
+    // The coroutine running now, for awaitables that park it elsewhere (CoroEvent)
+    Waiter park(std::coroutine_handle<> h) const {
+        return { (uint32_t)current, tasks[(size_t)current].generation, h };
+    }
+
+    void wakeAt(CoroTime at, const Waiter& w) {
+        heap.push_back({ at < clock ? clock : at, seq++, w });
+        size_t i = heap.size() - 1;
+        while (i > 0) {
+            size_t p = (i - 1) / 2;
+            if (!before(heap[i], heap[p])) break;
+            std::swap(heap[i], heap[p]);
+            i = p;
+        }
+    }
+
+private:
+    struct Task {
+        std::coroutine_handle<> root;
+        uint32_t generation = 0;
+        bool cancelled = false;
+    };
+
+    struct Wake {
+        CoroTime at;
+        uint64_t seq; // FIFO among equal times, so runs do not depend on heap layout
+        Waiter waiter;
+    };
+
+    static bool before(const Wake& a, const Wake& b) { return a.at != b.at ? a.at < b.at : a.seq < b.seq; }
+
+    void popHeap() {
+        heap[0] = heap.back();
+        heap.pop_back();
+        size_t i = 0;
+        for (;;) {
+            size_t l = 2 * i + 1, r = l + 1, m = i;
+            if (l < heap.size() && before(heap[l], heap[m])) m = l;
+            if (r < heap.size() && before(heap[r], heap[m])) m = r;
+            if (m == i) return;
+            std::swap(heap[i], heap[m]);
+            i = m;
+        }
+    }
+
+    // Destroying the root frame destroys the tasks it awaits; their wakes go stale
+    void finish(uint32_t idx) {
+        Task& t = tasks[idx];
+        t.root.destroy();
+        t.root = nullptr;
+        t.generation++;
+        freeTasks.push_back(idx);
+    }
+
+    std::vector<Task> tasks;
+    std::vector<uint32_t> freeTasks;
+    std::vector<Wake> heap;
+    uint64_t seq = 0;
+    CoroTime clock = 0;
+    int current = -1;
+    CoroTime tickFirst = 0, tickPeriod = 1;
+    uint64_t resumes = 0;
+};
+
+//
+// Event: co_await suspends until set(); it stays set, and lets awaiters straight
+// through, until reset(). Waiters resume in the order they waited, on the executor's
+// next runUntil(), at the executor's now() when set() was called.
+//
+class CoroEvent {
+public:
+    explicit CoroEvent(CoroExecutor& ex) : ex(ex) {}
+
+    void set() {
+        signalled = true;
+        for (const CoroExecutor::Waiter& w : waiters) ex.wakeAt(ex.now(), w);
+        waiters.clear();
+    }
+
+    void reset() { signalled = false; }
+    bool isSet() const { return signalled; }
+
+    struct Awaiter {
+        CoroEvent& ev;
+        bool await_ready() const noexcept { return ev.signalled; }
+        void await_suspend(std::coroutine_handle<> h) { ev.waiters.push_back(ev.ex.park(h)); }
+        void await_resume() noexcept {}
+    };
+    Awaiter operator co_await() { return { *this }; }
+
+private:
+    CoroExecutor& ex;
+    bool signalled = false;
+    std::vector<CoroExecutor::Waiter> waiters; // stale ones (cancelled tasks) are skipped on wake
+};
@@ -0,0 +1,324 @@
+// snake_coro_bench.cpp
+// main.cpp's game loop (snake_game_loop.h) on CoroExecutor (snake_coro.h), fast-forwarded:
+// a bot plays SnakeSim games through the very loop the game runs - wait for the first key,
+// tick on a fixed grid, pause and resume behind a 3-2-1 countdown, blink on death - while
+// a "player" coroutine presses the keys. Every resume is hashed with its virtual time, and
+// the whole run is done twice to show it comes out the same. Then what waiting costs: the
+// game left on its start screen for an hour of virtual time, against the 1 ms polling
+// loop it replaced, and a key after such a spell, which must start the game one tick
+// later and not run the ticks it sat out. Last, the executor's own cost per resume, for
+// sleeps and events.
+// Compile: g++ snake_coro_bench.cpp -std=c++20 -O2 -o snake_coro_bench
+// Run:     ./snake_coro_bench [--hours 10] [--tick-ms 80] [--width 20] [--height 20] [--seed 1]
+
+#include "snake_coro.h"
+#include "snake_game_loop.h"
+#include "snake_sim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//
+// Config
+//
+struct CoroBenchConfig {
+    int hours = 10;
+    int tickMs = 80; // main.cpp's hard speed
+    int width = 20;
+    int height = 20;
+    uint64_t seed = 1;
+};
+
+static CoroBenchConfig parseArgs(int argc, char** argv) {
+    CoroBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--hours") && i + 1 < argc) cfg.hours = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--tick-ms") && i + 1 < argc) cfg.tickMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.seed = strtoull(argv[++i], nullptr, 10);
+    }
+    return cfg;
+}
+
+using BenchClock = std::chrono::steady_clock;
+
+static double msSince(BenchClock::time_point t) {
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - t).count();
+}
+
+//
+// The game: main.cpp's loop on a SnakeSim with a bot at the keys
+//
+struct BenchGame {
+    const CoroBenchConfig& cfg;
+    CoroExecutor ex;
+    GameLoop<BenchGame> loop{ ex, *this };
+    SnakeSim sim;
+    std::vector<uint32_t> mem;
+    SimRng playerRng;
+    bool paused = false, dying = false, over = false, hidden = false;
+    int countdown = 0, games = 0, ticks = 0, pauses = 0;
+    uint64_t trace = 0xCBF29CE484222325ull; // FNV-1a over (time, what happened)
+
+    explicit BenchGame(const CoroBenchConfig& cfg) : cfg(cfg) {
+        mem.resize(SnakeSim::storageWords(cfg.width * cfg.height));
+        sim.bind(mem.data(), cfg.width * cfg.height);
+        playerRng.state = cfg.seed ^ 0x5DEECE66Dull;
+    }
+
+    void note(uint64_t what) {
+        uint64_t v = (uint64_t)ex.now() * 31 + what;
+        for (int i = 0; i < 8; i++) {
+            trace ^= (v >> (i * 8)) & 0xFF;
+            trace *= 0x100000001B3ull;
+        }
+    }
+
+    // Greedy: the safe turn closest to the first fruit
+    int botAction() const {
+        uint32_t hc = sim.head();
+        int hx = (int)(hc % (uint32_t)sim.w), hy = (int)(hc / (uint32_t)sim.w);
+        int fx = sim.foodCount ? (int)(sim.food[0] % (uint32_t)sim.w) : hx;
+        int fy = sim.foodCount ? (int)(sim.food[0] / (uint32_t)sim.w) : hy;
+        static const int dx[4] = { 0, 0, -1, 1 }, dy[4] = { -1, 1, 0, 0 };
+        int best = sim.dir, bestScore = INT32_MAX;
+        for (int d = 0; d < 4; d++) {
+            if ((SimDir)d == simOpposite(sim.dir)) continue;
+            int x = hx + dx[d], y = hy + dy[d];
+            if (x < 0 || x >= sim.w || y < 0 || y >= sim.h || sim.occupied((uint32_t)(y * sim.w + x))) continue;
+            int score = abs(x - fx) + abs(y - fy);
+            if (score < bestScore) {
+                bestScore = score;
+                best = d;
+            }
+        }
+        return best;
+    }
+
+    //
+    // GameLoop's view of the game
+    //
+    CoroTime tickPeriod() const { return coroMs(cfg.tickMs); }
+    bool pausedNow() const { return paused; }
+    void ticksStarted() {}
+
+    TickResult tick() {
+        SimResult r = sim.step(botAction());
+        ticks++;
+        note(r);
+        if (r == SIM_DIED) {
+            dying = true;
+            return TICK_DIED;
+        }
+        if (r == SIM_WON) {
+            over = true;
+            return TICK_WON;
+        }
+        return TICK_MOVED;
+    }
+
+    bool showCountdown(int n) {
+        if (n > 0 && paused) return false;
+        countdown = n;
+        if (n > 0) note(100 + (uint64_t)n);
+        return true;
+    }
+
+    void blink(bool h) { hidden = h; }
+
+    void endGame() {
+        hidden = false;
+        dying = false;
+        over = true;
+        note(200);
+    }
+
+    void reset() {
+        sim.reset(cfg.width, cfg.height, 3, cfg.seed + (uint64_t)games);
+        games++;
+        paused = dying = over = hidden = false;
+        countdown = 0;
+        loop.restart();
+    }
+
+    // The keys: start each game after a moment, pause now and then, restart when it ends
+    CoroTask player() {
+        for (;;) {
+            reset();
+            co_await ex.sleepFor(coroMs(500 + (int64_t)playerRng.below(1000)));
+            loop.started.set();
+            while (!over) {
+                co_await ex.sleepFor(coroMs(2000 + (int64_t)playerRng.below(20000)));
+                if (over || dying) continue;
+                paused = true;
+                loop.resumed.reset();
+                pauses++;
+                co_await ex.sleepFor(coroMs(1000 + (int64_t)playerRng.below(4000)));
+                paused = false;
+                loop.resumed.set();
+            }
+            co_await ex.sleepFor(coroMs(1000)); // on the game-over screen
+        }
+    }
+};
+
+struct PlayResult {
+    double ms;
+    uint64_t trace, resumes;
+    int games, ticks, pauses;
+};
+
+static PlayResult play(const CoroBenchConfig& cfg) {
+    BenchGame game(cfg);
+    game.ex.spawn(game.player());
+    auto t0 = BenchClock::now();
+    game.ex.runUntil(coroMs((int64_t)cfg.hours * 3600 * 1000));
+    return { msSince(t0), game.trace, game.ex.totalResumes(), game.games, game.ticks, game.pauses };
+}
+
+//
+// Idle: a game on its start screen
+//
+static void idle(const CoroBenchConfig& cfg) {
+    BenchGame game(cfg);
+    game.reset();
+    game.ex.runUntil(0); // the loop runs up to its wait for the first key
+    uint64_t before = game.ex.totalResumes();
+    auto t0 = BenchClock::now();
+    game.ex.runUntil(coroMs(3600 * 1000));
+    double ms = msSince(t0);
+    printf("idle hour  %llu resumes, next wake %s, %.3f ms; the 1 ms polling loop woke 3600000 times\n",
+        (unsigned long long)(game.ex.totalResumes() - before), game.ex.nextWake() == CORO_NEVER ? "never" : "due", ms);
+}
+
+//
+// A key after an idle spell. Nothing runs runUntil() while the game waits on an event, so
+// the clock stands still; main.cpp's WndProc brings it up to now before handling input.
+// Without that, the key's wake-ups land in the past and the pump after it runs every tick
+// since at once (and the resume countdown all in one go).
+//
+struct KeyAfterIdle {
+    int startBurst = 0, startNext = 0;  // ticks at the key, and in the tick period after
+    int countdown[3] = {};              // at the key, 400 and 800 ms later
+    int resumeBurst = 0, resumeNext = 0; // ticks during the countdown, and in the period after
+};
+
+static KeyAfterIdle keyAfterIdle(const CoroBenchConfig& cfg, bool catchUp) {
+    KeyAfterIdle r;
+    CoroTime tick = coroMs(cfg.tickMs);
+    {
+        // 3 s on the start screen, then an arrow key
+        BenchGame game(cfg);
+        game.reset();
+        game.ex.runUntil(0);
+        CoroTime now = coroMs(3000);
+        if (catchUp) game.ex.runUntil(now);
+        game.loop.started.set();
+        game.ex.runUntil(now); // the pump after the key
+        r.startBurst = game.ticks;
+        game.ex.runUntil(now + tick);
+        r.startNext = game.ticks - r.startBurst;
+    }
+    {
+        // A second of play, paused for 3 s, then Resume
+        BenchGame game(cfg);
+        game.reset();
+        game.loop.started.set();
+        CoroTime now = coroMs(1000);
+        game.ex.runUntil(now);
+        game.paused = true;
+        game.loop.resumed.reset();
+        game.ex.runUntil(now += tick); // the loop sees the pause on its next tick
+        now += coroMs(3000);
+        if (catchUp) game.ex.runUntil(now);
+        game.paused = false;
+        game.loop.resumed.set();
+        int before = game.ticks;
+        for (int i = 0; i < 3; i++) {
+            game.ex.runUntil(now + coroMs(400 * i));
+            r.countdown[i] = game.countdown;
+        }
+        r.resumeBurst = game.ticks - before;
+        game.ex.runUntil(now + coroMs(1200) + tick);
+        r.resumeNext = game.ticks - before - r.resumeBurst;
+    }
+    return r;
+}
+
+static bool keyAfterIdle(const CoroBenchConfig& cfg) {
+    KeyAfterIdle ok = keyAfterIdle(cfg, true), stale = keyAfterIdle(cfg, false);
+    bool pass = ok.startBurst == 0 && ok.startNext == 1 && ok.countdown[0] == 3 && ok.countdown[1] == 2 &&
+        ok.countdown[2] == 1 && ok.resumeBurst == 0 && ok.resumeNext == 1;
+    printf("key, 3 s   start: %d ticks at once, %d the period after; resume: countdown %d %d %d, %d ticks in it, %d after: %s\n",
+        ok.startBurst, ok.startNext, ok.countdown[0], ok.countdown[1], ok.countdown[2], ok.resumeBurst, ok.resumeNext,
+        pass ? "ok" : "WRONG");
+    printf("           without moving the clock first: %d ticks at once; countdown %d %d %d, %d ticks in it\n", stale.startBurst,
+        stale.countdown[0], stale.countdown[1], stale.countdown[2], stale.resumeBurst);
+    return pass;
+}
+
+//
+// Executor cost per resume
+//
+static CoroTask sleeper(CoroExecutor& ex, SimRng& rng, int rounds) {
+    for (int i = 0; i < rounds; i++) co_await ex.sleepFor(1 + (CoroTime)rng.below(1000));
+}
+
+static CoroTask waiter(CoroEvent& ev, CoroEvent& back, int rounds, int& count) {
+    for (int i = 0; i < rounds; i++) {
+        co_await ev;
+        count++;
+        back.set();
+    }
+}
+
+static void resumeCost() {
+    {
+        CoroExecutor ex;
+        SimRng rng;
+        rng.state = 7;
+        const int tasks = 1000, rounds = 1000;
+        for (int t = 0; t < tasks; t++) ex.spawn(sleeper(ex, rng, rounds));
+        auto t0 = BenchClock::now();
+        while (ex.nextWake() != CORO_NEVER) ex.runUntil(ex.nextWake());
+        double ms = msSince(t0);
+        printf("sleeps     %d tasks x %d sleeps: %.0f ns a resume\n", tasks, rounds, ms * 1e6 / ((double)tasks * (rounds + 1)));
+    }
+    {
+        CoroExecutor ex;
+        CoroEvent ping(ex), pong(ex);
+        const int rounds = 1000000;
+        int count = 0;
+        ex.spawn(waiter(ping, pong, rounds, count));
+        ex.runUntil(0);
+        auto t0 = BenchClock::now();
+        for (int i = 0; i < rounds; i++) {
+            pong.reset();
+            ping.set();
+            ping.reset();
+            ex.runUntil(ex.now());
+        }
+        double ms = msSince(t0);
+        printf("events     %d set + resume: %.0f ns each (%d resumed)\n", rounds, ms * 1e6 / rounds, count);
+    }
+}
+
+int main(int argc, char** argv) {
+    CoroBenchConfig cfg = parseArgs(argc, argv);
+    printf("%dx%d board, %d ms ticks, %d virtual hours a run\n", cfg.width, cfg.height, cfg.tickMs, cfg.hours);
+
+    PlayResult a = play(cfg), b = play(cfg);
+    double virtualMs = (double)cfg.hours * 3600 * 1000;
+    printf("play       %d games, %d ticks, %d pauses, %llu resumes in %.0f ms: %.0fx real time\n", a.games, a.ticks, a.pauses,
+        (unsigned long long)a.resumes, a.ms, virtualMs / a.ms);
+    printf("replay     trace %016llx vs %016llx: %s\n", (unsigned long long)a.trace, (unsigned long long)b.trace,
+        a.trace == b.trace && a.resumes == b.resumes ? "same" : "DIFFERENT");
+    idle(cfg);
+    bool pass = keyAfterIdle(cfg);
+    resumeCost();
+    return pass && a.trace == b.trace ? 0 : 1;
+}
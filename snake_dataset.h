@@ -0,0 +1,689 @@
+// snake_dataset.h
+// Imitation-learning datasets: (state, action) pairs from human or bot play, streamed to
+// chunked, columnar files with a footer index.
+// The game loop only copies a fixed-size sample into a queue; a writer thread packs
+// columns (delta + varint, bodies usually implied by the previous record) and writes.
+// The reader maps a file and shuffles across chunks for training.
+
+#pragma once
+
+#include "snake_queue.h"
+#include "snake_sim.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//
+// File layout
+//   DatasetFileHeader
+//   chunk*:  DatasetChunkHeader | column 0 | column 1 | ... (sizes in the chunk header)
+//   DatasetIndexEntry[chunkCount]
+//   DatasetTrailer
+// A file without a trailer (writer killed) is still readable by walking the chunks.
+//
+static constexpr uint32_t DATASET_VERSION = 1;
+static constexpr uint32_t DATASET_CHUNK_MAGIC = 0x4B4E4843; // "CHNK"
+static constexpr char DATASET_MAGIC[8] = { 'S', 'N', 'K', 'D', 'A', 'T', 'A', '1' };
+static constexpr int DATASET_MAX_SIDE = 64;
+static constexpr int DATASET_MAX_CELLS = DATASET_MAX_SIDE * DATASET_MAX_SIDE;
+
+// Columns of a chunk
+enum DatasetColumn {
+    DS_COL_EPISODE,   // zigzag varint, delta from the previous record
+    DS_COL_HEAD,      // zigzag varint, delta
+    DS_COL_LENGTH,    // zigzag varint, delta
+    DS_COL_FLAGS,     // byte: dir | action << 2 | explicit body << 4
+    DS_COL_FOODCOUNT, // byte
+    DS_COL_FOOD,      // zigzag varint per fruit, delta from the previous record's same fruit
+    DS_COL_MOVES,     // 2-bit moves head to tail, only for records with an explicit body
+    DS_COLUMNS
+};
+
+struct DatasetFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+};
+
+struct DatasetChunkHeader {
+    uint32_t magic;
+    uint32_t records;
+    uint16_t w, h;
+    uint32_t columnBytes[DS_COLUMNS];
+};
+
+struct DatasetIndexEntry {
+    uint64_t offset;
+    uint32_t bytes;
+    uint32_t records;
+};
+
+struct DatasetTrailer {
+    uint64_t indexOffset;
+    uint64_t records;
+    uint32_t chunkCount;
+    uint32_t version;
+    char magic[8];
+};
+
+//
+// One record: the state the action was chosen in, body as moves from head to tail
+//
+struct DatasetSample {
+    uint16_t w = 0, h = 0;
+    uint8_t dir = 0;
+    uint8_t action = 0;
+    uint8_t foodCount = 0;
+    uint32_t episode = 0;
+    uint32_t head = 0;
+    uint32_t length = 0;
+    uint32_t tail = 0; // last segment pushed
+    uint32_t food[SIM_MAX_FOOD];
+    uint8_t moves[DATASET_MAX_CELLS / 4];
+};
+
+static inline int datasetMoveBytes(uint32_t length) { return length > 1 ? (int)((length - 1 + 3) / 4) : 0; }
+
+// Building a sample: begin, then segments head first, then fruits
+static inline void datasetBegin(DatasetSample& s, int w, int h, uint32_t episode, int dir, int action) {
+    s.w = (uint16_t)w;
+    s.h = (uint16_t)h;
+    s.episode = episode;
+    s.dir = (uint8_t)dir;
+    s.action = (uint8_t)action;
+    s.length = 0;
+    s.foodCount = 0;
+}
+
+static inline void datasetPushSegment(DatasetSample& s, uint32_t cell) {
+    if (s.length == 0) {
+        s.head = cell;
+    }
+    else {
+        uint32_t i = s.length - 1;
+        uint32_t m;
+        if (cell + s.w == s.tail) m = SIM_UP;
+        else if (cell == s.tail + s.w) m = SIM_DOWN;
+        else if (cell + 1 == s.tail) m = SIM_LEFT;
+        else m = SIM_RIGHT;
+        if ((i & 3) == 0) s.moves[i >> 2] = 0;
+        s.moves[i >> 2] |= (uint8_t)(m << ((i & 3) * 2));
+    }
+    s.tail = cell;
+    s.length++;
+}
+
+static inline void datasetPushFood(DatasetSample& s, uint32_t cell) {
+    if (s.foodCount < SIM_MAX_FOOD) s.food[s.foodCount++] = cell;
+}
+
+static inline void datasetFromSim(DatasetSample& s, const SnakeSim& g, uint32_t episode, int action) {
+    datasetBegin(s, g.w, g.h, episode, g.dir, action);
+    for (uint32_t i = 0; i < g.length; i++) datasetPushSegment(s, g.segment(i));
+    for (int i = 0; i < g.foodCount; i++) datasetPushFood(s, g.food[i]);
+}
+
+// Rebuild the state into g, bound to storage for at least s.w * s.h cells
+static inline void datasetToSim(const DatasetSample& s, SnakeSim& g) {
+    g.w = s.w;
+    g.h = s.h;
+    g.cells = s.w * s.h;
+    g.fruitCount = s.foodCount > 0 ? s.foodCount : 1;
+    std::memset(g.grid, 0, sizeof(uint32_t) * (size_t)g.cells);
+    g.length = s.length;
+    g.headPos = s.length - 1;
+    g.tailSerial = 1;
+    g.headSerial = s.length;
+    g.dir = (SimDir)s.dir;
+    g.gameOver = false;
+    g.gameWon = false;
+
+    uint32_t c = s.head;
+    for (uint32_t i = 0; i < s.length; i++) {
+        g.body[(g.headPos - i) & g.ringMask] = c;
+        g.grid[c] = s.length - i;
+        if (i + 1 < s.length) {
+            switch ((s.moves[i >> 2] >> ((i & 3) * 2)) & 3) {
+            case SIM_UP:   c -= s.w; break;
+            case SIM_DOWN: c += s.w; break;
+            case SIM_LEFT: c -= 1; break;
+            default:       c += 1; break;
+            }
+        }
+    }
+    g.foodCount = s.foodCount;
+    std::memcpy(g.food, s.food, sizeof(uint32_t) * s.foodCount);
+}
+
+//
+// Column coding
+//
+static inline void datasetPutVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static inline void datasetPutDelta(std::vector<uint8_t>& out, uint32_t value, uint32_t prev) {
+    int64_t d = (int64_t)value - (int64_t)prev;
+    datasetPutVarint(out, (uint64_t)((d << 1) ^ (d >> 63)));
+}
+
+struct DatasetCursor {
+    const uint8_t* p;
+    const uint8_t* end;
+
+    bool varint(uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) return false;
+            uint8_t b = *p++;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool delta(uint32_t& value, uint32_t prev) {
+        uint64_t z;
+        if (!varint(z)) return false;
+        int64_t d = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+        int64_t v = (int64_t)prev + d;
+        if (v < 0 || v > 0xFFFFFFFFll) return false;
+        value = (uint32_t)v;
+        return true;
+    }
+
+    bool readByte(uint8_t& v) {
+        if (p >= end) return false;
+        v = *p++;
+        return true;
+    }
+};
+
+// The previous body advanced one cell to the new head (the common case between ticks)
+static inline bool datasetShiftedBody(const DatasetSample& prev, uint32_t head, uint32_t length,
+    uint8_t* moves) {
+    if (prev.length == 0 || length < 1 || length > prev.length + 1) return false;
+    uint32_t w = prev.w, h0 = prev.head;
+    uint32_t m;
+    if (h0 + w == head) m = SIM_UP; // the old head is the next segment
+    else if (head + w == h0) m = SIM_DOWN;
+    else if (h0 + 1 == head && head % w != 0) m = SIM_LEFT;
+    else if (head + 1 == h0 && h0 % w != 0) m = SIM_RIGHT;
+    else return false;
+
+    int bytes = datasetMoveBytes(length);
+    int prevBytes = datasetMoveBytes(prev.length);
+    for (int b = 0; b < bytes; b++) {
+        uint8_t lo = b > 0 ? (uint8_t)(prev.moves[b - 1] >> 6) : (uint8_t)m;
+        uint8_t hi = b < prevBytes ? (uint8_t)(prev.moves[b] << 2) : 0;
+        moves[b] = hi | lo;
+    }
+    return true;
+}
+
+static inline bool datasetSameMoves(const uint8_t* a, const uint8_t* b, uint32_t length) {
+    int bytes = datasetMoveBytes(length);
+    if (bytes == 0) return true;
+    if (bytes > 1 && std::memcmp(a, b, (size_t)bytes - 1) != 0) return false;
+    int used = (int)(length - 1) - 4 * (bytes - 1);
+    uint8_t mask = (uint8_t)((1u << (used * 2)) - 1);
+    return ((a[bytes - 1] ^ b[bytes - 1]) & mask) == 0;
+}
+
+//
+// Writer: submit() from the game loop, packing and file IO on a background thread
+//
+class DatasetWriter {
+public:
+    ~DatasetWriter() { close(); }
+
+    bool open(const char* path, int chunkRecords = 4096, size_t queueSamples = 2048) {
+        close();
+        file = std::fopen(path, "wb");
+        if (!file) return false;
+        DatasetFileHeader fh;
+        std::memcpy(fh.magic, DATASET_MAGIC, sizeof(fh.magic));
+        fh.version = DATASET_VERSION;
+        fh.headerBytes = sizeof(fh);
+        std::fwrite(&fh, sizeof(fh), 1, file);
+        offset = sizeof(fh);
+
+        this->chunkRecords = chunkRecords > 0 ? chunkRecords : 4096;
+        queue.reset(new SpscQueue<DatasetSample>(queueSamples));
+        stopping.store(false, std::memory_order_relaxed);
+        writer = std::thread([this] { run(); });
+        return true;
+    }
+
+    // Never blocks unless wait is set: a full queue drops the sample and counts it
+    bool submit(const DatasetSample& s, bool wait = false) {
+        if (!queue) return false;
+        if (s.w == 0 || s.w > DATASET_MAX_SIDE || s.h > DATASET_MAX_SIDE || s.length == 0) return false;
+        while (!queue->push(s)) {
+            if (!wait) {
+                droppedCount.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    // Drains the queue, writes the index and trailer
+    void close() {
+        if (!file) return;
+        stopping.store(true, std::memory_order_release);
+        writer.join();
+
+        uint64_t indexOffset = offset;
+        if (!index.empty()) std::fwrite(index.data(), sizeof(DatasetIndexEntry), index.size(), file);
+        DatasetTrailer t;
+        t.indexOffset = indexOffset;
+        t.records = totalRecords;
+        t.chunkCount = (uint32_t)index.size();
+        t.version = DATASET_VERSION;
+        std::memcpy(t.magic, DATASET_MAGIC, sizeof(t.magic));
+        std::fwrite(&t, sizeof(t), 1, file);
+        std::fclose(file);
+        file = nullptr;
+        queue.reset();
+        index.clear();
+    }
+
+    bool isOpen() const { return file != nullptr; }
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+    uint64_t records() const { return totalRecords; }
+    uint64_t bytesWritten() const { return offset; }
+
+private:
+    void run() {
+        DatasetSample s;
+        for (;;) {
+            if (!queue->pop(s)) {
+                if (stopping.load(std::memory_order_acquire)) {
+                    if (queue->pop(s)) {
+                        append(s);
+                        continue;
+                    }
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            append(s);
+        }
+        flushChunk();
+    }
+
+    void append(const DatasetSample& s) {
+        if (chunkCount > 0 && (s.w != chunkW || s.h != chunkH)) flushChunk();
+        if (chunkCount == 0) {
+            chunkW = s.w;
+            chunkH = s.h;
+            prev.length = 0;
+            prev.foodCount = 0;
+            prev.episode = 0;
+            prev.head = 0;
+        }
+
+        uint8_t shifted[DATASET_MAX_CELLS / 4];
+        bool implied = datasetShiftedBody(prev, s.head, s.length, shifted) &&
+            datasetSameMoves(shifted, s.moves, s.length);
+
+        datasetPutDelta(columns[DS_COL_EPISODE], s.episode, prev.episode);
+        datasetPutDelta(columns[DS_COL_HEAD], s.head, prev.head);
+        datasetPutDelta(columns[DS_COL_LENGTH], s.length, prev.length);
+        columns[DS_COL_FLAGS].push_back((uint8_t)((s.dir & 3) | (s.action & 3) << 2 | (implied ? 0 : 1) << 4));
+        columns[DS_COL_FOODCOUNT].push_back(s.foodCount);
+        for (int i = 0; i < s.foodCount; i++) {
+            datasetPutDelta(columns[DS_COL_FOOD], s.food[i], i < prev.foodCount ? prev.food[i] : s.head);
+        }
+        if (!implied) {
+            int bytes = datasetMoveBytes(s.length);
+            columns[DS_COL_MOVES].insert(columns[DS_COL_MOVES].end(), s.moves, s.moves + bytes);
+        }
+
+        prev = s;
+        if (++chunkCount == (uint32_t)chunkRecords) flushChunk();
+    }
+
+    void flushChunk() {
+        if (chunkCount == 0) return;
+        DatasetChunkHeader ch;
+        ch.magic = DATASET_CHUNK_MAGIC;
+        ch.records = chunkCount;
+        ch.w = chunkW;
+        ch.h = chunkH;
+        uint32_t bytes = sizeof(ch);
+        for (int c = 0; c < DS_COLUMNS; c++) {
+            ch.columnBytes[c] = (uint32_t)columns[c].size();
+            bytes += ch.columnBytes[c];
+        }
+
+        std::fwrite(&ch, sizeof(ch), 1, file);
+        for (int c = 0; c < DS_COLUMNS; c++) {
+            if (!columns[c].empty()) std::fwrite(columns[c].data(), 1, columns[c].size(), file);
+            columns[c].clear();
+        }
+        index.push_back({ offset, bytes, chunkCount });
+        offset += bytes;
+        totalRecords += chunkCount;
+        chunkCount = 0;
+    }
+
+    std::FILE* file = nullptr;
+    std::unique_ptr<SpscQueue<DatasetSample>> queue;
+    std::thread writer;
+    std::atomic<bool> stopping{ false };
+    std::atomic<uint64_t> droppedCount{ 0 };
+
+    // Writer thread only (and close() after the join)
+    int chunkRecords = 4096;
+    uint32_t chunkCount = 0;
+    uint16_t chunkW = 0, chunkH = 0;
+    DatasetSample prev;
+    std::vector<uint8_t> columns[DS_COLUMNS];
+    std::vector<DatasetIndexEntry> index;
+    uint64_t offset = 0;
+    uint64_t totalRecords = 0;
+};
+
+//
+// Reader: maps the whole file; chunks decode independently
+//
+class DatasetReader {
+public:
+    ~DatasetReader() { close(); }
+
+    bool open(const char* path) {
+        close();
+        if (!map(path)) return false;
+        if (size < sizeof(DatasetFileHeader) || std::memcmp(base, DATASET_MAGIC, sizeof(DATASET_MAGIC)) != 0) {
+            close();
+            return false;
+        }
+        if (!readIndex()) scanChunks();
+        return true;
+    }
+
+    void close() {
+        unmap();
+        index.clear();
+        totalRecords = 0;
+    }
+
+    uint32_t chunkCount() const { return (uint32_t)index.size(); }
+    uint64_t records() const { return totalRecords; }
+    const DatasetIndexEntry& chunk(uint32_t i) const { return index[i]; }
+
+    // Appends chunk i's records to out; false (with out unchanged) if the chunk is corrupt
+    bool readChunk(uint32_t i, std::vector<DatasetSample>& out) const {
+        const DatasetIndexEntry& e = index[i];
+        DatasetChunkHeader ch;
+        std::memcpy(&ch, base + e.offset, sizeof(ch));
+        if (ch.w == 0 || ch.h == 0 || ch.w > DATASET_MAX_SIDE || ch.h > DATASET_MAX_SIDE) return false;
+        if (ch.records == 0) return true;
+
+        DatasetCursor col[DS_COLUMNS];
+        const uint8_t* p = base + e.offset + sizeof(ch);
+        for (int c = 0; c < DS_COLUMNS; c++) {
+            col[c] = { p, p + ch.columnBytes[c] };
+            p += ch.columnBytes[c];
+        }
+
+        size_t first = out.size();
+        out.resize(first + ch.records);
+        uint32_t cells = (uint32_t)ch.w * ch.h;
+        DatasetSample prev;
+        prev.length = 0;
+        prev.foodCount = 0;
+        prev.episode = 0;
+        prev.head = 0;
+
+        for (uint32_t r = 0; r < ch.records; r++) {
+            DatasetSample& s = out[first + r];
+            uint8_t flags, foodCount;
+            bool ok = col[DS_COL_EPISODE].delta(s.episode, prev.episode) &&
+                col[DS_COL_HEAD].delta(s.head, prev.head) &&
+                col[DS_COL_LENGTH].delta(s.length, prev.length) &&
+                col[DS_COL_FLAGS].readByte(flags) &&
+                col[DS_COL_FOODCOUNT].readByte(foodCount);
+            ok = ok && s.head < cells && s.length >= 1 && s.length <= cells && foodCount <= SIM_MAX_FOOD;
+            if (!ok) break;
+
+            s.w = ch.w;
+            s.h = ch.h;
+            s.dir = flags & 3;
+            s.action = (flags >> 2) & 3;
+            s.foodCount = foodCount;
+            for (int f = 0; f < foodCount && ok; f++) {
+                ok = col[DS_COL_FOOD].delta(s.food[f], f < prev.foodCount ? prev.food[f] : s.head) && s.food[f] < cells;
+            }
+            if (!ok) break;
+
+            int bytes = datasetMoveBytes(s.length);
+            if (flags & 0x10) {
+                DatasetCursor& m = col[DS_COL_MOVES];
+                if (m.end - m.p < bytes) break;
+                std::memcpy(s.moves, m.p, (size_t)bytes);
+                m.p += bytes;
+                if (!bodyInBounds(s)) break;
+            }
+            else if (!datasetShiftedBody(prev, s.head, s.length, s.moves)) {
+                break;
+            }
+            s.tail = 0;
+            prev = s;
+            if (r + 1 == ch.records) return true;
+        }
+        out.resize(first);
+        return false;
+    }
+
+private:
+    static bool bodyInBounds(const DatasetSample& s) {
+        int x = (int)(s.head % s.w), y = (int)(s.head / s.w);
+        for (uint32_t i = 0; i + 1 < s.length; i++) {
+            switch ((s.moves[i >> 2] >> ((i & 3) * 2)) & 3) {
+            case SIM_UP:   y--; break;
+            case SIM_DOWN: y++; break;
+            case SIM_LEFT: x--; break;
+            default:       x++; break;
+            }
+            if (x < 0 || x >= s.w || y < 0 || y >= s.h) return false;
+        }
+        return true;
+    }
+
+    bool validChunk(uint64_t off, uint32_t& bytes, uint32_t& records) const {
+        if (off > size || size - off < sizeof(DatasetChunkHeader)) return false;
+        DatasetChunkHeader ch;
+        std::memcpy(&ch, base + off, sizeof(ch));
+        if (ch.magic != DATASET_CHUNK_MAGIC) return false;
+        uint64_t total = sizeof(ch);
+        for (int c = 0; c < DS_COLUMNS; c++) total += ch.columnBytes[c];
+        if (off + total > size) return false;
+        bytes = (uint32_t)total;
+        records = ch.records;
+        return true;
+    }
+
+    bool readIndex() {
+        if (size < sizeof(DatasetFileHeader) + sizeof(DatasetTrailer)) return false;
+        DatasetTrailer t;
+        std::memcpy(&t, base + size - sizeof(t), sizeof(t));
+        if (std::memcmp(t.magic, DATASET_MAGIC, sizeof(t.magic)) != 0) return false;
+        if (t.indexOffset > size || t.chunkCount > size / sizeof(DatasetIndexEntry)) return false;
+        if (t.indexOffset + (uint64_t)t.chunkCount * sizeof(DatasetIndexEntry) + sizeof(t) != size) return false;
+
+        index.resize(t.chunkCount);
+        std::memcpy(index.data(), base + t.indexOffset, sizeof(DatasetIndexEntry) * t.chunkCount);
+        for (auto& e : index) {
+            uint32_t bytes, records;
+            if (!validChunk(e.offset, bytes, records) || bytes != e.bytes || records != e.records) {
+                index.clear();
+                return false;
+            }
+        }
+        totalRecords = t.records;
+        return true;
+    }
+
+    // Recovery for a file whose writer never reached close()
+    void scanChunks() {
+        uint64_t off = sizeof(DatasetFileHeader);
+        uint32_t bytes, records;
+        while (validChunk(off, bytes, records)) {
+            index.push_back({ off, bytes, records });
+            totalRecords += records;
+            off += bytes;
+        }
+    }
+
+#if defined(_WIN32)
+    bool map(const char* path) {
+        fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER li;
+        if (!GetFileSizeEx(fileHandle, &li) || li.QuadPart == 0) {
+            unmap();
+            return false;
+        }
+        size = (size_t)li.QuadPart;
+        mapping = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) {
+            unmap();
+            return false;
+        }
+        base = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!base) {
+            unmap();
+            return false;
+        }
+        return true;
+    }
+
+    void unmap() {
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        base = nullptr;
+        mapping = NULL;
+        fileHandle = INVALID_HANDLE_VALUE;
+        size = 0;
+    }
+
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    bool map(const char* path) {
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t)st.st_size;
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            size = 0;
+            return false;
+        }
+        base = (const uint8_t*)p;
+        return true;
+    }
+
+    void unmap() {
+        if (base) munmap((void*)base, size);
+        base = nullptr;
+        size = 0;
+    }
+#endif
+
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+    std::vector<DatasetIndexEntry> index;
+    uint64_t totalRecords = 0;
+};
+
+//
+// Shuffled stream over one or more files: chunks are visited in a random order, a window
+// of decoded chunks is kept, and samples are drawn uniformly from the window
+//
+class DatasetShuffler {
+public:
+    DatasetShuffler(std::vector<const DatasetReader*> readers, int windowChunks, uint64_t seed)
+        : readers(std::move(readers)), windowChunks(windowChunks > 0 ? windowChunks : 1) {
+        rng.state = seed;
+        for (uint32_t f = 0; f < this->readers.size(); f++) {
+            for (uint32_t c = 0; c < this->readers[f]->chunkCount(); c++) order.push_back({ f, c });
+        }
+        startEpoch();
+    }
+
+    // False once every record of the epoch has been returned; the next call starts a new epoch
+    bool next(DatasetSample& out) {
+        while (pool.size() < poolTarget && nextChunk < order.size()) fill();
+        if (pool.empty()) {
+            startEpoch();
+            return false;
+        }
+        size_t i = rng.below((uint32_t)pool.size());
+        out = pool[i];
+        pool[i] = pool.back();
+        pool.pop_back();
+        return true;
+    }
+
+private:
+    struct ChunkRef {
+        uint32_t file;
+        uint32_t chunk;
+    };
+
+    void startEpoch() {
+        for (size_t i = order.size(); i > 1; i--) std::swap(order[i - 1], order[rng.below((uint32_t)i)]);
+        nextChunk = 0;
+        pool.clear();
+        uint64_t records = 0;
+        for (const DatasetReader* r : readers) records += r->records();
+        size_t chunks = order.size() ? order.size() : 1;
+        poolTarget = (size_t)(records / chunks) * (size_t)(windowChunks - 1) + 1;
+    }
+
+    void fill() {
+        ChunkRef ref = order[nextChunk++];
+        readers[ref.file]->readChunk(ref.chunk, pool);
+    }
+
+    std::vector<const DatasetReader*> readers;
+    int windowChunks;
+    std::vector<ChunkRef> order;
+    size_t nextChunk = 0;
+    size_t poolTarget = 1;
+    std::vector<DatasetSample> pool;
+    SimRng rng;
+};
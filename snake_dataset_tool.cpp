@@ -0,0 +1,224 @@
+// snake_dataset_tool.cpp
+// Headless side of snake_dataset.h: records bot play to a dataset file, and reads files
+// back through the shuffler the way a training loop would.
+// Compile: g++ snake_dataset_tool.cpp -std=c++20 -O2 -pthread -o snake_dataset_tool
+// Run:     ./snake_dataset_tool record bot.snkd [--episodes N] [--width W] [--height H] [--fruits F]
+//          ./snake_dataset_tool read bot.snkd human.snkd [--window CHUNKS]
+
+#include "snake_dataset.h"
+#include "snake_obs.h"
+#include "snake_sim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//
+// Config
+//
+struct ToolConfig {
+    int episodes = 2000;
+    int width = 10;
+    int height = 10;
+    int fruits = 1;
+    int window = 8;
+    uint64_t seed = 1;
+    std::vector<const char*> paths;
+};
+
+static ToolConfig parseArgs(int argc, char** argv, int first) {
+    ToolConfig cfg;
+    for (int i = first; i < argc; i++) {
+        if (!strcmp(argv[i], "--episodes") && i + 1 < argc) cfg.episodes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fruits") && i + 1 < argc) cfg.fruits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--window") && i + 1 < argc) cfg.window = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.seed = strtoull(argv[++i], nullptr, 10);
+        else cfg.paths.push_back(argv[i]);
+    }
+    return cfg;
+}
+
+using ToolClock = std::chrono::steady_clock;
+
+static double secondsSince(ToolClock::time_point t) {
+    return std::chrono::duration<double>(ToolClock::now() - t).count();
+}
+
+// FNV-1a over the fields a record round-trips, so record can check what read returns
+static uint64_t sampleHash(uint64_t h, const DatasetSample& s) {
+    auto mix = [&](uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            h ^= (v >> (i * 8)) & 0xFF;
+            h *= 0x100000001B3ull;
+        }
+    };
+    mix(s.episode);
+    mix(s.head);
+    mix(s.length);
+    mix(s.dir | s.action << 8 | s.foodCount << 16);
+    for (int i = 0; i < s.foodCount; i++) mix(s.food[i]);
+    for (uint32_t i = 0; i + 1 < s.length; i++) mix((s.moves[i >> 2] >> ((i & 3) * 2)) & 3);
+    return h;
+}
+
+//
+// Bot: step towards the nearest fruit, never into a wall or the body, a little noise
+//
+static int botAction(const SnakeSim& g, SimRng& rng) {
+    static const int dx[4] = { 0, 0, -1, 1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    uint32_t head = g.head();
+    int hx = (int)(head % (uint32_t)g.w), hy = (int)(head / (uint32_t)g.w);
+
+    int best = g.dir;
+    int bestScore = -1000000;
+    for (int a = 0; a < 4; a++) {
+        if (a == simOpposite(g.dir)) continue;
+        int x = hx + dx[a], y = hy + dy[a];
+        int score = (int)rng.below(3);
+        if (x < 0 || x >= g.w || y < 0 || y >= g.h || g.occupied((uint32_t)(y * g.w + x))) score -= 100000;
+        int nearest = 1000000;
+        for (int f = 0; f < g.foodCount; f++) {
+            int fx = (int)(g.food[f] % (uint32_t)g.w), fy = (int)(g.food[f] / (uint32_t)g.w);
+            nearest = std::min(nearest, abs(fx - x) + abs(fy - y));
+        }
+        score -= nearest * 4;
+        if (score > bestScore) {
+            bestScore = score;
+            best = a;
+        }
+    }
+    return best;
+}
+
+static int runRecord(const ToolConfig& cfg) {
+    if (cfg.paths.empty()) {
+        printf("record: no output path\n");
+        return 1;
+    }
+    if (cfg.width < 4 || cfg.height < 4 || cfg.width > DATASET_MAX_SIDE || cfg.height > DATASET_MAX_SIDE) {
+        printf("record: grid must be 4..%d on each side\n", DATASET_MAX_SIDE);
+        return 1;
+    }
+
+    DatasetWriter writer;
+    if (!writer.open(cfg.paths[0])) {
+        printf("record: cannot open %s\n", cfg.paths[0]);
+        return 1;
+    }
+
+    int cells = cfg.width * cfg.height;
+    std::vector<uint32_t> storage(SnakeSim::storageWords(cells));
+    SnakeSim g;
+    g.bind(storage.data(), cells);
+    SimRng rng{ cfg.seed };
+    DatasetSample s;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    long long steps = 0;
+    long long scoreSum = 0;
+
+    // Episodes are played one after another so consecutive records share a body
+    auto t0 = ToolClock::now();
+    for (int ep = 0; ep < cfg.episodes; ep++) {
+        g.reset(cfg.width, cfg.height, cfg.fruits, rng.next());
+        while (!g.done() && g.ticksSinceFood < (uint32_t)cells * 2) {
+            int action = botAction(g, rng);
+            datasetFromSim(s, g, (uint32_t)ep, action);
+            writer.submit(s, true);
+            hash = sampleHash(hash, s);
+            g.step(action);
+            steps++;
+        }
+        scoreSum += g.score;
+    }
+    double submitSecs = secondsSince(t0);
+    writer.close();
+    double secs = secondsSince(t0);
+
+    printf("%lld records from %d episodes (mean score %.1f), %.2f M records/s submitted, %.2f M/s written\n",
+        steps, cfg.episodes, double(scoreSum) / cfg.episodes, steps / submitSecs / 1e6, steps / secs / 1e6);
+    printf("%llu bytes, %.2f bytes/record (raw sample %zu bytes)\n",
+        (unsigned long long)writer.bytesWritten(), double(writer.bytesWritten()) / (steps ? steps : 1), sizeof(DatasetSample));
+
+    // Read the file straight back and compare
+    DatasetReader reader;
+    if (!reader.open(cfg.paths[0])) {
+        printf("verify: cannot reopen file\n");
+        return 1;
+    }
+    std::vector<DatasetSample> chunk;
+    uint64_t readHash = 0xCBF29CE484222325ull;
+    uint64_t readRecords = 0;
+    for (uint32_t c = 0; c < reader.chunkCount(); c++) {
+        chunk.clear();
+        if (!reader.readChunk(c, chunk)) {
+            printf("verify: chunk %u is corrupt\n", c);
+            return 1;
+        }
+        for (const DatasetSample& r : chunk) readHash = sampleHash(readHash, r);
+        readRecords += chunk.size();
+    }
+    bool ok = readHash == hash && readRecords == (uint64_t)steps;
+    printf("verify: %llu records in %u chunks, %s\n", (unsigned long long)readRecords, reader.chunkCount(),
+        ok ? "identical" : "MISMATCH");
+    return ok ? 0 : 1;
+}
+
+//
+// One shuffled epoch: decode every record and encode its observation, as a loader would
+//
+static int runRead(const ToolConfig& cfg) {
+    std::vector<DatasetReader> readers(cfg.paths.size());
+    std::vector<const DatasetReader*> open;
+    for (size_t i = 0; i < cfg.paths.size(); i++) {
+        if (!readers[i].open(cfg.paths[i])) {
+            printf("read: cannot open %s\n", cfg.paths[i]);
+            return 1;
+        }
+        printf("%s: %llu records in %u chunks\n", cfg.paths[i], (unsigned long long)readers[i].records(), readers[i].chunkCount());
+        open.push_back(&readers[i]);
+    }
+    if (open.empty()) {
+        printf("read: no input files\n");
+        return 1;
+    }
+
+    DatasetShuffler shuffler(open, cfg.window, cfg.seed);
+    std::vector<uint32_t> storage(SnakeSim::storageWords(DATASET_MAX_CELLS));
+    std::vector<float> obs((size_t)OBS_BOARD_CHANNELS * DATASET_MAX_CELLS);
+    SnakeSim g;
+    g.bind(storage.data(), DATASET_MAX_CELLS);
+
+    DatasetSample s;
+    long long count = 0;
+    long long actions[4] = {};
+    auto t0 = ToolClock::now();
+    while (shuffler.next(s)) {
+        datasetToSim(s, g);
+        int cells = g.w * g.h;
+        obsEncodeBoard(g, { obs.data(), (ptrdiff_t)cells, (ptrdiff_t)g.w });
+        actions[s.action & 3]++;
+        count++;
+    }
+    double secs = secondsSince(t0);
+    printf("shuffled epoch: %lld samples, %.2f M samples/s decoded + encoded (window %d chunks)\n",
+        count, count / secs / 1e6, cfg.window);
+    printf("actions: up %lld  down %lld  left %lld  right %lld\n", actions[0], actions[1], actions[2], actions[3]);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: snake_dataset_tool record <file> [options] | read <file>... [options]\n");
+        return 1;
+    }
+    ToolConfig cfg = parseArgs(argc, argv, 2);
+    if (!strcmp(argv[1], "record")) return runRecord(cfg);
+    if (!strcmp(argv[1], "read")) return runRead(cfg);
+    printf("unknown command %s\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,450 @@
+// snake_env.cpp
+// Vectorized headless Snake environment behind the C ABI in snake_env.h
+// Compile: g++ snake_env.cpp -std=c++20 -O2 -shared -fPIC -fvisibility=hidden -o libsnake_env.so
+
+#include "snake_env.h"
+#include "snake_sim.h"
+#include "snake_obs.h"
+#include "snake_queue.h"
+
+#include <vector>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+struct SnakeEnv {
+    int n;
+    SnakeEnvSettings settings;
+    int obsWidth = 0, obsHeight = 0; // largest level up to the frontier
+    int slotCells = 0;             // cells each game's storage holds
+    std::vector<uint32_t> storage; // one arena for every game's grid + body ring, sized to the largest level up to the frontier
+    std::vector<SnakeSim> games;
+    std::vector<uint8_t> gameLevel;
+    std::vector<int32_t> lastScore;
+    std::vector<int32_t> lastLength;
+
+    // Curriculum; a plain env is a single level that is never rescheduled
+    std::vector<SnakeEnvLevel> levels;
+    std::vector<float> mastery;       // running mean of score / targetScore
+    std::vector<uint32_t> levelEpisodes;
+    std::vector<float> drawCdf;       // cumulative draw weights over levels 0..frontier
+    std::vector<float> margins;       // per level up to the frontier: body plane with 1 outside the board, for boards smaller than the tensor
+    int frontier = 0;
+    bool unlockPending = false;       // frontier mastered during this step; moves on once the step is written
+};
+
+static constexpr float CURRICULUM_RATE = 0.05f;      // running-mean rate once warmed up
+static constexpr uint32_t CURRICULUM_MIN_EPISODES = 32;
+static constexpr float CURRICULUM_REVIEW_FLOOR = 0.1f;
+
+//
+// Helpers
+//
+static uint64_t gameSeed(uint64_t seed, uint64_t index) {
+    SimRng r{ seed ^ (index * 0xD1B54A32D192ED03ull) };
+    return r.next();
+}
+
+static_assert((int)OBS_HEAD == (int)SNAKE_OBS_HEAD && (int)OBS_BODY == (int)SNAKE_OBS_BODY &&
+    (int)OBS_AGE == (int)SNAKE_OBS_AGE && (int)OBS_FOOD == (int)SNAKE_OBS_FOOD &&
+    (int)OBS_BOARD_CHANNELS == (int)SNAKE_ENV_CHANNELS, "channel order");
+
+static size_t obsStride(const SnakeEnv* env) {
+    return (size_t)env->obsWidth * env->obsHeight * SNAKE_ENV_CHANNELS;
+}
+
+// Write one game's planes straight into the caller's tensor. A board smaller than the
+// tensor goes in the top-left corner; everything outside it reads as body.
+static void encodeObs(const SnakeEnv* env, int i, float* obs) {
+    const SnakeSim& g = env->games[i];
+    int ow = env->obsWidth, oh = env->obsHeight;
+    if (g.w == ow && g.h == oh) {
+        obsEncodeBoard(g, { obs, (ptrdiff_t)g.cells, (ptrdiff_t)g.w });
+        return;
+    }
+    // One contiguous clear, the body plane from the level's prebuilt margin, then the board
+    size_t plane = (size_t)ow * oh;
+    std::memset(obs, 0, sizeof(float) * plane * SNAKE_ENV_CHANNELS);
+    std::memcpy(obs + plane * SNAKE_OBS_BODY, env->margins.data() + plane * env->gameLevel[i], sizeof(float) * plane);
+    obsEncodeBoard(g, { obs, (ptrdiff_t)plane, (ptrdiff_t)ow }, true);
+}
+
+static void updateDrawWeights(SnakeEnv* env) {
+    env->drawCdf.resize((size_t)env->frontier + 1);
+    float total = 0.0f;
+    for (int l = 0; l <= env->frontier; l++) {
+        float w = l == env->frontier ? 1.0f : std::max(CURRICULUM_REVIEW_FLOOR, 1.0f - std::min(env->mastery[l], 1.0f));
+        env->drawCdf[l] = total += w;
+    }
+}
+
+// Level for the episode with this seed; a plain env never draws
+static int drawLevel(const SnakeEnv* env, uint64_t seed) {
+    if (env->frontier == 0) return 0;
+    SimRng r{ seed ^ 0x4C4556454Cull };
+    float u = (float)(r.next() >> 40) * (1.0f / 16777216.0f) * env->drawCdf.back();
+    int l = 0;
+    while (l < env->frontier && u >= env->drawCdf[l]) l++;
+    return l;
+}
+
+static void resetGame(SnakeEnv* env, int i, uint64_t seed) {
+    int l = drawLevel(env, seed);
+    const SnakeEnvLevel& lv = env->levels[l];
+    env->gameLevel[i] = (uint8_t)l;
+    env->games[i].reset(lv.gridWidth, lv.gridHeight, lv.fruitCount, seed);
+}
+
+// Scheduler update from one finished episode
+static void recordEpisode(SnakeEnv* env, int level, int score) {
+    if (env->levels.size() < 2) return;
+    uint32_t k = ++env->levelEpisodes[level];
+    float rate = std::max(CURRICULUM_RATE, 1.0f / (float)k); // plain mean until warmed up
+    const SnakeEnvLevel& lv = env->levels[level];
+    env->mastery[level] += rate * ((float)score / (float)std::max(1, lv.targetScore) - env->mastery[level]);
+
+    int last = (int)env->levels.size() - 1;
+    if (level == env->frontier && env->frontier < last && k >= CURRICULUM_MIN_EPISODES && env->mastery[level] >= 1.0f) {
+        env->unlockPending = true;
+    }
+    updateDrawWeights(env);
+}
+
+// Size the tensor, the margins and every slot's storage to the levels up to the frontier.
+// The tensor and storage only ever grow; games in play move to the new storage as they are.
+static void fitLevels(SnakeEnv* env) {
+    int maxCells = env->slotCells;
+    for (int l = 0; l <= env->frontier; l++) {
+        const SnakeEnvLevel& lv = env->levels[l];
+        env->obsWidth = std::max(env->obsWidth, (int)lv.gridWidth);
+        env->obsHeight = std::max(env->obsHeight, (int)lv.gridHeight);
+        maxCells = std::max(maxCells, lv.gridWidth * lv.gridHeight);
+    }
+
+    size_t plane = (size_t)env->obsWidth * env->obsHeight;
+    env->margins.assign(plane * ((size_t)env->frontier + 1), 1.0f);
+    for (int l = 0; l <= env->frontier; l++) {
+        for (int y = 0; y < env->levels[l].gridHeight; y++) {
+            float* row = env->margins.data() + plane * l + (size_t)y * env->obsWidth;
+            std::fill(row, row + env->levels[l].gridWidth, 0.0f);
+        }
+    }
+
+    if (maxCells == env->slotCells) return;
+    size_t words = SnakeSim::storageWords(maxCells);
+    std::vector<uint32_t> storage(words * (size_t)env->n);
+    for (int i = 0; i < (int)env->games.size(); i++) {
+        env->games[i].rebind(storage.data() + words * (size_t)i, maxCells);
+    }
+    env->storage.swap(storage);
+    env->slotCells = maxCells;
+}
+
+// Called between steps, so a step never writes rows of two shapes
+static void unlockNextLevel(SnakeEnv* env) {
+    if (!env->unlockPending) return;
+    env->unlockPending = false;
+    env->frontier++;
+    fitLevels(env);
+    updateDrawWeights(env);
+}
+
+// One tick of game i with auto-reset; obs may be null
+static void stepGame(SnakeEnv* env, int i, int action, float* obs, float* rewardOut, uint8_t* doneOut) {
+    const SnakeEnvSettings& s = env->settings;
+    SnakeSim& g = env->games[i];
+    float reward = s.rewardTick;
+    bool done = false;
+
+    switch (g.step(action)) {
+    case SIM_MOVED:
+        if (s.maxIdleTicks > 0 && g.ticksSinceFood >= (uint32_t)s.maxIdleTicks) done = true;
+        break;
+    case SIM_ATE:
+        reward += s.rewardFood;
+        break;
+    case SIM_DIED:
+        reward += s.rewardDeath;
+        done = true;
+        break;
+    case SIM_WON:
+        reward += s.rewardFood + s.rewardWin;
+        done = true;
+        break;
+    }
+
+    if (done) {
+        // Auto-reset: the next episode's seed continues this game's stream
+        env->lastScore[i] = g.score;
+        env->lastLength[i] = (int32_t)g.length;
+        recordEpisode(env, env->gameLevel[i], g.score);
+        resetGame(env, i, g.rng.next());
+    }
+
+    *rewardOut = reward;
+    *doneOut = done ? 1 : 0;
+    if (obs) encodeObs(env, i, obs);
+}
+
+static bool validLevel(const SnakeEnvLevel& l) {
+    if (l.gridWidth < 5 || l.gridHeight < 5) return false;
+    if (l.gridWidth > 4096 || l.gridHeight > 4096) return false;
+    if (l.fruitCount < 1 || l.fruitCount > SIM_MAX_FOOD) return false;
+    return true;
+}
+
+static SnakeEnvLevel settingsLevel(const SnakeEnvSettings& s) {
+    return { s.gridWidth, s.gridHeight, s.fruitCount, 0 };
+}
+
+static bool validSettings(int32_t n, const SnakeEnvSettings* settings) {
+    if (n <= 0 || !settings) return false;
+    return validLevel(settingsLevel(*settings));
+}
+
+//
+// C API
+//
+void env_default_settings(SnakeEnvSettings* settings) {
+    settings->gridWidth = 10;
+    settings->gridHeight = 10;
+    settings->fruitCount = 1;
+    settings->maxIdleTicks = 0;
+    settings->seed = 0;
+    settings->rewardFood = 1.0f;
+    settings->rewardDeath = -1.0f;
+    settings->rewardWin = 1.0f;
+    settings->rewardTick = 0.0f;
+}
+
+SnakeEnv* env_create(int32_t n, const SnakeEnvSettings* settings) {
+    if (!validSettings(n, settings)) return nullptr;
+    SnakeEnvLevel level = settingsLevel(*settings);
+    return env_create_curriculum(n, settings, &level, 1);
+}
+
+SnakeEnv* env_create_curriculum(int32_t n, const SnakeEnvSettings* settings, const SnakeEnvLevel* levels, int32_t level_count) {
+    if (n <= 0 || !settings || !levels || level_count < 1 || level_count > SNAKE_ENV_MAX_LEVELS) return nullptr;
+    for (int l = 0; l < level_count; l++) {
+        if (!validLevel(levels[l])) return nullptr;
+    }
+
+    SnakeEnv* env = new SnakeEnv();
+    env->n = n;
+    env->settings = *settings;
+    env->levels.assign(levels, levels + level_count);
+    env->mastery.assign((size_t)level_count, 0.0f);
+    env->levelEpisodes.assign((size_t)level_count, 0);
+    updateDrawWeights(env);
+
+    // Every slot can hold the largest level up to the frontier, so a slot changes level
+    // without moving; storage only grows when the frontier reaches a larger board
+    fitLevels(env);
+    size_t words = SnakeSim::storageWords(env->slotCells);
+    env->games.resize((size_t)n);
+    env->gameLevel.assign((size_t)n, 0);
+    env->lastScore.assign((size_t)n, 0);
+    env->lastLength.assign((size_t)n, 0);
+    for (int i = 0; i < n; i++) {
+        env->games[i].bind(env->storage.data() + words * (size_t)i, env->slotCells);
+        resetGame(env, i, gameSeed(settings->seed, (uint64_t)i));
+    }
+    return env;
+}
+
+void env_destroy(SnakeEnv* env) {
+    delete env;
+}
+
+void env_obs_shape(const SnakeEnv* env, int32_t shape_out[4]) {
+    shape_out[0] = env->n;
+    shape_out[1] = SNAKE_ENV_CHANNELS;
+    shape_out[2] = env->obsHeight;
+    shape_out[3] = env->obsWidth;
+}
+
+void env_reset(SnakeEnv* env, float* obs_out) {
+    size_t stride = obsStride(env);
+    for (int i = 0; i < env->n; i++) {
+        resetGame(env, i, gameSeed(env->settings.seed, (uint64_t)i));
+        if (obs_out) encodeObs(env, i, obs_out + stride * (size_t)i);
+    }
+}
+
+void env_step(SnakeEnv* env, const int32_t* actions, float* obs_out, float* reward_out, uint8_t* done_out) {
+    size_t stride = obsStride(env);
+    for (int i = 0; i < env->n; i++) {
+        float reward;
+        uint8_t done;
+        stepGame(env, i, actions[i], obs_out ? obs_out + stride * (size_t)i : nullptr, &reward, &done);
+        if (reward_out) reward_out[i] = reward;
+        if (done_out) done_out[i] = done;
+    }
+    unlockNextLevel(env);
+}
+
+void env_last_episode(const SnakeEnv* env, int32_t i, int32_t* score_out, int32_t* length_out) {
+    if (score_out) *score_out = env->lastScore[i];
+    if (length_out) *length_out = env->lastLength[i];
+}
+
+int32_t env_game_level(const SnakeEnv* env, int32_t i, int32_t* width_out, int32_t* height_out) {
+    if (width_out) *width_out = env->games[i].w;
+    if (height_out) *height_out = env->games[i].h;
+    return env->gameLevel[i];
+}
+
+int32_t env_curriculum_state(const SnakeEnv* env, float* mastery_out, float* share_out) {
+    int count = (int)env->levels.size();
+    for (int l = 0; l < count; l++) {
+        if (mastery_out) mastery_out[l] = env->mastery[l];
+        if (share_out) {
+            float lo = l == 0 ? 0.0f : env->drawCdf[std::min(l - 1, env->frontier)];
+            float hi = env->drawCdf[std::min(l, env->frontier)];
+            share_out[l] = l <= env->frontier ? (hi - lo) / env->drawCdf.back() : 0.0f;
+        }
+    }
+    return env->frontier;
+}
+
+//
+// Asynchronous pool
+// Results are written straight into a ring of preallocated batches: every finished game
+// takes a ticket, ticket / batchSize picks the batch and ticket % batchSize the row.
+// With at most n games in flight, n / batchSize + 3 batches can never be overrun
+// while the caller still holds the one it received.
+//
+struct PoolTask {
+    int32_t env;
+    int32_t action; // -1 = reset
+};
+
+struct PoolBatch {
+    std::vector<int32_t> envIds;
+    std::vector<float> obs;
+    std::vector<float> reward;
+    std::vector<uint8_t> done;
+    alignas(CACHE_LINE) std::atomic<uint32_t> filled{ 0 };
+};
+
+struct SnakeEnvPool {
+    SnakeEnv* env = nullptr;
+    int batchSize = 0;
+    size_t stride = 0;
+    std::vector<PoolBatch> batches;
+    MpmcQueue<PoolTask> tasks;
+    std::vector<std::thread> workers;
+
+    alignas(CACHE_LINE) std::atomic<uint64_t> writeTicket{ 0 };
+    alignas(CACHE_LINE) std::atomic<uint32_t> taskSignal{ 0 };
+    alignas(CACHE_LINE) std::atomic_bool stop{ false };
+    uint64_t readBatch = 0;
+    bool holding = false;
+
+    explicit SnakeEnvPool(int n) : tasks((size_t)n) {}
+};
+
+static void poolWorker(SnakeEnvPool* pool) {
+    while (!pool->stop.load(std::memory_order_relaxed)) {
+        uint32_t seen = pool->taskSignal.load(std::memory_order_acquire);
+        PoolTask t;
+        if (!pool->tasks.pop(t)) {
+            // Idle: sleep until env_pool_send bumps the signal
+            pool->taskSignal.wait(seen, std::memory_order_acquire);
+            continue;
+        }
+
+        uint64_t ticket = pool->writeTicket.fetch_add(1, std::memory_order_relaxed);
+        PoolBatch& b = pool->batches[(ticket / pool->batchSize) % pool->batches.size()];
+        size_t row = (size_t)(ticket % pool->batchSize);
+        float* obs = b.obs.data() + pool->stride * row;
+
+        b.envIds[row] = t.env;
+        if (t.action < 0) {
+            resetGame(pool->env, t.env, gameSeed(pool->env->settings.seed, (uint64_t)t.env));
+            encodeObs(pool->env, t.env, obs);
+            b.reward[row] = 0.0f;
+            b.done[row] = 0;
+        }
+        else {
+            stepGame(pool->env, t.env, t.action, obs, &b.reward[row], &b.done[row]);
+        }
+
+        if (b.filled.fetch_add(1, std::memory_order_acq_rel) + 1 == (uint32_t)pool->batchSize) {
+            b.filled.notify_one();
+        }
+    }
+}
+
+static void poolPush(SnakeEnvPool* pool, PoolTask t) {
+    while (!pool->tasks.push(t)) std::this_thread::yield();
+}
+
+SnakeEnvPool* env_pool_create(int32_t n, int32_t batch_size, int32_t threads, const SnakeEnvSettings* settings) {
+    if (!validSettings(n, settings)) return nullptr;
+    if (batch_size < 1 || batch_size > n) return nullptr;
+    if (threads <= 0) threads = (int32_t)std::max(1u, std::thread::hardware_concurrency());
+
+    SnakeEnvPool* pool = new SnakeEnvPool(n);
+    pool->env = env_create(n, settings);
+    pool->batchSize = batch_size;
+    pool->stride = obsStride(pool->env);
+
+    pool->batches = std::vector<PoolBatch>((size_t)(n / batch_size + 3));
+    for (auto& b : pool->batches) {
+        b.envIds.resize((size_t)batch_size);
+        b.obs.resize(pool->stride * (size_t)batch_size);
+        b.reward.resize((size_t)batch_size);
+        b.done.resize((size_t)batch_size);
+    }
+
+    for (int i = 0; i < threads; i++) pool->workers.emplace_back(poolWorker, pool);
+    return pool;
+}
+
+void env_pool_destroy(SnakeEnvPool* pool) {
+    if (!pool) return;
+    pool->stop = true;
+    pool->taskSignal.fetch_add(1, std::memory_order_release);
+    pool->taskSignal.notify_all();
+    for (auto& t : pool->workers) t.join();
+    env_destroy(pool->env);
+    delete pool;
+}
+
+void env_pool_reset(SnakeEnvPool* pool) {
+    for (int i = 0; i < pool->env->n; i++) poolPush(pool, { i, -1 });
+    pool->taskSignal.fetch_add(1, std::memory_order_release);
+    pool->taskSignal.notify_all();
+}
+
+void env_pool_send(SnakeEnvPool* pool, const int32_t* actions, const int32_t* env_ids, int32_t count) {
+    for (int i = 0; i < count; i++) poolPush(pool, { env_ids[i], std::max(0, actions[i]) });
+    pool->taskSignal.fetch_add(1, std::memory_order_release);
+    pool->taskSignal.notify_all();
+}
+
+void env_pool_recv(SnakeEnvPool* pool, SnakeEnvBatch* batch_out) {
+    size_t ringSize = pool->batches.size();
+
+    // Hand the previously received batch back to the ring
+    if (pool->holding) {
+        pool->batches[pool->readBatch % ringSize].filled.store(0, std::memory_order_relaxed);
+        pool->readBatch++;
+    }
+
+    PoolBatch& b = pool->batches[pool->readBatch % ringSize];
+    uint32_t filled = b.filled.load(std::memory_order_acquire);
+    while (filled < (uint32_t)pool->batchSize) {
+        b.filled.wait(filled, std::memory_order_acquire);
+        filled = b.filled.load(std::memory_order_acquire);
+    }
+    pool->holding = true;
+
+    batch_out->count = pool->batchSize;
+    batch_out->env_ids = b.envIds.data();
+    batch_out->obs = b.obs.data();
+    batch_out->reward = b.reward.data();
+    batch_out->done = b.done.data();
+}
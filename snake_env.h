@@ -0,0 +1,130 @@
+// snake_env.h
+// C ABI for running many headless Snake games as one vectorized, Gym-style environment.
+// Observations are written straight into caller-owned float32 tensors laid out as
+// [n][SNAKE_ENV_CHANNELS][height][width]; nothing is allocated per step.
+
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define SNAKE_ENV_API __declspec(dllexport)
+#else
+#define SNAKE_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Observation channels
+enum {
+    SNAKE_OBS_HEAD = 0,  // 1 at the head
+    SNAKE_OBS_BODY = 1,  // 1 on every other segment
+    SNAKE_OBS_AGE = 2,   // (i + 1) / length for segment i: 1/length at the head, 1 at the tail
+    SNAKE_OBS_FOOD = 3,  // 1 on each fruit
+    SNAKE_ENV_CHANNELS = 4
+};
+
+// Actions are absolute directions, same order as the game: 0=up 1=down 2=left 3=right.
+// A reversal is ignored, exactly like a reversing key press in the game.
+
+typedef struct SnakeEnvSettings {
+    int32_t gridWidth;    // >= 5
+    int32_t gridHeight;   // >= 5
+    int32_t fruitCount;   // 1-32
+    int32_t maxIdleTicks; // end an episode after this many ticks without food, 0 = never
+    uint64_t seed;        // game i is seeded from (seed, i)
+    float rewardFood;
+    float rewardDeath;
+    float rewardWin;
+    float rewardTick;
+} SnakeEnvSettings;
+
+typedef struct SnakeEnv SnakeEnv;
+
+// Fills in the defaults: 10x10, 1 fruit, no idle limit, +1 food / -1 death / +1 win
+SNAKE_ENV_API void env_default_settings(SnakeEnvSettings* settings);
+
+// Returns NULL if n or the settings are out of range
+SNAKE_ENV_API SnakeEnv* env_create(int32_t n, const SnakeEnvSettings* settings);
+SNAKE_ENV_API void env_destroy(SnakeEnv* env);
+
+// shape_out = { n, SNAKE_ENV_CHANNELS, height, width }
+SNAKE_ENV_API void env_obs_shape(const SnakeEnv* env, int32_t shape_out[4]);
+
+// Restarts every game and writes the first observations
+SNAKE_ENV_API void env_reset(SnakeEnv* env, float* obs_out);
+
+// Advances every game by one tick. Games that end report done_out[i] = 1 and are
+// reset straight away, so obs_out[i] already shows the first frame of the next episode.
+SNAKE_ENV_API void env_step(SnakeEnv* env, const int32_t* actions, float* obs_out,
+    float* reward_out, uint8_t* done_out);
+
+// Score and length of the last finished episode of game i (0 before any finished)
+SNAKE_ENV_API void env_last_episode(const SnakeEnv* env, int32_t i, int32_t* score_out, int32_t* length_out);
+
+//
+// Curriculum
+// Each game slot runs one level at a time; a slot draws its next level whenever its episode
+// ends. Levels are listed easiest first. Every level up to the frontier can be drawn: the
+// frontier always at full weight, earlier ones less the better they are already played,
+// down to a floor that keeps them from being forgotten. The frontier moves on once its
+// recent mean score reaches targetScore. The observation tensor is as large as the largest
+// level up to the frontier; smaller boards sit in its top-left corner with the cells outside
+// marked as body. It grows when the frontier moves on to a larger board, which happens at
+// the end of an env_step: read env_obs_shape again after a step whose frontier (from
+// env_curriculum_state) changed, and pass a tensor of the new shape from then on.
+//
+enum { SNAKE_ENV_MAX_LEVELS = 16 };
+
+typedef struct SnakeEnvLevel {
+    int32_t gridWidth;
+    int32_t gridHeight;
+    int32_t fruitCount;
+    int32_t targetScore;  // recent mean score that unlocks the next level (10 per fruit)
+} SnakeEnvLevel;
+
+// Like env_create, with the grid size and fruit count of settings replaced by the levels
+SNAKE_ENV_API SnakeEnv* env_create_curriculum(int32_t n, const SnakeEnvSettings* settings,
+    const SnakeEnvLevel* levels, int32_t level_count);
+
+// Level game i is playing now, and its board size
+SNAKE_ENV_API int32_t env_game_level(const SnakeEnv* env, int32_t i, int32_t* width_out, int32_t* height_out);
+
+// Returns the frontier level. mastery_out (recent mean score / target) and share_out (chance
+// of being drawn) take level_count values each and may be null.
+SNAKE_ENV_API int32_t env_curriculum_state(const SnakeEnv* env, float* mastery_out, float* share_out);
+
+//
+// Asynchronous pool (EnvPool-style)
+// Worker threads step games as soon as their actions arrive; env_pool_recv returns the
+// first batch_size games to finish, whichever they are. Only send actions for games
+// you have received, so at most n games are ever in flight.
+//
+typedef struct SnakeEnvPool SnakeEnvPool;
+
+// Rows of one received batch. The pointers stay valid until the next env_pool_recv.
+typedef struct SnakeEnvBatch {
+    int32_t count;
+    const int32_t* env_ids;
+    const float* obs;       // [count][SNAKE_ENV_CHANNELS][height][width]
+    const float* reward;
+    const uint8_t* done;
+} SnakeEnvBatch;
+
+// threads <= 0 uses every hardware thread. 1 <= batch_size <= n.
+SNAKE_ENV_API SnakeEnvPool* env_pool_create(int32_t n, int32_t batch_size, int32_t threads,
+    const SnakeEnvSettings* settings);
+SNAKE_ENV_API void env_pool_destroy(SnakeEnvPool* pool);
+
+// Queues a reset of every game; their first observations arrive through env_pool_recv
+SNAKE_ENV_API void env_pool_reset(SnakeEnvPool* pool);
+SNAKE_ENV_API void env_pool_send(SnakeEnvPool* pool, const int32_t* actions, const int32_t* env_ids, int32_t count);
+
+// Blocks until batch_size games have results
+SNAKE_ENV_API void env_pool_recv(SnakeEnvPool* pool, SnakeEnvBatch* batch_out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,435 @@
+// snake_env_bench.cpp
+// Throughput benchmark for the headless training environment
+// Compile: g++ snake_env_bench.cpp snake_env.cpp -std=c++20 -O2 -pthread -o snake_env_bench
+
+#include "snake_env.h"
+#include "snake_sim.h"
+#include "snake_obs.h"
+#include "snake_replay.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+//
+// Config
+//
+struct BenchConfig {
+    int envs = 256;
+    int steps = 20000;
+    int width = 10;
+    int height = 10;
+    int fruits = 1;
+    bool noObs = false;
+    int batch = 64;
+    int threads = 0;
+    int workUs = 0; // simulated trainer time per batch
+    int crop = 11;
+    int capacity = 1 << 20; // replay transitions
+    const char* mode = "sync";
+};
+
+static BenchConfig parseArgs(int argc, char** argv) {
+    BenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--envs") && i + 1 < argc) cfg.envs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--steps") && i + 1 < argc) cfg.steps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fruits") && i + 1 < argc) cfg.fruits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--no-obs")) cfg.noObs = true;
+        else if (!strcmp(argv[i], "--batch") && i + 1 < argc) cfg.batch = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) cfg.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--work-us") && i + 1 < argc) cfg.workUs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--crop") && i + 1 < argc) cfg.crop = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--capacity") && i + 1 < argc) cfg.capacity = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--mode") && i + 1 < argc) cfg.mode = argv[++i];
+    }
+    return cfg;
+}
+
+//
+// Helpers
+//
+using BenchClock = std::chrono::steady_clock;
+
+static SnakeEnvSettings benchSettings(const BenchConfig& cfg) {
+    SnakeEnvSettings s;
+    env_default_settings(&s);
+    s.gridWidth = cfg.width;
+    s.gridHeight = cfg.height;
+    s.fruitCount = cfg.fruits;
+    s.seed = 1;
+    return s;
+}
+
+// Stand-in for the trainer's forward pass
+static void simulateWork(int us) {
+    if (us <= 0) return;
+    auto until = BenchClock::now() + std::chrono::microseconds(us);
+    while (BenchClock::now() < until) {}
+}
+
+static double usSince(BenchClock::time_point t) {
+    return std::chrono::duration<double, std::micro>(BenchClock::now() - t).count();
+}
+
+static void printLatency(const char* label, std::vector<double>& samples) {
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&](double p) { return samples[std::min(samples.size() - 1, size_t(p * samples.size()))]; };
+    printf("%s wait us: p50 %.1f  p99 %.1f  max %.1f\n", label, pct(0.50), pct(0.99), samples.back());
+}
+
+//
+// Synchronous env_step loop with random actions
+//
+static void benchSync(const BenchConfig& cfg) {
+    SnakeEnvSettings s = benchSettings(cfg);
+
+    SnakeEnv* env = env_create(cfg.envs, &s);
+    if (!env) {
+        printf("invalid settings\n");
+        return;
+    }
+
+    int32_t shape[4];
+    env_obs_shape(env, shape);
+    std::vector<float> obs((size_t)shape[0] * shape[1] * shape[2] * shape[3]);
+    std::vector<float> reward(cfg.envs);
+    std::vector<uint8_t> done(cfg.envs);
+    std::vector<int32_t> actions(cfg.envs);
+    float* obsOut = cfg.noObs ? nullptr : obs.data();
+
+    env_reset(env, obsOut);
+    SimRng rng{ 42 };
+    long long episodes = 0;
+
+    std::vector<double> waits;
+    waits.reserve((size_t)cfg.steps);
+
+    auto t0 = BenchClock::now();
+    for (int step = 0; step < cfg.steps; step++) {
+        for (auto& a : actions) a = (int32_t)rng.below(4);
+        auto w0 = BenchClock::now();
+        env_step(env, actions.data(), obsOut, reward.data(), done.data());
+        waits.push_back(usSince(w0));
+        for (uint8_t d : done) episodes += d;
+        // The trainer sees every env each step: one forward pass per batch-sized chunk
+        for (int b = 0; b < cfg.envs; b += cfg.batch) simulateWork(cfg.workUs);
+    }
+    double secs = usSince(t0) / 1e6;
+    double total = double(cfg.envs) * cfg.steps;
+    printf("sync  %dx%d envs=%d obs=%s: %.2f M steps/s, %lld episodes\n",
+        cfg.width, cfg.height, cfg.envs, cfg.noObs ? "off" : "on", total / secs / 1e6, episodes);
+    printLatency("sync ", waits);
+
+    env_destroy(env);
+}
+
+//
+// Curriculum: mixed boards in one env, random actions. The levels are easy enough for
+// random play to clear the first ones, so the scheduler can be watched moving on.
+//
+static void benchCurriculum(const BenchConfig& cfg) {
+    SnakeEnvSettings s = benchSettings(cfg);
+    const SnakeEnvLevel levels[] = {
+        { 5, 5, 6, 10 },
+        { 8, 8, 8, 10 },
+        { 12, 12, 8, 10 },
+        { 16, 16, 4, 10 },
+        { cfg.width, cfg.height, cfg.fruits, 10 },
+    };
+    const int count = (int)(sizeof(levels) / sizeof(levels[0]));
+    SnakeEnv* env = env_create_curriculum(cfg.envs, &s, levels, count);
+    if (!env) {
+        printf("invalid settings\n");
+        return;
+    }
+
+    int32_t shape[4];
+    env_obs_shape(env, shape);
+    std::vector<float> obs((size_t)shape[0] * shape[1] * shape[2] * shape[3]);
+    std::vector<float> reward(cfg.envs);
+    std::vector<uint8_t> done(cfg.envs);
+    std::vector<int32_t> actions(cfg.envs);
+    float* obsOut = cfg.noObs ? nullptr : obs.data();
+    float mastery[SNAKE_ENV_MAX_LEVELS], share[SNAKE_ENV_MAX_LEVELS];
+
+    env_reset(env, obsOut);
+    SimRng rng{ 42 };
+    long long episodes = 0, cellSteps = 0, tensorSteps = 0;
+    int report = std::max(1, cfg.steps / 5);
+    int frontier = 0;
+
+    auto t0 = BenchClock::now();
+    for (int step = 1; step <= cfg.steps; step++) {
+        for (auto& a : actions) a = (int32_t)rng.below(4);
+        env_step(env, actions.data(), obsOut, reward.data(), done.data());
+        tensorSteps += (long long)shape[2] * shape[3] * cfg.envs;
+        // The tensor grows when the frontier reaches a larger board
+        if (env_curriculum_state(env, nullptr, nullptr) != frontier) {
+            frontier = env_curriculum_state(env, nullptr, nullptr);
+            env_obs_shape(env, shape);
+            obs.resize((size_t)shape[0] * shape[1] * shape[2] * shape[3]);
+            if (obsOut) obsOut = obs.data();
+            printf("step %6d  frontier %d  tensor %dx%d\n", step, frontier, shape[3], shape[2]);
+        }
+        for (int i = 0; i < cfg.envs; i++) {
+            int32_t w, h;
+            env_game_level(env, i, &w, &h);
+            cellSteps += w * h;
+            episodes += done[i];
+        }
+        if (step % report == 0) {
+            env_curriculum_state(env, mastery, share);
+            printf("step %6d  frontier %d  share", step, frontier);
+            for (int l = 0; l < count; l++) printf(" %4.2f", share[l]);
+            printf("  mastery");
+            for (int l = 0; l < count; l++) printf(" %4.2f", mastery[l]);
+            printf("\n");
+        }
+    }
+    double secs = usSince(t0) / 1e6;
+    double total = double(cfg.envs) * cfg.steps;
+    printf("curriculum envs=%d obs=%s (%dx%d tensor at the end): %.2f M steps/s, mean board %.0f cells, mean tensor %.0f cells, "
+        "%lld episodes\n",
+        cfg.envs, cfg.noObs ? "off" : "on", shape[3], shape[2], total / secs / 1e6, cellSteps / total, tensorSteps / total,
+        episodes);
+    env_destroy(env);
+}
+
+//
+// Asynchronous pool: recv whichever batch is ready, act on it, send it back
+//
+static void benchAsync(const BenchConfig& cfg) {
+    SnakeEnvSettings s = benchSettings(cfg);
+
+    SnakeEnvPool* pool = env_pool_create(cfg.envs, cfg.batch, cfg.threads, &s);
+    if (!pool) {
+        printf("invalid settings\n");
+        return;
+    }
+
+    std::vector<int32_t> actions(cfg.batch);
+    SimRng rng{ 42 };
+    long long episodes = 0;
+    long long batches = (long long)cfg.steps * cfg.envs / cfg.batch;
+    std::vector<double> waits;
+    waits.reserve((size_t)batches);
+
+    env_pool_reset(pool);
+    SnakeEnvBatch batch;
+    auto t0 = BenchClock::now();
+    for (long long i = 0; i < batches; i++) {
+        auto w0 = BenchClock::now();
+        env_pool_recv(pool, &batch);
+        waits.push_back(usSince(w0));
+        for (int r = 0; r < batch.count; r++) episodes += batch.done[r];
+
+        simulateWork(cfg.workUs);
+        for (auto& a : actions) a = (int32_t)rng.below(4);
+        env_pool_send(pool, actions.data(), batch.env_ids, batch.count);
+    }
+    double secs = usSince(t0) / 1e6;
+    double total = double(batches) * cfg.batch;
+    printf("async %dx%d envs=%d batch=%d: %.2f M steps/s, %lld episodes\n",
+        cfg.width, cfg.height, cfg.envs, cfg.batch, total / secs / 1e6, episodes);
+    printLatency("async", waits);
+
+    env_pool_destroy(pool);
+}
+
+//
+// Observation encoders on one core: games are advanced off the clock, only encoding is timed
+//
+static void benchObs(const BenchConfig& cfg) {
+    const int games = 64;
+    int cells = cfg.width * cfg.height;
+    int k = std::min(cfg.crop | 1, OBS_MAX_CROP);
+    size_t words = SnakeSim::storageWords(cells);
+    std::vector<uint32_t> storage(words * games);
+    std::vector<SnakeSim> sims(games);
+    SimRng rng{ 7 };
+    for (int i = 0; i < games; i++) {
+        sims[i].bind(storage.data() + words * i, cells);
+        sims[i].reset(cfg.width, cfg.height, cfg.fruits, rng.next());
+        for (int t = 0; t < 20 && !sims[i].done(); t++) sims[i].step((int)rng.below(4));
+    }
+
+    size_t boardFloats = (size_t)cells * OBS_BOARD_CHANNELS;
+    std::vector<float> board(boardFloats * games);
+    std::vector<float> crops((size_t)k * k * OBS_CROP_CHANNELS * games);
+    std::vector<float> sym(boardFloats * 8);
+    int reps = std::max(1, cfg.steps / 10);
+
+    auto run = [&](const char* label, auto&& encode) {
+        auto t0 = BenchClock::now();
+        for (int r = 0; r < reps; r++) {
+            for (int i = 0; i < games; i++) encode(i);
+        }
+        double secs = usSince(t0) / 1e6;
+        printf("%-10s %dx%d: %.2f M obs/s per core\n", label, cfg.width, cfg.height, double(reps) * games / secs / 1e6);
+    };
+
+    run("board", [&](int i) {
+        obsEncodeBoard(sims[i], { board.data() + boardFloats * i, (ptrdiff_t)cells, (ptrdiff_t)cfg.width });
+    });
+    run("crop", [&](int i) {
+        size_t stride = (size_t)k * k * OBS_CROP_CHANNELS;
+        obsEncodeCrop(sims[i], k, { crops.data() + stride * i, (ptrdiff_t)k * k, (ptrdiff_t)k });
+    });
+    run("dihedral8", [&](int i) {
+        ObsPlanes src{ board.data() + boardFloats * i, (ptrdiff_t)cells, (ptrdiff_t)cfg.width };
+        ObsPlanes out[8];
+        for (int t = 0; t < 8; t++) {
+            int ow, oh;
+            obsDihedralDims(t, cfg.width, cfg.height, ow, oh);
+            out[t] = { sym.data() + boardFloats * t, (ptrdiff_t)cells, (ptrdiff_t)ow };
+        }
+        obsDihedralAll(src, cfg.width, cfg.height, OBS_BOARD_CHANNELS, out);
+    });
+}
+
+//
+// Replay buffer: producer threads play random games into it while one sampler draws
+// prioritized batches and writes back new priorities
+//
+// to = from, in to's own storage (grid and body ring are one block of words)
+static void copyGame(SnakeSim& to, const SnakeSim& from, size_t words) {
+    uint32_t* grid = to.grid;
+    uint32_t* body = to.body;
+    std::copy(from.grid, from.grid + words, grid);
+    to = from;
+    to.grid = grid;
+    to.body = body;
+}
+
+// The same board: size, snake from head to tail, heading and fruits
+static bool sameGame(const SnakeSim& a, const SnakeSim& b) {
+    if (a.w != b.w || a.h != b.h || a.length != b.length || a.dir != b.dir || a.foodCount != b.foodCount) return false;
+    for (uint32_t i = 0; i < a.length; i++) {
+        if (a.segment(i) != b.segment(i)) return false;
+    }
+    for (int i = 0; i < a.foodCount; i++) {
+        if (a.food[i] != b.food[i]) return false;
+    }
+    for (int c = 0; c < a.cells; c++) {
+        if (a.occupied((uint32_t)c) != b.occupied((uint32_t)c)) return false;
+    }
+    return true;
+}
+
+// Every record must decode to the transition that went in: the state to the board before
+// the step, the next state to the board after it (unless the episode ended there)
+static bool checkReplay(const BenchConfig& cfg, int transitions) {
+    int cells = cfg.width * cfg.height;
+    size_t words = SnakeSim::storageWords(cells);
+    std::vector<uint32_t> storage(words * 3);
+    SnakeSim g, prev, decoded;
+    g.bind(storage.data(), cells);
+    prev.bind(storage.data() + words, cells);
+    decoded.bind(storage.data() + words * 2, cells);
+    ReplayBuffer one(1, cfg.width, cfg.height, cfg.fruits, 0.6);
+    std::vector<uint8_t> rec(one.bytesPerRecord());
+    ReplaySample sample;
+    SimRng rng{ 7 };
+    g.reset(cfg.width, cfg.height, cfg.fruits, rng.next());
+    for (int n = 0; n < transitions; n++) {
+        copyGame(prev, g, words);
+        int action = (int)rng.below(4);
+        SimResult r = g.step(action);
+        one.add(prev, action, r == SIM_ATE ? 1.0f : 0.0f, g.done(), g);
+        if (one.sample(1, rng, &sample, rec.data()) != 1) return false;
+        one.decode(rec.data(), decoded, false);
+        if (!sameGame(decoded, prev)) return false;
+        if (!g.done()) {
+            one.decode(rec.data(), decoded, true);
+            if (!sameGame(decoded, g)) return false;
+        }
+        if (g.done()) g.reset(cfg.width, cfg.height, cfg.fruits, rng.next());
+    }
+    return true;
+}
+
+static void benchReplay(const BenchConfig& cfg) {
+    int cells = cfg.width * cfg.height;
+    int producers = std::max(1, cfg.threads);
+    ReplayBuffer replay((size_t)cfg.capacity, cfg.width, cfg.height, cfg.fruits, 0.6);
+    printf("replay capacity %d, %zu bytes per transition\n", cfg.capacity, replay.bytesPerRecord());
+    printf("round trip 100000 transitions re-decoded: %s\n", checkReplay(cfg, 100000) ? "same boards" : "DIFFERENT");
+
+    // Fill once off the clock so sampling sees a full tree
+    std::atomic<bool> stop{ false };
+    std::atomic<long long> inserted{ 0 };
+    auto produce = [&](int id, long long count) {
+        size_t words = SnakeSim::storageWords(cells);
+        std::vector<uint32_t> storage(words * 2);
+        SnakeSim g, prev;
+        g.bind(storage.data(), cells);
+        prev.bind(storage.data() + words, cells);
+        SimRng rng{ 1000 + (uint64_t)id };
+        g.reset(cfg.width, cfg.height, cfg.fruits, rng.next());
+        long long n = 0;
+        while (count ? n < count : !stop.load(std::memory_order_relaxed)) {
+            copyGame(prev, g, words);
+            int action = (int)rng.below(4);
+            SimResult r = g.step(action);
+            float reward = r == SIM_ATE ? 1.0f : r == SIM_DIED ? -1.0f : 0.0f;
+            replay.add(prev, action, reward, g.done(), g);
+            if (g.done()) g.reset(cfg.width, cfg.height, cfg.fruits, rng.next());
+            n++;
+        }
+        inserted.fetch_add(n, std::memory_order_relaxed);
+    };
+    auto t0 = BenchClock::now();
+    produce(0, cfg.capacity);
+    printf("fill       %.2f M inserts/s (1 thread)\n", cfg.capacity / (usSince(t0) / 1e6) / 1e6);
+    inserted = 0;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; i++) threads.emplace_back(produce, i + 1, 0LL);
+
+    int batch = cfg.batch;
+    std::vector<ReplaySample> samples(batch);
+    std::vector<uint8_t> records(replay.bytesPerRecord() * batch);
+    std::vector<float> obs((size_t)cells * OBS_BOARD_CHANNELS * batch);
+    size_t words = SnakeSim::storageWords(cells);
+    std::vector<uint32_t> storage(words);
+    SnakeSim decoded;
+    decoded.bind(storage.data(), cells);
+    SimRng rng{ 3 };
+    long long sampled = 0;
+
+    t0 = BenchClock::now();
+    for (int r = 0; r < cfg.steps; r++) {
+        int got = replay.sample(batch, rng, samples.data(), records.data());
+        for (int i = 0; i < got; i++) {
+            replay.decode(records.data() + replay.bytesPerRecord() * i, decoded, false);
+            ObsPlanes planes{ obs.data() + (size_t)cells * OBS_BOARD_CHANNELS * i, (ptrdiff_t)cells, (ptrdiff_t)cfg.width };
+            obsEncodeBoard(decoded, planes);
+            replay.updatePriority(samples[i], 0.01 + double(rng.below(1000)) / 1000.0);
+        }
+        sampled += got;
+    }
+    double secs = usSince(t0) / 1e6;
+    stop = true;
+    for (auto& t : threads) t.join();
+    printf("sample     %.2f M transitions/s (batch %d, decoded + encoded + reprioritized)\n", sampled / secs / 1e6, batch);
+    printf("insert     %.2f M transitions/s concurrently (%d producer threads)\n", inserted.load() / secs / 1e6, producers);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig cfg = parseArgs(argc, argv);
+    if (!strcmp(cfg.mode, "sync") || !strcmp(cfg.mode, "both")) benchSync(cfg);
+    if (!strcmp(cfg.mode, "async") || !strcmp(cfg.mode, "both")) benchAsync(cfg);
+    if (!strcmp(cfg.mode, "curriculum")) benchCurriculum(cfg);
+    if (!strcmp(cfg.mode, "obs")) benchObs(cfg);
+    if (!strcmp(cfg.mode, "replay")) benchReplay(cfg);
+    return 0;
+}
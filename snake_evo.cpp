@@ -0,0 +1,138 @@
+// snake_evo.cpp
+// Evolution-strategies trainer for the headless simulator (see snake_evo.h).
+// Compile: g++ snake_evo.cpp -std=c++20 -O2 -pthread -o snake_evo
+// Run:     ./snake_evo --generations 200 --grids 10,16,20 --out policy.evo
+//          ./snake_evo --in policy.evo --generations 0 --eval-games 4096 --check-threads 1,8,64
+
+#include "snake_evo.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//
+// Config
+//
+struct EvoRunConfig {
+    EvoConfig es;
+    EvoLayout layout;
+    int generations = 100;
+    int reportEvery = 10;
+    int evalGames = 64;
+    uint64_t evalSeed = 0xE7A1;
+    std::vector<int> checkThreads; // evaluate at each count and require identical results
+    const char* in = nullptr;
+    const char* out = nullptr;
+};
+
+static std::vector<int> parseList(const char* s) {
+    std::vector<int> v;
+    while (*s) {
+        v.push_back(atoi(s));
+        while (*s && *s != ',') s++;
+        if (*s == ',') s++;
+    }
+    return v;
+}
+
+static EvoRunConfig parseArgs(int argc, char** argv) {
+    EvoRunConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--pairs") && i + 1 < argc) cfg.es.pairs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seeds") && i + 1 < argc) cfg.es.seedsPerGrid = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--grids") && i + 1 < argc) cfg.es.grids = parseList(argv[++i]);
+        else if (!strcmp(argv[i], "--fruits") && i + 1 < argc) cfg.es.fruits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--sigma") && i + 1 < argc) cfg.es.sigma = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--lr") && i + 1 < argc) cfg.es.learningRate = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) cfg.es.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.es.seed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--hidden") && i + 1 < argc) cfg.layout.hidden = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--generations") && i + 1 < argc) cfg.generations = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--report") && i + 1 < argc) cfg.reportEvery = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--eval-games") && i + 1 < argc) cfg.evalGames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--eval-seed") && i + 1 < argc) cfg.evalSeed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--check-threads") && i + 1 < argc) cfg.checkThreads = parseList(argv[++i]);
+        else if (!strcmp(argv[i], "--in") && i + 1 < argc) cfg.in = argv[++i];
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc) cfg.out = argv[++i];
+    }
+    return cfg;
+}
+
+//
+// Evaluate the current weights at every requested thread count; any difference is a bug
+//
+static bool checkThreads(const EvoRunConfig& cfg, const EvoLayout& layout, const std::vector<float>& w) {
+    bool ok = true;
+    for (int gsz : cfg.es.grids) {
+        uint64_t runSeed = evoMix(cfg.evalSeed, (uint64_t)gsz);
+        EvoEvalResult first;
+        for (size_t i = 0; i < cfg.checkThreads.size(); i++) {
+            int threads = std::max(1, cfg.checkThreads[i]);
+            EvoEvalResult r = evoEvaluate(layout, w.data(), gsz, gsz, cfg.es.fruits, cfg.evalGames, runSeed, threads);
+            if (i == 0) first = r;
+            bool same = r == first;
+            ok = ok && same;
+            printf("  %3dx%-3d  %3d threads  mean %.6f  sd %.6f  fill %.6f  wins %lld  digest %016llx  %s\n", gsz, gsz, threads,
+                r.mean(), r.stddev(), r.meanFill(), (long long)r.wins, (unsigned long long)r.digest(), same ? "ok" : "MISMATCH");
+        }
+    }
+    printf("thread-count check: %s\n", ok ? "identical" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    EvoRunConfig cfg = parseArgs(argc, argv);
+    std::vector<float> loaded;
+    if (cfg.in && !evoLoadWeights(cfg.in, cfg.layout, loaded)) {
+        printf("cannot load weights from %s\n", cfg.in);
+        return 1;
+    }
+    if (cfg.es.grids.empty() || cfg.es.pairs < 1 || cfg.es.seedsPerGrid < 1 || cfg.layout.hidden < 1) {
+        printf("invalid settings\n");
+        return 1;
+    }
+    for (int g : cfg.es.grids) {
+        if (g < 4 || g > 256) {
+            printf("grid sizes must be 4..256\n");
+            return 1;
+        }
+    }
+
+    EvoTrainer trainer(cfg.es, cfg.layout);
+    if (cfg.in) trainer.setWeights(loaded);
+    printf("%d params, population %d, %zu grids x %d seeds per candidate, %d threads\n",
+        trainer.paramCount(), cfg.es.pairs * 2, cfg.es.grids.size(), cfg.es.seedsPerGrid, trainer.threadCount());
+
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+    std::vector<EvoTrainer::GridScore> best;
+
+    for (int g = 1; g <= cfg.generations; g++) {
+        double mean = trainer.step();
+        double secs = std::chrono::duration<double>(clock::now() - t0).count();
+        printf("gen %4d  fitness mean %7.2f  best %7.2f  %.0f gens/hour\n", g, mean, trainer.lastBestFitness(), g / secs * 3600.0);
+
+        if (g % cfg.reportEvery == 0 || g == cfg.generations) {
+            auto scores = trainer.evaluate(cfg.evalGames, cfg.evalSeed);
+            if (best.empty()) best = scores;
+            for (size_t i = 0; i < scores.size(); i++) {
+                best[i].mean = std::max(best[i].mean, scores[i].mean);
+                best[i].best = std::max(best[i].best, scores[i].best);
+                printf("  %3dx%-3d  mean %7.2f  top %5d   (best so far: mean %7.2f  top %5d)\n", scores[i].grid, scores[i].grid,
+                    scores[i].mean, scores[i].best, best[i].mean, best[i].best);
+            }
+            if (cfg.out && !evoSaveWeights(cfg.out, cfg.layout, trainer.weights())) printf("  could not write %s\n", cfg.out);
+        }
+    }
+
+    if (cfg.generations > 0) {
+        double secs = std::chrono::duration<double>(clock::now() - t0).count();
+        printf("%d generations in %.1f s: %.0f generations/hour\n", cfg.generations, secs, cfg.generations / secs * 3600.0);
+    } else {
+        for (const auto& s : trainer.evaluate(cfg.evalGames, cfg.evalSeed)) printf("  %3dx%-3d  mean %7.2f  top %5d\n", s.grid, s.grid, s.mean, s.best);
+    }
+    if (!cfg.checkThreads.empty() && !checkThreads(cfg, cfg.layout, trainer.weights())) return 1;
+    return 0;
+}
@@ -0,0 +1,436 @@
+// snake_evo.h
+// Evolution strategies on the headless simulator: a small MLP policy over heading-relative
+// features, evaluated by a population of antithetic perturbations across all cores.
+// Only the mean weights are stored. A candidate's perturbation is regenerated from its seed
+// one parameter at a time, both to build its weights and to form the update.
+
+#pragma once
+
+#include "snake_sim.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+//
+// Seeds and noise: counter-based, so any (seed, index) can be drawn in any order
+//
+static inline uint64_t evoMix(uint64_t a, uint64_t b) {
+    SimRng r{ a ^ (b * 0xD1B54A32D192ED03ull) };
+    r.next();
+    return r.next();
+}
+
+// Standard normal for parameter j of the perturbation with this seed (Box-Muller)
+static inline float evoNoise(uint64_t seed, uint32_t j) {
+    uint64_t bits = evoMix(seed, j);
+    double u1 = ((bits >> 11) + 1) * (1.0 / 9007199254740993.0); // (0, 1]
+    double u2 = (double)(uint32_t)bits * (1.0 / 4294967296.0);
+    return (float)(std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2));
+}
+
+//
+// Features, from the head looking along the heading: for forward, left and right the
+// next cell is blocked, the free run to an obstacle, and whether a fruit lies on that
+// line; then the nearest fruit in the heading frame, and the fill ratio
+//
+enum { EVO_INPUTS = 12, EVO_OUTPUTS = 3 }; // outputs: turn left, straight, turn right
+
+static inline SimDir evoTurn(SimDir d, int turn) {
+    // Clockwise order up, right, down, left
+    static const int cw[4] = { 0, 2, 3, 1 }; // SimDir -> clockwise index
+    static const SimDir dirs[4] = { SIM_UP, SIM_RIGHT, SIM_DOWN, SIM_LEFT };
+    return dirs[(cw[d] + turn + 4) & 3];
+}
+
+static inline void evoFeatures(const SnakeSim& g, float* f) {
+    static const int dx[4] = { 0, 0, -1, 1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    uint32_t head = g.head();
+    int hx = (int)(head % (uint32_t)g.w), hy = (int)(head / (uint32_t)g.w);
+    float span = (float)std::max(g.w, g.h);
+
+    for (int t = 0; t < 3; t++) {
+        SimDir d = evoTurn(g.dir, t - 1);
+        int x = hx, y = hy, run = 0;
+        bool fruit = false;
+        for (;;) {
+            x += dx[d];
+            y += dy[d];
+            if (x < 0 || x >= g.w || y < 0 || y >= g.h) break;
+            uint32_t c = (uint32_t)(y * g.w + x);
+            if (g.occupied(c)) break;
+            fruit = fruit || g.hasFood(c);
+            run++;
+        }
+        f[t * 3 + 0] = run == 0 ? 1.0f : 0.0f;
+        f[t * 3 + 1] = (float)run / span;
+        f[t * 3 + 2] = fruit ? 1.0f : 0.0f;
+    }
+
+    // Nearest fruit as (ahead, right) offsets
+    int best = 1 << 30, fx = 0, fy = 0;
+    for (int i = 0; i < g.foodCount; i++) {
+        int x = (int)(g.food[i] % (uint32_t)g.w) - hx, y = (int)(g.food[i] / (uint32_t)g.w) - hy;
+        int dist = std::abs(x) + std::abs(y);
+        if (dist < best) {
+            best = dist;
+            fx = x;
+            fy = y;
+        }
+    }
+    int ahead = 0, right = 0;
+    switch (g.dir) {
+    case SIM_UP:    ahead = -fy; right = fx; break;
+    case SIM_DOWN:  ahead = fy; right = -fx; break;
+    case SIM_LEFT:  ahead = -fx; right = -fy; break;
+    case SIM_RIGHT: ahead = fx; right = fy; break;
+    }
+    f[9] = (float)ahead / span;
+    f[10] = (float)right / span;
+    f[11] = (float)g.length / (float)g.cells;
+}
+
+//
+// Policy: EVO_INPUTS -> hidden (tanh) -> EVO_OUTPUTS, all parameters in one flat block
+//
+struct EvoLayout {
+    int hidden = 16;
+
+    int params() const { return EVO_INPUTS * hidden + hidden + hidden * EVO_OUTPUTS + EVO_OUTPUTS; }
+};
+
+static inline int evoAct(const EvoLayout& L, const float* p, const SnakeSim& g) {
+    float in[EVO_INPUTS];
+    evoFeatures(g, in);
+
+    const float* w1 = p;
+    const float* b1 = w1 + EVO_INPUTS * L.hidden;
+    const float* w2 = b1 + L.hidden;
+    const float* b2 = w2 + L.hidden * EVO_OUTPUTS;
+
+    float out[EVO_OUTPUTS] = { b2[0], b2[1], b2[2] };
+    for (int j = 0; j < L.hidden; j++) {
+        float a = b1[j];
+        for (int i = 0; i < EVO_INPUTS; i++) a += in[i] * w1[i * L.hidden + j];
+        a = std::tanh(a);
+        for (int o = 0; o < EVO_OUTPUTS; o++) out[o] += a * w2[j * EVO_OUTPUTS + o];
+    }
+    int turn = (int)(std::max_element(out, out + EVO_OUTPUTS) - out) - 1;
+    return evoTurn(g.dir, turn);
+}
+
+// One game to the end, or until the snake goes too long without eating
+static inline int evoPlay(const EvoLayout& L, const float* p, SnakeSim& g, int w, int h, int fruits, uint64_t seed) {
+    g.reset(w, h, fruits, seed);
+    uint32_t idleLimit = (uint32_t)(w * h) * 2;
+    while (!g.done() && g.ticksSinceFood < idleLimit) g.step(evoAct(L, p, g));
+    return g.score;
+}
+
+//
+// Weights file: "SNKEVO1\0", hidden size, parameter count, floats
+//
+static bool evoSaveWeights(const char* path, const EvoLayout& L, const std::vector<float>& w) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    const char magic[8] = { 'S', 'N', 'K', 'E', 'V', 'O', '1', 0 };
+    int32_t header[2] = { L.hidden, (int32_t)w.size() };
+    bool ok = fwrite(magic, sizeof(magic), 1, f) == 1 && fwrite(header, sizeof(header), 1, f) == 1 &&
+        fwrite(w.data(), sizeof(float), w.size(), f) == w.size();
+    return fclose(f) == 0 && ok;
+}
+
+static bool evoLoadWeights(const char* path, EvoLayout& L, std::vector<float>& w) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    char magic[8];
+    int32_t header[2];
+    bool ok = fread(magic, sizeof(magic), 1, f) == 1 && !memcmp(magic, "SNKEVO1", 8) &&
+        fread(header, sizeof(header), 1, f) == 1 && header[0] > 0 && header[0] <= 4096;
+    if (ok) {
+        L.hidden = header[0];
+        ok = header[1] == L.params();
+    }
+    if (ok) {
+        w.resize((size_t)header[1]);
+        ok = fread(w.data(), sizeof(float), w.size(), f) == w.size();
+    }
+    fclose(f);
+    return ok;
+}
+
+//
+// Work split: jobs claimed from an atomic counter by one thread per core
+//
+template <typename Fn>
+static void evoParallel(int threads, int jobs, Fn&& fn) {
+    std::atomic<int> next{ 0 };
+    auto worker = [&](int t) {
+        for (int j = next.fetch_add(1, std::memory_order_relaxed); j < jobs; j = next.fetch_add(1, std::memory_order_relaxed)) fn(t, j);
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+}
+
+//
+// Deterministic evaluation
+// Game i of a run is seeded from (run seed, i) alone. Games are grouped into blocks of
+// EVO_EVAL_BLOCK whatever the thread count, each block's partial lands in its own slot,
+// and the slots are merged in block order. Every total is an integer, and the one real
+// valued metric is summed in fixed point, so merge order could not change it anyway:
+// the same run gives the same bits on 1 thread or 64.
+//
+static constexpr int EVO_EVAL_BLOCK = 16;
+static constexpr double EVO_FIXED_ONE = 4294967296.0; // 32.32 fixed point
+
+struct EvoEvalResult {
+    int64_t games = 0;
+    int64_t wins = 0;
+    int64_t scoreSum = 0;
+    int64_t scoreSqSum = 0;
+    int64_t ticks = 0;
+    int64_t fillFixed = 0; // sum of final length / cells, 32.32
+    int scoreMin = INT32_MAX;
+    int scoreMax = 0;
+
+    void add(const SnakeSim& g) {
+        games++;
+        wins += g.gameWon ? 1 : 0;
+        scoreSum += g.score;
+        scoreSqSum += (int64_t)g.score * g.score;
+        ticks += g.ticks;
+        fillFixed += (int64_t)std::llround((double)g.length / (double)g.cells * EVO_FIXED_ONE);
+        scoreMin = std::min(scoreMin, g.score);
+        scoreMax = std::max(scoreMax, g.score);
+    }
+
+    void merge(const EvoEvalResult& o) {
+        games += o.games;
+        wins += o.wins;
+        scoreSum += o.scoreSum;
+        scoreSqSum += o.scoreSqSum;
+        ticks += o.ticks;
+        fillFixed += o.fillFixed;
+        scoreMin = std::min(scoreMin, o.scoreMin);
+        scoreMax = std::max(scoreMax, o.scoreMax);
+    }
+
+    bool operator==(const EvoEvalResult& o) const {
+        return games == o.games && wins == o.wins && scoreSum == o.scoreSum && scoreSqSum == o.scoreSqSum &&
+            ticks == o.ticks && fillFixed == o.fillFixed && scoreMin == o.scoreMin && scoreMax == o.scoreMax;
+    }
+
+    // Derived values, computed once from the exact totals
+    double mean() const { return games ? (double)scoreSum / games : 0.0; }
+    double stddev() const {
+        if (!games) return 0.0;
+        double m = mean();
+        return std::sqrt(std::max(0.0, (double)scoreSqSum / games - m * m));
+    }
+    double meanFill() const { return games ? (double)fillFixed / EVO_FIXED_ONE / games : 0.0; }
+
+    // FNV-1a over the totals, to compare runs at a glance
+    uint64_t digest() const {
+        const int64_t v[8] = { games, wins, scoreSum, scoreSqSum, ticks, fillFixed, scoreMin, scoreMax };
+        uint64_t h = 0xCBF29CE484222325ull;
+        for (int64_t x : v) {
+            for (int i = 0; i < 8; i++) {
+                h ^= (uint64_t)(x >> (i * 8)) & 0xFF;
+                h *= 0x100000001B3ull;
+            }
+        }
+        return h;
+    }
+};
+
+static inline uint64_t evoEvalSeed(uint64_t runSeed, uint64_t game) { return evoMix(runSeed, game); }
+
+static EvoEvalResult evoEvaluate(const EvoLayout& L, const float* p, int w, int h, int fruits,
+    int games, uint64_t runSeed, int threads) {
+    int blocks = (games + EVO_EVAL_BLOCK - 1) / EVO_EVAL_BLOCK;
+    threads = std::max(1, std::min(threads, std::max(blocks, 1)));
+    std::vector<EvoEvalResult> partial((size_t)blocks);
+
+    int cells = w * h;
+    size_t words = SnakeSim::storageWords(cells);
+    std::vector<uint32_t> arena(words * (size_t)threads);
+    std::vector<SnakeSim> sims((size_t)threads);
+    for (int t = 0; t < threads; t++) sims[t].bind(arena.data() + words * t, cells);
+
+    evoParallel(threads, blocks, [&](int t, int b) {
+        int end = std::min(games, (b + 1) * EVO_EVAL_BLOCK);
+        for (int i = b * EVO_EVAL_BLOCK; i < end; i++) {
+            evoPlay(L, p, sims[t], w, h, fruits, evoEvalSeed(runSeed, (uint64_t)i));
+            partial[b].add(sims[t]);
+        }
+    });
+
+    EvoEvalResult total;
+    for (const EvoEvalResult& r : partial) total.merge(r);
+    return total;
+}
+
+//
+// Trainer (OpenAI-style ES with antithetic pairs, centered-rank shaping and Adam)
+//
+struct EvoConfig {
+    int pairs = 64;          // population = 2 * pairs
+    int seedsPerGrid = 8;    // games per candidate on each grid
+    std::vector<int> grids = { 10, 16, 20 };
+    int fruits = 1;
+    float sigma = 0.1f;
+    float learningRate = 0.03f;
+    float weightDecay = 0.005f;
+    int threads = 0;         // 0 = all cores
+    uint64_t seed = 1;
+};
+
+class EvoTrainer {
+public:
+    EvoTrainer(const EvoConfig& cfg, const EvoLayout& layout)
+        : cfg(cfg), layout(layout), nParams(layout.params()) {
+        threads = cfg.threads > 0 ? cfg.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+        theta.resize((size_t)nParams);
+        for (int j = 0; j < nParams; j++) theta[j] = 0.5f * evoNoise(evoMix(cfg.seed, 0xC0FFEE), (uint32_t)j) / std::sqrt((float)EVO_INPUTS);
+        adamM.assign((size_t)nParams, 0.0f);
+        adamV.assign((size_t)nParams, 0.0f);
+
+        // One weight buffer and one game per thread, each in its own contiguous arena
+        maxCells = 0;
+        for (int gsz : cfg.grids) maxCells = std::max(maxCells, gsz * gsz);
+        scratch.assign((size_t)threads * paramStride(), 0.0f);
+        simWords = SnakeSim::storageWords(maxCells);
+        simArena.assign(simWords * (size_t)threads, 0);
+        sims.resize((size_t)threads);
+        for (int t = 0; t < threads; t++) sims[t].bind(simArena.data() + simWords * t, maxCells);
+    }
+
+    int paramCount() const { return nParams; }
+    int threadCount() const { return threads; }
+    const std::vector<float>& weights() const { return theta; }
+    int generation() const { return gen; }
+
+    // One generation; returns the population's mean fitness
+    double step() {
+        int population = cfg.pairs * 2;
+        int gamesPer = (int)cfg.grids.size() * cfg.seedsPerGrid;
+        fitness.assign((size_t)population, 0.0);
+
+        // Job = one candidate on all its games; every candidate sees the same game seeds
+        evoParallel(threads, population, [&](int t, int c) {
+            float* p = candidateWeights(t, c);
+            long long total = 0;
+            for (int k = 0; k < gamesPer; k++) {
+                int gsz = cfg.grids[k / cfg.seedsPerGrid];
+                total += evoPlay(layout, p, sims[t], gsz, gsz, cfg.fruits, gameSeed(k));
+            }
+            fitness[c] = double(total) / gamesPer;
+        });
+
+        // Centered ranks in [-0.5, 0.5]
+        std::vector<int> order((size_t)population);
+        for (int i = 0; i < population; i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return fitness[a] < fitness[b]; });
+        std::vector<float> rank((size_t)population);
+        for (int i = 0; i < population; i++) rank[order[i]] = (float)i / (float)(population - 1) - 0.5f;
+
+        // Gradient, regenerating each pair's noise; parameters are split across threads
+        std::vector<float> grad((size_t)nParams);
+        int blocks = std::min(nParams, threads * 4);
+        evoParallel(threads, blocks, [&](int, int b) {
+            int j0 = (int)((long long)nParams * b / blocks), j1 = (int)((long long)nParams * (b + 1) / blocks);
+            for (int j = j0; j < j1; j++) {
+                float g = 0.0f;
+                for (int k = 0; k < cfg.pairs; k++) g += (rank[2 * k] - rank[2 * k + 1]) * evoNoise(pairSeed(k), (uint32_t)j);
+                grad[j] = g / (float)(population * cfg.sigma);
+            }
+        });
+
+        // Adam ascent with decoupled weight decay
+        gen++;
+        const float b1 = 0.9f, b2 = 0.999f;
+        float c1 = 1.0f - std::pow(b1, (float)gen), c2 = 1.0f - std::pow(b2, (float)gen);
+        for (int j = 0; j < nParams; j++) {
+            adamM[j] = b1 * adamM[j] + (1.0f - b1) * grad[j];
+            adamV[j] = b2 * adamV[j] + (1.0f - b2) * grad[j] * grad[j];
+            theta[j] += cfg.learningRate * ((adamM[j] / c1) / (std::sqrt(adamV[j] / c2) + 1e-8f) - cfg.weightDecay * theta[j]);
+        }
+
+        double sum = 0.0;
+        bestFitness = -1.0;
+        for (int c = 0; c < population; c++) {
+            sum += fitness[c];
+            bestFitness = std::max(bestFitness, fitness[c]);
+        }
+        return sum / population;
+    }
+
+    double lastBestFitness() const { return bestFitness; }
+
+    // Mean and best score of the current weights on fresh seeds, per grid size
+    struct GridScore {
+        int grid;
+        double mean;
+        int best;
+    };
+
+    std::vector<GridScore> evaluate(int gamesPerGrid, uint64_t evalSeed) {
+        std::vector<GridScore> out;
+        for (int gsz : cfg.grids) {
+            EvoEvalResult r = evoEvaluate(layout, theta.data(), gsz, gsz, cfg.fruits, gamesPerGrid, evoMix(evalSeed, (uint64_t)gsz), threads);
+            out.push_back({ gsz, r.mean(), r.scoreMax });
+        }
+        return out;
+    }
+
+    // Replaces the mean weights (e.g. loaded from a file) and restarts the optimizer
+    bool setWeights(const std::vector<float>& w) {
+        if ((int)w.size() != nParams) return false;
+        theta = w;
+        adamM.assign((size_t)nParams, 0.0f);
+        adamV.assign((size_t)nParams, 0.0f);
+        gen = 0;
+        return true;
+    }
+
+private:
+    // Per-thread slices padded to whole cache lines
+    size_t paramStride() const { return ((size_t)nParams + 15) & ~(size_t)15; }
+
+    uint64_t pairSeed(int k) const { return evoMix(evoMix(cfg.seed, (uint64_t)gen + 1), (uint64_t)k); }
+    uint64_t gameSeed(int k) const { return evoMix(evoMix(cfg.seed ^ 0x5EEDull, (uint64_t)gen + 1), (uint64_t)k); }
+
+    // theta +- sigma * eps, written into this thread's slice of the arena
+    float* candidateWeights(int t, int c) {
+        float* p = scratch.data() + paramStride() * t;
+        uint64_t s = pairSeed(c / 2);
+        float sign = (c & 1) ? -cfg.sigma : cfg.sigma;
+        for (int j = 0; j < nParams; j++) p[j] = theta[j] + sign * evoNoise(s, (uint32_t)j);
+        return p;
+    }
+
+    EvoConfig cfg;
+    EvoLayout layout;
+    int nParams;
+    int threads = 1;
+    int gen = 0;
+    int maxCells = 0;
+    double bestFitness = 0.0;
+
+    std::vector<float> theta, adamM, adamV;
+    std::vector<float> scratch;
+    std::vector<double> fitness;
+    size_t simWords = 0;
+    std::vector<uint32_t> simArena;
+    std::vector<SnakeSim> sims;
+};
@@ -0,0 +1,96 @@
+// snake_game_loop.h
+// One game of Snake as coroutines on CoroExecutor (snake_coro.h), from the first arrow key
+// to the end: ticks on a fixed grid, pause and resume behind a 3-2-1 countdown, a blink on
+// death. What a tick does and where the state lives comes from Game, so main.cpp runs this
+// on its window state and snake_coro_bench fast-forwards the very same loop on SnakeSim.
+//
+// Game provides, each called on the executor's thread with nothing locked (main.cpp's
+// take stateMtx themselves):
+//   CoroTime tickPeriod()       time between ticks
+//   bool pausedNow()
+//   TickResult tick()           one step of the snake
+//   void ticksStarted()         the tick grid starts over now, after the first key or a pause
+//   bool showCountdown(int n)   shows 3, 2, 1 (0 clears it); false, showing nothing, if the
+//                               game has been paused again
+//   void blink(bool hidden)     the death animation
+//   void endGame()              the death animation is over
+//
+// A game nobody is playing waits on started or resumed and leaves no wake-ups, so whoever
+// sets them brings the executor's clock up to now first (see snake_coro.h).
+
+#pragma once
+
+#include "snake_coro.h"
+
+enum TickResult { TICK_MOVED, TICK_DIED, TICK_WON };
+
+template <typename Game>
+class GameLoop {
+public:
+    GameLoop(CoroExecutor& ex, Game& game) : started(ex), resumed(ex), ex(ex), game(game) {}
+
+    CoroEvent started; // the first arrow key of a game
+    CoroEvent resumed; // Resume on the pause screen
+
+    // Drops the game in progress, if any, for a new one waiting for the first key
+    void restart() {
+        started.reset();
+        resumed.reset();
+        ex.cancel(task);
+        task = ex.spawn(run());
+    }
+
+private:
+    // One game, from the first arrow key to the end
+    CoroTask run() {
+        co_await started;
+        startTicks();
+        for (;;) {
+            co_await ex.nextTick();
+            if (game.pausedNow()) {
+                do {
+                    co_await resumed;
+                    co_await countdown();
+                } while (game.pausedNow());
+                startTicks();
+                continue;
+            }
+
+            TickResult result = game.tick();
+            if (result == TICK_DIED) {
+                co_await deathAnimation();
+                co_return;
+            }
+            if (result == TICK_WON) co_return;
+        }
+    }
+
+    // 3, 2, 1 before play picks up again; stops early if the game is paused meanwhile
+    CoroTask countdown() {
+        for (int n = 3; n > 0; n--) {
+            if (!game.showCountdown(n)) break;
+            co_await ex.sleepFor(coroMs(400));
+        }
+        game.showCountdown(0);
+    }
+
+    // The snake blinks where it hit, then the game-over screen comes up
+    CoroTask deathAnimation() {
+        for (int i = 0; i < 6; i++) {
+            game.blink(i % 2 == 0);
+            co_await ex.sleepFor(coroMs(150));
+        }
+        game.endGame();
+    }
+
+    // Ticks fall on a fixed grid from here on, without drift
+    void startTicks() {
+        CoroTime period = game.tickPeriod();
+        ex.startTicks(ex.now() + period, period);
+        game.ticksStarted();
+    }
+
+    CoroExecutor& ex;
+    Game& game;
+    CoroTaskId task;
+};
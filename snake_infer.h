@@ -0,0 +1,327 @@
+// snake_infer.h
+// Batched inference for many bot-controlled games sharing one policy. Games post decision
+// requests into per-game slots; a scheduler thread gathers whatever is pending into one
+// batch and runs the policy as a matrix multiply once the batch is full or the oldest
+// request reaches its deadline, then answers through the same slots.
+
+#pragma once
+
+#include "snake_queue.h"
+#include "snake_sim.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SNAKE_INFER_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define SNAKE_INFER_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static inline int inferLowestBit(unsigned bits) {
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, bits);
+    return (int)i;
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+
+//
+// Dense layer over a batch: out[r] = act(rows[r] * w + b), w is K x N row-major.
+// Rows are read through pointers so requests are never copied into a batch matrix.
+// Rows go through in pairs that share every weight load, and only inputs that are nonzero
+// in either row are visited: a board observation has ~10 of 400, a ReLU layer about half.
+//
+static constexpr int INFER_ROW_BLOCK = 2;
+
+static void inferDense(const float* const* rows, int count, int K, const float* w, const float* b,
+    int N, float* out, bool relu) {
+    std::vector<int> active((size_t)K);
+    int* act = active.data();
+
+    for (int r0 = 0; r0 < count; r0 += INFER_ROW_BLOCK) {
+        int rb = std::min(INFER_ROW_BLOCK, count - r0);
+        const float* x0 = rows[r0];
+        const float* x1 = rows[r0 + rb - 1];
+
+        // Nonzero columns of the pair
+        int n = 0;
+        int k = 0;
+#if SNAKE_INFER_SSE2
+        for (; k + 4 <= K; k += 4) {
+            __m128 nz = _mm_or_ps(_mm_cmpneq_ps(_mm_loadu_ps(x0 + k), _mm_setzero_ps()),
+                _mm_cmpneq_ps(_mm_loadu_ps(x1 + k), _mm_setzero_ps()));
+            unsigned bits = (unsigned)_mm_movemask_ps(nz);
+            while (bits) {
+                act[n++] = k + inferLowestBit(bits);
+                bits &= bits - 1;
+            }
+        }
+#endif
+        for (; k < K; k++) {
+            act[n] = k;
+            n += (x0[k] != 0.0f || x1[k] != 0.0f) ? 1 : 0;
+        }
+
+        int j = 0;
+#if SNAKE_INFER_AVX2
+        for (; j + 8 <= N; j += 8) {
+            __m256 acc0 = _mm256_loadu_ps(b + j);
+            __m256 acc1 = acc0;
+            for (int q = 0; q < n; q++) {
+                __m256 wv = _mm256_loadu_ps(w + (size_t)act[q] * N + j);
+                acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_set1_ps(x0[act[q]]), wv));
+                acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_set1_ps(x1[act[q]]), wv));
+            }
+            if (relu) {
+                acc0 = _mm256_max_ps(acc0, _mm256_setzero_ps());
+                acc1 = _mm256_max_ps(acc1, _mm256_setzero_ps());
+            }
+            _mm256_storeu_ps(out + (size_t)r0 * N + j, acc0);
+            if (rb > 1) _mm256_storeu_ps(out + (size_t)(r0 + 1) * N + j, acc1);
+        }
+#endif
+#if SNAKE_INFER_SSE2
+        for (; j + 4 <= N; j += 4) {
+            __m128 acc0 = _mm_loadu_ps(b + j);
+            __m128 acc1 = acc0;
+            for (int q = 0; q < n; q++) {
+                __m128 wv = _mm_loadu_ps(w + (size_t)act[q] * N + j);
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_set1_ps(x0[act[q]]), wv));
+                acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_set1_ps(x1[act[q]]), wv));
+            }
+            if (relu) {
+                acc0 = _mm_max_ps(acc0, _mm_setzero_ps());
+                acc1 = _mm_max_ps(acc1, _mm_setzero_ps());
+            }
+            _mm_storeu_ps(out + (size_t)r0 * N + j, acc0);
+            if (rb > 1) _mm_storeu_ps(out + (size_t)(r0 + 1) * N + j, acc1);
+        }
+#endif
+        for (; j < N; j++) {
+            float acc0 = b[j], acc1 = b[j];
+            for (int q = 0; q < n; q++) {
+                float wv = w[(size_t)act[q] * N + j];
+                acc0 += x0[act[q]] * wv;
+                acc1 += x1[act[q]] * wv;
+            }
+            out[(size_t)r0 * N + j] = relu ? std::max(acc0, 0.0f) : acc0;
+            if (rb > 1) out[(size_t)(r0 + 1) * N + j] = relu ? std::max(acc1, 0.0f) : acc1;
+        }
+    }
+}
+
+//
+// Policy: inputs -> hidden (ReLU) -> 4 action logits
+//
+struct InferPolicy {
+    int inputs = 0;
+    int hidden = 0;
+    static constexpr int ACTIONS = 4;
+    std::vector<float> w1, b1, w2, b2;
+
+    void init(int inputCount, int hiddenCount, uint64_t seed) {
+        inputs = inputCount;
+        hidden = hiddenCount;
+        w1.resize((size_t)inputs * hidden);
+        b1.assign((size_t)hidden, 0.0f);
+        w2.resize((size_t)hidden * ACTIONS);
+        b2.assign(ACTIONS, 0.0f);
+
+        // Uniform +-1/sqrt(fan in)
+        SimRng rng{ seed };
+        auto fill = [&](std::vector<float>& v, int fanIn) {
+            float scale = 1.0f / std::sqrt((float)fanIn);
+            for (float& x : v) x = ((float)(rng.next() >> 40) / 16777216.0f * 2.0f - 1.0f) * scale;
+        };
+        fill(w1, inputs);
+        fill(w2, hidden);
+    }
+
+    // Greedy actions for count rows; hiddenOut needs count * hidden floats
+    void act(const float* const* rows, int count, float* hiddenOut, const float** hiddenRows,
+        float* logits, int32_t* actions) const {
+        inferDense(rows, count, inputs, w1.data(), b1.data(), hidden, hiddenOut, true);
+        for (int i = 0; i < count; i++) hiddenRows[i] = hiddenOut + (size_t)i * hidden;
+        inferDense(hiddenRows, count, hidden, w2.data(), b2.data(), ACTIONS, logits, false);
+        for (int i = 0; i < count; i++) {
+            const float* l = logits + (size_t)i * ACTIONS;
+            actions[i] = (int32_t)(std::max_element(l, l + ACTIONS) - l);
+        }
+    }
+};
+
+//
+// Per-game slot. The game writes its features into input(), then submit(); the answer is
+// ready once answered catches up with submitted.
+//
+struct alignas(CACHE_LINE) InferSlot {
+    std::atomic<uint32_t> answered{ 0 };
+    int32_t action = 0;
+    uint32_t submitted = 0; // game side only
+    int64_t submittedAt = 0; // steady clock ns, for the deadline
+};
+
+struct InferStats {
+    uint64_t batches = 0;
+    uint64_t requests = 0;
+    uint64_t deadlineFlushes = 0; // batches sent before they were full
+};
+
+// The policy must outlive the server.
+class InferServer {
+public:
+    InferServer(const InferPolicy& policy, int games, int maxBatch, int deadlineUs)
+        : policy(policy), maxBatch(std::max(1, maxBatch)), deadlineNs((int64_t)deadlineUs * 1000),
+          slots((size_t)games), inputs((size_t)games * policy.inputs), requests((size_t)games) {
+        scheduler = std::thread([this] { run(); });
+    }
+
+    ~InferServer() {
+        stop.store(true, std::memory_order_relaxed);
+        signal.fetch_add(1, std::memory_order_release);
+        signal.notify_one();
+        scheduler.join();
+    }
+
+    InferServer(const InferServer&) = delete;
+    InferServer& operator=(const InferServer&) = delete;
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //
+    // Game side: at most one request per game in flight
+    //
+    float* input(int game) { return inputs.data() + (size_t)game * policy.inputs; }
+
+    void submit(int game) {
+        InferSlot& s = slots[(size_t)game];
+        s.submitted++;
+        s.submittedAt = nowNs();
+        while (!requests.push((uint32_t)game)) std::this_thread::yield();
+        // Pairs with the scheduler's fence: either it sees the request or we see it idle
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (idle.load(std::memory_order_relaxed)) {
+            signal.fetch_add(1, std::memory_order_release);
+            signal.notify_one();
+        }
+    }
+
+    bool poll(int game, int32_t& action) const {
+        const InferSlot& s = slots[(size_t)game];
+        if (s.answered.load(std::memory_order_acquire) != s.submitted) return false;
+        action = s.action;
+        return true;
+    }
+
+    int32_t wait(int game) const {
+        const InferSlot& s = slots[(size_t)game];
+        uint32_t seen = s.answered.load(std::memory_order_acquire);
+        while (seen != s.submitted) {
+            s.answered.wait(seen, std::memory_order_acquire);
+            seen = s.answered.load(std::memory_order_acquire);
+        }
+        return s.action;
+    }
+
+    int64_t submittedAt(int game) const { return slots[(size_t)game].submittedAt; }
+
+    // Counters as of the last completed batch
+    InferStats stats() const {
+        InferStats st;
+        st.batches = batches.load(std::memory_order_relaxed);
+        st.requests = answeredCount.load(std::memory_order_relaxed);
+        st.deadlineFlushes = deadlineFlushes.load(std::memory_order_relaxed);
+        return st;
+    }
+
+private:
+    void run() {
+        std::vector<uint32_t> batch;
+        std::vector<const float*> rows((size_t)maxBatch), hiddenRows((size_t)maxBatch);
+        std::vector<float> hidden((size_t)maxBatch * policy.hidden);
+        std::vector<float> logits((size_t)maxBatch * InferPolicy::ACTIONS);
+        std::vector<int32_t> actions((size_t)maxBatch);
+        batch.reserve((size_t)maxBatch);
+
+        while (!stop.load(std::memory_order_relaxed)) {
+            // Gather until full or the oldest request is due
+            int64_t flushAt = 0;
+            while ((int)batch.size() < maxBatch) {
+                uint32_t game;
+                if (requests.pop(game)) {
+                    if (batch.empty()) flushAt = slots[game].submittedAt + deadlineNs;
+                    batch.push_back(game);
+                    continue;
+                }
+                if (!batch.empty()) {
+                    if (nowNs() >= flushAt) break;
+                    std::this_thread::yield();
+                    continue;
+                }
+                // Nothing pending: sleep until a game submits
+                uint32_t seen = signal.load(std::memory_order_acquire);
+                idle.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!requests.pop(game)) {
+                    if (stop.load(std::memory_order_relaxed)) break;
+                    signal.wait(seen, std::memory_order_acquire);
+                    idle.store(false, std::memory_order_relaxed);
+                    continue;
+                }
+                idle.store(false, std::memory_order_relaxed);
+                flushAt = slots[game].submittedAt + deadlineNs;
+                batch.push_back(game);
+            }
+            if (batch.empty()) continue;
+
+            int count = (int)batch.size();
+            for (int i = 0; i < count; i++) rows[i] = inputs.data() + (size_t)batch[i] * policy.inputs;
+            policy.act(rows.data(), count, hidden.data(), hiddenRows.data(), logits.data(), actions.data());
+
+            for (int i = 0; i < count; i++) {
+                InferSlot& s = slots[batch[i]];
+                s.action = actions[i];
+                s.answered.fetch_add(1, std::memory_order_release);
+                s.answered.notify_one();
+            }
+            batches.fetch_add(1, std::memory_order_relaxed);
+            answeredCount.fetch_add((uint64_t)count, std::memory_order_relaxed);
+            if (count < maxBatch) deadlineFlushes.fetch_add(1, std::memory_order_relaxed);
+            batch.clear();
+        }
+    }
+
+    const InferPolicy& policy;
+    int maxBatch;
+    int64_t deadlineNs;
+    std::vector<InferSlot> slots;
+    std::vector<float> inputs;
+    MpmcQueue<uint32_t> requests;
+    std::thread scheduler;
+
+    alignas(CACHE_LINE) std::atomic<uint32_t> signal{ 0 };
+    std::atomic<bool> idle{ false };
+    std::atomic<bool> stop{ false };
+    alignas(CACHE_LINE) std::atomic<uint64_t> batches{ 0 };
+    std::atomic<uint64_t> answeredCount{ 0 };
+    std::atomic<uint64_t> deadlineFlushes{ 0 };
+};
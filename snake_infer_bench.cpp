@@ -0,0 +1,139 @@
+// snake_infer_bench.cpp
+// Drives many games from one policy through the batched inference server and reports
+// decision throughput, batch fill and request-to-answer latency.
+// Compile: g++ snake_infer_bench.cpp -std=c++20 -O2 -pthread -o snake_infer_bench
+// Compare against one forward pass per game with --max-batch 1.
+
+#include "snake_infer.h"
+#include "snake_obs.h"
+#include "snake_sim.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+//
+// Config
+//
+struct InferBenchConfig {
+    int games = 4096;
+    int clients = 1; // threads running games
+    int maxBatch = 256;
+    int deadlineUs = 500;
+    int hidden = 64;
+    int width = 10;
+    int height = 10;
+    double seconds = 3.0;
+};
+
+static InferBenchConfig parseArgs(int argc, char** argv) {
+    InferBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--games") && i + 1 < argc) cfg.games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--clients") && i + 1 < argc) cfg.clients = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-batch") && i + 1 < argc) cfg.maxBatch = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--deadline-us") && i + 1 < argc) cfg.deadlineUs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hidden") && i + 1 < argc) cfg.hidden = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) cfg.seconds = atof(argv[++i]);
+    }
+    return cfg;
+}
+
+//
+// One client thread: keeps a request in flight for each of its games, steps a game as
+// soon as its answer arrives
+//
+struct ClientResult {
+    long long decisions = 0;
+    long long episodes = 0;
+    std::vector<double> latencyUs;
+};
+
+static void runClient(InferServer& server, const InferBenchConfig& cfg, int first, int count,
+    int64_t stopAt, ClientResult& result) {
+    int cells = cfg.width * cfg.height;
+    size_t words = SnakeSim::storageWords(cells);
+    std::vector<uint32_t> storage(words * count);
+    std::vector<SnakeSim> games((size_t)count);
+    SimRng rng{ 500 + (uint64_t)first };
+
+    auto encodeAndSubmit = [&](int i) {
+        obsEncodeBoard(games[i], { server.input(first + i), (ptrdiff_t)cells, (ptrdiff_t)cfg.width });
+        server.submit(first + i);
+    };
+
+    for (int i = 0; i < count; i++) {
+        games[i].bind(storage.data() + words * i, cells);
+        games[i].reset(cfg.width, cfg.height, 1, rng.next());
+        encodeAndSubmit(i);
+    }
+
+    result.latencyUs.reserve(1 << 20);
+    while (InferServer::nowNs() < stopAt) {
+        bool any = false;
+        for (int i = 0; i < count; i++) {
+            int32_t action;
+            if (!server.poll(first + i, action)) continue;
+            any = true;
+            result.latencyUs.push_back((InferServer::nowNs() - server.submittedAt(first + i)) / 1000.0);
+            result.decisions++;
+
+            games[i].step(action);
+            if (games[i].done()) {
+                result.episodes++;
+                games[i].reset(cfg.width, cfg.height, 1, rng.next());
+            }
+            encodeAndSubmit(i);
+        }
+        if (!any) std::this_thread::yield();
+    }
+
+    // Drain so the server never answers into a destroyed game
+    for (int i = 0; i < count; i++) server.wait(first + i);
+}
+
+int main(int argc, char** argv) {
+    InferBenchConfig cfg = parseArgs(argc, argv);
+    int clients = std::max(1, std::min(cfg.clients, cfg.games));
+
+    InferPolicy policy;
+    policy.init(OBS_BOARD_CHANNELS * cfg.width * cfg.height, cfg.hidden, 1);
+    InferServer server(policy, cfg.games, cfg.maxBatch, cfg.deadlineUs);
+
+    std::vector<ClientResult> results((size_t)clients);
+    std::vector<std::thread> threads;
+    int64_t t0 = InferServer::nowNs();
+    int64_t stopAt = t0 + (int64_t)(cfg.seconds * 1e9);
+    for (int c = 0; c < clients; c++) {
+        int first = (int)((long long)cfg.games * c / clients);
+        int last = (int)((long long)cfg.games * (c + 1) / clients);
+        threads.emplace_back(runClient, std::ref(server), std::cref(cfg), first, last - first, stopAt, std::ref(results[c]));
+    }
+    for (auto& t : threads) t.join();
+    double secs = (InferServer::nowNs() - t0) / 1e9;
+
+    long long decisions = 0, episodes = 0;
+    std::vector<double> latency;
+    for (auto& r : results) {
+        decisions += r.decisions;
+        episodes += r.episodes;
+        latency.insert(latency.end(), r.latencyUs.begin(), r.latencyUs.end());
+    }
+    std::sort(latency.begin(), latency.end());
+    auto pct = [&](double p) { return latency.empty() ? 0.0 : latency[std::min(latency.size() - 1, size_t(p * latency.size()))]; };
+
+    InferStats st = server.stats();
+    printf("%d games, %d clients, %dx%d, hidden %d, max batch %d, deadline %d us\n",
+        cfg.games, clients, cfg.width, cfg.height, cfg.hidden, cfg.maxBatch, cfg.deadlineUs);
+    printf("%.2f M decisions/s, %lld episodes, mean batch %.1f, %.1f%% flushed by deadline\n",
+        decisions / secs / 1e6, episodes, st.batches ? double(st.requests) / st.batches : 0.0,
+        st.batches ? 100.0 * st.deadlineFlushes / st.batches : 0.0);
+    printf("decision latency us: p50 %.1f  p99 %.1f  max %.1f\n", pct(0.50), pct(0.99), latency.empty() ? 0.0 : latency.back());
+    return 0;
+}
@@ -0,0 +1,530 @@
+// snake_jobs.h
+// Job system: small functions that run once every job they depend on has finished, on a
+// fixed set of worker threads. Each worker owns a work-stealing deque: jobs it makes
+// ready go on its own end and it pops them newest first, while idle workers steal the
+// oldest from the other end. Jobs made ready anywhere else go through a shared injector
+// queue. Jobs with JOB_MAIN affinity never run on a worker: they wait in a queue that
+// the main thread drains with runMain(), for work that must happen on the thread that
+// owns the window. addAt() holds a job back until a point in time as well, which is how
+// periodic work is expressed: each run adds the next.
+//
+// Jobs live in a fixed pool of slots and are named by JobId, a slot index plus the
+// slot's generation, so an id stays valid to wait on or depend on after its slot has
+// been reused: a job whose generation moved on has finished. Functions are stored
+// inline in the slot (JOB_FN_BYTES), so adding a job does not allocate.
+
+#pragma once
+
+#include "snake_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using JobClock = std::chrono::steady_clock;
+
+static constexpr size_t JOB_FN_BYTES = 64;
+static constexpr int JOB_INLINE_SUCCESSORS = 4;
+
+enum JobAffinity : uint8_t {
+    JOB_ANY,  // any worker, or a thread helping in wait() / drain()
+    JOB_MAIN, // only the thread that constructed the JobSystem, in runMain()
+};
+
+struct JobId {
+    uint32_t index = UINT32_MAX; // UINT32_MAX: no job, already done
+    uint32_t generation = 0;
+    bool valid() const { return index != UINT32_MAX; }
+};
+
+struct JobStats {
+    uint64_t executed = 0; // by workers
+    uint64_t stolen = 0;   // of those, taken from another worker's deque
+    uint64_t helped = 0;   // run by threads waiting in wait() / drain()
+    uint64_t main = 0;     // JOB_MAIN jobs run by runMain()
+};
+
+//
+// Chase-Lev deque of slot indices (the C11 version of Le et al., PPoPP 2013). Only the
+// owning worker pushes and pops, at the bottom; anyone steals from the top. Fixed size:
+// push() fails when full and the caller falls back to the injector.
+//
+class JobDeque {
+public:
+    explicit JobDeque(size_t minCapacity) {
+        size_t cap = 2;
+        while (cap < minCapacity) cap <<= 1;
+        mask = cap - 1;
+        ring = std::make_unique<std::atomic<uint32_t>[]>(cap);
+    }
+
+    bool push(uint32_t v) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t > (int64_t)mask) return false;
+        ring[(size_t)b & mask].store(v, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release); // thieves read the slot after bottom
+        return true;
+    }
+
+    bool pop(uint32_t& v) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        v = ring[(size_t)b & mask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // The last one: race the thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    bool steal(uint32_t& v) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+        v = ring[(size_t)t & mask].load(std::memory_order_relaxed);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+private:
+    std::unique_ptr<std::atomic<uint32_t>[]> ring;
+    size_t mask = 0;
+    alignas(CACHE_LINE) std::atomic<int64_t> top{ 0 };
+    alignas(CACHE_LINE) std::atomic<int64_t> bottom{ 0 };
+};
+
+//
+// The system. Construct it on the main thread; mainWake (if any) is called from
+// whichever thread makes a JOB_MAIN job ready while none is pending, so the main thread
+// can be told to call runMain(), e.g. by posting it a window message.
+//
+class JobSystem {
+public:
+    explicit JobSystem(int workers, void (*mainWake)(void*) = nullptr, void* wakeCtx = nullptr, uint32_t capacity = 4096)
+        : capacity(capacity), slots(new Job[capacity]), freeSlots(capacity), injector(capacity), mainQueue(capacity),
+          mainWake(mainWake), wakeCtx(wakeCtx), mainThread(std::this_thread::get_id()) {
+        for (uint32_t i = 0; i < capacity; i++) freeSlots.push(i);
+        int n = workers < 1 ? 1 : workers;
+        for (int w = 0; w < n; w++) this->workers.push_back(std::make_unique<Worker>(capacity, 0x9E3779B9u * (uint32_t)(w + 1)));
+        for (int w = 0; w < n; w++) threads.emplace_back([this, w] { loop(w); });
+    }
+
+    // Jobs not run by now are dropped; call drain() first to finish them
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lk(sleepMtx);
+            stopping.store(true, std::memory_order_relaxed);
+        }
+        sleepCv.notify_all();
+        for (auto& th : threads) th.join();
+        for (uint32_t i = 0; i < capacity; i++) {
+            if (slots[i].drop) slots[i].drop(slots[i].fn);
+        }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int workerCount() const { return (int)workers.size(); }
+
+    // fn runs once every job in after has finished; ids that are not valid() are skipped
+    template <typename Fn>
+    JobId add(Fn&& fn, std::initializer_list<JobId> after = {}, JobAffinity affinity = JOB_ANY) {
+        return add(std::forward<Fn>(fn), after.begin(), after.size(), affinity);
+    }
+
+    template <typename Fn>
+    JobId add(Fn&& fn, const JobId* after, size_t count, JobAffinity affinity = JOB_ANY) {
+        uint32_t idx = prepare(std::forward<Fn>(fn), affinity);
+        JobId id = { idx, slots[idx].generation.load(std::memory_order_relaxed) };
+        depend(idx, after, count);
+        release(idx);
+        return id;
+    }
+
+    // The same, and not before at
+    template <typename Fn>
+    JobId addAt(JobClock::time_point at, Fn&& fn, std::initializer_list<JobId> after = {}, JobAffinity affinity = JOB_ANY) {
+        uint32_t idx = prepare(std::forward<Fn>(fn), affinity);
+        JobId id = { idx, slots[idx].generation.load(std::memory_order_relaxed) };
+        slots[idx].waiting.fetch_add(1, std::memory_order_relaxed); // released by the timer
+        depend(idx, after.begin(), after.size());
+        {
+            std::lock_guard<std::mutex> lk(sleepMtx);
+            timers.push_back({ at, idx });
+            siftUp(timers.size() - 1);
+            nextTimer.store(timers[0].at.time_since_epoch().count(), std::memory_order_release);
+        }
+        wakeWorker(); // a sleeper may need an earlier deadline
+        release(idx);
+        return id;
+    }
+
+    bool done(JobId id) const {
+        return !id.valid() || slots[id.index].generation.load(std::memory_order_acquire) != id.generation;
+    }
+
+    // Runs other jobs until id has finished
+    void wait(JobId id) {
+        for (int spin = 0; !done(id); spin++) {
+            if (helpOne()) spin = 0;
+            else if (spin > 64) std::this_thread::sleep_for(std::chrono::microseconds(50));
+            else std::this_thread::yield();
+        }
+    }
+
+    // Main thread: runs the JOB_MAIN jobs that are ready, and any they make ready
+    int runMain() {
+        if (std::this_thread::get_id() != mainThread) return 0;
+        mainPending.store(false, std::memory_order_seq_cst);
+        int n = 0;
+        uint32_t idx;
+        while (mainQueue.pop(idx)) {
+            execute(idx);
+            n++;
+        }
+        if (n) stats.main.fetch_add((uint64_t)n, std::memory_order_relaxed);
+        return n;
+    }
+
+    // Fires every timer now, including those added meanwhile, and helps until no job is
+    // left. Jobs that add themselves again must stop doing so first.
+    void drain() {
+        draining.store(true, std::memory_order_seq_cst);
+        wakeWorker();
+        for (int spin = 0; live.load(std::memory_order_acquire) != 0; spin++) {
+            fireTimers();
+            if (runMain() || helpOne()) spin = 0;
+            else if (spin > 64) std::this_thread::sleep_for(std::chrono::microseconds(50));
+            else std::this_thread::yield();
+        }
+        draining.store(false, std::memory_order_seq_cst);
+    }
+
+    JobStats statistics() const {
+        JobStats s;
+        for (auto& w : workers) {
+            s.executed += w->executed.load(std::memory_order_relaxed);
+            s.stolen += w->stolen.load(std::memory_order_relaxed);
+        }
+        s.helped = stats.helped.load(std::memory_order_relaxed);
+        s.main = stats.main.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    //
+    // Slots
+    //
+    struct alignas(CACHE_LINE) Job {
+        alignas(std::max_align_t) unsigned char fn[JOB_FN_BYTES];
+        void (*run)(void*) = nullptr;  // calls and destroys fn
+        void (*drop)(void*) = nullptr; // destroys fn without calling it
+        std::atomic<uint32_t> generation{ 0 };
+        std::atomic<int32_t> waiting{ 0 }; // unfinished dependencies, timer and submission holds
+        std::atomic_flag lock = ATOMIC_FLAG_INIT; // guards the successors
+        JobAffinity affinity = JOB_ANY;
+        uint32_t successorCount = 0;
+        uint32_t successors[JOB_INLINE_SUCCESSORS];
+        std::vector<uint32_t> more; // past JOB_INLINE_SUCCESSORS; keeps its capacity
+    };
+
+    struct Timer {
+        JobClock::time_point at;
+        uint32_t idx;
+    };
+
+    struct Worker {
+        Worker(size_t capacity, uint32_t seed) : deque(capacity), rng(seed) {}
+        JobDeque deque;
+        uint32_t rng; // victim order
+        alignas(CACHE_LINE) std::atomic<uint64_t> executed{ 0 };
+        std::atomic<uint64_t> stolen{ 0 };
+    };
+
+    template <typename Fn>
+    uint32_t prepare(Fn&& fn, JobAffinity affinity) {
+        using F = std::decay_t<Fn>;
+        static_assert(sizeof(F) <= JOB_FN_BYTES, "job captures too much; capture a pointer instead");
+        static_assert(alignof(F) <= alignof(std::max_align_t), "job function over-aligned");
+
+        uint32_t idx;
+        for (int spin = 0; !freeSlots.pop(idx); spin++) {
+            // Every slot is in flight: help finish some
+            if (!helpOne()) std::this_thread::yield();
+        }
+        live.fetch_add(1, std::memory_order_relaxed);
+        Job& j = slots[idx];
+        new (j.fn) F(std::forward<Fn>(fn));
+        j.run = [](void* p) {
+            F& f = *static_cast<F*>(p);
+            f();
+            f.~F();
+        };
+        j.drop = [](void* p) { static_cast<F*>(p)->~F(); };
+        j.affinity = affinity;
+        j.successorCount = 0;
+        j.waiting.store(1, std::memory_order_relaxed); // held until add() has set it up
+        return idx;
+    }
+
+    void lockSlot(Job& j) {
+        while (j.lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+    }
+
+    void depend(uint32_t idx, const JobId* after, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const JobId& d = after[i];
+            if (!d.valid()) continue;
+            Job& dep = slots[d.index];
+            lockSlot(dep);
+            // A slot's generation moves on, under its lock, as its job finishes
+            if (dep.generation.load(std::memory_order_relaxed) == d.generation) {
+                slots[idx].waiting.fetch_add(1, std::memory_order_relaxed);
+                if (dep.successorCount < JOB_INLINE_SUCCESSORS) dep.successors[dep.successorCount] = idx;
+                else dep.more.push_back(idx);
+                dep.successorCount++;
+            }
+            dep.lock.clear(std::memory_order_release);
+        }
+    }
+
+    // The rings hold every slot, so they never fill; but a push can find the cell it
+    // wraps onto still being read by a pop that already claimed it, and must retry
+    static void enqueue(MpmcQueue<uint32_t>& q, uint32_t idx) {
+        while (!q.push(idx)) std::this_thread::yield();
+    }
+
+    // Drops one hold on the job; the last one makes it ready
+    void release(uint32_t idx) {
+        Job& j = slots[idx];
+        if (j.waiting.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+        if (j.affinity == JOB_MAIN) {
+            enqueue(mainQueue, idx);
+            if (!mainPending.exchange(true, std::memory_order_seq_cst) && mainWake) mainWake(wakeCtx);
+            return;
+        }
+        int w = tlsSystem == this ? tlsWorker : -1;
+        if (w < 0 || !workers[w]->deque.push(idx)) enqueue(injector, idx);
+        ready.fetch_add(1, std::memory_order_seq_cst);
+        wakeWorker();
+    }
+
+    void execute(uint32_t idx) {
+        Job& j = slots[idx];
+        j.run(j.fn);
+        j.run = nullptr;
+        j.drop = nullptr;
+
+        lockSlot(j);
+        j.generation.fetch_add(1, std::memory_order_release);
+        j.lock.clear(std::memory_order_release);
+        // No one adds successors any more: the generation they would name has passed
+        uint32_t n = j.successorCount;
+        for (uint32_t i = 0; i < n; i++) release(i < JOB_INLINE_SUCCESSORS ? j.successors[i] : j.more[i - JOB_INLINE_SUCCESSORS]);
+        j.more.clear();
+
+        live.fetch_sub(1, std::memory_order_release);
+        enqueue(freeSlots, idx);
+    }
+
+    //
+    // Finding work
+    //
+    bool take(int w, uint32_t& idx, bool& stolen) {
+        stolen = false;
+        if (w >= 0 && workers[w]->deque.pop(idx)) return taken();
+        if (injector.pop(idx)) return taken();
+        size_t n = workers.size();
+        uint32_t start;
+        if (w >= 0) {
+            uint32_t& r = workers[w]->rng;
+            r ^= r << 13;
+            r ^= r >> 17;
+            r ^= r << 5;
+            start = r;
+        }
+        else start = 0;
+        for (size_t k = 0; k < n; k++) {
+            size_t v = (start + k) % n;
+            if ((int)v == w) continue;
+            if (workers[v]->deque.steal(idx)) {
+                stolen = true;
+                return taken();
+            }
+        }
+        return false;
+    }
+
+    bool taken() {
+        ready.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // One job from anywhere, on a thread that is not a worker or is waiting inside a job
+    bool helpOne() {
+        uint32_t idx;
+        bool stolen;
+        int w = tlsSystem == this ? tlsWorker : -1;
+        if (std::this_thread::get_id() == mainThread && mainQueue.pop(idx)) {
+            execute(idx);
+            stats.main.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (!take(w, idx, stolen)) return false;
+        execute(idx);
+        if (w >= 0) {
+            workers[w]->executed.fetch_add(1, std::memory_order_relaxed);
+            if (stolen) workers[w]->stolen.fetch_add(1, std::memory_order_relaxed);
+        }
+        else stats.helped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void loop(int w) {
+        tlsSystem = this;
+        tlsWorker = w;
+        Worker& me = *workers[w];
+        uint32_t idx;
+        bool stolen;
+        int idle = 0;
+        while (!stopping.load(std::memory_order_relaxed)) {
+            fireTimers();
+            if (take(w, idx, stolen)) {
+                execute(idx);
+                me.executed.fetch_add(1, std::memory_order_relaxed);
+                if (stolen) me.stolen.fetch_add(1, std::memory_order_relaxed);
+                idle = 0;
+                continue;
+            }
+            if (++idle < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            sleep();
+            idle = 0;
+        }
+        tlsSystem = nullptr;
+        tlsWorker = -1;
+    }
+
+    //
+    // Sleeping and timers. A thread that makes work ready bumps epoch and then looks for
+    // sleepers; a worker going to sleep counts itself and then reads epoch, both under
+    // sleepMtx, so one of them always sees the other.
+    //
+    void sleep() {
+        std::unique_lock<std::mutex> lk(sleepMtx);
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        uint64_t seen = epoch.load(std::memory_order_seq_cst);
+        auto woken = [&] { return stopping.load(std::memory_order_relaxed) || epoch.load(std::memory_order_seq_cst) != seen; };
+        if (ready.load(std::memory_order_seq_cst) == 0 && !draining.load(std::memory_order_relaxed)) {
+            if (timers.empty()) sleepCv.wait(lk, woken);
+            else {
+                JobClock::time_point until = timers[0].at; // not a reference: the heap moves while we sleep
+                sleepCv.wait_until(lk, until, woken);
+            }
+        }
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void wakeWorker() {
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_seq_cst) == 0) return;
+        { std::lock_guard<std::mutex> lk(sleepMtx); }
+        sleepCv.notify_one();
+    }
+
+    void fireTimers() {
+        bool all = draining.load(std::memory_order_relaxed);
+        if (!all && nextTimer.load(std::memory_order_acquire) > JobClock::now().time_since_epoch().count()) return;
+
+        uint32_t due[32];
+        for (;;) {
+            int n = 0;
+            {
+                std::lock_guard<std::mutex> lk(sleepMtx);
+                auto now = JobClock::now();
+                while (n < 32 && !timers.empty() && (all || timers[0].at <= now)) {
+                    due[n++] = timers[0].idx;
+                    timers[0] = timers.back();
+                    timers.pop_back();
+                    if (!timers.empty()) siftDown(0);
+                }
+                nextTimer.store(timers.empty() ? INT64_MAX : timers[0].at.time_since_epoch().count(), std::memory_order_release);
+            }
+            for (int i = 0; i < n; i++) release(due[i]);
+            if (n < 32) return;
+        }
+    }
+
+    void siftUp(size_t i) {
+        while (i > 0) {
+            size_t p = (i - 1) / 2;
+            if (!(timers[i].at < timers[p].at)) break;
+            std::swap(timers[i], timers[p]);
+            i = p;
+        }
+    }
+
+    void siftDown(size_t i) {
+        for (;;) {
+            size_t l = 2 * i + 1, r = l + 1, m = i;
+            if (l < timers.size() && timers[l].at < timers[m].at) m = l;
+            if (r < timers.size() && timers[r].at < timers[m].at) m = r;
+            if (m == i) return;
+            std::swap(timers[i], timers[m]);
+            i = m;
+        }
+    }
+
+    inline static thread_local JobSystem* tlsSystem = nullptr;
+    inline static thread_local int tlsWorker = -1;
+
+    uint32_t capacity;
+    std::unique_ptr<Job[]> slots;
+    MpmcQueue<uint32_t> freeSlots;
+    MpmcQueue<uint32_t> injector;
+    MpmcQueue<uint32_t> mainQueue;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    void (*mainWake)(void*);
+    void* wakeCtx;
+    std::thread::id mainThread;
+
+    std::mutex sleepMtx;
+    std::condition_variable sleepCv;
+    std::vector<Timer> timers; // min-heap on at, under sleepMtx
+
+    alignas(CACHE_LINE) std::atomic<int64_t> ready{ 0 }; // in the injector or a deque
+    alignas(CACHE_LINE) std::atomic<uint64_t> epoch{ 0 };
+    std::atomic<int> sleepers{ 0 };
+    alignas(CACHE_LINE) std::atomic<int64_t> nextTimer{ INT64_MAX };
+    std::atomic<bool> draining{ false };
+    std::atomic<bool> stopping{ false };
+    std::atomic<bool> mainPending{ false };
+    alignas(CACHE_LINE) std::atomic<uint32_t> live{ 0 }; // slots in use
+    struct {
+        std::atomic<uint64_t> helped{ 0 };
+        std::atomic<uint64_t> main{ 0 };
+    } stats;
+};
@@ -0,0 +1,198 @@
+// snake_jobs_bench.cpp
+// What a job costs in JobSystem (snake_jobs.h): adding and running empty jobs from outside
+// the workers (through the injector) and from inside one (its own deque), joining many with
+// one dependent job, chains where each job waits for the last, and how many of a
+// producer's jobs idle workers steal. Then scaling: a fixed amount of work cut into chunks,
+// run on 1, 2, 4 ... workers, next to a thread per chunk and ArenaWorkers (snake_arena.h).
+// Workers beyond the machine's cores only add switching; the header line says how many
+// there are.
+// Compile: g++ snake_jobs_bench.cpp -std=c++20 -O2 -pthread -o snake_jobs_bench
+// Run:     ./snake_jobs_bench [--jobs 200000] [--chunks 256] [--chunk-us 20] [--max-workers 8]
+
+#include "snake_arena.h"
+#include "snake_jobs.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+//
+// Config
+//
+struct JobsBenchConfig {
+    int jobs = 200000;  // empty jobs per overhead test
+    int chunks = 256;   // scaling: pieces of work
+    int chunkUs = 20;   // scaling: roughly how long each takes on one core
+    int maxWorkers = 0; // 0: the larger of 8 and the core count
+};
+
+static JobsBenchConfig parseArgs(int argc, char** argv) {
+    JobsBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--jobs") && i + 1 < argc) cfg.jobs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--chunks") && i + 1 < argc) cfg.chunks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--chunk-us") && i + 1 < argc) cfg.chunkUs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-workers") && i + 1 < argc) cfg.maxWorkers = atoi(argv[++i]);
+    }
+    return cfg;
+}
+
+using BenchClock = std::chrono::steady_clock;
+
+static double usSince(BenchClock::time_point t) {
+    return std::chrono::duration<double, std::micro>(BenchClock::now() - t).count();
+}
+
+//
+// Overhead: empty jobs, ns each
+//
+struct OverheadRow {
+    double injected = 0, local = 0, joined = 0, chained = 0, stealShare = 0;
+};
+
+// Waits without helping, so everything runs on the workers
+static void idleWait(const std::function<bool()>& finished) {
+    while (!finished()) std::this_thread::sleep_for(std::chrono::microseconds(20));
+}
+
+static OverheadRow overhead(int workers, int jobs) {
+    OverheadRow row;
+    JobSystem js(workers, nullptr, nullptr, 1 << 16);
+    std::atomic<int> count{ 0 };
+    auto bump = [&count] { count.fetch_add(1, std::memory_order_relaxed); };
+
+    // From the main thread: every job goes through the injector
+    auto t0 = BenchClock::now();
+    for (int i = 0; i < jobs; i++) js.add(bump);
+    js.drain();
+    row.injected = usSince(t0) * 1000.0 / jobs;
+
+    // From a worker: onto its own deque, where the others can steal them
+    int target = 2 * jobs;
+    JobStats before = js.statistics();
+    t0 = BenchClock::now();
+    js.add([&] {
+        for (int i = 0; i < jobs; i++) js.add(bump);
+    });
+    idleWait([&] { return count.load() == target; });
+    row.local = usSince(t0) * 1000.0 / jobs;
+    JobStats after = js.statistics();
+    row.stealShare = (double)(after.stolen - before.stolen) / jobs;
+
+    // The same, plus one job that runs after all of them
+    std::vector<JobId> ids((size_t)jobs);
+    std::atomic<bool> joined{ false };
+    t0 = BenchClock::now();
+    js.add([&] {
+        for (int i = 0; i < jobs; i++) ids[(size_t)i] = js.add(bump);
+        js.add([&joined] { joined.store(true); }, ids.data(), ids.size());
+    });
+    idleWait([&] { return joined.load(); });
+    row.joined = usSince(t0) * 1000.0 / jobs;
+
+    // Each job after the last: nothing runs in parallel, every hop is a hand-off
+    JobId last;
+    t0 = BenchClock::now();
+    js.add([&] {
+        for (int i = 0; i < jobs; i++) last = js.add(bump, { last });
+    });
+    target = 4 * jobs;
+    idleWait([&] { return count.load() == target; });
+    row.chained = usSince(t0) * 1000.0 / jobs;
+    js.drain();
+    if (count.load() != 4 * jobs) printf("  lost jobs: %d of %d ran\n", count.load(), 4 * jobs);
+    return row;
+}
+
+//
+// Scaling: the same work in chunks, in ms
+//
+static volatile double sink = 0;
+
+static double spinWork(int iterations) {
+    double x = 1.0;
+    for (int i = 0; i < iterations; i++) x = std::sqrt(x + i);
+    return x;
+}
+
+static int calibrate(int us) {
+    int iterations = 1000;
+    for (;;) {
+        auto t0 = BenchClock::now();
+        sink = sink + spinWork(iterations);
+        double took = usSince(t0);
+        if (took > 200.0) return (std::max)(1, (int)(iterations * us / took));
+        iterations *= 2;
+    }
+}
+
+struct ScalingRow {
+    double jobs = 0, threads = 0, arena = 0;
+};
+
+static ScalingRow scaling(int workers, int chunks, int iterations) {
+    ScalingRow row;
+    std::vector<double> out((size_t)chunks);
+
+    {
+        JobSystem js(workers);
+        auto t0 = BenchClock::now();
+        for (int c = 0; c < chunks; c++) js.add([&out, c, iterations] { out[(size_t)c] = spinWork(iterations); });
+        js.drain();
+        row.jobs = usSince(t0) / 1000.0;
+    }
+    {
+        auto t0 = BenchClock::now();
+        std::vector<std::thread> th;
+        for (int c = 0; c < chunks; c++) {
+            th.emplace_back([&out, c, iterations] { out[(size_t)c] = spinWork(iterations); });
+            if ((int)th.size() == workers) {
+                for (auto& t : th) t.join();
+                th.clear();
+            }
+        }
+        for (auto& t : th) t.join();
+        row.threads = usSince(t0) / 1000.0;
+    }
+    {
+        ArenaWorkers pool(workers);
+        auto t0 = BenchClock::now();
+        pool.run(chunks, [&](int, int c) { out[(size_t)c] = spinWork(iterations); });
+        row.arena = usSince(t0) / 1000.0;
+    }
+    for (double v : out) sink = sink + v;
+    return row;
+}
+
+int main(int argc, char** argv) {
+    JobsBenchConfig cfg = parseArgs(argc, argv);
+    unsigned cores = std::thread::hardware_concurrency();
+    int maxWorkers = cfg.maxWorkers > 0 ? cfg.maxWorkers : (std::max)(8, (int)cores);
+    printf("%u hardware threads; %d empty jobs per overhead test, %d chunks of ~%d us for scaling\n", cores, cfg.jobs,
+        cfg.chunks, cfg.chunkUs);
+
+    printf("\noverhead, ns per job\n%-8s %9s %9s %9s %9s %7s\n", "workers", "injected", "local", "joined", "chained", "stolen");
+    for (int w = 1; w <= maxWorkers; w *= 2) {
+        OverheadRow r = overhead(w, cfg.jobs);
+        printf("%-8d %9.0f %9.0f %9.0f %9.0f %6.0f%%\n", w, r.injected, r.local, r.joined, r.chained, 100.0 * r.stealShare);
+    }
+
+    int iterations = calibrate(cfg.chunkUs);
+    double serial;
+    {
+        auto t0 = BenchClock::now();
+        for (int c = 0; c < cfg.chunks; c++) sink = sink + spinWork(iterations);
+        serial = usSince(t0) / 1000.0;
+    }
+    printf("\nscaling, ms for all chunks (one thread, no jobs: %.1f ms)\n%-8s %9s %8s %9s %9s\n", serial, "workers", "jobs",
+        "speedup", "threads", "arena");
+    for (int w = 1; w <= maxWorkers; w *= 2) {
+        ScalingRow r = scaling(w, cfg.chunks, iterations);
+        printf("%-8d %9.1f %7.2fx %9.1f %9.1f\n", w, r.jobs, serial / r.jobs, r.threads, r.arena);
+    }
+    return 0;
+}
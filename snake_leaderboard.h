@@ -0,0 +1,655 @@
+// snake_leaderboard.h
+// Leaderboards for the leaderboard daemon (snake_leaderboard_server.cpp): one per settings
+// key (mode, board size, fruits), holding each player's best result. A board is a skiplist
+// ordered best first whose links also store how many entries they skip, so the rank of an
+// entry and the entries from any rank on are found in O(log n).
+//
+// Writers take the board's lock; readers take nothing. A writer fills in a node before
+// linking it, so a reader walking the list sees each link either before or after the
+// change. Nodes and index tables a writer takes out are only reused once every reader
+// that might still hold them has finished (epoch-based reclamation, LeaderEpoch). A rank
+// read while results come in is exact for some moment during the read, give or take the
+// updates in flight.
+//
+// Protocol (UDP, little-endian; the daemon takes results on its port and queries on the next)
+//   RESULTS  c->s  type, count u8, count results: key u32, player u32, score i32, length u16, replay u64
+//   RANK     c->s  type, request u32, key u32, player u32
+//            s->c  type, request u32, key u32, player u32, rank u32 (0 = not on the board), total u32,
+//                  score i32, length u16, replay u64
+//   TOP      c->s  type, request u32, key u32, first u32 (0 = the best), count u8
+//            s->c  type, request u32, key u32, total u32, first u32, count u8, count entries:
+//                  player u32, score i32, length u16, replay u64
+//   STATS    c->s  type, request u32
+//            s->c  type, request u32, results u64, improved u64, queries u64, entries u64, boards u32
+// Results are not acknowledged: a lost one is only a lost leaderboard update. The replay
+// is whatever the game server uses to find the game again (for snake_match_server, the
+// shard and recording id of snake_record.h).
+//
+// Snapshot file: magic u32, version u16, then per board: key u32, count u32, count entries
+// (player u32, score i32, length u16, replay u64), best first.
+
+#pragma once
+
+#include "snake_net.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define SNAKE_LEADER_SSE2 1
+#endif
+
+static constexpr size_t LEADER_CACHE_LINE = 64;
+
+//
+// Wire format
+//
+enum LeaderMsg : uint8_t { LEADER_RESULTS = 0x50, LEADER_RANK, LEADER_TOP, LEADER_STATS };
+
+static constexpr int LEADER_RESULT_BYTES = 22;
+static constexpr int LEADER_ENTRY_BYTES = 18;
+static constexpr int LEADER_MAX_RESULTS = (NET_MAX_PACKET - 2) / LEADER_RESULT_BYTES;
+static constexpr int LEADER_RANK_REPLY = 35;
+static constexpr int LEADER_TOP_HEADER = 18;
+static constexpr int LEADER_TOP_MAX = (NET_MAX_PACKET - LEADER_TOP_HEADER) / LEADER_ENTRY_BYTES;
+static constexpr int LEADER_STATS_REPLY = 41;
+
+// The settings a leaderboard is kept for
+static inline uint32_t leaderKey(int mode, int width, int height, int fruits) {
+    return (uint32_t)(mode & 0xFF) << 24 | (uint32_t)(width & 0xFF) << 16 | (uint32_t)(height & 0xFF) << 8 | (uint32_t)(fruits & 0xFF);
+}
+
+struct LeaderEntry {
+    uint32_t player = 0; // 0 is not a player
+    int32_t score = 0;
+    uint16_t length = 0;
+    uint64_t replay = 0;
+};
+
+static inline uint8_t* leaderPutEntry(uint8_t* p, const LeaderEntry& e) {
+    netPut32(p, e.player);
+    netPut32(p + 4, (uint32_t)e.score);
+    netPut16(p + 8, e.length);
+    netPut64(p + 10, e.replay);
+    return p + LEADER_ENTRY_BYTES;
+}
+
+static inline const uint8_t* leaderGetEntry(const uint8_t* p, LeaderEntry& e) {
+    e.player = netGet32(p);
+    e.score = (int32_t)netGet32(p + 4);
+    e.length = netGet16(p + 8);
+    e.replay = netGet64(p + 10);
+    return p + LEADER_ENTRY_BYTES;
+}
+
+//
+// Epoch-based reclamation. A reader announces the epoch it started in; a writer tags what
+// it takes out with the epoch of the moment it did, and may reuse it once the epoch is two
+// further on. The epoch only moves when every reader inside has seen the current one.
+//
+class LeaderEpoch {
+public:
+    static constexpr int SLOTS = 64;
+    static constexpr uint64_t IDLE = UINT64_MAX;
+
+    LeaderEpoch() {
+        for (Slot& s : slots) s.epoch.store(IDLE, std::memory_order_relaxed);
+    }
+
+    // A slot for one reader thread; -1 when all are taken
+    int join() {
+        int n = joined.fetch_add(1);
+        return n < SLOTS ? n : -1;
+    }
+
+    void enter(int slot) {
+        for (;;) {
+            uint64_t e = global.load();
+            slots[slot].epoch.store(e);
+            if (global.load() == e) return;
+        }
+    }
+
+    void leave(int slot) { slots[slot].epoch.store(IDLE, std::memory_order_release); }
+
+    uint64_t current() const { return global.load(); }
+
+    // Moves the epoch on if no reader is behind; returns the epoch either way
+    uint64_t tryAdvance() {
+        uint64_t e = global.load();
+        int n = (std::min)(joined.load(), SLOTS);
+        for (int i = 0; i < n; i++) {
+            uint64_t s = slots[i].epoch.load();
+            if (s != IDLE && s != e) return e;
+        }
+        global.compare_exchange_strong(e, e + 1);
+        return global.load();
+    }
+
+private:
+    struct alignas(LEADER_CACHE_LINE) Slot {
+        std::atomic<uint64_t> epoch;
+    };
+
+    alignas(LEADER_CACHE_LINE) std::atomic<uint64_t> global{ 2 };
+    std::atomic<int> joined{ 0 };
+    Slot slots[SLOTS];
+};
+
+// Inside for the lifetime of the guard
+class LeaderReadGuard {
+public:
+    LeaderReadGuard(LeaderEpoch& epoch, int slot) : epoch(epoch), slot(slot) { epoch.enter(slot); }
+    ~LeaderReadGuard() { epoch.leave(slot); }
+    LeaderReadGuard(const LeaderReadGuard&) = delete;
+    LeaderReadGuard& operator=(const LeaderReadGuard&) = delete;
+
+private:
+    LeaderEpoch& epoch;
+    int slot;
+};
+
+//
+// One board
+//
+static constexpr int LEADER_MAX_LEVELS = 12; // p = 1/4: good to about 16M entries
+static constexpr size_t LEADER_SLAB_BYTES = 1 << 20;
+
+struct LeaderNode;
+
+struct LeaderLink {
+    std::atomic<LeaderNode*> next{ nullptr };
+    std::atomic<uint32_t> width{ 1 }; // entries from this node to next (the end counts as one past the last)
+};
+
+struct LeaderNodeTail {
+    LeaderEntry entry;
+    LeaderNode* chain = nullptr; // retired or free list (writer only)
+    uint64_t retiredAt = 0;
+};
+
+// What a search reads on each node it passes comes first: the order key, then `levels`
+// links. A node of up to three levels keeps all of it in one cache line (nodes are 32-byte
+// aligned); the entry and the writer's bookkeeping follow.
+struct LeaderNode {
+    int32_t score = 0;
+    int32_t levels = 0;
+    uint64_t seq = 0; // arrival: equal scores rank in the order they were reached
+
+    LeaderLink& link(int lvl) { return reinterpret_cast<LeaderLink*>(this + 1)[lvl]; }
+    const LeaderLink& link(int lvl) const { return reinterpret_cast<const LeaderLink*>(this + 1)[lvl]; }
+    LeaderNodeTail& tail() { return *reinterpret_cast<LeaderNodeTail*>(&link(levels)); }
+    const LeaderNodeTail& tail() const { return *reinterpret_cast<const LeaderNodeTail*>(&link(levels)); }
+
+    static size_t bytes(int levels) { return (sizeof(LeaderNode) + sizeof(LeaderLink) * (size_t)levels + sizeof(LeaderNodeTail) + 31) & ~(size_t)31; }
+};
+
+class LeaderBoard {
+public:
+    explicit LeaderBoard(uint32_t key, LeaderEpoch& epoch) : key(key), epoch(epoch) {
+        head = makeNode(LEADER_MAX_LEVELS);
+        index.store(new Index(1024));
+        rng.state = 0x4C454144ull ^ (uint64_t)key * 0x9E3779B97F4A7C15ull;
+    }
+
+    ~LeaderBoard() {
+        for (void* s : slabs) ::operator delete(s, std::align_val_t(LEADER_CACHE_LINE));
+        delete index.load();
+        for (auto& t : oldIndexes) delete t.second;
+    }
+
+    LeaderBoard(const LeaderBoard&) = delete;
+    LeaderBoard& operator=(const LeaderBoard&) = delete;
+
+    const uint32_t key;
+
+    // Writer: keeps the result if it beats the player's best (equal scores keep the older)
+    bool submit(const LeaderEntry& e) {
+        if (e.player == 0) return false;
+        std::lock_guard<std::mutex> lock(writer);
+        Index* idx = index.load(std::memory_order_relaxed);
+        Index::Slot* slot = idx->find(e.player);
+        if (slot && e.score <= slot->best.load(std::memory_order_relaxed)) return false; // most results end here
+
+        LeaderNode* n = allocNode(randomLevels());
+        n->score = e.score;
+        n->seq = nextSeq++;
+        n->tail().entry = e;
+        LeaderNode* update[LEADER_MAX_LEVELS];
+        uint32_t rankAt[LEADER_MAX_LEVELS];
+        LeaderNode* old = slot ? slot->node.load(std::memory_order_relaxed) : nullptr;
+        if (old) {
+            LeaderNode* oldUpdate[LEADER_MAX_LEVELS];
+            searchBoth(n, old, update, rankAt, oldUpdate);
+            unlink(old, oldUpdate);
+        }
+        else {
+            search(n->score, n->seq, update, rankAt);
+        }
+        link(n, update, rankAt);
+        if (slot) {
+            slot->best.store(e.score, std::memory_order_relaxed);
+            slot->node.store(n, std::memory_order_release);
+        }
+        else {
+            if ((idx->used + 1) * 2 > idx->capacity()) idx = growIndex();
+            idx->insert(e.player, e.score, n);
+        }
+        if (old) retire(old);
+        if (++writes % 64 == 0) reclaim();
+        return true;
+    }
+
+    // Starts loading the player's index slot. A batch of results prefetched first, then
+    // submitted, waits for its cache misses together rather than one after another.
+    void prefetch(uint32_t player) const {
+#if defined(SNAKE_LEADER_SSE2)
+        const Index* idx = index.load(std::memory_order_relaxed);
+        _mm_prefetch((const char*)&idx->slots[Index::hash(player) & idx->mask], _MM_HINT_T0);
+#else
+        (void)player;
+#endif
+    }
+
+    // Reader (inside an epoch): 1-based rank of the player's best, or 0 when it has none
+    uint32_t rank(uint32_t player, LeaderEntry& out) const {
+        Index::Slot* slot = index.load(std::memory_order_acquire)->find(player);
+        LeaderNode* n = slot ? slot->node.load(std::memory_order_acquire) : nullptr;
+        if (!n) return 0;
+        out = n->tail().entry;
+        int32_t score = n->tail().entry.score;
+        uint64_t seq = n->seq;
+        uint32_t before = 0;
+        LeaderNode* x = head;
+        for (int lvl = LEADER_MAX_LEVELS - 1; lvl >= 0; lvl--) {
+            for (;;) {
+                LeaderNode* next = x->link(lvl).next.load(std::memory_order_acquire);
+                if (!next || !ahead(next, score, seq)) break;
+                before += x->link(lvl).width.load(std::memory_order_relaxed);
+                x = next;
+            }
+        }
+        return before + 1;
+    }
+
+    // Reader (inside an epoch): up to count entries from 0-based rank first on
+    int top(uint32_t first, int count, LeaderEntry* out) const {
+        LeaderNode* x = head;
+        uint32_t pos = 0; // rank of x; the head is 0
+        for (int lvl = LEADER_MAX_LEVELS - 1; lvl >= 0; lvl--) {
+            for (;;) {
+                LeaderNode* next = x->link(lvl).next.load(std::memory_order_acquire);
+                uint32_t w = x->link(lvl).width.load(std::memory_order_relaxed);
+                if (!next || pos + w > first) break;
+                pos += w;
+                x = next;
+            }
+        }
+        int n = 0;
+        for (LeaderNode* next = x->link(0).next.load(std::memory_order_acquire); next && n < count;
+             next = next->link(0).next.load(std::memory_order_acquire)) {
+            out[n++] = next->tail().entry;
+        }
+        return n;
+    }
+
+    uint32_t size() const { return count.load(std::memory_order_relaxed); }
+
+    // Reader (inside an epoch): every entry, best first
+    template <typename Visit>
+    void forEach(Visit&& visit) const {
+        for (LeaderNode* n = head->link(0).next.load(std::memory_order_acquire); n; n = n->link(0).next.load(std::memory_order_acquire)) {
+            visit(n->tail().entry);
+        }
+    }
+
+private:
+    // Player -> node, open addressing; a table is only ever added to, and replaced when full.
+    // The slot repeats the best score so a result that does not beat it costs one lookup.
+    struct Index {
+        struct Slot {
+            std::atomic<uint32_t> player{ 0 };
+            std::atomic<int32_t> best{ 0 };
+            std::atomic<LeaderNode*> node{ nullptr };
+        };
+
+        explicit Index(size_t cap) : slots(cap), mask(cap - 1) {}
+
+        size_t capacity() const { return mask + 1; }
+
+        Slot* find(uint32_t player) {
+            for (size_t i = hash(player) & mask;; i = (i + 1) & mask) {
+                uint32_t p = slots[i].player.load(std::memory_order_acquire);
+                if (p == player) return &slots[i];
+                if (p == 0) return nullptr;
+            }
+        }
+
+        void insert(uint32_t player, int32_t best, LeaderNode* n) {
+            size_t i = hash(player) & mask;
+            while (slots[i].player.load(std::memory_order_relaxed) != 0) i = (i + 1) & mask;
+            slots[i].best.store(best, std::memory_order_relaxed);
+            slots[i].node.store(n, std::memory_order_relaxed);
+            slots[i].player.store(player, std::memory_order_release);
+            used++;
+        }
+
+        static size_t hash(uint32_t v) { return (size_t)((v * 0x9E3779B97F4A7C15ull) >> 20); }
+
+        std::vector<Slot> slots;
+        size_t mask;
+        size_t used = 0;
+    };
+
+    LeaderEpoch& epoch;
+    std::mutex writer;
+    LeaderNode* head = nullptr;
+    std::atomic<Index*> index{ nullptr };
+    std::atomic<uint32_t> count{ 0 };
+    uint64_t nextSeq = 1;
+    uint64_t writes = 0;
+    SimRng rng;
+    LeaderNode* retiredHead = nullptr; // oldest first
+    LeaderNode* retiredTail = nullptr;
+    LeaderNode* freeLists[LEADER_MAX_LEVELS] = {};
+    std::vector<std::pair<uint64_t, Index*>> oldIndexes;
+    std::vector<void*> slabs;
+    size_t slabUsed = LEADER_SLAB_BYTES;
+
+    static bool ahead(const LeaderNode* n, int32_t score, uint64_t seq) {
+        return n->score > score || (n->score == score && n->seq < seq);
+    }
+
+    // Nodes come from slabs and are never given back, only reused through the free lists
+    LeaderNode* makeNode(int levels) {
+        size_t bytes = LeaderNode::bytes(levels);
+        if (slabUsed + bytes > LEADER_SLAB_BYTES) {
+            slabs.push_back(::operator new(LEADER_SLAB_BYTES, std::align_val_t(LEADER_CACHE_LINE)));
+            slabUsed = 0;
+        }
+        uint8_t* mem = static_cast<uint8_t*>(slabs.back()) + slabUsed;
+        slabUsed += bytes;
+        LeaderNode* n = new (mem) LeaderNode();
+        n->levels = levels;
+        for (int i = 0; i < levels; i++) new (&n->link(i)) LeaderLink();
+        new (&n->tail()) LeaderNodeTail();
+        return n;
+    }
+
+    int randomLevels() {
+        uint64_t r = rng.next();
+        int levels = 1;
+        while (levels < LEADER_MAX_LEVELS && (r & 3) == 0) {
+            levels++;
+            r >>= 2;
+        }
+        return levels;
+    }
+
+    LeaderNode* allocNode(int levels) {
+        LeaderNode*& list = freeLists[levels - 1];
+        if (!list) return makeNode(levels);
+        LeaderNode* n = list;
+        list = n->tail().chain;
+        n->tail().chain = nullptr;
+        return n;
+    }
+
+    // The nodes before where (score, seq) goes, per level, and the rank of each
+    void search(int32_t score, uint64_t seq, LeaderNode** update, uint32_t* rankAt) const {
+        LeaderNode* x = head;
+        uint32_t r = 0;
+        for (int lvl = LEADER_MAX_LEVELS - 1; lvl >= 0; lvl--) {
+            for (;;) {
+                LeaderNode* next = x->link(lvl).next.load(std::memory_order_relaxed);
+                if (!next || !ahead(next, score, seq)) break;
+                r += x->link(lvl).width.load(std::memory_order_relaxed);
+                x = next;
+            }
+            update[lvl] = x;
+            rankAt[lvl] = r;
+        }
+    }
+
+    // search() for a new best n and for the player's old node in one descent: the old node
+    // is behind n, so on each level its search goes on from wherever n's stopped
+    void searchBoth(const LeaderNode* n, const LeaderNode* old, LeaderNode** update, uint32_t* rankAt, LeaderNode** oldUpdate) const {
+        LeaderNode* x = head;
+        LeaderNode* y = head;
+        uint32_t rx = 0, ry = 0;
+        for (int lvl = LEADER_MAX_LEVELS - 1; lvl >= 0; lvl--) {
+            for (;;) {
+                LeaderNode* next = x->link(lvl).next.load(std::memory_order_relaxed);
+                if (!next || !ahead(next, n->score, n->seq)) break;
+                rx += x->link(lvl).width.load(std::memory_order_relaxed);
+                x = next;
+            }
+            update[lvl] = x;
+            rankAt[lvl] = rx;
+            if (rx > ry) {
+                y = x;
+                ry = rx;
+            }
+            for (;;) {
+                LeaderNode* next = y->link(lvl).next.load(std::memory_order_relaxed);
+                if (!next || !ahead(next, old->score, old->seq)) break;
+                ry += y->link(lvl).width.load(std::memory_order_relaxed);
+                y = next;
+            }
+            oldUpdate[lvl] = y;
+        }
+    }
+
+    // The node is complete before a reader can reach it; lower levels are linked first
+    void link(LeaderNode* n, LeaderNode** update, const uint32_t* rankAt) {
+        uint32_t before = rankAt[0];
+        for (int lvl = 0; lvl < n->levels; lvl++) {
+            LeaderLink& prev = update[lvl]->link(lvl);
+            uint32_t w = prev.width.load(std::memory_order_relaxed);
+            n->link(lvl).next.store(prev.next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            n->link(lvl).width.store(w - (before - rankAt[lvl]), std::memory_order_relaxed);
+        }
+        for (int lvl = 0; lvl < LEADER_MAX_LEVELS; lvl++) {
+            LeaderLink& prev = update[lvl]->link(lvl);
+            if (lvl < n->levels) {
+                prev.width.store(before + 1 - rankAt[lvl], std::memory_order_relaxed);
+                prev.next.store(n, std::memory_order_release);
+            }
+            else {
+                prev.width.store(prev.width.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        }
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Top level first, so the node stays reachable along the bottom until the end. The
+    // ranks before the node do not change, so a link() searched for beforehand still holds.
+    void unlink(LeaderNode* n, LeaderNode** update) {
+        for (int lvl = LEADER_MAX_LEVELS - 1; lvl >= 0; lvl--) {
+            LeaderLink& prev = update[lvl]->link(lvl);
+            uint32_t w = prev.width.load(std::memory_order_relaxed);
+            if (lvl < n->levels) {
+                prev.width.store(w + n->link(lvl).width.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+                prev.next.store(n->link(lvl).next.load(std::memory_order_relaxed), std::memory_order_release);
+            }
+            else {
+                prev.width.store(w - 1, std::memory_order_relaxed);
+            }
+        }
+        count.store(count.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+
+    void retire(LeaderNode* n) {
+        n->tail().retiredAt = epoch.current();
+        n->tail().chain = nullptr;
+        if (retiredTail) retiredTail->tail().chain = n;
+        else retiredHead = n;
+        retiredTail = n;
+    }
+
+    // Retired nodes and tables no reader can still be on go back to use
+    void reclaim() {
+        uint64_t now = epoch.tryAdvance();
+        while (retiredHead && retiredHead->tail().retiredAt + 2 <= now) {
+            LeaderNode* n = retiredHead;
+            retiredHead = n->tail().chain;
+            if (!retiredHead) retiredTail = nullptr;
+            for (int i = 0; i < n->levels; i++) {
+                n->link(i).next.store(nullptr, std::memory_order_relaxed);
+                n->link(i).width.store(1, std::memory_order_relaxed);
+            }
+            n->tail().chain = freeLists[n->levels - 1];
+            freeLists[n->levels - 1] = n;
+        }
+        size_t kept = 0;
+        for (auto& t : oldIndexes) {
+            if (t.first + 2 <= now) delete t.second;
+            else oldIndexes[kept++] = t;
+        }
+        oldIndexes.resize(kept);
+    }
+
+    Index* growIndex() {
+        Index* old = index.load(std::memory_order_relaxed);
+        Index* bigger = new Index(old->capacity() * 2);
+        for (auto& s : old->slots) {
+            uint32_t p = s.player.load(std::memory_order_relaxed);
+            if (p) bigger->insert(p, s.best.load(std::memory_order_relaxed), s.node.load(std::memory_order_relaxed));
+        }
+        index.store(bigger, std::memory_order_release);
+        oldIndexes.push_back({ epoch.current(), old });
+        return bigger;
+    }
+};
+
+//
+// Every board, by settings key. Boards are created on first use and live as long as this.
+//
+static constexpr size_t LEADER_MAX_BOARDS = 4096;
+
+class Leaderboards {
+public:
+    Leaderboards() : table(LEADER_MAX_BOARDS) {}
+
+    LeaderEpoch epoch;
+
+    // nullptr when there is no such board
+    LeaderBoard* find(uint32_t key) const {
+        for (size_t i = hash(key), probes = 0; probes < LEADER_MAX_BOARDS; i = (i + 1) & (LEADER_MAX_BOARDS - 1), probes++) {
+            LeaderBoard* b = table[i].load(std::memory_order_acquire);
+            if (!b) return nullptr;
+            if (b->key == key) return b;
+        }
+        return nullptr;
+    }
+
+    // nullptr when the table is full
+    LeaderBoard* findOrAdd(uint32_t key) {
+        if (LeaderBoard* b = find(key)) return b;
+        std::lock_guard<std::mutex> lock(adding);
+        for (size_t i = hash(key), probes = 0; probes < LEADER_MAX_BOARDS; i = (i + 1) & (LEADER_MAX_BOARDS - 1), probes++) {
+            LeaderBoard* b = table[i].load(std::memory_order_relaxed);
+            if (b && b->key == key) return b;
+            if (!b && boards.size() < LEADER_MAX_BOARDS * 3 / 4) {
+                boards.push_back(std::make_unique<LeaderBoard>(key, epoch));
+                table[i].store(boards.back().get(), std::memory_order_release);
+                boardCount.store((uint32_t)boards.size(), std::memory_order_release);
+                return boards.back().get();
+            }
+        }
+        return nullptr;
+    }
+
+    // Boards in the order they were added; safe alongside findOrAdd
+    template <typename Visit>
+    void forEachBoard(Visit&& visit) const {
+        uint32_t n = boardCount.load(std::memory_order_acquire);
+        for (size_t i = 0; i < table.size() && n > 0; i++) {
+            LeaderBoard* b = table[i].load(std::memory_order_acquire);
+            if (b) {
+                visit(*b);
+                n--;
+            }
+        }
+    }
+
+    uint32_t size() const { return boardCount.load(std::memory_order_acquire); }
+
+private:
+    std::vector<std::atomic<LeaderBoard*>> table;
+    std::vector<std::unique_ptr<LeaderBoard>> boards;
+    std::atomic<uint32_t> boardCount{ 0 };
+    std::mutex adding;
+
+    static size_t hash(uint32_t key) { return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 40) & (LEADER_MAX_BOARDS - 1); }
+};
+
+//
+// Snapshots. Writing reads the boards like any reader, so results keep coming in; each
+// board is as it was at some moment during its walk.
+//
+static constexpr uint32_t LEADER_SNAPSHOT_MAGIC = 0x4C4B4E53; // "SNKL"
+static constexpr uint16_t LEADER_SNAPSHOT_VERSION = 1;
+
+// Written to path.tmp and renamed over path; the bytes written, or 0 on failure
+static inline uint64_t leaderWriteSnapshot(Leaderboards& lb, int slot, const char* path) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return 0;
+    uint8_t head[6];
+    netPut32(head, LEADER_SNAPSHOT_MAGIC);
+    netPut16(head + 4, LEADER_SNAPSHOT_VERSION);
+    fwrite(head, 1, sizeof(head), f);
+    uint64_t bytes = sizeof(head);
+    std::vector<uint8_t> buf;
+    lb.forEachBoard([&](const LeaderBoard& b) {
+        buf.assign(8, 0);
+        {
+            LeaderReadGuard guard(lb.epoch, slot);
+            b.forEach([&](const LeaderEntry& e) {
+                size_t at = buf.size();
+                buf.resize(at + LEADER_ENTRY_BYTES);
+                leaderPutEntry(&buf[at], e);
+            });
+        }
+        netPut32(&buf[0], b.key);
+        netPut32(&buf[4], (uint32_t)((buf.size() - 8) / LEADER_ENTRY_BYTES));
+        fwrite(buf.data(), 1, buf.size(), f);
+        bytes += buf.size();
+    });
+    bool ok = fflush(f) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp, path) != 0) return 0;
+    return bytes;
+}
+
+// Into empty boards; false if the file is missing or damaged (what was read stays)
+static inline bool leaderReadSnapshot(Leaderboards& lb, const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t head[8];
+    bool ok = fread(head, 1, 6, f) == 6 && netGet32(head) == LEADER_SNAPSHOT_MAGIC && netGet16(head + 4) == LEADER_SNAPSHOT_VERSION;
+    uint8_t e[LEADER_ENTRY_BYTES];
+    while (ok && fread(head, 1, 8, f) == 8) {
+        LeaderBoard* b = lb.findOrAdd(netGet32(head));
+        uint32_t n = netGet32(head + 4);
+        for (uint32_t i = 0; ok && i < n; i++) {
+            LeaderEntry entry;
+            ok = b && fread(e, 1, sizeof(e), f) == sizeof(e);
+            if (ok) {
+                leaderGetEntry(e, entry);
+                b->submit(entry);
+            }
+        }
+    }
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,275 @@
+// snake_leaderboard_bench.cpp
+// Load test for snake_leaderboard_server: one thread sends results at a fixed rate in full
+// RESULTS batches, while another asks for ranks and top-K pages and times the replies.
+// Replies are checked (a TOP page is in order, a rank is within its board). Reports the
+// rate the server took results at, from its own counters, and query latency percentiles.
+// Against empty boards most results are new bests, which cost far more than the rest; run
+// it twice, or against a server restarted from its snapshot, for the steady state.
+// Compile: g++ snake_leaderboard_bench.cpp -std=c++20 -O2 -pthread -o snake_leaderboard_bench
+// Run:     ./snake_leaderboard_server --port 7900 &
+//          ./snake_leaderboard_bench --port 7900 --rate 1000000 --seconds 20 [--keys 16] [--players 100000]
+
+#include "snake_leaderboard.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+//
+// Config
+//
+struct LeaderBenchConfig {
+    const char* ip = "127.0.0.1";
+    int port = 7900;
+    int keys = 16;           // settings keys, as many boards
+    int players = 100000;
+    int rate = 1000000;      // results per second
+    int seconds = 20;
+    int queryRate = 2000;    // queries per second, half RANK and half TOP
+    int topK = 10;
+    int trend = 0;           // score points per second every player gains, so new bests keep coming
+    uint64_t seed = 1;
+};
+
+static LeaderBenchConfig parseArgs(int argc, char** argv) {
+    LeaderBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--ip") && i + 1 < argc) cfg.ip = argv[++i];
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) cfg.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--keys") && i + 1 < argc) cfg.keys = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--players") && i + 1 < argc) cfg.players = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc) cfg.rate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) cfg.seconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--query-rate") && i + 1 < argc) cfg.queryRate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--top") && i + 1 < argc) cfg.topK = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--trend") && i + 1 < argc) cfg.trend = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.seed = strtoull(argv[++i], nullptr, 10);
+    }
+    return cfg;
+}
+
+using BenchClock = std::chrono::steady_clock;
+
+static uint32_t benchKey(int k) { return leaderKey(k & 1, 16 + 4 * (k >> 1), 16 + 4 * (k >> 1), 1); }
+
+//
+// Server counters
+//
+struct LeaderServerStats {
+    uint64_t results = 0, improved = 0, queries = 0, entries = 0;
+    uint32_t boards = 0;
+};
+
+static bool queryStats(NetSocket sock, const NetAddr& server, uint32_t request, LeaderServerStats& out) {
+    uint8_t q[5] = { LEADER_STATS };
+    netPut32(q + 1, request);
+    netSend(sock, server, q, sizeof(q));
+    uint8_t buf[NET_MAX_PACKET];
+    NetAddr from;
+    while (netWait(sock, 1000)) {
+        int n = netRecv(sock, from, buf, sizeof(buf));
+        if (n != LEADER_STATS_REPLY || buf[0] != LEADER_STATS || netGet32(buf + 1) != request) continue;
+        out.results = netGet64(buf + 5);
+        out.improved = netGet64(buf + 13);
+        out.queries = netGet64(buf + 21);
+        out.entries = netGet64(buf + 29);
+        out.boards = netGet32(buf + 37);
+        return true;
+    }
+    return false;
+}
+
+//
+// Results: in 1 ms slices, each a run of full batches
+//
+static uint64_t sendResults(const LeaderBenchConfig& cfg, const NetAddr& server, BenchClock::time_point until) {
+    NetSocket sock = netOpenUdp("127.0.0.1", 0, 4 << 20);
+    SimRng rng;
+    rng.state = cfg.seed;
+    uint8_t buf[NET_MAX_PACKET];
+    uint64_t sent = 0;
+    double carry = 0.0;
+    auto start = BenchClock::now();
+    auto slice = start;
+    while (slice < until) {
+        std::this_thread::sleep_until(slice);
+        slice += std::chrono::milliseconds(1);
+        double elapsed = std::chrono::duration<double>(BenchClock::now() - start).count();
+        carry += cfg.rate / 1000.0;
+        int due = (int)carry;
+        carry -= due;
+        while (due > 0) {
+            int count = (std::min)(due, LEADER_MAX_RESULTS);
+            buf[0] = LEADER_RESULTS;
+            buf[1] = (uint8_t)count;
+            uint8_t* p = buf + 2;
+            for (int i = 0; i < count; i++, p += LEADER_RESULT_BYTES) {
+                uint32_t player = rng.below((uint32_t)cfg.players) + 1;
+                int k = (int)rng.below((uint32_t)cfg.keys);
+                // A skill per player and board, some luck, and the season's drift
+                uint32_t skill = (uint32_t)(((uint64_t)player * 0x9E3779B97F4A7C15ull + (uint64_t)k) >> 54);
+                LeaderEntry e;
+                e.player = player;
+                e.score = (int32_t)(skill + rng.below(400) + (uint32_t)(elapsed * cfg.trend));
+                e.length = (uint16_t)(3 + e.score / 10);
+                e.replay = (uint64_t)k << 32 | (uint32_t)sent;
+                netPut32(p, benchKey(k));
+                leaderPutEntry(p + 4, e);
+                sent++;
+            }
+            netSend(sock, server, buf, 2 + count * LEADER_RESULT_BYTES);
+            due -= count;
+        }
+    }
+    netClose(sock);
+    return sent;
+}
+
+//
+// Queries: one outstanding at a time per kind would hide queueing, so they go out on
+// schedule and replies are matched by request id
+//
+struct QueryResults {
+    std::vector<double> rankUs, topUs;
+    uint64_t sent = 0, lost = 0, badReplies = 0, onBoard = 0;
+};
+
+static QueryResults runQueries(const LeaderBenchConfig& cfg, const NetAddr& server, BenchClock::time_point from,
+    BenchClock::time_point until) {
+    QueryResults r;
+    NetSocket sock = netOpenUdp("127.0.0.1", 0);
+    SimRng rng;
+    rng.state = cfg.seed ^ 0x5155455259ull;
+    static constexpr uint32_t WINDOW = 1 << 16;
+    std::vector<BenchClock::time_point> sentAt(WINDOW);
+    std::vector<uint8_t> pending(WINDOW, 0);
+    uint8_t buf[NET_MAX_PACKET];
+    NetAddr addr;
+    auto gap = std::chrono::nanoseconds(1000000000ll / (std::max)(cfg.queryRate, 1));
+    auto next = from;
+    uint32_t request = 0;
+    auto drain = [&](int waitMs) {
+        while (netWait(sock, waitMs)) {
+            int n = netRecv(sock, addr, buf, sizeof(buf));
+            if (n < 5) continue;
+            uint32_t id = netGet32(buf + 1);
+            uint32_t slot = id & (WINDOW - 1);
+            if (!pending[slot]) continue;
+            double us = std::chrono::duration<double, std::micro>(BenchClock::now() - sentAt[slot]).count();
+            pending[slot] = 0;
+            if (buf[0] == LEADER_RANK && n == LEADER_RANK_REPLY) {
+                uint32_t rank = netGet32(buf + 13), total = netGet32(buf + 17);
+                r.badReplies += rank > total;
+                r.onBoard += rank != 0;
+                r.rankUs.push_back(us);
+            }
+            else if (buf[0] == LEADER_TOP && n >= LEADER_TOP_HEADER && n == LEADER_TOP_HEADER + buf[17] * LEADER_ENTRY_BYTES) {
+                const uint8_t* p = buf + LEADER_TOP_HEADER;
+                LeaderEntry prev, e;
+                for (int i = 0; i < buf[17]; i++, prev = e) {
+                    p = leaderGetEntry(p, e);
+                    r.badReplies += i > 0 && e.score > prev.score;
+                }
+                r.topUs.push_back(us);
+            }
+            else {
+                r.badReplies++;
+            }
+            waitMs = 0;
+        }
+    };
+    while (next < until) {
+        // Poll in short steps: a wait in whole milliseconds would time replies late
+        while (BenchClock::now() < next) {
+            drain(0);
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+        request++;
+        uint32_t slot = request & (WINDOW - 1);
+        r.lost += pending[slot]; // never answered within a window's worth of queries
+        uint32_t key = benchKey((int)rng.below((uint32_t)cfg.keys));
+        int len;
+        buf[0] = request & 1 ? LEADER_RANK : LEADER_TOP;
+        netPut32(buf + 1, request);
+        netPut32(buf + 5, key);
+        if (buf[0] == LEADER_RANK) {
+            netPut32(buf + 9, rng.below((uint32_t)cfg.players) + 1);
+            len = 13;
+        }
+        else {
+            netPut32(buf + 9, rng.below(4) == 0 ? rng.below(1000) : 0); // mostly the top, sometimes a later page
+            buf[13] = (uint8_t)cfg.topK;
+            len = 14;
+        }
+        sentAt[slot] = BenchClock::now();
+        pending[slot] = 1;
+        netSend(sock, server, buf, len);
+        r.sent++;
+        next += gap;
+        drain(0);
+    }
+    drain(1000);
+    for (uint8_t p : pending) r.lost += p;
+    netClose(sock);
+    return r;
+}
+
+static void printLatency(const char* what, std::vector<double>& us) {
+    if (us.empty()) {
+        printf("%s: no replies\n", what);
+        return;
+    }
+    std::sort(us.begin(), us.end());
+    auto at = [&](double q) { return us[(size_t)(q * (double)(us.size() - 1))]; };
+    printf("%s: %zu replies, p50 %.0f us  p90 %.0f  p99 %.0f  p99.9 %.0f  max %.0f\n", what, us.size(), at(0.5), at(0.9),
+        at(0.99), at(0.999), us.back());
+}
+
+int main(int argc, char** argv) {
+    LeaderBenchConfig cfg = parseArgs(argc, argv);
+    if (cfg.keys < 1 || cfg.keys > 256 || cfg.players < 1 || cfg.rate < 1 || cfg.seconds < 1 || cfg.queryRate < 0 ||
+        cfg.topK < 1 || cfg.topK > LEADER_TOP_MAX) {
+        printf("invalid settings (1..256 keys, --top 1..%d)\n", LEADER_TOP_MAX);
+        return 1;
+    }
+    if (!netInit()) return 1;
+    NetAddr ingest = netAddr(cfg.ip, (uint16_t)cfg.port), queries = netAddr(cfg.ip, (uint16_t)(cfg.port + 1));
+    NetSocket console = netOpenUdp("127.0.0.1", 0);
+    LeaderServerStats before, after;
+    if (!queryStats(console, queries, 1, before)) {
+        printf("no leaderboard server on %s:%d\n", cfg.ip, cfg.port + 1);
+        return 1;
+    }
+
+    // Queries start after a second of results, so the boards have something in them
+    auto start = BenchClock::now();
+    auto until = start + std::chrono::seconds(cfg.seconds);
+    uint64_t sent = 0;
+    std::thread sender([&] { sent = sendResults(cfg, ingest, until); });
+    QueryResults q;
+    if (cfg.queryRate > 0) q = runQueries(cfg, queries, start + std::chrono::seconds(1), until);
+    sender.join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500)); // let the server catch up
+    if (!queryStats(console, queries, 2, after)) {
+        printf("the server stopped answering\n");
+        return 1;
+    }
+
+    uint64_t taken = after.results - before.results;
+    printf("%d keys, %d players, %d results/s asked for %d s, %d queries/s (top %d)\n", cfg.keys, cfg.players, cfg.rate,
+        cfg.seconds, cfg.queryRate, cfg.topK);
+    printf("results: %llu sent, %llu taken by the server = %.0f/s (%.2f%% lost), %.1f%% new bests; %u boards, %llu entries\n",
+        (unsigned long long)sent, (unsigned long long)taken, (double)taken / cfg.seconds, sent ? 100.0 * (double)(sent - std::min(sent, taken)) / (double)sent : 0.0,
+        taken ? 100.0 * (double)(after.improved - before.improved) / (double)taken : 0.0, after.boards, (unsigned long long)after.entries);
+    printf("queries: %llu sent, %llu lost, %llu bad replies, %.0f%% of ranked players on their board\n", (unsigned long long)q.sent,
+        (unsigned long long)q.lost, (unsigned long long)q.badReplies, q.rankUs.empty() ? 0.0 : 100.0 * (double)q.onBoard / (double)q.rankUs.size());
+    printLatency("RANK", q.rankUs);
+    printLatency("TOP ", q.topUs);
+    netClose(console);
+    return q.badReplies ? 1 : 0;
+}
@@ -0,0 +1,286 @@
+// snake_leaderboard_server.cpp
+// Leaderboard daemon (snake_leaderboard.h). Game servers send it batches of results on its
+// port; clients ask for a player's rank or the entries from some rank on, on the next
+// port. Ingest threads write into the boards while query threads read them without
+// locks, and the main thread snapshots every board to disk every few seconds (and on
+// exit). A snapshot found at start is loaded back.
+// Compile: g++ snake_leaderboard_server.cpp -std=c++20 -O2 -pthread -o snake_leaderboard_server
+// Run:     ./snake_leaderboard_server --port 7900 [--ingest-threads 1] [--query-threads 1]
+//          [--snapshot leaderboard.snap] [--snapshot-seconds 30]
+//          then snake_leaderboard_bench for load and query latency
+
+#include "snake_leaderboard.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//
+// Config
+//
+struct LeaderServerConfig {
+    const char* ip = "127.0.0.1";
+    int port = 7900;              // results; queries on port + 1
+    int ingestThreads = 1;
+    int queryThreads = 1;
+    const char* snapshotPath = "leaderboard.snap";
+    int snapshotSeconds = 30;
+    int statsSeconds = 5;
+    int seconds = 0;              // 0 = run until killed
+};
+
+static LeaderServerConfig parseArgs(int argc, char** argv) {
+    LeaderServerConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--ip") && i + 1 < argc) cfg.ip = argv[++i];
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) cfg.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--ingest-threads") && i + 1 < argc) cfg.ingestThreads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--query-threads") && i + 1 < argc) cfg.queryThreads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--snapshot") && i + 1 < argc) cfg.snapshotPath = argv[++i];
+        else if (!strcmp(argv[i], "--snapshot-seconds") && i + 1 < argc) cfg.snapshotSeconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--stats") && i + 1 < argc) cfg.statsSeconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) cfg.seconds = atoi(argv[++i]);
+    }
+    return cfg;
+}
+
+//
+// Counters, one set per thread so the hot paths share no cache lines
+//
+struct alignas(LEADER_CACHE_LINE) LeaderCounters {
+    std::atomic<uint64_t> results{ 0 };
+    std::atomic<uint64_t> improved{ 0 };
+    std::atomic<uint64_t> malformed{ 0 };
+    std::atomic<uint64_t> queries{ 0 };
+};
+
+struct LeaderTotals {
+    uint64_t results = 0, improved = 0, malformed = 0, queries = 0;
+};
+
+class LeaderServer {
+public:
+    LeaderServer(const LeaderServerConfig& cfg) : cfg(cfg), counters((size_t)(cfg.ingestThreads + cfg.queryThreads)) {}
+
+    ~LeaderServer() {
+        if (ingestSock != NET_INVALID_SOCKET) netClose(ingestSock);
+        if (querySock != NET_INVALID_SOCKET) netClose(querySock);
+    }
+
+    Leaderboards boards;
+
+    bool open() {
+        ingestSock = netOpenUdp(cfg.ip, (uint16_t)cfg.port, 16 << 20);
+        querySock = netOpenUdp(cfg.ip, (uint16_t)(cfg.port + 1), 4 << 20);
+        return ingestSock != NET_INVALID_SOCKET && querySock != NET_INVALID_SOCKET;
+    }
+
+    // Threads share their socket: the kernel hands each datagram to one of them
+    void start() {
+        for (int i = 0; i < cfg.ingestThreads; i++) threads.emplace_back([this, i] { ingestLoop(counters[(size_t)i]); });
+        for (int i = 0; i < cfg.queryThreads; i++) {
+            int slot = boards.epoch.join();
+            threads.emplace_back([this, i, slot] { queryLoop(counters[(size_t)(cfg.ingestThreads + i)], slot); });
+        }
+    }
+
+    void stop() {
+        stopping.store(true);
+        for (auto& t : threads) t.join();
+        threads.clear();
+    }
+
+    LeaderTotals totals() const {
+        LeaderTotals t;
+        for (const LeaderCounters& c : counters) {
+            t.results += c.results.load(std::memory_order_relaxed);
+            t.improved += c.improved.load(std::memory_order_relaxed);
+            t.malformed += c.malformed.load(std::memory_order_relaxed);
+            t.queries += c.queries.load(std::memory_order_relaxed);
+        }
+        return t;
+    }
+
+    uint64_t entries() const {
+        uint64_t n = 0;
+        boards.forEachBoard([&](const LeaderBoard& b) { n += b.size(); });
+        return n;
+    }
+
+private:
+    const LeaderServerConfig& cfg;
+    NetSocket ingestSock = NET_INVALID_SOCKET;
+    NetSocket querySock = NET_INVALID_SOCKET;
+    std::vector<LeaderCounters> counters;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping{ false };
+
+    void ingestLoop(LeaderCounters& c) {
+        uint8_t buf[NET_MAX_PACKET];
+        NetAddr from;
+        while (!stopping.load(std::memory_order_relaxed)) {
+            if (!netWait(ingestSock, 100)) continue;
+            int n;
+            while ((n = netRecv(ingestSock, from, buf, sizeof(buf))) > 0) {
+                int count = n >= 2 ? buf[1] : 0;
+                if (buf[0] != LEADER_RESULTS || n != 2 + count * LEADER_RESULT_BYTES) {
+                    c.malformed.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                // Boards and index slots first, so the slots' cache misses overlap
+                LeaderBoard* board[LEADER_MAX_RESULTS];
+                const uint8_t* p = buf + 2;
+                for (int i = 0; i < count; i++, p += LEADER_RESULT_BYTES) {
+                    uint32_t key = netGet32(p);
+                    board[i] = i > 0 && board[i - 1] && board[i - 1]->key == key ? board[i - 1] : boards.findOrAdd(key);
+                    if (board[i]) board[i]->prefetch(netGet32(p + 4));
+                }
+                uint64_t improved = 0;
+                p = buf + 2;
+                for (int i = 0; i < count; i++, p += LEADER_RESULT_BYTES) {
+                    LeaderEntry e;
+                    leaderGetEntry(p + 4, e);
+                    improved += board[i] && board[i]->submit(e);
+                }
+                c.results.fetch_add((uint64_t)count, std::memory_order_relaxed);
+                c.improved.fetch_add(improved, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void queryLoop(LeaderCounters& c, int slot) {
+        uint8_t buf[NET_MAX_PACKET], out[NET_MAX_PACKET];
+        LeaderEntry entries[LEADER_TOP_MAX];
+        NetAddr from;
+        while (!stopping.load(std::memory_order_relaxed)) {
+            if (!netWait(querySock, 100)) continue;
+            int n;
+            while ((n = netRecv(querySock, from, buf, sizeof(buf))) > 0) {
+                int len = answer(buf, n, out, entries, slot);
+                if (len <= 0) {
+                    c.malformed.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                netSend(querySock, from, out, len);
+                c.queries.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // The reply to one query, or 0 if it is not one
+    int answer(const uint8_t* q, int n, uint8_t* out, LeaderEntry* found, int slot) {
+        if (n >= 13 && q[0] == LEADER_RANK) {
+            uint32_t key = netGet32(q + 5), player = netGet32(q + 9);
+            LeaderEntry e;
+            uint32_t rank = 0, total = 0;
+            if (LeaderBoard* b = boards.find(key)) {
+                LeaderReadGuard guard(boards.epoch, slot);
+                rank = b->rank(player, e);
+                total = b->size();
+            }
+            std::memcpy(out, q, 13); // type, request, key, player
+            netPut32(out + 13, rank);
+            netPut32(out + 17, total);
+            netPut32(out + 21, (uint32_t)e.score);
+            netPut16(out + 25, e.length);
+            netPut64(out + 27, e.replay);
+            return LEADER_RANK_REPLY;
+        }
+        if (n >= 14 && q[0] == LEADER_TOP) {
+            uint32_t key = netGet32(q + 5), first = netGet32(q + 9);
+            int count = (std::min)((int)q[13], LEADER_TOP_MAX), got = 0;
+            uint32_t total = 0;
+            if (LeaderBoard* b = boards.find(key)) {
+                LeaderReadGuard guard(boards.epoch, slot);
+                got = b->top(first, count, found);
+                total = b->size();
+            }
+            out[0] = LEADER_TOP;
+            std::memcpy(out + 1, q + 1, 8); // request, key
+            netPut32(out + 9, total);
+            netPut32(out + 13, first);
+            out[17] = (uint8_t)got;
+            uint8_t* p = out + LEADER_TOP_HEADER;
+            for (int i = 0; i < got; i++) p = leaderPutEntry(p, found[i]);
+            return (int)(p - out);
+        }
+        if (n >= 5 && q[0] == LEADER_STATS) {
+            LeaderTotals t = totals();
+            std::memcpy(out, q, 5);
+            netPut64(out + 5, t.results);
+            netPut64(out + 13, t.improved);
+            netPut64(out + 21, t.queries);
+            netPut64(out + 29, entries());
+            netPut32(out + 37, boards.size());
+            return LEADER_STATS_REPLY;
+        }
+        return 0;
+    }
+};
+
+static void snapshot(LeaderServer& server, int slot, const char* path) {
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t bytes = leaderWriteSnapshot(server.boards, slot, path);
+    double took = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (bytes) printf("snapshot: %.1f MB in %.2f s\n", bytes / 1048576.0, took);
+    else printf("snapshot: cannot write %s\n", path);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    LeaderServerConfig cfg = parseArgs(argc, argv);
+    if (cfg.ingestThreads < 1 || cfg.queryThreads < 1 || cfg.ingestThreads + cfg.queryThreads > LeaderEpoch::SLOTS ||
+        cfg.snapshotSeconds < 1 || cfg.statsSeconds < 1 || cfg.port < 1 || cfg.port > 65534) {
+        printf("invalid settings\n");
+        return 1;
+    }
+    if (!netInit()) return 1;
+    auto server = std::make_unique<LeaderServer>(cfg);
+    if (!server->open()) {
+        printf("cannot bind %s:%d and %d\n", cfg.ip, cfg.port, cfg.port + 1);
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (leaderReadSnapshot(server->boards, cfg.snapshotPath)) {
+        printf("loaded %s: %u boards, %llu entries in %.2f s\n", cfg.snapshotPath, server->boards.size(),
+            (unsigned long long)server->entries(), std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    }
+    int snapshotSlot = server->boards.epoch.join();
+    server->start();
+    printf("results on %s:%d, queries on %d, %d ingest and %d query threads, snapshots to %s every %d s\n", cfg.ip, cfg.port,
+        cfg.port + 1, cfg.ingestThreads, cfg.queryThreads, cfg.snapshotPath, cfg.snapshotSeconds);
+    fflush(stdout);
+
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now(), lastStats = start, lastSnapshot = start;
+    LeaderTotals previous = server->totals();
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        auto now = Clock::now();
+        bool done = cfg.seconds > 0 && now - start >= std::chrono::seconds(cfg.seconds);
+        if (now - lastStats >= std::chrono::seconds(cfg.statsSeconds)) {
+            double dt = std::chrono::duration<double>(now - lastStats).count();
+            LeaderTotals t = server->totals();
+            printf("%8.0f results/s (%.0f new bests/s), %6.0f queries/s, %llu malformed; %u boards, %llu entries\n",
+                (t.results - previous.results) / dt, (t.improved - previous.improved) / dt, (t.queries - previous.queries) / dt,
+                (unsigned long long)(t.malformed - previous.malformed), server->boards.size(), (unsigned long long)server->entries());
+            fflush(stdout);
+            previous = t;
+            lastStats = now;
+        }
+        if (done) break;
+        if (now - lastSnapshot >= std::chrono::seconds(cfg.snapshotSeconds)) {
+            snapshot(*server, snapshotSlot, cfg.snapshotPath);
+            lastSnapshot = Clock::now();
+        }
+    }
+    server->stop();
+    snapshot(*server, snapshotSlot, cfg.snapshotPath);
+    return 0;
+}
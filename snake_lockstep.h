@@ -0,0 +1,248 @@
+// snake_lockstep.h
+// Lockstep play for 2-4 players on a SnakeArena, local or over a LAN. Every peer runs the
+// whole game and only inputs cross the network: tick t runs once every player's input for
+// it has arrived, so unlike rollback (snake_rollback.h) nothing is ever predicted. Local
+// input is scheduled a few ticks ahead to hide the round trip.
+//
+// Each peer sends every other peer one FRAME per tick holding all the inputs and tick
+// hashes that peer has not acknowledged yet, so a lost FRAME only adds latency. The
+// hashes are compared tick by tick; the first tick whose hashes differ is a desync, and
+// both sides can dump that tick (its inputs and the board before and after) to diff.
+//
+// Ticks are numbered from 1; the actions of tick t are applied by the t-th arena tick.
+
+#pragma once
+
+#include "snake_arena.h"
+#include "snake_net.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static constexpr int LOCKSTEP_MAX_PLAYERS = 4;
+static constexpr int LOCKSTEP_RING = 64;       // ticks of inputs, hashes and states kept
+static constexpr int LOCKSTEP_MAX_DELAY = 16;  // local input delay, in ticks (< LOCKSTEP_RING / 2)
+static constexpr int LOCKSTEP_MAX_HASHES = 16; // tick hashes per FRAME
+
+struct LockstepStats {
+    uint64_t ticks = 0;
+    uint64_t stalls = 0;         // advance() calls that waited for input
+    uint64_t hashesChecked = 0;  // remote tick hashes compared with ours
+};
+
+// The first tick on which a remote player's hash differed from ours
+struct LockstepDesync {
+    uint32_t tick = 0;           // 0 = none
+    int player = -1;
+    uint32_t localHash = 0, remoteHash = 0;
+};
+
+//
+// One peer
+//
+class LockstepSession {
+public:
+    // cfg.snakes is the number of players; local is this peer's player
+    LockstepSession(const ArenaConfig& cfg, int local, int inputDelay)
+        : cfg(cfg), arena(cfg), players(cfg.snakes), local(local), delay(inputDelay) {
+        for (int p = 0; p < players; p++) arena.setBot(p, false);
+        // Ticks inside the input delay have no input from anyone
+        for (int t = 0; t < LOCKSTEP_RING; t++) {
+            for (int p = 0; p < players; p++) inputs[t][p] = -1;
+        }
+        for (int p = 0; p < players; p++) confirmed[p] = (uint32_t)delay;
+        for (ArenaState& s : states) arena.save(s); // allocate once, up front
+    }
+
+    const SnakeArena& game() const { return arena; }
+    int localPlayer() const { return local; }
+    int playerCount() const { return players; }
+    const LockstepStats& stats() const { return stat; }
+    const LockstepDesync& desync() const { return firstDesync; }
+
+    // Newest tick with input from player p
+    uint32_t confirmedTick(int p) const { return confirmed[p]; }
+
+    // The local action for the next tick without one, at most `delay` ticks after the
+    // next tick to run; false (and dropped) while the game waits for other players
+    bool addLocalInput(int action) {
+        uint32_t t = confirmed[local] + 1;
+        if (t > arena.tickCount() + 1 + (uint32_t)delay) return false;
+        inputs[t % LOCKSTEP_RING][local] = (int8_t)action;
+        confirmed[local] = t;
+        return true;
+    }
+
+    // Inputs of a remote player must arrive in tick order; repeats are ignored, and so are
+    // ticks too far ahead for the ring (the sender repeats them until acknowledged)
+    void addRemoteInput(int p, uint32_t tick, int action) {
+        if (p == local || tick != confirmed[p] + 1) return;
+        if (tick >= arena.tickCount() + LOCKSTEP_RING) return;
+        inputs[tick % LOCKSTEP_RING][p] = (int8_t)action;
+        confirmed[p] = tick;
+    }
+
+    // Runs the next tick if every player's input for it is here
+    bool advance() {
+        uint32_t t = arena.tickCount() + 1;
+        for (int p = 0; p < players; p++) {
+            if (confirmed[p] < t) {
+                stat.stalls++;
+                return false;
+            }
+        }
+        arena.save(states[t % LOCKSTEP_RING]);
+        for (int p = 0; p < players; p++) arena.setAction(p, inputs[t % LOCKSTEP_RING][p]);
+        arena.tick();
+        hashes[t % LOCKSTEP_RING] = arena.stateHash(false);
+        stat.ticks++;
+        return true;
+    }
+
+    // stateHash(false) after tick t, for t within LOCKSTEP_RING of the current tick
+    uint64_t tickHash(uint32_t t) const { return hashes[t % LOCKSTEP_RING]; }
+
+    // Newest tick whose hash player p has confirmed to match ours
+    uint32_t checkedTick(int p) const { return checked[p]; }
+
+    //
+    // FRAME: type, player, inputAck u32, hashAck u32 (newest input and hash tick received
+    // from the destination's player), first u32, count u8, hashFirst u32, hashCount u8,
+    // hashCount tick hashes (low 32 bits, u32 each), then count actions in 3 bits (action + 1)
+    //
+    static constexpr uint8_t LOCKSTEP_FRAME = 0x41;
+    static constexpr int FRAME_HEADER = 20;
+
+    int writeFrame(uint8_t* out, int cap, int toPlayer) const {
+        uint32_t first = std::max(acked[toPlayer], (uint32_t)delay) + 1;
+        int count = (int)std::min<uint32_t>(confirmed[local] + 1 - first, LOCKSTEP_RING - 1);
+        uint32_t now = arena.tickCount();
+        uint32_t hashFirst = hashAcked[toPlayer] + 1;
+        if (now >= LOCKSTEP_RING && hashFirst <= now - LOCKSTEP_RING) hashFirst = now - LOCKSTEP_RING + 1; // gone
+        int hashCount = (int)std::min<uint32_t>(now + 1 - hashFirst, LOCKSTEP_MAX_HASHES);
+        if (cap < FRAME_HEADER + hashCount * 4 + (count * 3 + 7) / 8) return 0;
+        out[0] = LOCKSTEP_FRAME;
+        out[1] = (uint8_t)local;
+        netPut32(out + 2, confirmed[toPlayer]);
+        netPut32(out + 6, checked[toPlayer]);
+        netPut32(out + 10, first);
+        out[14] = (uint8_t)count;
+        netPut32(out + 15, hashFirst);
+        out[19] = (uint8_t)hashCount;
+        uint8_t* p = out + FRAME_HEADER;
+        for (int k = 0; k < hashCount; k++, p += 4) netPut32(p, (uint32_t)hashes[(hashFirst + k) % LOCKSTEP_RING]);
+        NetBitWriter bw(p, (size_t)(cap - (p - out)));
+        for (int k = 0; k < count; k++) bw.put((uint32_t)(inputs[(first + k) % LOCKSTEP_RING][local] + 1), 3);
+        return (int)(p - out) + (int)bw.finish();
+    }
+
+    bool readFrame(const uint8_t* p, int n) {
+        if (n < FRAME_HEADER || p[0] != LOCKSTEP_FRAME || p[1] >= players || p[1] == local) return false;
+        int from = p[1];
+        int count = p[14], hashCount = p[19];
+        if (hashCount > LOCKSTEP_MAX_HASHES || n < FRAME_HEADER + hashCount * 4) return false;
+        uint32_t ack = netGet32(p + 2), hashAck = netGet32(p + 6);
+        if (ack > acked[from] && ack <= confirmed[local]) acked[from] = ack;
+        if (hashAck > hashAcked[from] && hashAck <= arena.tickCount()) hashAcked[from] = hashAck;
+
+        // Hashes in tick order, each against ours for the same tick; later ones come again
+        uint32_t hashFirst = netGet32(p + 15);
+        const uint8_t* h = p + FRAME_HEADER;
+        for (int k = 0; k < hashCount; k++, h += 4) {
+            uint32_t t = hashFirst + (uint32_t)k;
+            if (t != checked[from] + 1) continue;
+            if (t > arena.tickCount()) break;
+            if (t + LOCKSTEP_RING > arena.tickCount()) {
+                uint32_t mine = (uint32_t)hashes[t % LOCKSTEP_RING], theirs = netGet32(h);
+                stat.hashesChecked++;
+                if (mine != theirs && firstDesync.tick == 0) firstDesync = LockstepDesync{ t, from, mine, theirs };
+            }
+            checked[from] = t;
+        }
+
+        uint32_t first = netGet32(p + 10);
+        const uint8_t* bits = p + FRAME_HEADER + hashCount * 4;
+        NetBitReader br(bits, (size_t)(n - (bits - p)));
+        for (int k = 0; k < count; k++) {
+            int action = (int)br.get(3) - 1;
+            if (!br.ok) return false;
+            addRemoteInput(from, first + (uint32_t)k, action);
+        }
+        return true;
+    }
+
+    //
+    // Desync dump: tick t's inputs and the board before and after it, in text. Each side
+    // writes its own; diffing the two shows what diverged.
+    //
+    bool writeDump(FILE* f, uint32_t t) const {
+        uint32_t now = arena.tickCount();
+        if (t == 0 || t > now || t + LOCKSTEP_RING <= now) return false;
+        fprintf(f, "lockstep dump: player %d of %d, tick %u, %dx%d, %d fruits, seed %llu\n", local, players, t, cfg.width,
+            cfg.height, cfg.fruits, (unsigned long long)cfg.seed);
+        if (firstDesync.tick) {
+            fprintf(f, "desync with player %d at tick %u: our hash %08x, theirs %08x\n", firstDesync.player, firstDesync.tick,
+                firstDesync.localHash, firstDesync.remoteHash);
+        }
+        fprintf(f, "inputs:");
+        for (int p = 0; p < players; p++) fprintf(f, " %d", inputs[t % LOCKSTEP_RING][p]);
+        fprintf(f, "\n\nbefore tick %u:\n", t);
+        SnakeArena view(cfg);
+        view.restore(states[t % LOCKSTEP_RING]);
+        dumpBoard(f, view);
+        fprintf(f, "\nafter tick %u (hash %016llx):\n", t, (unsigned long long)hashes[t % LOCKSTEP_RING]);
+        if (t < now) view.restore(states[(t + 1) % LOCKSTEP_RING]);
+        dumpBoard(f, t < now ? view : arena);
+        return true;
+    }
+
+private:
+    static void dumpBoard(FILE* f, const SnakeArena& a) {
+        static const char dirs[4] = { 'U', 'D', 'L', 'R' };
+        int w = a.width();
+        fprintf(f, "tick %u, hash %016llx, fruits", a.tickCount(), (unsigned long long)a.stateHash(false));
+        for (uint32_t c : a.fruits()) fprintf(f, " %u,%u", c % (uint32_t)w, c / (uint32_t)w);
+        fprintf(f, "\n");
+        for (int i = 0; i < a.snakeCount(); i++) {
+            const ArenaSnake& s = a.snake(i);
+            fprintf(f, "snake %d: %s dir %c length %u score %d fate %d respawn %u rng %016llx", i, s.alive ? "alive" : "dead",
+                dirs[s.dir], s.length, s.score, (int)s.fate, s.respawnAt, (unsigned long long)s.rng.state);
+            if (s.alive) {
+                fprintf(f, " body");
+                for (uint32_t k = 0; k < s.length; k++) fprintf(f, " %u,%u", s.segment(k) % (uint32_t)w, s.segment(k) / (uint32_t)w);
+            }
+            fprintf(f, "\n");
+        }
+        // Heads in capitals, bodies in lower case, fruit as *
+        std::vector<char> row((size_t)w + 1, 0);
+        for (int y = 0; y < a.height(); y++) {
+            for (int x = 0; x < w; x++) {
+                uint32_t tag = a.cell((uint32_t)(y * w + x));
+                char ch = '.';
+                if (tag & ARENA_FOOD) ch = '*';
+                else if (tag != ARENA_EMPTY) {
+                    int id = (int)tag - 1;
+                    ch = (char)((a.snake(id).head() == (uint32_t)(y * w + x) ? 'A' : 'a') + id);
+                }
+                row[(size_t)x] = ch;
+            }
+            fprintf(f, "%s\n", row.data());
+        }
+    }
+
+    ArenaConfig cfg;
+    SnakeArena arena;
+    int players;
+    int local;
+    int delay;
+    int8_t inputs[LOCKSTEP_RING][LOCKSTEP_MAX_PLAYERS]; // by tick
+    uint32_t confirmed[LOCKSTEP_MAX_PLAYERS] = {};
+    uint32_t acked[LOCKSTEP_MAX_PLAYERS] = {};          // newest local input tick each peer has
+    uint32_t checked[LOCKSTEP_MAX_PLAYERS] = {};        // newest tick compared with each peer
+    uint32_t hashAcked[LOCKSTEP_MAX_PLAYERS] = {};      // newest local hash each peer has compared
+    ArenaState states[LOCKSTEP_RING];                   // by tick: state before it
+    uint64_t hashes[LOCKSTEP_RING] = {};
+    LockstepStats stat;
+    LockstepDesync firstDesync;
+};
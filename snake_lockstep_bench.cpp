@@ -0,0 +1,267 @@
+// snake_lockstep_bench.cpp
+// Lockstep play (snake_lockstep.h) over real UDP sockets. By default every player runs in
+// this process on loopback; with --player and --peers it runs one player and talks to the
+// others on the LAN. Bots stand in for the players. Outgoing FRAMEs can be dropped at
+// random, and --desync corrupts one input on player 1's side to show the desync check and
+// dump. Reports bandwidth per player.
+// Compile: g++ snake_lockstep_bench.cpp -std=c++20 -O2 -o snake_lockstep_bench
+// Run:     ./snake_lockstep_bench --players 4 --ticks 1000 [--loss 0.05] [--delay 2] [--desync 300]
+//          LAN: ./snake_lockstep_bench --players 2 --player 0 --peers 10.0.0.1:7800,10.0.0.2:7800
+//               (same settings and seed on every machine)
+
+#include "snake_lockstep.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// Config
+//
+struct LockstepBenchConfig {
+    ArenaConfig arena;
+    int ticks = 1000;
+    int tickMs = 20;
+    int delay = 2;            // local input delay in ticks
+    double loss = 0.0;        // of outgoing FRAMEs
+    uint32_t desyncTick = 0;  // 0 = no injected desync
+    int player = -1;          // -1 = every player in this process
+    std::vector<NetAddr> peers;
+    uint64_t seed = 1;
+};
+
+static std::vector<NetAddr> parsePeers(const char* s) {
+    std::vector<NetAddr> out;
+    std::string list = s;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        std::string item = list.substr(start, end - start);
+        size_t colon = item.rfind(':');
+        if (colon != std::string::npos) out.push_back(netAddr(item.substr(0, colon).c_str(), (uint16_t)atoi(item.c_str() + colon + 1)));
+        start = end + 1;
+    }
+    return out;
+}
+
+static LockstepBenchConfig parseArgs(int argc, char** argv) {
+    LockstepBenchConfig cfg;
+    cfg.arena.width = 32;
+    cfg.arena.height = 32;
+    cfg.arena.snakes = 2;
+    cfg.arena.fruits = 16;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--players") && i + 1 < argc) cfg.arena.snakes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.arena.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.arena.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fruits") && i + 1 < argc) cfg.arena.fruits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--ticks") && i + 1 < argc) cfg.ticks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--tick-ms") && i + 1 < argc) cfg.tickMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--delay") && i + 1 < argc) cfg.delay = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--loss") && i + 1 < argc) cfg.loss = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--desync") && i + 1 < argc) cfg.desyncTick = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--player") && i + 1 < argc) cfg.player = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--peers") && i + 1 < argc) cfg.peers = parsePeers(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.seed = strtoull(argv[++i], nullptr, 10);
+    }
+    cfg.arena.seed = cfg.seed;
+    return cfg;
+}
+
+//
+// Player bot: heads for the nearest fruit and avoids walls and snakes
+//
+static int playerAction(const SnakeArena& a, int id, SimRng& rng) {
+    const ArenaSnake& s = a.snake(id);
+    if (!s.alive) return -1;
+    static const int dx[4] = { 0, 0, -1, 1 }, dy[4] = { -1, 1, 0, 0 };
+    int w = a.width(), h = a.height();
+    int hx = (int)(s.head() % (uint32_t)w), hy = (int)(s.head() / (uint32_t)w);
+    int tx = hx, ty = hy, nearest = INT32_MAX;
+    for (uint32_t f : a.fruits()) {
+        int d = std::abs((int)(f % (uint32_t)w) - hx) + std::abs((int)(f / (uint32_t)w) - hy);
+        if (d < nearest) {
+            nearest = d;
+            tx = (int)(f % (uint32_t)w);
+            ty = (int)(f / (uint32_t)w);
+        }
+    }
+    int best = s.dir, bestScore = INT32_MIN;
+    for (int d = 0; d < 4; d++) {
+        if (d == simOpposite(s.dir)) continue;
+        int x = hx + dx[d], y = hy + dy[d];
+        int score = (int)rng.below(3);
+        if (x < 0 || x >= w || y < 0 || y >= h || arenaIsSnake(a.cell((uint32_t)(y * w + x)))) score -= 1000000;
+        score -= (std::abs(tx - x) + std::abs(ty - y)) * 4;
+        if (score > bestScore) {
+            bestScore = score;
+            best = d;
+        }
+    }
+    return best;
+}
+
+//
+// The injected desync: player 1 rewrites player 0's action for one tick in every FRAME it
+// receives, before the session reads it, as a turn across it. A turn across the real
+// action always changes where the snake goes, whichever way it was heading (the reverse
+// of its heading is ignored, and so is no different from going straight on).
+//
+static void injectDesync(uint8_t* p, int n, uint32_t tick, SimRng& rng) {
+    if (n < LockstepSession::FRAME_HEADER || p[0] != LockstepSession::LOCKSTEP_FRAME || p[1] != 0) return;
+    uint32_t first = netGet32(p + 10);
+    int count = p[14], hashCount = p[19];
+    if (tick < first || tick >= first + (uint32_t)count) return;
+    // Actions are 3 bits each (action + 1), lowest bit first, after the hashes
+    size_t bit = (size_t)(tick - first) * 3, at = LockstepSession::FRAME_HEADER + (size_t)hashCount * 4 + bit / 8;
+    int shift = (int)(bit % 8);
+    bool spans = shift > 5; // into the next byte
+    if (at + (spans ? 1 : 0) >= (size_t)n) return;
+
+    uint32_t word = p[at] | (spans ? (uint32_t)p[at + 1] << 8 : 0u);
+    int action = (int)((word >> shift) & 7) - 1;
+    if (action < 0) return; // player 0 is out; nothing to steer
+    int across = (action < SIM_LEFT ? SIM_LEFT : SIM_UP) + (int)rng.below(2);
+    word = (word & ~(7u << shift)) | ((uint32_t)(across + 1) << shift);
+    p[at] = (uint8_t)word;
+    if (spans) p[at + 1] = (uint8_t)(word >> 8);
+}
+
+//
+// One player in this process: its session, socket and traffic
+//
+struct Peer {
+    LockstepSession session;
+    NetSocket sock = NET_INVALID_SOCKET;
+    SimRng bot, link;
+    uint64_t packetsOut = 0, bytesOut = 0, dropped = 0, packetsIn = 0, bytesIn = 0;
+    bool dumped = false;
+
+    Peer(const ArenaConfig& cfg, int player, int delay) : session(cfg, player, delay) {}
+};
+
+using BenchClock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    LockstepBenchConfig cfg = parseArgs(argc, argv);
+    int players = cfg.arena.snakes;
+    bool lan = cfg.player >= 0;
+    if (players < 2 || players > LOCKSTEP_MAX_PLAYERS || cfg.arena.width < 8 || cfg.arena.height < 8 || cfg.ticks < 1 ||
+        cfg.tickMs < 1 || cfg.delay < 0 || cfg.delay > LOCKSTEP_MAX_DELAY || cfg.loss < 0.0 || cfg.loss >= 1.0 ||
+        (lan && (cfg.player >= players || (int)cfg.peers.size() != players))) {
+        printf("invalid settings (2..%d players, delay 0..%d, --peers lists every player)\n", LOCKSTEP_MAX_PLAYERS, LOCKSTEP_MAX_DELAY);
+        return 1;
+    }
+    if (!netInit()) return 1;
+
+    // Peers in this process, and every player's address
+    std::vector<std::unique_ptr<Peer>> peers;
+    std::vector<NetAddr> addrs((size_t)players);
+    for (int p = lan ? cfg.player : 0; p < (lan ? cfg.player + 1 : players); p++) {
+        auto peer = std::make_unique<Peer>(cfg.arena, p, cfg.delay);
+        peer->sock = lan ? netOpenUdp("0.0.0.0", ntohs(cfg.peers[p].sa.sin_port)) : netOpenUdp("127.0.0.1", 0);
+        if (peer->sock == NET_INVALID_SOCKET) {
+            printf("cannot open a socket for player %d\n", p);
+            return 1;
+        }
+        peer->bot.state = cfg.seed * 0x9E3779B97F4A7C15ull + (uint64_t)p;
+        peer->link.state = cfg.seed ^ (0x4C494E4Bull << 8 | (uint64_t)p);
+        addrs[p] = lan ? cfg.peers[p] : netAddr("127.0.0.1", netLocalPort(peer->sock));
+        peers.push_back(std::move(peer));
+    }
+    if (lan) addrs = cfg.peers;
+
+    auto start = BenchClock::now();
+    auto deadline = start + std::chrono::milliseconds((int64_t)cfg.tickMs * cfg.ticks * 3 + 10000);
+    auto nextFrame = start;
+    uint8_t buf[NET_MAX_PACKET];
+    NetAddr from;
+    int frames = 0;
+    for (;;) {
+        // Everyone is done, or stuck
+        bool done = true;
+        for (auto& peer : peers) {
+            done = done && (peer->session.game().tickCount() >= (uint32_t)cfg.ticks || peer->session.desync().tick != 0);
+        }
+        if (done || BenchClock::now() > deadline) break;
+
+        std::this_thread::sleep_until(nextFrame);
+        nextFrame += std::chrono::milliseconds(cfg.tickMs);
+        frames++;
+        for (auto& peer : peers) {
+            LockstepSession& s = peer->session;
+            int me = s.localPlayer();
+            int n;
+            while ((n = netRecv(peer->sock, from, buf, sizeof(buf))) > 0) {
+                peer->packetsIn++;
+                peer->bytesIn += (uint64_t)n;
+                if (me == 1 && cfg.desyncTick != 0) injectDesync(buf, n, cfg.desyncTick, peer->bot);
+                s.readFrame(buf, n);
+            }
+
+            s.addLocalInput(playerAction(s.game(), me, peer->bot));
+            s.advance();
+
+            for (int q = 0; q < players; q++) {
+                if (q == me) continue;
+                n = s.writeFrame(buf, sizeof(buf), q);
+                if (n <= 0) continue;
+                peer->packetsOut++;
+                peer->bytesOut += (uint64_t)n;
+                if (peer->link.below(1u << 24) < (uint32_t)(cfg.loss * (1u << 24))) {
+                    peer->dropped++;
+                    continue;
+                }
+                netSend(peer->sock, addrs[q], buf, n);
+            }
+
+            const LockstepDesync& d = s.desync();
+            if (d.tick != 0 && !peer->dumped) {
+                char path[64];
+                snprintf(path, sizeof(path), "lockstep_desync_p%d_t%u.txt", me, d.tick);
+                FILE* f = fopen(path, "w");
+                if (f) {
+                    s.writeDump(f, d.tick);
+                    fclose(f);
+                }
+                printf("player %d: desync with player %d at tick %u (hash %08x vs %08x), dumped to %s\n", me, d.player, d.tick,
+                    d.localHash, d.remoteHash, f ? path : "(cannot write)");
+                peer->dumped = true;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(BenchClock::now() - start).count();
+
+    printf("%d players on %dx%d, %d fruits, %d ms ticks, input delay %d, loss %.1f%%: %d frames in %.1f s\n", players,
+        cfg.arena.width, cfg.arena.height, cfg.arena.fruits, cfg.tickMs, cfg.delay, cfg.loss * 100.0, frames, seconds);
+    bool failed = false;
+    for (auto& peer : peers) {
+        const LockstepSession& s = peer->session;
+        const LockstepStats& st = s.stats();
+        uint64_t ticks = std::max<uint64_t>(st.ticks, 1);
+        printf("player %d: %llu ticks, %llu stalled frames, %llu hashes checked; out %.1f B/tick (%.2f KB/s, %.1f B/packet, %llu dropped),"
+            " in %.1f B/tick\n", s.localPlayer(), (unsigned long long)st.ticks, (unsigned long long)st.stalls,
+            (unsigned long long)st.hashesChecked, (double)peer->bytesOut / ticks, peer->bytesOut / seconds / 1024.0,
+            peer->packetsOut ? (double)peer->bytesOut / peer->packetsOut : 0.0, (unsigned long long)peer->dropped,
+            (double)peer->bytesIn / ticks);
+        failed = failed || st.ticks < (uint64_t)cfg.ticks || s.desync().tick != 0;
+    }
+
+    // In one process the peers can also be compared directly on their newest common tick
+    if (!lan) {
+        uint32_t common = UINT32_MAX;
+        for (auto& peer : peers) common = std::min(common, peer->session.game().tickCount());
+        int differ = 0;
+        for (auto& peer : peers) differ += peer->session.tickHash(common) != peers[0]->session.tickHash(common);
+        printf("tick %u: %d of %d peers differ from player 0\n", common, differ, players);
+        failed = failed || differ != 0;
+    }
+    for (auto& peer : peers) netClose(peer->sock);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,160 @@
+// snake_match.h
+// Wire formats shared by the sharded match server (snake_match_server.cpp) and its load
+// client: the arena board snapshot and the server's tick-lateness report. Solo matches
+// use the snapshot protocol of snake_net.h unchanged.
+
+#pragma once
+
+#include "snake_arena.h"
+#include "snake_net.h"
+
+#include <cstdint>
+#include <cstring>
+
+//
+// Tick lateness: how long after its due time a match tick ran, in 250 us buckets up to
+// 32 ms plus one overflow bucket. Reports carry running totals, so the histogram of any
+// window is the difference of two reports.
+//
+static constexpr int MATCH_LATE_BUCKET_US = 250;
+static constexpr int MATCH_LATE_BUCKETS = 128;
+
+struct MatchReport {
+    uint32_t shards = 0;
+    uint32_t matches = 0;   // now
+    uint32_t clients = 0;   // now
+    uint64_t ticks = 0;     // running totals from here on
+    uint64_t cpuMicros = 0; // shard threads
+    uint64_t bytesOut = 0;
+    uint64_t recordBytes = 0; // match recordings handed to the writer
+    uint64_t late[MATCH_LATE_BUCKETS + 1] = {};
+
+    void addLateness(uint64_t us) {
+        uint64_t b = us / MATCH_LATE_BUCKET_US;
+        late[b < MATCH_LATE_BUCKETS ? b : MATCH_LATE_BUCKETS]++;
+        ticks++;
+    }
+
+    void merge(const MatchReport& o) {
+        shards += o.shards;
+        matches += o.matches;
+        clients += o.clients;
+        ticks += o.ticks;
+        cpuMicros += o.cpuMicros;
+        bytesOut += o.bytesOut;
+        recordBytes += o.recordBytes;
+        for (int i = 0; i <= MATCH_LATE_BUCKETS; i++) late[i] += o.late[i];
+    }
+
+    // The window between an earlier report and this one; current counts stay as they are
+    MatchReport since(const MatchReport& before) const {
+        MatchReport d = *this;
+        d.ticks -= before.ticks;
+        d.cpuMicros -= before.cpuMicros;
+        d.bytesOut -= before.bytesOut;
+        d.recordBytes -= before.recordBytes;
+        for (int i = 0; i <= MATCH_LATE_BUCKETS; i++) d.late[i] -= before.late[i];
+        return d;
+    }
+
+    // Lateness in ms that fraction q of the ticks stayed within (bucket upper edge)
+    double percentileMs(double q) const {
+        if (ticks == 0) return 0.0;
+        uint64_t need = (uint64_t)(q * (double)ticks + 0.5), seen = 0;
+        for (int i = 0; i <= MATCH_LATE_BUCKETS; i++) {
+            seen += late[i];
+            if (seen >= need && seen > 0) return (i + 1) * MATCH_LATE_BUCKET_US / 1000.0;
+        }
+        return (MATCH_LATE_BUCKETS + 1) * MATCH_LATE_BUCKET_US / 1000.0;
+    }
+};
+
+static constexpr int MATCH_REPORT_BYTES = 1 + 4 + 4 * 3 + 8 * 4 + 4 * (MATCH_LATE_BUCKETS + 1);
+
+// STATS reply: type, request u32, then the report (bucket counts as u32)
+static inline int matchWriteReport(uint8_t* out, uint32_t request, const MatchReport& r) {
+    uint8_t* p = out;
+    *p++ = NET_STATS;
+    netPut32(p, request), p += 4;
+    netPut32(p, r.shards), p += 4;
+    netPut32(p, r.matches), p += 4;
+    netPut32(p, r.clients), p += 4;
+    for (uint64_t v : { r.ticks, r.cpuMicros, r.bytesOut, r.recordBytes }) netPut32(p, (uint32_t)v), netPut32(p + 4, (uint32_t)(v >> 32)), p += 8;
+    for (int i = 0; i <= MATCH_LATE_BUCKETS; i++) netPut32(p, (uint32_t)r.late[i]), p += 4;
+    return (int)(p - out);
+}
+
+static inline bool matchReadReport(const uint8_t* p, int n, uint32_t& request, MatchReport& r) {
+    if (n < MATCH_REPORT_BYTES || p[0] != NET_STATS) return false;
+    p++;
+    request = netGet32(p), p += 4;
+    r.shards = netGet32(p), p += 4;
+    r.matches = netGet32(p), p += 4;
+    r.clients = netGet32(p), p += 4;
+    uint64_t* wide[4] = { &r.ticks, &r.cpuMicros, &r.bytesOut, &r.recordBytes };
+    for (uint64_t* v : wide) *v = netGet32(p) | (uint64_t)netGet32(p + 4) << 32, p += 8;
+    for (int i = 0; i <= MATCH_LATE_BUCKETS; i++) r.late[i] = netGet32(p), p += 4;
+    return true;
+}
+
+//
+// ARENA snapshot: the whole board every tick. Arena matches are small (a few snakes on
+// at most NET_MAX_SIDE squared cells), so a bit-packed board fits one datagram:
+//   snakes u8, per snake alive (1) [score / 10 var, length - 1 var, head cell, dir (2),
+//   length - 1 steps from each segment to the next (2)], fruit count var, fruit cells
+//
+static constexpr int MATCH_ARENA_HEADER = 6;
+
+static inline int matchWriteArena(const SnakeArena& a, uint32_t tick, int seat, uint8_t* out) {
+    out[0] = NET_ARENA;
+    netPut32(out + 1, tick);
+    out[5] = (uint8_t)seat;
+    NetBitWriter bw(out + MATCH_ARENA_HEADER, NET_MAX_PACKET - MATCH_ARENA_HEADER);
+    int w = a.width();
+    int cellBits = netCellBits(w * a.height());
+    bw.put((uint32_t)a.snakeCount(), 8);
+    for (int i = 0; i < a.snakeCount(); i++) {
+        const ArenaSnake& s = a.snake(i);
+        bw.put(s.alive, 1);
+        if (!s.alive) continue;
+        bw.putVar((uint32_t)s.score / 10);
+        bw.putVar(s.length - 1);
+        bw.put(s.head(), cellBits);
+        bw.put(s.dir, 2);
+        for (uint32_t k = 1; k < s.length; k++) bw.put(netStepDir(s.segment(k - 1), s.segment(k), w), 2);
+    }
+    bw.putVar((uint32_t)a.fruits().size());
+    for (uint32_t f : a.fruits()) bw.put(f, cellBits);
+    size_t body = bw.finish();
+    return body ? MATCH_ARENA_HEADER + (int)body : 0;
+}
+
+// Parses an ARENA snapshot for a width x height board; false if it is malformed or any
+// body leaves the board
+static inline bool matchReadArena(const uint8_t* p, int n, int width, int height, int& snakes, int& fruits) {
+    if (n < MATCH_ARENA_HEADER || p[0] != NET_ARENA) return false;
+    NetBitReader br(p + MATCH_ARENA_HEADER, (size_t)(n - MATCH_ARENA_HEADER));
+    uint32_t cells = (uint32_t)(width * height);
+    int cellBits = netCellBits((int)cells);
+    snakes = (int)br.get(8);
+    for (int i = 0; i < snakes && br.ok; i++) {
+        if (!br.get(1)) continue;
+        br.getVar();
+        uint32_t length = br.getVar() + 1;
+        uint32_t c = br.get(cellBits);
+        br.get(2);
+        if (length > cells || c >= cells) return false;
+        for (uint32_t k = 1; k < length && br.ok; k++) {
+            uint32_t d = br.get(2);
+            int x = (int)(c % (uint32_t)width), y = (int)(c / (uint32_t)width);
+            if ((d == SIM_UP && y == 0) || (d == SIM_DOWN && y == height - 1) || (d == SIM_LEFT && x == 0) ||
+                (d == SIM_RIGHT && x == width - 1)) return false;
+            c = netApplyDir(c, d, width);
+        }
+    }
+    fruits = (int)br.getVar();
+    for (int i = 0; i < fruits && br.ok; i++) {
+        if (br.get(cellBits) >= cells) return false;
+    }
+    return br.ok;
+}
@@ -0,0 +1,303 @@
+// snake_match_bench.cpp
+// Load client for snake_match_server: adds bot clients in steps and, at each step, asks the
+// server for its tick-lateness histogram over a measured window. Reports matches per core
+// and the largest load that keeps p99 lateness under the target.
+// Compile: g++ snake_match_bench.cpp -std=c++20 -O2 -o snake_match_bench
+// Run:     ./snake_match_server --port 7777 &
+//          ./snake_match_bench --port 7777 --steps 500,1000,2000,4000 --arena-share 0.25 --target-p99 5
+
+#include "snake_match.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <sys/resource.h>
+
+//
+// Config
+//
+struct MatchBenchConfig {
+    const char* ip = "127.0.0.1";
+    int port = 7777;
+    std::vector<int> steps{ 250, 500, 1000 }; // clients at each step
+    double arenaShare = 0.0;                  // clients that ask for an arena seat
+    int warmupSeconds = 3;
+    int measureSeconds = 10;
+    double targetP99Ms = 5.0;
+    uint64_t seed = 1;
+};
+
+static std::vector<int> parseList(const char* s) {
+    std::vector<int> v;
+    while (*s) {
+        v.push_back(atoi(s));
+        while (*s && *s != ',') s++;
+        if (*s == ',') s++;
+    }
+    return v;
+}
+
+static MatchBenchConfig parseArgs(int argc, char** argv) {
+    MatchBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--ip") && i + 1 < argc) cfg.ip = argv[++i];
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) cfg.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--steps") && i + 1 < argc) cfg.steps = parseList(argv[++i]);
+        else if (!strcmp(argv[i], "--arena-share") && i + 1 < argc) cfg.arenaShare = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--warmup") && i + 1 < argc) cfg.warmupSeconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--measure") && i + 1 < argc) cfg.measureSeconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--target-p99") && i + 1 < argc) cfg.targetP99Ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.seed = strtoull(argv[++i], nullptr, 10);
+    }
+    return cfg;
+}
+
+using BenchClock = std::chrono::steady_clock;
+
+//
+// Clients
+//
+struct MatchClient {
+    NetSocket sock = NET_INVALID_SOCKET;
+    bool arena = false;
+    uint32_t nonce = 0;
+    uint32_t token = 0;  // 0 until WELCOME
+    NetAddr server;      // where WELCOME came from
+    int w = 0, h = 0;
+    NetReplica replica;  // solo
+    uint32_t arenaTick = 0;
+    uint16_t inputSeq = 0;
+    uint8_t inputs[NET_INPUT_REDUNDANCY];
+    uint16_t inputAck = 0;
+    BenchClock::time_point lastSent;
+};
+
+struct ClientTotals {
+    uint64_t snapshots = 0, bytes = 0, badSnapshots = 0;
+};
+
+class LoadClients {
+public:
+    LoadClients(const MatchBenchConfig& cfg) : cfg(cfg), lobby(netAddr(cfg.ip, (uint16_t)cfg.port)) {
+        rng.state = cfg.seed;
+        stats = netOpenUdp("127.0.0.1", 0);
+    }
+
+    ~LoadClients() {
+        for (MatchClient& c : clients) {
+            if (c.token) {
+                uint8_t out[5] = { NET_BYE };
+                netPut32(out + 1, c.token);
+                netSend(c.sock, c.server, out, 5);
+            }
+            netClose(c.sock);
+        }
+        netClose(stats);
+    }
+
+    bool grow(int count) {
+        while ((int)clients.size() < count) {
+            MatchClient c;
+            c.sock = netOpenUdp("127.0.0.1", 0, 256 << 10);
+            if (c.sock == NET_INVALID_SOCKET) return false;
+            c.arena = (double)rng.below(1u << 24) < cfg.arenaShare * (1u << 24);
+            c.nonce = (uint32_t)rng.next();
+            clients.push_back(std::move(c));
+            hello(clients.back());
+        }
+        fds.clear();
+        for (MatchClient& c : clients) fds.push_back(pollfd{ c.sock, POLLIN, 0 });
+        return true;
+    }
+
+    // Play until the deadline
+    void run(BenchClock::time_point until) {
+        uint8_t buf[NET_MAX_PACKET];
+        NetAddr from;
+        while (BenchClock::now() < until) {
+            poll(fds.data(), fds.size(), 5);
+            auto now = BenchClock::now();
+            for (size_t i = 0; i < clients.size(); i++) {
+                MatchClient& c = clients[i];
+                if (fds[i].revents & POLLIN) {
+                    int n;
+                    while ((n = netRecv(c.sock, from, buf, sizeof(buf))) > 0) receive(c, from, buf, n);
+                }
+                if (now - c.lastSent > std::chrono::milliseconds(500)) {
+                    if (c.token == 0) hello(c);
+                    else input(c);
+                }
+            }
+        }
+    }
+
+    // The server's running totals, or false if it did not answer
+    bool report(MatchReport& r) {
+        uint32_t request = ++requests;
+        uint8_t q[5] = { NET_STATS };
+        netPut32(q + 1, request);
+        netSend(stats, lobby, q, 5);
+        auto deadline = BenchClock::now() + std::chrono::seconds(2);
+        uint8_t buf[NET_MAX_PACKET];
+        NetAddr from;
+        while (BenchClock::now() < deadline) {
+            run(BenchClock::now() + std::chrono::milliseconds(5)); // keep playing meanwhile
+            int n;
+            uint32_t got;
+            while ((n = netRecv(stats, from, buf, sizeof(buf))) > 0) {
+                if (matchReadReport(buf, n, got, r) && got == request) return true;
+            }
+        }
+        return false;
+    }
+
+    int connected() const {
+        int n = 0;
+        for (const MatchClient& c : clients) n += c.token != 0;
+        return n;
+    }
+
+    ClientTotals totals;
+    uint64_t checkFailures() const {
+        uint64_t f = 0;
+        for (const MatchClient& c : clients) f += c.replica.checkFailures;
+        return f;
+    }
+
+private:
+    const MatchBenchConfig& cfg;
+    NetAddr lobby;
+    NetSocket stats;
+    SimRng rng;
+    std::vector<MatchClient> clients;
+    std::vector<pollfd> fds;
+    uint32_t requests = 0;
+
+    void hello(MatchClient& c) {
+        uint8_t out[10];
+        out[0] = NET_HELLO;
+        netPut32(out + 1, NET_MAGIC);
+        netPut32(out + 5, c.nonce);
+        out[9] = c.arena ? 1 : 0;
+        netSend(c.sock, lobby, out, 10);
+        c.lastSent = BenchClock::now();
+    }
+
+    void receive(MatchClient& c, const NetAddr& from, const uint8_t* p, int n) {
+        if (p[0] == NET_WELCOME && n >= 16 && netGet32(p + 5) == c.nonce) {
+            if (c.token != 0) return;
+            c.token = netGet32(p + 1);
+            c.server = from;
+            c.w = netGet16(p + 9);
+            c.h = netGet16(p + 11);
+            if (!c.arena) c.replica.configure(c.w, c.h);
+            return;
+        }
+        if (c.token == 0 || !(from == c.server)) return;
+        totals.snapshots++;
+        totals.bytes += (uint64_t)n;
+        if (p[0] == NET_SNAPSHOT && !c.arena) {
+            if (!c.replica.apply(p, n)) return;
+            c.inputAck = c.replica.inputAck;
+        }
+        else if (p[0] == NET_ARENA && c.arena) {
+            int snakes, fruits;
+            if (!matchReadArena(p, n, c.w, c.h, snakes, fruits)) {
+                totals.badSnapshots++;
+                return;
+            }
+            c.arenaTick = netGet32(p + 1);
+        }
+        else {
+            return;
+        }
+        // A turn now and then, like a player
+        if (rng.below(4) == 0) {
+            c.inputSeq++;
+            c.inputs[c.inputSeq % NET_INPUT_REDUNDANCY] = (uint8_t)rng.below(4);
+        }
+        input(c);
+    }
+
+    void input(MatchClient& c) {
+        uint8_t out[12 + NET_INPUT_REDUNDANCY];
+        int pending = c.arena ? 1 : (int16_t)(c.inputSeq - c.inputAck);
+        int count = pending < 0 ? 0 : pending > NET_INPUT_REDUNDANCY ? NET_INPUT_REDUNDANCY : pending;
+        if (c.inputSeq == 0) count = 0;
+        out[0] = NET_INPUT;
+        netPut32(out + 1, c.token);
+        netPut32(out + 5, c.arena ? c.arenaTick : c.replica.ackTick());
+        netPut16(out + 9, c.inputSeq);
+        out[11] = (uint8_t)count;
+        NetBitWriter bw(out + 12, NET_INPUT_REDUNDANCY);
+        for (int k = 0; k < count; k++) bw.put(c.inputs[(uint16_t)(c.inputSeq - k) % NET_INPUT_REDUNDANCY], 2);
+        netSend(c.sock, c.server, out, 12 + (int)bw.finish());
+        c.lastSent = BenchClock::now();
+    }
+};
+
+int main(int argc, char** argv) {
+    MatchBenchConfig cfg = parseArgs(argc, argv);
+    if (cfg.steps.empty() || cfg.arenaShare < 0.0 || cfg.arenaShare > 1.0 || cfg.measureSeconds < 1) {
+        printf("invalid settings\n");
+        return 1;
+    }
+    rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    LoadClients load(cfg);
+    printf("%9s %8s %7s %9s %8s %8s %8s %9s %10s %9s\n", "clients", "matches", "shards", "ticks/s", "p50 ms", "p99 ms",
+        "p99.9 ms", "cpu/core", "us/tick", "B/tick");
+    int bestMatches = 0, bestShards = 1;
+    double bestCpu = 0.0;
+    for (int target : cfg.steps) {
+        if (!load.grow(target)) {
+            printf("cannot open %d sockets\n", target);
+            return 1;
+        }
+        load.run(BenchClock::now() + std::chrono::seconds(cfg.warmupSeconds));
+        MatchReport before, after;
+        auto t0 = BenchClock::now();
+        if (!load.report(before)) {
+            printf("no answer from the server\n");
+            return 1;
+        }
+        load.run(t0 + std::chrono::seconds(cfg.measureSeconds));
+        if (!load.report(after)) {
+            printf("no answer from the server\n");
+            return 1;
+        }
+        double secs = std::chrono::duration<double>(BenchClock::now() - t0).count();
+        MatchReport w = after.since(before);
+        double cpuPerCore = w.cpuMicros / (secs * 1e6) / std::max(1u, w.shards);
+        double p99 = w.percentileMs(0.99);
+        printf("%9d %8u %7u %9.0f %8.2f %8.2f %8.2f %8.1f%% %10.1f %9.1f\n", load.connected(), w.matches, w.shards, w.ticks / secs,
+            w.percentileMs(0.5), p99, w.percentileMs(0.999), cpuPerCore * 100.0, w.ticks ? (double)w.cpuMicros / w.ticks : 0.0,
+            w.ticks ? (double)w.bytesOut / w.ticks : 0.0);
+        fflush(stdout);
+        if (p99 <= cfg.targetP99Ms && (int)w.matches > bestMatches) {
+            bestMatches = (int)w.matches;
+            bestShards = (int)std::max(1u, w.shards);
+            bestCpu = cpuPerCore;
+        }
+    }
+
+    if (bestMatches == 0) {
+        printf("no step kept p99 lateness under %.1f ms\n", cfg.targetP99Ms);
+    }
+    else {
+        printf("largest step within p99 %.1f ms: %d matches = %.0f per core at %.1f%% busy (%.0f per fully busy core)\n",
+            cfg.targetP99Ms, bestMatches, (double)bestMatches / bestShards, bestCpu * 100.0,
+            bestCpu > 0 ? bestMatches / bestShards / bestCpu : 0.0);
+    }
+    printf("clients: %llu snapshots, %llu malformed arena boards, %llu solo check failures\n",
+        (unsigned long long)load.totals.snapshots, (unsigned long long)load.totals.badSnapshots,
+        (unsigned long long)load.checkFailures());
+    return load.totals.badSnapshots || load.checkFailures() ? 1 : 0;
+}
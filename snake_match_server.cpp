@@ -0,0 +1,993 @@
+// snake_match_server.cpp
+// Sharded match server: one event loop per core, each owning a shard of matches, instead
+// of a process per match. A shard is an epoll loop over its own UDP socket, an eventfd
+// for its inbox and a timerfd armed for the next due match on its timer wheel. Matches run
+// the single-player rules (delta snapshots, as snake_server) or the arena rules (a few
+// seats, bots in the empty ones).
+// Clients say HELLO to the lobby port. The lobby (on shard 0's loop) places them on the
+// least loaded shard through that shard's lock-free inbox, and the shard answers WELCOME
+// from its own socket, which the client then talks to. Lateness reports are gathered
+// from every shard through the same inboxes. Every match is recorded (snake_record.h):
+// shards append records to their own buffer inside the tick, and a writer thread puts
+// the full buffers on disk. Linux only (epoll, eventfd, timerfd).
+// Compile: g++ snake_match_server.cpp -std=c++20 -O2 -pthread -o snake_match_server
+// Run:     ./snake_match_server --port 7777 [--shards 4] [--tick-ms 120] [--arena-seats 4]
+//          [--record-dir DIR | --no-record]
+//          then snake_match_bench for load and matches per core, and snake_record_tool
+//          to check or replay the recordings
+
+#include "snake_match.h"
+#include "snake_queue.h"
+#include "snake_record.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+
+//
+// Config
+//
+struct MatchServerConfig {
+    const char* ip = "127.0.0.1";
+    int port = 7777;
+    int shards = 0;            // 0 = one per hardware thread
+    int tickMs = 120;          // TICK_INTERVAL_MS_VALUE in main.cpp
+    int width = 20;            // solo board
+    int height = 20;
+    int fruits = 1;
+    int arenaWidth = 32;
+    int arenaHeight = 32;
+    int arenaFruits = 8;
+    int arenaSeats = 4;
+    int restartTicks = 8;
+    int timeoutMs = 5000;
+    int statsSeconds = 5;
+    int seconds = 0;           // 0 = run until killed
+    bool pin = true;           // shard i on CPU i
+    const char* recordDir = "."; // nullptr = no recordings
+    uint64_t seed = 1;
+};
+
+static MatchServerConfig parseArgs(int argc, char** argv) {
+    MatchServerConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--ip") && i + 1 < argc) cfg.ip = argv[++i];
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) cfg.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--shards") && i + 1 < argc) cfg.shards = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--tick-ms") && i + 1 < argc) cfg.tickMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fruits") && i + 1 < argc) cfg.fruits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--arena-width") && i + 1 < argc) cfg.arenaWidth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--arena-height") && i + 1 < argc) cfg.arenaHeight = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--arena-fruits") && i + 1 < argc) cfg.arenaFruits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--arena-seats") && i + 1 < argc) cfg.arenaSeats = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--restart") && i + 1 < argc) cfg.restartTicks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--timeout-ms") && i + 1 < argc) cfg.timeoutMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--stats") && i + 1 < argc) cfg.statsSeconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) cfg.seconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--no-pin")) cfg.pin = false;
+        else if (!strcmp(argv[i], "--record-dir") && i + 1 < argc) cfg.recordDir = argv[++i];
+        else if (!strcmp(argv[i], "--no-record")) cfg.recordDir = nullptr;
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.seed = strtoull(argv[++i], nullptr, 10);
+    }
+    return cfg;
+}
+
+static uint64_t monoMicros() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static uint64_t threadCpuMicros() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+//
+// Timer wheel: WHEEL_SLOTS slots of WHEEL_RES_US each (about a second in all). A timer goes
+// into the first slot starting at or after its due time, so it never fires early and is at
+// most one slot late. A bitmap of non-empty slots finds the next wakeup.
+//
+static constexpr uint64_t WHEEL_RES_US = 250;
+static constexpr uint64_t WHEEL_SLOTS = 4096;
+
+class TimerWheel {
+public:
+    void init(uint64_t nowUs) { cursor = nowUs / WHEEL_RES_US; }
+
+    // dueUs must be less than a wheel span ahead
+    void schedule(uint32_t id, uint64_t dueUs) {
+        uint64_t s = std::max((dueUs + WHEEL_RES_US - 1) / WHEEL_RES_US, cursor);
+        size_t i = (size_t)(s & (WHEEL_SLOTS - 1));
+        slots[i].push_back(id);
+        bits[i / 64] |= 1ull << (i % 64);
+    }
+
+    // Calls fn(id) for every timer due by nowUs. Timers scheduled from fn land in later slots.
+    template <typename Fn>
+    void expire(uint64_t nowUs, Fn&& fn) {
+        uint64_t last = nowUs / WHEEL_RES_US;
+        for (uint64_t n = 0; cursor <= last && n < WHEEL_SLOTS; n++) {
+            size_t i = (size_t)(cursor & (WHEEL_SLOTS - 1));
+            cursor++;
+            if (slots[i].empty()) continue;
+            firing.swap(slots[i]);
+            bits[i / 64] &= ~(1ull << (i % 64));
+            for (uint32_t id : firing) fn(id);
+            firing.clear();
+        }
+        if (cursor <= last) cursor = last + 1; // idle longer than a span: every slot was visited
+    }
+
+    // Start of the next non-empty slot, or 0 if the wheel is empty
+    uint64_t nextDue() const {
+        size_t start = (size_t)(cursor & (WHEEL_SLOTS - 1));
+        for (size_t k = 0; k <= WHEEL_SLOTS / 64; k++) {
+            size_t word = (start / 64 + k) % (WHEEL_SLOTS / 64);
+            uint64_t m = bits[word];
+            if (k == 0) m &= ~0ull << (start % 64);
+            if (!m) continue;
+            size_t i = word * 64 + (size_t)__builtin_ctzll(m);
+            uint64_t ahead = (i + WHEEL_SLOTS - start) % WHEEL_SLOTS;
+            return (cursor + ahead) * WHEEL_RES_US;
+        }
+        return 0;
+    }
+
+private:
+    std::vector<uint32_t> slots[WHEEL_SLOTS];
+    uint64_t bits[WHEEL_SLOTS / 64] = {};
+    uint64_t cursor = 0;
+    std::vector<uint32_t> firing;
+};
+
+//
+// Messages between loops
+//
+enum ShardMsgType : uint8_t { SHARD_JOIN, SHARD_REPORT };
+
+struct ShardMsg {
+    ShardMsgType type = SHARD_JOIN;
+    uint8_t mode = 0;      // JOIN: 0 solo, 1 arena
+    NetAddr addr;          // JOIN: the client; REPORT: who asked
+    uint32_t nonce = 0;    // JOIN: from HELLO; REPORT: the request id
+    uint32_t arenaKey = 0; // JOIN arena: which arena match
+};
+
+struct ShardReportMsg {
+    NetAddr addr;
+    uint32_t request = 0;
+    MatchReport report;
+};
+
+//
+// Recording writer. Each shard fills a chunk with records and hands it over once it holds
+// RECORD_CHUNK_BYTES (or a second has passed); this thread appends it to the shard's file
+// and returns it to the spare queue. A shard with no spare chunk keeps appending to the
+// one it has, so a slow disk costs memory, never a tick.
+//
+static constexpr size_t RECORD_CHUNK_BYTES = 64 << 10;
+static constexpr int RECORD_CHUNKS_PER_SHARD = 8;
+
+struct RecordChunk {
+    int shard = 0;
+    std::vector<uint8_t> bytes;
+};
+
+class MatchRecorder {
+public:
+    MatchRecorder(const MatchServerConfig& cfg, int shards)
+        : cfg(cfg), files((size_t)shards, nullptr), full((size_t)shards * RECORD_CHUNKS_PER_SHARD),
+          spare((size_t)shards * RECORD_CHUNKS_PER_SHARD) {
+        for (int i = 0; i < shards * RECORD_CHUNKS_PER_SHARD; i++) {
+            storage.push_back(std::make_unique<RecordChunk>());
+            storage.back()->bytes.reserve(RECORD_CHUNK_BYTES + 4096);
+            spare.push(storage.back().get());
+        }
+    }
+
+    ~MatchRecorder() {
+        for (FILE* f : files) {
+            if (f) fclose(f);
+        }
+        if (eventFd >= 0) close(eventFd);
+    }
+
+    // One file per shard, named for the server's start time
+    bool open() {
+        eventFd = eventfd(0, 0);
+        if (eventFd < 0) return false;
+        uint64_t started = (uint64_t)time(nullptr);
+        for (size_t s = 0; s < files.size(); s++) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/match-%llu-shard%zu.snkrec", cfg.recordDir, (unsigned long long)started, s);
+            files[s] = fopen(path, "wb");
+            if (!files[s]) return false;
+            std::vector<uint8_t> header;
+            recordFileHeader(header, (uint16_t)s);
+            fwrite(header.data(), 1, header.size(), files[s]);
+        }
+        return true;
+    }
+
+    void start() { worker = std::thread([this] { loop(); }); }
+
+    // Writes what is queued, then returns
+    void finish() {
+        stopping.store(true);
+        wake();
+        if (worker.joinable()) worker.join();
+    }
+
+    // An empty chunk, or nullptr if the writer holds them all
+    RecordChunk* acquire(int shard) {
+        RecordChunk* c = nullptr;
+        if (!spare.pop(c)) return nullptr;
+        c->shard = shard;
+        c->bytes.clear();
+        return c;
+    }
+
+    // Never fails: the queue has room for every chunk
+    void submit(RecordChunk* c) {
+        full.push(c);
+        wake();
+    }
+
+    std::atomic<uint64_t> written{ 0 };
+
+private:
+    const MatchServerConfig& cfg;
+    std::vector<FILE*> files;
+    std::vector<std::unique_ptr<RecordChunk>> storage;
+    MpmcQueue<RecordChunk*> full, spare;
+    int eventFd = -1;
+    std::thread worker;
+    std::atomic<bool> stopping{ false };
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t r = write(eventFd, &one, sizeof(one));
+        (void)r;
+    }
+
+    void loop() {
+        for (;;) {
+            uint64_t drained;
+            if (read(eventFd, &drained, sizeof(drained)) < 0) {}
+            bool stop = stopping.load();
+            RecordChunk* c;
+            while (full.pop(c)) {
+                fwrite(c->bytes.data(), 1, c->bytes.size(), files[(size_t)c->shard]);
+                written.fetch_add(c->bytes.size(), std::memory_order_relaxed);
+                spare.push(c);
+            }
+            for (FILE* f : files) fflush(f);
+            if (stop) return;
+        }
+    }
+};
+
+//
+// Matches
+//
+struct Seat {
+    NetAddr addr;
+    uint32_t token = 0;    // 0 = empty (a bot plays)
+    int action = -1;
+    uint16_t inputSeq = 0;
+    uint64_t lastHeard = 0;
+};
+
+struct Match {
+    bool live = false;
+    bool arena = false;
+    uint32_t arenaKey = 0;
+    uint32_t tick = 1;
+    uint64_t due = 0;
+    uint32_t recording = 0;            // id in the shard's recording file, 0 = none
+    uint64_t seed = 0;                 // of the game (solo: of its first episode)
+    NetSession solo;                   // solo: the game, its frames and the client
+    std::unique_ptr<SnakeArena> board; // arena
+    std::vector<Seat> seats;
+};
+
+class MatchLobby;
+
+//
+// Shard: one event loop and the matches it owns
+//
+class Shard {
+public:
+    Shard(int id, const MatchServerConfig& cfg, MatchLobby* lobby, MatchRecorder* recorder)
+        : id(id), cfg(cfg), lobby(lobby), recorder(recorder), inbox(4096) {
+        rng.state = cfg.seed * 0x9E3779B97F4A7C15ull + (uint64_t)id;
+        report.shards = 1;
+    }
+
+    ~Shard() {
+        for (int fd : { epfd, eventFd, timerFd }) {
+            if (fd >= 0) close(fd);
+        }
+        if (sock != NET_INVALID_SOCKET) netClose(sock);
+    }
+
+    bool open(NetSocket lobbySock);
+
+    void start() { worker = std::thread([this] { loop(); }); }
+
+    void join() {
+        if (worker.joinable()) worker.join();
+    }
+
+    // From any thread
+    bool post(const ShardMsg& m) {
+        if (!inbox.push(m)) return false;
+        wake();
+        return true;
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t r = write(eventFd, &one, sizeof(one));
+        (void)r;
+    }
+
+    std::atomic<int> load{ 0 }; // live matches, for placement
+    std::atomic<bool> stop{ false };
+
+private:
+    enum : uint32_t { EV_SOCKET, EV_INBOX, EV_TIMER, EV_LOBBY };
+
+    int id;
+    const MatchServerConfig& cfg;
+    MatchLobby* lobby;
+    MatchRecorder* recorder; // nullptr = no recordings
+    MpmcQueue<ShardMsg> inbox;
+    NetSocket sock = NET_INVALID_SOCKET;
+    NetSocket lobbySock = NET_INVALID_SOCKET;
+    int epfd = -1, eventFd = -1, timerFd = -1;
+    uint64_t armedFor = 0;
+    std::thread worker;
+    SimRng rng;
+    TimerWheel wheel;
+
+    std::vector<std::unique_ptr<Match>> matches;
+    std::vector<uint32_t> freeMatches;
+    struct Route {
+        uint32_t match;
+        int seat; // -1 solo
+    };
+    std::unordered_map<uint64_t, Route> byAddr;
+    std::unordered_map<uint32_t, uint32_t> arenas; // arena key -> match
+    int clients = 0;
+    MatchReport report;
+    uint8_t out[NET_MAX_PACKET];
+
+    // Recordings: records go into chunk->bytes (or spill while the writer is behind)
+    RecordChunk* chunk = nullptr;
+    std::vector<uint8_t> spill;
+    uint32_t recordings = 0;
+    uint64_t handedOffAt = 0;
+
+    void loop();
+    void drainSocket();
+    void drainInbox();
+    void admit(const ShardMsg& m);
+    void input(const NetAddr& from, const uint8_t* p, int n);
+    void bye(const NetAddr& from, uint32_t token);
+    void runMatch(uint32_t m);
+    void tickSolo(Match& m, uint64_t now);
+    void tickArena(Match& m, uint64_t now);
+    void release(uint32_t m);
+    void armTimer();
+    void beginRecording(Match& m);
+    void endRecording(Match& m);
+    void handOff(uint64_t now, bool force);
+
+    std::vector<uint8_t>& log() { return chunk ? chunk->bytes : spill; }
+
+    static RecordPlayer player(const NetAddr& a, uint32_t token) {
+        RecordPlayer p;
+        p.ip = a.sa.sin_addr.s_addr;
+        p.port = a.sa.sin_port;
+        p.token = token;
+        return p;
+    }
+
+    void send(const NetAddr& to, const uint8_t* data, int n) {
+        netSend(sock, to, data, n);
+        report.bytesOut += (uint64_t)n;
+    }
+
+    void welcome(const NetAddr& to, uint32_t token, uint32_t nonce, bool arena) {
+        uint8_t w[16];
+        w[0] = NET_WELCOME;
+        netPut32(w + 1, token);
+        netPut32(w + 5, nonce);
+        netPut16(w + 9, (uint16_t)(arena ? cfg.arenaWidth : cfg.width));
+        netPut16(w + 11, (uint16_t)(arena ? cfg.arenaHeight : cfg.height));
+        w[13] = (uint8_t)(arena ? cfg.arenaFruits : cfg.fruits);
+        netPut16(w + 14, (uint16_t)cfg.tickMs);
+        send(to, w, 16);
+    }
+
+    uint32_t newToken() { return (uint32_t)rng.next() | 1; }
+};
+
+//
+// Lobby: placement and report gathering, driven by shard 0's loop
+//
+class MatchLobby {
+public:
+    MatchLobby(const MatchServerConfig& cfg, std::vector<std::unique_ptr<Shard>>& shards)
+        : cfg(cfg), shards(shards), reports(256) {}
+
+    // Shards hand their reports back here; shard 0 is woken to gather them
+    void postReport(const ShardReportMsg& r) {
+        while (!reports.push(r)) std::this_thread::yield();
+        shards[0]->wake();
+    }
+
+    void onReadable(NetSocket sock) {
+        uint8_t buf[NET_MAX_PACKET];
+        NetAddr from;
+        int n;
+        uint64_t now = monoMicros();
+        while ((n = netRecv(sock, from, buf, sizeof(buf))) > 0) {
+            if (buf[0] == NET_HELLO && n >= 9 && netGet32(buf + 1) == NET_MAGIC) hello(from, netGet32(buf + 5), n >= 10 ? buf[9] : 0, now);
+            else if (buf[0] == NET_STATS && n >= 5) requestReports(from, netGet32(buf + 1));
+        }
+        // Forget placements old enough that no HELLO for them can still be in flight
+        if (now - lastPrune > 10000000) {
+            for (auto it = placed.begin(); it != placed.end();) {
+                if (now - it->second.at > 10000000) it = placed.erase(it);
+                else ++it;
+            }
+            lastPrune = now;
+        }
+    }
+
+    void gatherReports(NetSocket sock) {
+        ShardReportMsg r;
+        while (reports.pop(r)) {
+            uint64_t key = r.addr.key() * 0x9E3779B97F4A7C15ull ^ r.request;
+            Pending& p = pending[key];
+            p.report.merge(r.report);
+            if (++p.count < (int)shards.size()) continue;
+            uint8_t out[NET_MAX_PACKET];
+            int n = matchWriteReport(out, r.request, p.report);
+            netSend(sock, r.addr, out, n);
+            pending.erase(key);
+        }
+    }
+
+private:
+    struct Placement {
+        int shard;
+        uint64_t at;
+    };
+
+    struct Pending {
+        int count = 0;
+        MatchReport report;
+    };
+
+    const MatchServerConfig& cfg;
+    std::vector<std::unique_ptr<Shard>>& shards;
+    MpmcQueue<ShardReportMsg> reports;
+    std::unordered_map<uint64_t, Placement> placed;
+    std::unordered_map<uint64_t, Pending> pending;
+    uint64_t lastPrune = 0;
+    int arenaShard = -1;
+    uint32_t arenaKey = 0;
+    int arenaFilled = 0;
+
+    int leastLoaded() const {
+        int best = 0;
+        for (int s = 1; s < (int)shards.size(); s++) {
+            if (shards[s]->load.load(std::memory_order_relaxed) < shards[best]->load.load(std::memory_order_relaxed)) best = s;
+        }
+        return best;
+    }
+
+    void hello(const NetAddr& from, uint32_t nonce, uint8_t mode, uint64_t now) {
+        ShardMsg m;
+        m.type = SHARD_JOIN;
+        m.mode = mode ? 1 : 0;
+        m.addr = from;
+        m.nonce = nonce;
+        auto it = placed.find(from.key());
+        int shard;
+        if (it != placed.end()) {
+            shard = it->second.shard; // repeated HELLO: that shard answers WELCOME again
+        }
+        else if (m.mode == 0) {
+            shard = leastLoaded();
+        }
+        else {
+            // Arena seats fill one match at a time
+            if (arenaShard < 0 || arenaFilled == cfg.arenaSeats) {
+                arenaShard = leastLoaded();
+                arenaKey++;
+                arenaFilled = 0;
+                shards[arenaShard]->load.fetch_add(1, std::memory_order_relaxed); // counted now, so the next solo join sees it
+            }
+            arenaFilled++;
+            shard = arenaShard;
+        }
+        if (it == placed.end() && m.mode == 0) shards[shard]->load.fetch_add(1, std::memory_order_relaxed);
+        m.arenaKey = arenaKey;
+        placed[from.key()] = Placement{ shard, now };
+        shards[shard]->post(m);
+    }
+
+    void requestReports(const NetAddr& from, uint32_t request) {
+        ShardMsg m;
+        m.type = SHARD_REPORT;
+        m.addr = from;
+        m.nonce = request;
+        for (auto& s : shards) s->post(m);
+    }
+};
+
+//
+// Shard implementation
+//
+bool Shard::open(NetSocket lobbySocket) {
+    lobbySock = lobbySocket;
+    sock = netOpenUdp(cfg.ip, 0, 8 << 20);
+    epfd = epoll_create1(0);
+    eventFd = eventfd(0, EFD_NONBLOCK);
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (sock == NET_INVALID_SOCKET || epfd < 0 || eventFd < 0 || timerFd < 0) return false;
+    auto add = [&](int fd, uint32_t tag) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = tag;
+        return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+    };
+    bool ok = add(sock, EV_SOCKET) && add(eventFd, EV_INBOX) && add(timerFd, EV_TIMER);
+    if (lobbySock != NET_INVALID_SOCKET) ok = ok && add(lobbySock, EV_LOBBY);
+    return ok;
+}
+
+void Shard::loop() {
+    if (cfg.pin) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(id % (int)std::thread::hardware_concurrency(), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    wheel.init(monoMicros());
+    if (recorder) chunk = recorder->acquire(id);
+    epoll_event events[64];
+    while (!stop.load(std::memory_order_relaxed)) {
+        armTimer();
+        int n = epoll_wait(epfd, events, 64, 200);
+        for (int i = 0; i < n; i++) {
+            uint64_t drained;
+            switch (events[i].data.u32) {
+            case EV_SOCKET: drainSocket(); break;
+            case EV_INBOX:
+                if (read(eventFd, &drained, sizeof(drained)) < 0) {}
+                drainInbox();
+                if (lobbySock != NET_INVALID_SOCKET) lobby->gatherReports(lobbySock);
+                break;
+            case EV_TIMER:
+                if (read(timerFd, &drained, sizeof(drained)) < 0) {}
+                armedFor = 0;
+                break;
+            case EV_LOBBY: lobby->onReadable(lobbySock); break;
+            }
+        }
+        uint64_t now = monoMicros();
+        wheel.expire(now, [this](uint32_t m) { runMatch(m); });
+        if (recorder) handOff(now, false);
+    }
+    if (recorder) {
+        for (auto& m : matches) {
+            if (m->live) endRecording(*m);
+        }
+        handOff(monoMicros(), true);
+    }
+}
+
+// Full chunks (and, once a second, partial ones) go to the writer
+void Shard::handOff(uint64_t now, bool force) {
+    std::vector<uint8_t>& bytes = log();
+    if (bytes.empty() || (!force && bytes.size() < RECORD_CHUNK_BYTES && now - handedOffAt < 1000000)) return;
+    if (!chunk) {
+        chunk = recorder->acquire(id);
+        if (!chunk) return; // the writer is behind: keep spilling
+        chunk->bytes.swap(spill);
+    }
+    report.recordBytes += chunk->bytes.size();
+    recorder->submit(chunk);
+    chunk = recorder->acquire(id);
+    spill.clear();
+    handedOffAt = now;
+}
+
+void Shard::beginRecording(Match& mt) {
+    if (!recorder) return;
+    mt.recording = ++recordings;
+    RecordBegin b;
+    b.mode = mt.arena ? 1 : 0;
+    b.width = (uint16_t)(mt.arena ? cfg.arenaWidth : cfg.width);
+    b.height = (uint16_t)(mt.arena ? cfg.arenaHeight : cfg.height);
+    b.fruits = (uint16_t)(mt.arena ? cfg.arenaFruits : cfg.fruits);
+    b.seats = (uint8_t)(mt.arena ? cfg.arenaSeats : 1);
+    b.respawnTicks = (uint16_t)ArenaConfig{}.respawnTicks;
+    b.tickMs = (uint16_t)cfg.tickMs;
+    b.seed = mt.seed;
+    b.unixMs = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    RecordPlayer pl = player(mt.solo.addr, mt.solo.token);
+    recordBegin(log(), mt.recording, mt.tick, b, mt.arena ? nullptr : &pl);
+}
+
+void Shard::endRecording(Match& mt) {
+    if (!recorder || mt.recording == 0) return;
+    recordEnd(log(), mt.recording, mt.tick, mt.arena ? mt.board->stateHash(false) : recordSoloHash(mt.solo.game));
+    mt.recording = 0;
+}
+
+void Shard::armTimer() {
+    uint64_t next = wheel.nextDue();
+    if (next == armedFor) return;
+    itimerspec ts{};
+    if (next != 0) {
+        ts.it_value.tv_sec = (time_t)(next / 1000000);
+        ts.it_value.tv_nsec = (long)(next % 1000000) * 1000;
+    }
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &ts, nullptr);
+    armedFor = next;
+}
+
+void Shard::drainSocket() {
+    uint8_t buf[NET_MAX_PACKET];
+    NetAddr from;
+    int n;
+    while ((n = netRecv(sock, from, buf, sizeof(buf))) > 0) {
+        if (buf[0] == NET_INPUT && n >= 12) input(from, buf, n);
+        else if (buf[0] == NET_BYE && n >= 5) bye(from, netGet32(buf + 1));
+    }
+}
+
+void Shard::drainInbox() {
+    ShardMsg m;
+    while (inbox.pop(m)) {
+        if (m.type == SHARD_JOIN) {
+            admit(m);
+        }
+        else {
+            ShardReportMsg r;
+            r.addr = m.addr;
+            r.request = m.nonce;
+            r.report = report;
+            r.report.matches = (uint32_t)(matches.size() - freeMatches.size());
+            r.report.clients = (uint32_t)clients;
+            r.report.cpuMicros = threadCpuMicros();
+            lobby->postReport(r);
+        }
+    }
+}
+
+void Shard::admit(const ShardMsg& m) {
+    auto known = byAddr.find(m.addr.key());
+    if (known != byAddr.end()) {
+        // WELCOME was lost
+        Match& mt = *matches[known->second.match];
+        uint32_t token = known->second.seat < 0 ? mt.solo.token : mt.seats[known->second.seat].token;
+        welcome(m.addr, token, m.nonce, mt.arena);
+        return;
+    }
+
+    uint32_t mi;
+    bool fresh = true;
+    if (m.mode == 1) {
+        auto it = arenas.find(m.arenaKey);
+        if (it != arenas.end()) {
+            mi = it->second;
+            fresh = false;
+        }
+    }
+    if (fresh) {
+        if (!freeMatches.empty()) {
+            mi = freeMatches.back();
+            freeMatches.pop_back();
+        }
+        else {
+            mi = (uint32_t)matches.size();
+            matches.push_back(std::make_unique<Match>());
+        }
+        Match& mt = *matches[mi];
+        mt.live = true;
+        mt.arena = m.mode == 1;
+        mt.tick = 1;
+        mt.due = monoMicros() + (uint64_t)cfg.tickMs * 1000;
+        if (mt.arena) {
+            ArenaConfig ac;
+            ac.width = cfg.arenaWidth;
+            ac.height = cfg.arenaHeight;
+            ac.snakes = cfg.arenaSeats;
+            ac.fruits = cfg.arenaFruits;
+            ac.seed = mt.seed = rng.next();
+            mt.board = std::make_unique<SnakeArena>(ac);
+            mt.seats.assign((size_t)cfg.arenaSeats, Seat{});
+            mt.arenaKey = m.arenaKey;
+            arenas[m.arenaKey] = mi;
+        }
+        else {
+            mt.solo = NetSession{};
+            mt.seed = rng.next();
+            mt.solo.start(cfg.width, cfg.height, cfg.fruits, mt.seed);
+            mt.solo.record(mt.tick);
+        }
+        wheel.schedule(mi, mt.due);
+    }
+
+    Match& mt = *matches[mi];
+    uint32_t token = newToken();
+    if (mt.arena) {
+        int seat = 0;
+        while (seat < cfg.arenaSeats && mt.seats[seat].token != 0) seat++;
+        if (seat == cfg.arenaSeats) return; // full; the client's HELLO retry goes to a new arena
+        Seat& s = mt.seats[seat];
+        s = Seat{};
+        s.addr = m.addr;
+        s.token = token;
+        s.lastHeard = monoMicros();
+        mt.board->setBot(seat, false);
+        byAddr[m.addr.key()] = Route{ mi, seat };
+        if (fresh) beginRecording(mt);
+        if (mt.recording) recordSeat(log(), mt.recording, mt.tick + 1, seat, true, player(m.addr, token));
+    }
+    else {
+        mt.solo.addr = m.addr;
+        mt.solo.token = token;
+        mt.solo.lastHeard = std::chrono::steady_clock::now();
+        byAddr[m.addr.key()] = Route{ mi, -1 };
+        beginRecording(mt);
+    }
+    clients++;
+    welcome(m.addr, token, m.nonce, mt.arena);
+}
+
+void Shard::input(const NetAddr& from, const uint8_t* p, int n) {
+    auto it = byAddr.find(from.key());
+    if (it == byAddr.end()) return;
+    Match& mt = *matches[it->second.match];
+    uint32_t token = netGet32(p + 1);
+    int count = p[11];
+    if (count > NET_INPUT_REDUNDANCY || n < 12 + (count * 2 + 7) / 8) return;
+    uint8_t dirs[NET_INPUT_REDUNDANCY];
+    NetBitReader br(p + 12, (size_t)(n - 12));
+    for (int i = 0; i < count; i++) dirs[i] = (uint8_t)br.get(2);
+    uint16_t newest = netGet16(p + 9);
+
+    if (it->second.seat < 0) {
+        NetSession& s = mt.solo;
+        if (s.token != token) return;
+        s.lastHeard = std::chrono::steady_clock::now();
+        uint32_t ack = netGet32(p + 5);
+        if (ack == 0 || (int32_t)(ack - s.ackTick) > 0) s.ackTick = ack;
+        s.receiveInput(newest, count, dirs);
+    }
+    else {
+        // The whole board goes out every tick, so only the newest turn matters
+        Seat& s = mt.seats[it->second.seat];
+        if (s.token != token) return;
+        s.lastHeard = monoMicros();
+        if ((int16_t)(newest - s.inputSeq) > 0 && count > 0) s.action = dirs[0];
+        s.inputSeq = newest;
+    }
+}
+
+void Shard::bye(const NetAddr& from, uint32_t token) {
+    auto it = byAddr.find(from.key());
+    if (it == byAddr.end()) return;
+    Match& mt = *matches[it->second.match];
+    // Marked silent; the match's next tick lets it go
+    if (it->second.seat < 0 && mt.solo.token == token) mt.solo.lastHeard = {};
+    else if (it->second.seat >= 0 && mt.seats[it->second.seat].token == token) mt.seats[it->second.seat].lastHeard = 0;
+}
+
+// A match's timer fired: run its tick, then schedule the next one or let it go
+void Shard::runMatch(uint32_t mi) {
+    Match& mt = *matches[mi];
+    uint64_t now = monoMicros();
+    report.addLateness(now > mt.due ? now - mt.due : 0);
+    if (mt.arena) tickArena(mt, now);
+    else tickSolo(mt, now);
+    if (!mt.live) {
+        release(mi);
+        return;
+    }
+    mt.due += (uint64_t)cfg.tickMs * 1000;
+    wheel.schedule(mi, mt.due);
+}
+
+void Shard::tickSolo(Match& mt, uint64_t) {
+    NetSession& s = mt.solo;
+    if (std::chrono::steady_clock::now() - s.lastHeard > std::chrono::milliseconds(cfg.timeoutMs)) {
+        byAddr.erase(s.addr.key());
+        clients--;
+        mt.live = false;
+        endRecording(mt);
+        return;
+    }
+    mt.tick++;
+    if (!s.game.done()) {
+        int action = s.nextAction();
+        if (action >= 0 && mt.recording) recordInput(log(), mt.recording, mt.tick, 0, action);
+        s.game.step(action);
+    }
+    else if (s.overSince == 0) {
+        s.overSince = mt.tick;
+    }
+    else if (mt.tick - s.overSince >= (uint32_t)cfg.restartTicks) {
+        uint64_t seed = rng.next();
+        if (mt.recording) recordRestart(log(), mt.recording, mt.tick, seed);
+        s.start(cfg.width, cfg.height, cfg.fruits, seed);
+    }
+    if (mt.recording && (mt.tick - 1) % RECORD_KEYFRAME_TICKS == 0) recordSoloKeyframe(log(), mt.recording, mt.tick, s.game);
+    s.record(mt.tick);
+    int n = s.writeSnapshot(mt.tick, out);
+    if (n > 0) send(s.addr, out, n);
+}
+
+void Shard::tickArena(Match& mt, uint64_t now) {
+    int humans = 0;
+    for (int i = 0; i < cfg.arenaSeats; i++) {
+        Seat& s = mt.seats[i];
+        if (s.token == 0) continue;
+        if (now - s.lastHeard > (uint64_t)cfg.timeoutMs * 1000) {
+            if (mt.recording) recordSeat(log(), mt.recording, mt.tick + 1, i, false, player(s.addr, s.token));
+            byAddr.erase(s.addr.key());
+            clients--;
+            s = Seat{};
+            mt.board->setBot(i, true);
+            continue;
+        }
+        humans++;
+        if (s.action >= 0 && mt.recording) recordInput(log(), mt.recording, mt.tick + 1, i, s.action);
+        mt.board->setAction(i, s.action);
+        s.action = -1;
+    }
+    if (humans == 0 && mt.tick > 1) {
+        arenas.erase(mt.arenaKey);
+        mt.live = false;
+        endRecording(mt);
+        return;
+    }
+    mt.tick++;
+    mt.board->think();
+    mt.board->tick();
+    if (mt.recording && (mt.tick - 1) % RECORD_KEYFRAME_TICKS == 0) recordArenaKeyframe(log(), mt.recording, mt.tick, *mt.board);
+    int n = matchWriteArena(*mt.board, mt.tick, 0, out);
+    if (n == 0) return;
+    for (int i = 0; i < cfg.arenaSeats; i++) {
+        if (mt.seats[i].token == 0) continue;
+        out[5] = (uint8_t)i;
+        send(mt.seats[i].addr, out, n);
+    }
+}
+
+void Shard::release(uint32_t mi) {
+    Match& mt = *matches[mi];
+    mt.board.reset();
+    mt.seats.clear();
+    freeMatches.push_back(mi);
+    load.fetch_sub(1, std::memory_order_relaxed);
+}
+
+//
+// Console: the main thread asks the lobby for reports like any client would
+//
+static void printReport(const MatchReport& w, double seconds, int tickMs) {
+    double ticksPerMatch = seconds * 1000.0 / tickMs;
+    double cpuShare = w.cpuMicros / (seconds * 1e6) / (w.shards ? w.shards : 1);
+    printf("%u matches, %u clients on %u shards (%.0f per shard)  %.0f ticks/s  lateness p50 %.2f  p99 %.2f  p99.9 %.2f ms\n",
+        w.matches, w.clients, w.shards, (double)w.matches / (w.shards ? w.shards : 1), w.ticks / seconds, w.percentileMs(0.5),
+        w.percentileMs(0.99), w.percentileMs(0.999));
+    printf("          shard cpu %.1f%% per core, %.1f us per match tick, %.1f B out per match tick (%.0f expected ticks/match)\n",
+        cpuShare * 100.0, w.ticks ? (double)w.cpuMicros / w.ticks : 0.0, w.ticks ? (double)w.bytesOut / w.ticks : 0.0, ticksPerMatch);
+    printf("          recordings %.1f KB/s, %.2f B per match tick\n", w.recordBytes / seconds / 1024.0,
+        w.ticks ? (double)w.recordBytes / w.ticks : 0.0);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    MatchServerConfig cfg = parseArgs(argc, argv);
+    if (cfg.shards <= 0) cfg.shards = (int)std::max(1u, std::thread::hardware_concurrency());
+    if (cfg.width < 4 || cfg.height < 4 || cfg.width > NET_MAX_SIDE || cfg.height > NET_MAX_SIDE || cfg.fruits < 1 ||
+        cfg.fruits > SIM_MAX_FOOD || cfg.arenaWidth < 8 || cfg.arenaHeight < 8 || cfg.arenaWidth > NET_MAX_SIDE ||
+        cfg.arenaHeight > NET_MAX_SIDE || cfg.arenaSeats < 1 || cfg.arenaSeats > 255 || cfg.tickMs < 1 ||
+        (uint64_t)cfg.tickMs * 1000 >= WHEEL_RES_US * (WHEEL_SLOTS - 1) || cfg.statsSeconds < 1 || cfg.shards > 256) {
+        printf("invalid settings\n");
+        return 1;
+    }
+
+    NetSocket lobbySock = netOpenUdp(cfg.ip, (uint16_t)cfg.port, 8 << 20);
+    if (lobbySock == NET_INVALID_SOCKET) {
+        printf("cannot bind %s:%d\n", cfg.ip, cfg.port);
+        return 1;
+    }
+    std::unique_ptr<MatchRecorder> recorder;
+    if (cfg.recordDir) {
+        recorder = std::make_unique<MatchRecorder>(cfg, cfg.shards);
+        if (!recorder->open()) {
+            printf("cannot write recordings to %s\n", cfg.recordDir);
+            return 1;
+        }
+        recorder->start();
+    }
+    std::vector<std::unique_ptr<Shard>> shards;
+    MatchLobby lobby(cfg, shards);
+    for (int s = 0; s < cfg.shards; s++) {
+        shards.push_back(std::make_unique<Shard>(s, cfg, &lobby, recorder.get()));
+        if (!shards.back()->open(s == 0 ? lobbySock : NET_INVALID_SOCKET)) {
+            printf("cannot set up shard %d\n", s);
+            return 1;
+        }
+    }
+    for (auto& s : shards) s->start();
+    printf("lobby on %s:%d, %d shards, %d ms ticks (solo %dx%d, arena %dx%d with %d seats)\n", cfg.ip, cfg.port, cfg.shards,
+        cfg.tickMs, cfg.width, cfg.height, cfg.arenaWidth, cfg.arenaHeight, cfg.arenaSeats);
+    printf("recording to %s\n", cfg.recordDir ? cfg.recordDir : "nowhere (--no-record)");
+    fflush(stdout);
+
+    NetSocket console = netOpenUdp("127.0.0.1", 0);
+    NetAddr lobbyAddr = netAddr(cfg.ip, (uint16_t)cfg.port);
+    MatchReport previous;
+    uint64_t previousAt = monoMicros(), start = previousAt;
+    for (uint32_t request = 1;; request++) {
+        std::this_thread::sleep_for(std::chrono::seconds(cfg.statsSeconds));
+        uint8_t q[5] = { NET_STATS };
+        netPut32(q + 1, request);
+        netSend(console, lobbyAddr, q, 5);
+        uint8_t buf[NET_MAX_PACKET];
+        NetAddr from;
+        uint32_t got = 0;
+        MatchReport r;
+        while (got != request && netWait(console, 1000)) {
+            int n = netRecv(console, from, buf, sizeof(buf));
+            if (n > 0) matchReadReport(buf, n, got, r);
+        }
+        uint64_t now = monoMicros();
+        if (got == request) {
+            printReport(r.since(previous), (now - previousAt) * 1e-6, cfg.tickMs);
+            previous = r;
+            previousAt = now;
+        }
+        if (cfg.seconds > 0 && now - start >= (uint64_t)cfg.seconds * 1000000) break;
+    }
+    for (auto& s : shards) {
+        s->stop.store(true);
+        s->wake();
+    }
+    for (auto& s : shards) s->join();
+    if (recorder) {
+        recorder->finish();
+        printf("recordings: %.1f MB written to %s\n", recorder->written.load() / 1048576.0, cfg.recordDir);
+    }
+    netClose(console);
+    netClose(lobbySock);
+    return 0;
+}
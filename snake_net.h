@@ -0,0 +1,587 @@
+// snake_net.h
+// Networked play over UDP: socket helpers, a bit packer, and both ends of the snapshot
+// protocol. The server owns the game (NetSession) and sends every client a snapshot per
+// tick, encoded against the newest tick that client has acknowledged: the heads added,
+// how far the tail moved, and which fruit went and came. A keyframe (the whole board) is
+// only sent when there is no acknowledged tick to build on - at the start, after a reset,
+// or when losses outlast the history window. The client (NetReplica) keeps the same
+// history, so any acknowledged tick can serve as the base.
+//
+// Both sides index body cells by their serial (one per head, as in SnakeSim), so a state
+// is just (head serial, tail serial, fruit) plus a log of cells by serial.
+
+#pragma once
+
+#include "snake_sim.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET NetSocket;
+static const NetSocket NET_INVALID_SOCKET = INVALID_SOCKET;
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int NetSocket;
+static const NetSocket NET_INVALID_SOCKET = -1;
+#endif
+
+//
+// Sockets (IPv4 UDP, non-blocking)
+//
+struct NetAddr {
+    sockaddr_in sa{};
+
+    bool operator==(const NetAddr& o) const { return sa.sin_addr.s_addr == o.sa.sin_addr.s_addr && sa.sin_port == o.sa.sin_port; }
+    uint64_t key() const { return (uint64_t)sa.sin_addr.s_addr << 16 | sa.sin_port; }
+};
+
+static inline bool netInit() {
+#if defined(_WIN32)
+    WSADATA wsa;
+    return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+#else
+    return true;
+#endif
+}
+
+static inline NetAddr netAddr(const char* ip, uint16_t port) {
+    NetAddr a;
+    a.sa.sin_family = AF_INET;
+    a.sa.sin_port = htons(port);
+    inet_pton(AF_INET, ip, &a.sa.sin_addr);
+    return a;
+}
+
+static inline void netClose(NetSocket s) {
+#if defined(_WIN32)
+    closesocket(s);
+#else
+    close(s);
+#endif
+}
+
+// Bound to ip:port (port 0 = any free port); NET_INVALID_SOCKET on failure
+static inline NetSocket netOpenUdp(const char* ip, uint16_t port, int bufferBytes = 1 << 20) {
+    NetSocket s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s == NET_INVALID_SOCKET) return s;
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferBytes, sizeof(bufferBytes));
+    setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char*)&bufferBytes, sizeof(bufferBytes));
+#if defined(_WIN32)
+    u_long nb = 1;
+    ioctlsocket(s, FIONBIO, &nb);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    NetAddr a = netAddr(ip, port);
+    if (bind(s, (const sockaddr*)&a.sa, sizeof(a.sa)) != 0) {
+        netClose(s);
+        return NET_INVALID_SOCKET;
+    }
+    return s;
+}
+
+static inline uint16_t netLocalPort(NetSocket s) {
+    sockaddr_in a{};
+    socklen_t len = sizeof(a);
+    getsockname(s, (sockaddr*)&a, &len);
+    return ntohs(a.sin_port);
+}
+
+static inline int netSend(NetSocket s, const NetAddr& to, const void* data, int bytes) {
+    return (int)sendto(s, (const char*)data, bytes, 0, (const sockaddr*)&to.sa, sizeof(to.sa));
+}
+
+// The same payload to many addresses. On Linux it is one sendmmsg per batch, with every
+// message pointing at the payload through one shared iovec: nothing is copied per receiver
+// in user space. Returns the number of datagrams sent.
+static inline int netSendMany(NetSocket s, const NetAddr* to, int count, const void* data, int bytes) {
+#if defined(__linux__)
+    static constexpr int BATCH = 256;
+    mmsghdr msgs[BATCH];
+    iovec iov{ const_cast<void*>(data), (size_t)bytes };
+    int sent = 0;
+    for (int first = 0; first < count; first += BATCH) {
+        int n = (std::min)(BATCH, count - first);
+        for (int i = 0; i < n; i++) {
+            msgs[i].msg_hdr = msghdr{};
+            msgs[i].msg_hdr.msg_name = const_cast<sockaddr_in*>(&to[first + i].sa);
+            msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            msgs[i].msg_hdr.msg_iov = &iov;
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        for (int done = 0; done < n;) {
+            int r = sendmmsg(s, msgs + done, (unsigned)(n - done), 0);
+            if (r <= 0) break; // socket buffer full: the rest of the batch is dropped, like loss
+            done += r;
+            sent += r;
+        }
+    }
+    return sent;
+#else
+    int sent = 0;
+    for (int i = 0; i < count; i++) sent += netSend(s, to[i], data, bytes) == bytes;
+    return sent;
+#endif
+}
+
+// Bytes received, or -1 when nothing is waiting
+static inline int netRecv(NetSocket s, NetAddr& from, void* data, int cap) {
+    socklen_t len = sizeof(from.sa);
+    int n = (int)recvfrom(s, (char*)data, cap, 0, (sockaddr*)&from.sa, &len);
+    return n < 0 ? -1 : n;
+}
+
+// Wait up to timeoutMs for the socket to become readable
+static inline bool netWait(NetSocket s, int timeoutMs) {
+#if defined(_WIN32)
+    WSAPOLLFD p{ s, POLLRDNORM, 0 };
+    return WSAPoll(&p, 1, timeoutMs) > 0;
+#else
+    pollfd p{ s, POLLIN, 0 };
+    return poll(&p, 1, timeoutMs) > 0;
+#endif
+}
+
+//
+// Bit packing, least significant bit first. Small counts use order-0 exp-Golomb codes.
+//
+struct NetBitWriter {
+    uint8_t* buf;
+    size_t cap;
+    size_t bytes = 0;
+    uint64_t acc = 0;
+    int bits = 0;
+    bool overflow = false;
+
+    NetBitWriter(uint8_t* buf, size_t cap) : buf(buf), cap(cap) {}
+
+    void put(uint32_t v, int n) {
+        if (n == 0) return;
+        acc |= (uint64_t)(v & (uint32_t)((1ull << n) - 1)) << bits;
+        bits += n;
+        while (bits >= 8) {
+            if (bytes < cap) buf[bytes] = (uint8_t)acc;
+            else overflow = true;
+            bytes++;
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+
+    void putVar(uint32_t v) {
+        uint64_t x = (uint64_t)v + 1;
+        int n = 0;
+        while ((x >> n) > 1) n++;
+        put(0, n);
+        put(1, 1);
+        put((uint32_t)x, n); // the n bits below the leading one (n <= 32)
+    }
+
+    // Flushes the last partial byte; returns the size, or 0 if the buffer overflowed
+    size_t finish() {
+        if (bits > 0) put(0, 8 - bits);
+        return overflow ? 0 : bytes;
+    }
+};
+
+struct NetBitReader {
+    const uint8_t* buf;
+    size_t size;
+    size_t pos = 0;
+    uint64_t acc = 0;
+    int bits = 0;
+    bool ok = true;
+
+    NetBitReader(const uint8_t* buf, size_t size) : buf(buf), size(size) {}
+
+    uint32_t get(int n) {
+        if (n == 0) return 0;
+        while (bits < n) {
+            if (pos >= size) {
+                ok = false;
+                return 0;
+            }
+            acc |= (uint64_t)buf[pos++] << bits;
+            bits += 8;
+        }
+        uint32_t v = (uint32_t)(acc & ((1ull << n) - 1));
+        acc >>= n;
+        bits -= n;
+        return v;
+    }
+
+    uint32_t getVar() {
+        int n = 0;
+        while (ok && get(1) == 0) {
+            if (++n > 32) {
+                ok = false;
+                return 0;
+            }
+        }
+        uint64_t x = (1ull << n) | get(n);
+        return (uint32_t)(x - 1);
+    }
+};
+
+static inline void netPut16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static inline void netPut32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (i * 8)); }
+static inline uint16_t netGet16(const uint8_t* p) { return (uint16_t)(p[0] | p[1] << 8); }
+static inline uint32_t netGet32(const uint8_t* p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+static inline void netPut64(uint8_t* p, uint64_t v) { netPut32(p, (uint32_t)v); netPut32(p + 4, (uint32_t)(v >> 32)); }
+static inline uint64_t netGet64(const uint8_t* p) { return (uint64_t)netGet32(p) | (uint64_t)netGet32(p + 4) << 32; }
+
+//
+// Protocol
+//   HELLO     c->s  type, magic u32, nonce u32 [, mode u8: 0 solo, 1 arena (match server)]
+//   WELCOME   s->c  type, token u32, nonce u32, width u16, height u16, fruits u8, tickMs u16
+//   INPUT     c->s  type, token u32, ackTick u32, newestSeq u16, count u8, count dirs (2 bits, newest first)
+//   SNAPSHOT  s->c  type, tick u32, baseAge u8 (0 = keyframe), check u16, inputAck u16, bit-packed body
+//   BYE       c->s  type, token u32
+//   ARENA     s->c  type, tick u32, seat u8, bit-packed board (match server, see snake_match.h)
+//   STATS     both  type, request u32 [, report] (match server, see snake_match.h)
+//   WATCH     c->s  type, matchId u32 (0 = the longest-running match), resync u8; sent every
+//                   second to keep watching; SNAPSHOTs follow (see snake_spectate.h)
+// WELCOME comes from the address that serves the game; later packets go there.
+// Inputs are resent until a snapshot acknowledges them, so a lost INPUT costs nothing.
+//
+enum NetMsg : uint8_t { NET_HELLO = 1, NET_WELCOME, NET_INPUT, NET_SNAPSHOT, NET_BYE, NET_ARENA, NET_STATS, NET_WATCH };
+
+static constexpr uint32_t NET_MAGIC = 0x314B4E53; // "SNK1"
+static constexpr int NET_MAX_PACKET = 1200;
+static constexpr int NET_MAX_SIDE = 64;           // keeps a full keyframe inside one datagram
+static constexpr int NET_HISTORY = 32;            // ticks either side can use as a delta base
+static constexpr int NET_INPUT_REDUNDANCY = 8;    // inputs repeated in every INPUT
+static constexpr int NET_SNAPSHOT_HEADER = 10;
+
+enum : uint8_t { NET_FLAG_OVER = 1, NET_FLAG_WON = 2 };
+
+// What a snapshot conveys about one tick
+struct NetFrame {
+    uint32_t tick = 0; // 0 = unused slot
+    uint16_t episode = 0;
+    uint32_t headSerial = 0;
+    uint32_t tailSerial = 0;
+    uint32_t headCell = 0;
+    uint32_t score = 0;
+    uint8_t dir = 0;
+    uint8_t flags = 0;
+    uint8_t foodCount = 0;
+    uint32_t food[SIM_MAX_FOOD];
+    uint32_t bodyHash = 0; // every segment, so the check covers what deltas rebuild
+
+    uint32_t length() const { return headSerial - tailSerial + 1; }
+
+    // Both ends compute this and the client checks it against the snapshot
+    uint16_t check() const {
+        uint32_t h = 2166136261u;
+        auto mix = [&](uint32_t v) { h = (h ^ v) * 16777619u; };
+        mix(headCell);
+        mix(length());
+        mix(bodyHash);
+        mix(score | (uint32_t)dir << 24 | (uint32_t)flags << 28);
+        for (int i = 0; i < foodCount; i++) mix(food[i]);
+        return (uint16_t)(h ^ (h >> 16));
+    }
+};
+
+// FNV-1a over segment(0) .. segment(length - 1)
+template <typename Segment>
+static inline uint32_t netBodyHash(uint32_t length, Segment segment) {
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < length; i++) h = (h ^ segment(i)) * 16777619u;
+    return h;
+}
+
+static inline int netCellBits(int cells) {
+    int b = 1;
+    while ((1 << b) < cells) b++;
+    return b;
+}
+
+// Step from cell a to the adjacent cell b as a SimDir
+static inline uint32_t netStepDir(uint32_t a, uint32_t b, int w) {
+    if (b + (uint32_t)w == a) return SIM_UP;
+    if (b == a + (uint32_t)w) return SIM_DOWN;
+    return b + 1 == a ? SIM_LEFT : SIM_RIGHT;
+}
+
+static inline uint32_t netApplyDir(uint32_t c, uint32_t d, int w) {
+    switch (d) {
+    case SIM_UP:    return c - (uint32_t)w;
+    case SIM_DOWN:  return c + (uint32_t)w;
+    case SIM_LEFT:  return c - 1;
+    default:        return c + 1;
+    }
+}
+
+//
+// Server side of one client: the authoritative game, its recent frames, and queued input
+//
+struct NetSession {
+    NetAddr addr;
+    uint32_t token = 0;
+    uint32_t matchId = 0;        // public handle, for spectators
+    uint16_t episode = 0;
+    uint32_t ackTick = 0;        // newest tick the client has confirmed
+    uint16_t inputSeq = 0;       // newest input taken from the client
+    uint8_t inputQueue[NET_INPUT_REDUNDANCY];
+    int inputCount = 0;
+    uint32_t overSince = 0;      // tick the game ended, for the automatic restart
+    std::chrono::steady_clock::time_point lastHeard;
+    SnakeSim game;
+    std::vector<uint32_t> storage;
+    NetFrame frames[NET_HISTORY];
+
+    // New episode; the next snapshot is a keyframe since no acknowledged tick belongs to it
+    void start(int w, int h, int fruits, uint64_t seed) {
+        if (storage.empty()) {
+            storage.assign(SnakeSim::storageWords(w * h), 0);
+            game.bind(storage.data(), w * h);
+        }
+        game.reset(w, h, fruits, seed);
+        episode++;
+        inputCount = 0;
+        overSince = 0;
+    }
+
+    NetFrame& frameAt(uint32_t tick) { return frames[tick % NET_HISTORY]; }
+
+    // Takes the inputs this INPUT carries that are newer than any seen; the oldest first
+    void receiveInput(uint16_t newest, int count, const uint8_t* dirsNewestFirst) {
+        int fresh = (int16_t)(newest - inputSeq);
+        if (fresh <= 0) return;
+        if (fresh > count) fresh = count; // older ones are lost for good
+        for (int k = fresh - 1; k >= 0; k--) {
+            if (inputCount == NET_INPUT_REDUNDANCY) {
+                std::memmove(inputQueue, inputQueue + 1, NET_INPUT_REDUNDANCY - 1);
+                inputCount--;
+            }
+            inputQueue[inputCount++] = dirsNewestFirst[k];
+        }
+        inputSeq = newest;
+    }
+
+    // One queued turn per tick, like key presses between game ticks
+    int nextAction() {
+        if (inputCount == 0) return -1;
+        int a = inputQueue[0];
+        std::memmove(inputQueue, inputQueue + 1, (size_t)--inputCount);
+        return a;
+    }
+
+    void record(uint32_t tick) {
+        NetFrame& f = frameAt(tick);
+        f.tick = tick;
+        f.episode = episode;
+        f.headSerial = game.headSerial;
+        f.tailSerial = game.tailSerial;
+        f.headCell = game.head();
+        f.score = (uint32_t)game.score;
+        f.dir = game.dir;
+        f.flags = (game.gameOver ? NET_FLAG_OVER : 0) | (game.gameWon ? NET_FLAG_WON : 0);
+        f.foodCount = (uint8_t)game.foodCount;
+        std::memcpy(f.food, game.food, sizeof(uint32_t) * (size_t)game.foodCount);
+        f.bodyHash = netBodyHash(f.length(), [this](uint32_t i) { return game.segment(i); });
+    }
+
+    // Snapshot of tick against the client's acknowledged tick when that is still in the
+    // history, else a keyframe. Returns the packet size (0 if it would not fit).
+    int writeSnapshot(uint32_t tick, uint8_t* out, bool* keyframe = nullptr) {
+        return encodeSnapshot(tick, ackTick, out, keyframe);
+    }
+
+    // Snapshot of tick against baseTick (0 = keyframe); falls back to a keyframe when the
+    // base has left the history or belongs to another episode
+    int encodeSnapshot(uint32_t tick, uint32_t baseTick, uint8_t* out, bool* keyframe = nullptr) {
+        const NetFrame& cur = frameAt(tick);
+        const NetFrame* base = nullptr;
+        if (baseTick != 0 && tick - baseTick < NET_HISTORY) {
+            const NetFrame& b = frameAt(baseTick);
+            if (b.tick == baseTick && b.episode == cur.episode && b.headSerial <= cur.headSerial) base = &b;
+        }
+        if (keyframe) *keyframe = base == nullptr;
+
+        out[0] = NET_SNAPSHOT;
+        netPut32(out + 1, tick);
+        out[5] = (uint8_t)(base ? tick - base->tick : 0);
+        netPut16(out + 6, cur.check());
+        netPut16(out + 8, inputSeq);
+
+        NetBitWriter bw(out + NET_SNAPSHOT_HEADER, NET_MAX_PACKET - NET_SNAPSHOT_HEADER);
+        int cellBits = netCellBits(game.cells);
+        bw.put(cur.flags, 2);
+        bw.put(cur.dir, 2);
+        if (base) {
+            // Heads since the base; if the tail has passed the base's head, start absolute
+            uint32_t first = cur.headSerial - base->headSerial > cur.length() ? cur.tailSerial : base->headSerial + 1;
+            uint32_t gap = first - (base->headSerial + 1);
+            bw.putVar(cur.headSerial + 1 - first);
+            bw.putVar(gap);
+            uint32_t prev = base->headCell;
+            for (uint32_t s = first; s <= cur.headSerial; s++) {
+                uint32_t c = game.segment(cur.headSerial - s);
+                if (s == first && gap != 0) bw.put(c, cellBits);
+                else bw.put(netStepDir(prev, c, game.w), 2);
+                prev = c;
+            }
+            bw.putVar(cur.tailSerial - base->tailSerial);
+            bw.putVar((cur.score - base->score) / 10);
+
+            // Fruit: one bit per base fruit (gone or kept), then the new ones
+            int added = 0;
+            uint32_t addedCells[SIM_MAX_FOOD];
+            for (int i = 0; i < base->foodCount; i++) {
+                bool kept = false;
+                for (int j = 0; j < cur.foodCount; j++) kept = kept || cur.food[j] == base->food[i];
+                bw.put(kept ? 0 : 1, 1);
+            }
+            for (int j = 0; j < cur.foodCount; j++) {
+                bool old = false;
+                for (int i = 0; i < base->foodCount; i++) old = old || base->food[i] == cur.food[j];
+                if (!old) addedCells[added++] = cur.food[j];
+            }
+            bw.putVar((uint32_t)added);
+            for (int i = 0; i < added; i++) bw.put(addedCells[i], cellBits);
+        }
+        else {
+            bw.put(cur.episode, 16);
+            bw.put(cur.headSerial, 32);
+            bw.putVar(cur.length() - 1);
+            bw.putVar(cur.score / 10);
+            bw.put(cur.headCell, cellBits);
+            for (uint32_t i = 1; i < cur.length(); i++) bw.put(netStepDir(game.segment(i - 1), game.segment(i), game.w), 2);
+            bw.putVar(cur.foodCount);
+            for (int i = 0; i < cur.foodCount; i++) bw.put(cur.food[i], cellBits);
+        }
+        size_t body = bw.finish();
+        return body ? NET_SNAPSHOT_HEADER + (int)body : 0;
+    }
+};
+
+//
+// Client side: rebuilds the server's frames from snapshots
+//
+class NetReplica {
+public:
+    int w = 0, h = 0;
+    NetFrame latest;     // newest frame applied (tick 0 = none yet)
+    uint16_t inputAck = 0;
+    uint32_t keyframes = 0, deltas = 0, rejected = 0, checkFailures = 0;
+
+    void configure(int width, int height) {
+        w = width;
+        h = height;
+        uint32_t cap = 1;
+        while (cap < (uint32_t)(w * h + 4 * NET_HISTORY)) cap <<= 1;
+        log.assign(cap, 0);
+        logMask = cap - 1;
+        for (NetFrame& f : frames) f.tick = 0;
+        latest = NetFrame{};
+    }
+
+    // Body segment i counted from the head, of the newest frame
+    uint32_t segment(uint32_t i) const { return log[(latest.headSerial - i) & logMask]; }
+
+    // Applies one SNAPSHOT; false if it is stale, refers to a base we no longer have, or is malformed
+    bool apply(const uint8_t* p, int n) {
+        if (n < NET_SNAPSHOT_HEADER || p[0] != NET_SNAPSHOT) return false;
+        uint32_t tick = netGet32(p + 1);
+        uint32_t baseAge = p[5];
+        uint16_t check = netGet16(p + 6);
+        if (latest.tick != 0 && (int32_t)(tick - latest.tick) <= 0) return false; // old or repeated
+
+        NetBitReader br(p + NET_SNAPSHOT_HEADER, (size_t)(n - NET_SNAPSHOT_HEADER));
+        int cellBits = netCellBits(w * h);
+        NetFrame f;
+        f.tick = tick;
+        f.flags = (uint8_t)br.get(2);
+        f.dir = (uint8_t)br.get(2);
+        if (baseAge != 0) {
+            const NetFrame& base = frames[(tick - baseAge) % NET_HISTORY];
+            if (base.tick != tick - baseAge) {
+                rejected++;
+                return false;
+            }
+            f.episode = base.episode;
+            uint32_t heads = br.getVar();
+            uint32_t gap = br.getVar();
+            uint32_t first = base.headSerial + 1 + gap;
+            uint32_t prev = base.headCell;
+            for (uint32_t k = 0; k < heads && br.ok; k++) {
+                uint32_t c = (k == 0 && gap != 0) ? br.get(cellBits) : netApplyDir(prev, br.get(2), w);
+                log[(first + k) & logMask] = c;
+                prev = c;
+            }
+            f.headSerial = first + heads - 1;
+            f.headCell = prev;
+            f.tailSerial = base.tailSerial + br.getVar();
+            f.score = base.score + br.getVar() * 10;
+            for (int i = 0; i < base.foodCount; i++) {
+                if (br.get(1) == 0) f.food[f.foodCount++] = base.food[i];
+            }
+            uint32_t added = br.getVar();
+            for (uint32_t i = 0; i < added && f.foodCount < SIM_MAX_FOOD && br.ok; i++) f.food[f.foodCount++] = br.get(cellBits);
+        }
+        else {
+            f.episode = (uint16_t)br.get(16);
+            f.headSerial = br.get(32);
+            uint32_t len = br.getVar() + 1;
+            if (len > (uint32_t)(w * h)) return malformed();
+            f.tailSerial = f.headSerial - len + 1;
+            f.score = br.getVar() * 10;
+            f.headCell = br.get(cellBits);
+            uint32_t c = f.headCell;
+            log[f.headSerial & logMask] = c;
+            for (uint32_t i = 1; i < len && br.ok; i++) {
+                c = netApplyDir(c, br.get(2), w);
+                log[(f.headSerial - i) & logMask] = c;
+            }
+            uint32_t count = br.getVar();
+            if (count > SIM_MAX_FOOD) return malformed();
+            for (uint32_t i = 0; i < count; i++) f.food[f.foodCount++] = br.get(cellBits);
+        }
+        if (!br.ok || f.length() == 0 || f.length() > (uint32_t)(w * h)) return malformed();
+        f.bodyHash = netBodyHash(f.length(), [&](uint32_t i) { return log[(f.headSerial - i) & logMask]; });
+
+        frames[tick % NET_HISTORY] = f;
+        latest = f;
+        inputAck = netGet16(p + 8);
+        if (baseAge) deltas++;
+        else keyframes++;
+        if (f.check() != check) {
+            // Should never happen; forget every base so the server falls back to a keyframe
+            checkFailures++;
+            for (NetFrame& fr : frames) fr.tick = 0;
+            latest.tick = 0;
+            return false;
+        }
+        return true;
+    }
+
+    // Tick to acknowledge in the next INPUT (0 = please send a keyframe)
+    uint32_t ackTick() const { return latest.tick; }
+
+private:
+    bool malformed() {
+        rejected++;
+        return false;
+    }
+
+    std::vector<uint32_t> log; // cell by serial
+    uint32_t logMask = 0;
+    NetFrame frames[NET_HISTORY];
+};
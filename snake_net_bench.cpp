@@ -0,0 +1,304 @@
+// snake_net_bench.cpp
+// Loopback load test for snake_server: N bot clients, each on its own UDP socket, playing
+// from their replicas, optionally through a proxy that drops packets both ways. Reports
+// what the clients saw: bytes per tick, keyframe share and check failures (must be 0).
+// Compile: g++ snake_net_bench.cpp -std=c++20 -O2 -pthread -o snake_net_bench
+// Run:     ./snake_server --port 7777 &
+//          ./snake_net_bench --port 7777 --clients 1000 --seconds 20 [--loss 0.05]
+
+#include "snake_net.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/resource.h>
+
+//
+// Config
+//
+struct NetBenchConfig {
+    const char* ip = "127.0.0.1";
+    int port = 7777;
+    int clients = 100;
+    int seconds = 10;
+    double loss = 0.0; // drop probability per packet and direction, via the proxy
+    uint64_t seed = 1;
+};
+
+static NetBenchConfig parseArgs(int argc, char** argv) {
+    NetBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--ip") && i + 1 < argc) cfg.ip = argv[++i];
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) cfg.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--clients") && i + 1 < argc) cfg.clients = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) cfg.seconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--loss") && i + 1 < argc) cfg.loss = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.seed = strtoull(argv[++i], nullptr, 10);
+    }
+    return cfg;
+}
+
+using BenchClock = std::chrono::steady_clock;
+
+//
+// Loss proxy: clients talk to it, and it forwards each client's traffic from its own
+// upstream socket so the server still sees one address per client
+//
+class LossProxy {
+public:
+    LossProxy(const NetAddr& server, double loss, uint64_t seed) : server(server), loss(loss) { rng.state = seed; }
+
+    ~LossProxy() {
+        stop.store(true);
+        if (worker.joinable()) worker.join();
+        for (auto& kv : links) netClose(kv.second.upstream);
+        if (front != NET_INVALID_SOCKET) netClose(front);
+    }
+
+    // Port the clients should use, 0 on failure
+    uint16_t start() {
+        front = netOpenUdp("127.0.0.1", 0, 8 << 20);
+        if (front == NET_INVALID_SOCKET) return 0;
+        worker = std::thread([this] { run(); });
+        return netLocalPort(front);
+    }
+
+    std::atomic<uint64_t> forwarded{ 0 }, dropped{ 0 };
+
+private:
+    struct Link {
+        NetAddr client;
+        NetSocket upstream;
+    };
+
+    NetAddr server;
+    double loss;
+    SimRng rng;
+    NetSocket front = NET_INVALID_SOCKET;
+    std::unordered_map<uint64_t, Link> links; // by client address
+    std::vector<pollfd> fds;                  // front, then one per link
+    std::vector<uint64_t> fdClient;
+    std::atomic<bool> stop{ false };
+    std::thread worker;
+
+    bool drop() {
+        bool d = rng.below(1u << 24) < (uint32_t)(loss * (1u << 24));
+        (d ? dropped : forwarded).fetch_add(1, std::memory_order_relaxed);
+        return d;
+    }
+
+    void run() {
+        fds.push_back(pollfd{ front, POLLIN, 0 });
+        fdClient.push_back(0);
+        uint8_t buf[NET_MAX_PACKET];
+        NetAddr from;
+        while (!stop.load()) {
+            if (poll(fds.data(), fds.size(), 20) <= 0) continue;
+            int n;
+            while ((n = netRecv(front, from, buf, sizeof(buf))) > 0) {
+                auto it = links.find(from.key());
+                if (it == links.end()) {
+                    NetSocket up = netOpenUdp("127.0.0.1", 0);
+                    if (up == NET_INVALID_SOCKET) continue;
+                    it = links.emplace(from.key(), Link{ from, up }).first;
+                    fds.push_back(pollfd{ up, POLLIN, 0 });
+                    fdClient.push_back(from.key());
+                }
+                if (!drop()) netSend(it->second.upstream, server, buf, n);
+            }
+            for (size_t i = 1; i < fds.size(); i++) {
+                if (!(fds[i].revents & POLLIN)) continue;
+                const Link& link = links[fdClient[i]];
+                while ((n = netRecv(link.upstream, from, buf, sizeof(buf))) > 0) {
+                    if (!drop()) netSend(front, link.client, buf, n);
+                }
+            }
+        }
+    }
+};
+
+//
+// One bot client
+//
+struct BenchClient {
+    NetSocket sock = NET_INVALID_SOCKET;
+    uint32_t nonce = 0;
+    uint32_t token = 0; // 0 until WELCOME
+    NetReplica replica;
+    uint16_t inputSeq = 0;
+    uint8_t inputs[NET_INPUT_REDUNDANCY]; // by seq % NET_INPUT_REDUNDANCY
+    BenchClock::time_point lastSent;
+    std::vector<uint8_t> occupied;
+    uint64_t bytesIn = 0, packetsIn = 0;
+    uint32_t firstTick = 0;
+};
+
+// Toward the first fruit, avoiding walls and the body where it can
+static uint8_t botDirection(BenchClient& c, SimRng& rng) {
+    const NetReplica& r = c.replica;
+    const NetFrame& f = r.latest;
+    c.occupied.assign((size_t)(r.w * r.h), 0);
+    for (uint32_t i = 0; i < f.length(); i++) c.occupied[r.segment(i)] = 1;
+
+    int hx = (int)(f.headCell % (uint32_t)r.w), hy = (int)(f.headCell / (uint32_t)r.w);
+    int fx = f.foodCount ? (int)(f.food[0] % (uint32_t)r.w) : hx;
+    int fy = f.foodCount ? (int)(f.food[0] / (uint32_t)r.w) : hy;
+    static const int dx[4] = { 0, 0, -1, 1 }, dy[4] = { -1, 1, 0, 0 };
+    int best = f.dir, bestScore = -1000000;
+    for (int d = 0; d < 4; d++) {
+        if (d == simOpposite((SimDir)f.dir)) continue;
+        int x = hx + dx[d], y = hy + dy[d];
+        int score = (int)rng.below(3);
+        if (x < 0 || y < 0 || x >= r.w || y >= r.h || c.occupied[(size_t)(y * r.w + x)]) score -= 100000;
+        score -= 10 * (abs(fx - x) + abs(fy - y));
+        if (score > bestScore) {
+            bestScore = score;
+            best = d;
+        }
+    }
+    return (uint8_t)best;
+}
+
+static void sendHello(BenchClient& c, const NetAddr& to) {
+    uint8_t out[9];
+    out[0] = NET_HELLO;
+    netPut32(out + 1, NET_MAGIC);
+    netPut32(out + 5, c.nonce);
+    netSend(c.sock, to, out, 9);
+    c.lastSent = BenchClock::now();
+}
+
+// Ack plus every input the server has not acknowledged yet, newest first
+static void sendInput(BenchClient& c, const NetAddr& to) {
+    uint8_t out[12 + NET_INPUT_REDUNDANCY];
+    int pending = (int16_t)(c.inputSeq - c.replica.inputAck);
+    int count = pending < 0 ? 0 : pending > NET_INPUT_REDUNDANCY ? NET_INPUT_REDUNDANCY : pending;
+    out[0] = NET_INPUT;
+    netPut32(out + 1, c.token);
+    netPut32(out + 5, c.replica.ackTick());
+    netPut16(out + 9, c.inputSeq);
+    out[11] = (uint8_t)count;
+    NetBitWriter bw(out + 12, NET_INPUT_REDUNDANCY);
+    for (int k = 0; k < count; k++) bw.put(c.inputs[(uint16_t)(c.inputSeq - k) % NET_INPUT_REDUNDANCY], 2);
+    netSend(c.sock, to, out, 12 + (int)bw.finish());
+    c.lastSent = BenchClock::now();
+}
+
+int main(int argc, char** argv) {
+    NetBenchConfig cfg = parseArgs(argc, argv);
+    if (cfg.clients < 1 || cfg.seconds < 1 || cfg.loss < 0.0 || cfg.loss >= 1.0) {
+        printf("invalid settings\n");
+        return 1;
+    }
+    // Two sockets per client with the proxy
+    rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    NetAddr server = netAddr(cfg.ip, (uint16_t)cfg.port);
+    NetAddr target = server;
+    std::unique_ptr<LossProxy> proxy;
+    if (cfg.loss > 0.0) {
+        proxy = std::make_unique<LossProxy>(server, cfg.loss, cfg.seed ^ 0x50524F5859);
+        uint16_t port = proxy->start();
+        if (!port) {
+            printf("cannot start the proxy\n");
+            return 1;
+        }
+        target = netAddr("127.0.0.1", port);
+    }
+
+    SimRng rng;
+    rng.state = cfg.seed;
+    std::vector<BenchClient> clients((size_t)cfg.clients);
+    std::vector<pollfd> fds;
+    for (BenchClient& c : clients) {
+        c.sock = netOpenUdp("127.0.0.1", 0, 256 << 10);
+        if (c.sock == NET_INVALID_SOCKET) {
+            printf("cannot open %d sockets\n", cfg.clients);
+            return 1;
+        }
+        c.nonce = (uint32_t)rng.next();
+        sendHello(c, target);
+        fds.push_back(pollfd{ c.sock, POLLIN, 0 });
+    }
+
+    auto start = BenchClock::now();
+    auto end = start + std::chrono::seconds(cfg.seconds);
+    uint8_t buf[NET_MAX_PACKET];
+    NetAddr from;
+    while (BenchClock::now() < end) {
+        poll(fds.data(), fds.size(), 10);
+        auto now = BenchClock::now();
+        for (size_t i = 0; i < clients.size(); i++) {
+            BenchClient& c = clients[i];
+            if (fds[i].revents & POLLIN) {
+                int n;
+                while ((n = netRecv(c.sock, from, buf, sizeof(buf))) > 0) {
+                    if (buf[0] == NET_WELCOME && n >= 16 && netGet32(buf + 5) == c.nonce && c.token == 0) {
+                        c.token = netGet32(buf + 1);
+                        c.replica.configure(netGet16(buf + 9), netGet16(buf + 11));
+                    }
+                    else if (buf[0] == NET_SNAPSHOT && c.token != 0) {
+                        c.bytesIn += (uint64_t)n;
+                        c.packetsIn++;
+                        if (c.firstTick == 0) c.firstTick = netGet32(buf + 1);
+                        if (!c.replica.apply(buf, n)) continue;
+                        if (c.replica.latest.flags == 0) {
+                            c.inputSeq++;
+                            c.inputs[c.inputSeq % NET_INPUT_REDUNDANCY] = botDirection(c, rng);
+                        }
+                        sendInput(c, target);
+                    }
+                }
+            }
+            // Lost HELLO, or a keyframe request (ack 0) that went missing along with everything after it
+            if (now - c.lastSent > std::chrono::milliseconds(500)) {
+                if (c.token == 0) sendHello(c, target);
+                else sendInput(c, target);
+            }
+        }
+    }
+
+    uint64_t bytes = 0, packets = 0, keyframes = 0, deltas = 0, rejected = 0, failures = 0, ticksSpanned = 0;
+    int connected = 0;
+    for (BenchClient& c : clients) {
+        uint8_t out[5];
+        out[0] = NET_BYE;
+        netPut32(out + 1, c.token);
+        if (c.token) netSend(c.sock, target, out, 5);
+        connected += c.token != 0;
+        bytes += c.bytesIn;
+        packets += c.packetsIn;
+        keyframes += c.replica.keyframes;
+        deltas += c.replica.deltas;
+        rejected += c.replica.rejected;
+        failures += c.replica.checkFailures;
+        if (c.firstTick && c.replica.latest.tick) ticksSpanned += c.replica.latest.tick - c.firstTick + 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    printf("%d/%d clients connected, %d s%s\n", connected, cfg.clients, cfg.seconds, proxy ? "" : ", no loss");
+    if (proxy) {
+        uint64_t dropped = proxy->dropped.load(), total = dropped + proxy->forwarded.load();
+        printf("proxy: %.2f%% of %llu packets dropped\n", 100.0 * dropped / (total + 1e-9), (unsigned long long)total);
+    }
+    printf("received %llu snapshots over %llu client-ticks (%.2f%% missing)\n", (unsigned long long)packets,
+        (unsigned long long)ticksSpanned, ticksSpanned ? 100.0 * (1.0 - (double)packets / ticksSpanned) : 0.0);
+    printf("%.1f B/client/tick payload (%.1f with UDP/IP), %.1f B per snapshot\n", ticksSpanned ? (double)bytes / ticksSpanned : 0.0,
+        ticksSpanned ? (double)(bytes + 28 * packets) / ticksSpanned : 0.0, packets ? (double)bytes / packets : 0.0);
+    printf("applied %llu deltas + %llu keyframes (%.2f%%), %llu stale or unusable, %llu check failures\n",
+        (unsigned long long)deltas, (unsigned long long)keyframes, 100.0 * keyframes / (deltas + keyframes + 1e-9),
+        (unsigned long long)rejected, (unsigned long long)failures);
+    for (BenchClient& c : clients) netClose(c.sock);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,328 @@
+// snake_obs.h
+// Observation encoders for training: full-board planes, egocentric crops turned to the
+// heading, and the 8 dihedral symmetries for augmentation. Everything writes into
+// caller-owned strided buffers (columns contiguous) and never allocates.
+
+#pragma once
+
+#include "snake_sim.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SNAKE_OBS_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#define SNAKE_OBS_SSE2 1
+#endif
+
+//
+// Output layout: element (channel, y, x) lives at data[channel * channelStride + y * rowStride + x]
+//
+struct ObsPlanes {
+    float* data;
+    ptrdiff_t channelStride;
+    ptrdiff_t rowStride;
+
+    float* row(int channel, int y) const { return data + channel * channelStride + y * rowStride; }
+};
+
+// Board planes, same order as the env's SNAKE_OBS_* channels
+enum { OBS_HEAD = 0, OBS_BODY = 1, OBS_AGE = 2, OBS_FOOD = 3, OBS_BOARD_CHANNELS = 4 };
+
+// Egocentric crop planes
+enum { CROP_BODY = 0, CROP_AGE = 1, CROP_FOOD = 2, CROP_WALL = 3, OBS_CROP_CHANNELS = 4 };
+
+static constexpr int OBS_MAX_CROP = 63;
+
+//
+// Per-cell transform shared by both encoders. From a run of grid serials it writes
+// head (serial == headSerial), body (occupied and not head) and age ((i + 1) / length for
+// segment i) and clears food; walls are passed as an all-ones mask per cell.
+//
+struct ObsCellMath {
+    uint32_t headSerial;
+    uint32_t tailSerial;
+    float invLen;
+
+    void scalar(uint32_t v, uint32_t wall, float* head, float* body, float* age, float* food) const {
+        bool occ = !wall && v >= tailSerial;
+        bool isHead = occ && v == headSerial;
+        *head = isHead ? 1.0f : 0.0f;
+        *body = (occ && !isHead) ? 1.0f : 0.0f;
+        *age = occ ? float(headSerial - v + 1) * invLen : 0.0f;
+        *food = 0.0f;
+    }
+
+    // n cells; head may be null (crops fold the head into body)
+    void run(const uint32_t* src, const uint32_t* walls, int n,
+        float* head, float* body, float* age, float* food, bool headIntoBody) const {
+        int x = 0;
+#if SNAKE_OBS_AVX2
+        {
+            const __m256i sign = _mm256_set1_epi32((int)0x80000000u);
+            const __m256i tailM1 = _mm256_xor_si256(_mm256_set1_epi32((int)(tailSerial - 1)), sign);
+            const __m256i hs = _mm256_set1_epi32((int)headSerial);
+            const __m256i hs1 = _mm256_set1_epi32((int)(headSerial + 1));
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 inv = _mm256_set1_ps(invLen);
+            for (; x + 8 <= n; x += 8) {
+                __m256i v = _mm256_loadu_si256((const __m256i*)(src + x));
+                __m256i occ = _mm256_cmpgt_epi32(_mm256_xor_si256(v, sign), tailM1);
+                if (walls) occ = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i*)(walls + x)), occ);
+                __m256i isHead = _mm256_and_si256(occ, _mm256_cmpeq_epi32(v, hs));
+                __m256i bodyM = headIntoBody ? occ : _mm256_andnot_si256(isHead, occ);
+                __m256 ageV = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(hs1, v)), inv);
+                if (head) _mm256_storeu_ps(head + x, _mm256_and_ps(_mm256_castsi256_ps(isHead), one));
+                _mm256_storeu_ps(body + x, _mm256_and_ps(_mm256_castsi256_ps(bodyM), one));
+                _mm256_storeu_ps(age + x, _mm256_and_ps(_mm256_castsi256_ps(occ), ageV));
+                _mm256_storeu_ps(food + x, _mm256_setzero_ps());
+            }
+        }
+#endif
+#if SNAKE_OBS_SSE2
+        {
+            const __m128i sign = _mm_set1_epi32((int)0x80000000u);
+            const __m128i tailM1 = _mm_xor_si128(_mm_set1_epi32((int)(tailSerial - 1)), sign);
+            const __m128i hs = _mm_set1_epi32((int)headSerial);
+            const __m128i hs1 = _mm_set1_epi32((int)(headSerial + 1));
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 inv = _mm_set1_ps(invLen);
+            for (; x + 4 <= n; x += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i*)(src + x));
+                __m128i occ = _mm_cmpgt_epi32(_mm_xor_si128(v, sign), tailM1);
+                if (walls) occ = _mm_andnot_si128(_mm_loadu_si128((const __m128i*)(walls + x)), occ);
+                __m128i isHead = _mm_and_si128(occ, _mm_cmpeq_epi32(v, hs));
+                __m128i bodyM = headIntoBody ? occ : _mm_andnot_si128(isHead, occ);
+                __m128 ageV = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(hs1, v)), inv);
+                if (head) _mm_storeu_ps(head + x, _mm_and_ps(_mm_castsi128_ps(isHead), one));
+                _mm_storeu_ps(body + x, _mm_and_ps(_mm_castsi128_ps(bodyM), one));
+                _mm_storeu_ps(age + x, _mm_and_ps(_mm_castsi128_ps(occ), ageV));
+                _mm_storeu_ps(food + x, _mm_setzero_ps());
+            }
+        }
+#endif
+        for (; x < n; x++) {
+            float h;
+            scalar(src[x], walls ? walls[x] : 0, &h, body + x, age + x, food + x);
+            if (head) head[x] = h;
+            else if (headIntoBody && h != 0.0f) body[x] = 1.0f;
+        }
+    }
+};
+
+static inline ObsCellMath obsCellMath(const SnakeSim& g) {
+    return { g.headSerial, g.tailSerial, 1.0f / float(g.length) };
+}
+
+static inline void obsClearPlanes(const ObsPlanes& out, int channels, int w, int h) {
+    if (out.rowStride == w && out.channelStride == (ptrdiff_t)w * h) {
+        std::memset(out.data, 0, sizeof(float) * (size_t)w * h * channels);
+        return;
+    }
+    for (int ch = 0; ch < channels; ch++) {
+        if (out.rowStride == w) {
+            std::memset(out.row(ch, 0), 0, sizeof(float) * (size_t)w * h);
+        }
+        else {
+            for (int y = 0; y < h; y++) std::memset(out.row(ch, y), 0, sizeof(float) * (size_t)w);
+        }
+    }
+}
+
+//
+// Full board: OBS_BOARD_CHANNELS planes of g.h rows by g.w columns.
+// Long snakes are encoded straight from the serial grid, each value written once by the
+// vector loop; short ones clear the planes and touch only the body. Pass cleared when the
+// planes are already zero, e.g. zeroed together with padding around them.
+//
+static inline void obsEncodeBoard(const SnakeSim& g, const ObsPlanes& out, bool cleared = false) {
+    if (g.length * 8 < (uint32_t)g.cells) {
+        if (!cleared) obsClearPlanes(out, OBS_BOARD_CHANNELS, g.w, g.h);
+        float invLen = 1.0f / float(g.length);
+        bool dense = out.rowStride == g.w;
+        for (uint32_t i = 0; i < g.length; i++) {
+            uint32_t c = g.segment(i);
+            ptrdiff_t at = dense ? (ptrdiff_t)c : (ptrdiff_t)(c / (uint32_t)g.w) * out.rowStride + c % (uint32_t)g.w;
+            out.data[(i == 0 ? OBS_HEAD : OBS_BODY) * out.channelStride + at] = 1.0f;
+            out.data[OBS_AGE * out.channelStride + at] = float(i + 1) * invLen;
+        }
+    }
+    else {
+        ObsCellMath m = obsCellMath(g);
+        if (out.rowStride == g.w) {
+            // Dense planes: one run over the whole board keeps the vector loop full
+            m.run(g.grid, nullptr, g.cells,
+                out.row(OBS_HEAD, 0), out.row(OBS_BODY, 0), out.row(OBS_AGE, 0), out.row(OBS_FOOD, 0), false);
+        }
+        else {
+            for (int y = 0; y < g.h; y++) {
+                m.run(g.grid + (size_t)y * g.w, nullptr, g.w,
+                    out.row(OBS_HEAD, y), out.row(OBS_BODY, y), out.row(OBS_AGE, y), out.row(OBS_FOOD, y), false);
+            }
+        }
+    }
+    for (int i = 0; i < g.foodCount; i++) {
+        int fx = (int)(g.food[i] % (uint32_t)g.w);
+        int fy = (int)(g.food[i] / (uint32_t)g.w);
+        out.row(OBS_FOOD, fy)[fx] = 1.0f;
+    }
+}
+
+//
+// Egocentric crop: k x k (k odd, <= OBS_MAX_CROP) centred on the head and turned so the
+// heading points up; row 0 is furthest ahead, column 0 is to the snake's left.
+// Cells past the board edge are walls.
+//
+static inline void obsCropBasis(SimDir d, int& fx, int& fy, int& rx, int& ry) {
+    switch (d) {
+    case SIM_UP:    fx = 0;  fy = -1; rx = 1;  ry = 0;  break;
+    case SIM_DOWN:  fx = 0;  fy = 1;  rx = -1; ry = 0;  break;
+    case SIM_LEFT:  fx = -1; fy = 0;  rx = 0;  ry = -1; break;
+    default:        fx = 1;  fy = 0;  rx = 0;  ry = 1;  break;
+    }
+}
+
+static inline void obsEncodeCrop(const SnakeSim& g, int k, const ObsPlanes& out) {
+    int half = k / 2;
+    int fx, fy, rx, ry;
+    obsCropBasis(g.dir, fx, fy, rx, ry);
+    int hx = (int)(g.head() % (uint32_t)g.w);
+    int hy = (int)(g.head() / (uint32_t)g.w);
+
+    ObsCellMath m = obsCellMath(g);
+    uint32_t vals[OBS_MAX_CROP];
+    uint32_t walls[OBS_MAX_CROP];
+    for (int r = 0; r < k; r++) {
+        // Output row r is (half - r) cells ahead; each column steps one cell to the right
+        int f = half - r;
+        int x = hx + f * fx - half * rx;
+        int y = hy + f * fy - half * ry;
+        float* wallRow = out.row(CROP_WALL, r);
+        for (int c = 0; c < k; c++, x += rx, y += ry) {
+            bool inside = x >= 0 && x < g.w && y >= 0 && y < g.h;
+            vals[c] = inside ? g.grid[y * g.w + x] : 0;
+            walls[c] = inside ? 0u : ~0u;
+            wallRow[c] = inside ? 0.0f : 1.0f;
+        }
+        m.run(vals, walls, k, nullptr, out.row(CROP_BODY, r), out.row(CROP_AGE, r), out.row(CROP_FOOD, r), true);
+    }
+
+    // Food: map each fruit back into crop coordinates
+    for (int i = 0; i < g.foodCount; i++) {
+        int dx = (int)(g.food[i] % (uint32_t)g.w) - hx;
+        int dy = (int)(g.food[i] / (uint32_t)g.w) - hy;
+        int r = half - (dx * fx + dy * fy);
+        int c = half + (dx * rx + dy * ry);
+        if (r >= 0 && r < k && c >= 0 && c < k) out.row(CROP_FOOD, r)[c] = 1.0f;
+    }
+}
+
+//
+// Dihedral symmetries. Variant t (0-7): bit 2 transposes, bit 0 mirrors x, bit 1 mirrors y
+// (both in source coordinates). Output (ox, oy) reads source (sx, sy) with
+// (sx, sy) = transpose ? (oy, ox) : (ox, oy), then mirrored. Transposed variants of a
+// W x H board are H x W. t = 0 is the identity.
+//
+static inline void obsDihedralDims(int t, int w, int h, int& outW, int& outH) {
+    outW = (t & 4) ? h : w;
+    outH = (t & 4) ? w : h;
+}
+
+// The action that means the same move on the transformed board
+static inline int obsDihedralAction(int t, int action) {
+    static const int vx[4] = { 0, 0, -1, 1 };
+    static const int vy[4] = { -1, 1, 0, 0 };
+    int x = vx[action], y = vy[action];
+    if (t & 1) x = -x;
+    if (t & 2) y = -y;
+    if (t & 4) { int tmp = x; x = y; y = tmp; }
+    if (x == 0) return y < 0 ? SIM_UP : SIM_DOWN;
+    return x < 0 ? SIM_LEFT : SIM_RIGHT;
+}
+
+// One plane: out[oy][ox] = start[oy * dy + ox * dx]
+static inline void obsDihedralPlane(const float* start, ptrdiff_t dx, ptrdiff_t dy,
+    int outW, int outH, float* dst, ptrdiff_t dstRow) {
+#if SNAKE_OBS_SSE2
+    if (dx == 1 || dx == -1) {
+        // Rows map to rows: straight or reversed copies
+        for (int oy = 0; oy < outH; oy++) {
+            const float* s = start + oy * dy;
+            float* d = dst + oy * dstRow;
+            int ox = 0;
+            if (dx == 1) {
+                for (; ox + 4 <= outW; ox += 4) _mm_storeu_ps(d + ox, _mm_loadu_ps(s + ox));
+            }
+            else {
+                for (; ox + 4 <= outW; ox += 4) {
+                    __m128 v = _mm_loadu_ps(s - ox - 3);
+                    _mm_storeu_ps(d + ox, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3)));
+                }
+            }
+            for (; ox < outW; ox++) d[ox] = s[ox * dx];
+        }
+        return;
+    }
+
+    // Rows map to columns: 4x4 register transposes. Here dy is +-1, so four output rows
+    // at one output column are contiguous (or reversed) in the source.
+    int oy = 0;
+    for (; oy + 4 <= outH; oy += 4) {
+        int ox = 0;
+        for (; ox + 4 <= outW; ox += 4) {
+            __m128 c[4];
+            for (int j = 0; j < 4; j++) {
+                const float* s = start + oy * dy + (ox + j) * dx;
+                if (dy == 1) {
+                    c[j] = _mm_loadu_ps(s);
+                }
+                else {
+                    __m128 v = _mm_loadu_ps(s - 3);
+                    c[j] = _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+                }
+            }
+            _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+            for (int i = 0; i < 4; i++) _mm_storeu_ps(dst + (oy + i) * dstRow + ox, c[i]);
+        }
+        for (; ox < outW; ox++) {
+            for (int i = 0; i < 4; i++) dst[(oy + i) * dstRow + ox] = start[(oy + i) * dy + ox * dx];
+        }
+    }
+    for (; oy < outH; oy++) {
+        for (int ox = 0; ox < outW; ox++) dst[oy * dstRow + ox] = start[oy * dy + ox * dx];
+    }
+#else
+    for (int oy = 0; oy < outH; oy++) {
+        for (int ox = 0; ox < outW; ox++) dst[oy * dstRow + ox] = start[oy * dy + ox * dx];
+    }
+#endif
+}
+
+// Transform `channels` planes of a w x h source into variant t
+static inline void obsDihedral(const ObsPlanes& src, int w, int h, int channels, int t, const ObsPlanes& out) {
+    bool mirrorX = (t & 1) != 0;
+    bool mirrorY = (t & 2) != 0;
+    ptrdiff_t sx = mirrorX ? -1 : 1;
+    ptrdiff_t sy = mirrorY ? -src.rowStride : src.rowStride;
+    ptrdiff_t origin = (mirrorX ? w - 1 : 0) + (mirrorY ? (ptrdiff_t)(h - 1) * src.rowStride : 0);
+    ptrdiff_t dx = (t & 4) ? sy : sx;
+    ptrdiff_t dy = (t & 4) ? sx : sy;
+
+    int outW, outH;
+    obsDihedralDims(t, w, h, outW, outH);
+    for (int ch = 0; ch < channels; ch++) {
+        obsDihedralPlane(src.data + ch * src.channelStride + origin, dx, dy, outW, outH,
+            out.data + ch * out.channelStride, out.rowStride);
+    }
+}
+
+// All 8 variants; out[t] receives variant t
+static inline void obsDihedralAll(const ObsPlanes& src, int w, int h, int channels, const ObsPlanes out[8]) {
+    for (int t = 0; t < 8; t++) obsDihedral(src, w, h, channels, t, out[t]);
+}
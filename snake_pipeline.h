@@ -0,0 +1,185 @@
+// snake_pipeline.h
+// Frame pipeline: each frame goes through build (sample the game state and lay out the
+// scene), raster (draw it off-screen) and present (put it on screen), each stage on its
+// own thread, so frame N+1 is built while frame N rasterizes and frame N-1 is presented.
+// Frames live in a fixed set of slots that circulate through bounded single-producer /
+// single-consumer queues: with SLOTS slots at most SLOTS frames are in flight, and a stage
+// that runs ahead waits for a free slot instead of queueing up latency.
+//
+// Every frame carries the time it entered each stage. FrameLatency keeps running averages
+// of each stage, of the time frames sat in queues, and of the whole trip from sampling the
+// state to presenting it, which is the latency the player sees.
+
+#pragma once
+
+#include "snake_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+using FrameClock = std::chrono::steady_clock;
+
+enum FrameStage { FRAME_BUILD, FRAME_RASTER, FRAME_PRESENT, FRAME_STAGES };
+
+struct FrameTimes {
+    FrameClock::time_point begin[FRAME_STAGES]; // when each stage started on the frame
+    FrameClock::time_point end[FRAME_STAGES];   // and finished; build begins by sampling the state
+};
+
+//
+// Running averages, written by whichever thread finishes frames and read by any
+//
+class FrameLatency {
+public:
+    void record(const FrameTimes& t) {
+        double stage[FRAME_STAGES];
+        for (int s = 0; s < FRAME_STAGES; s++) stage[s] = ms(t.begin[s], t.end[s]);
+        double total = ms(t.begin[FRAME_BUILD], t.end[FRAME_PRESENT]);
+        double queued = total - stage[FRAME_BUILD] - stage[FRAME_RASTER] - stage[FRAME_PRESENT];
+        double interval = lastPresent == FrameClock::time_point{} ? 0.0 : ms(lastPresent, t.end[FRAME_PRESENT]);
+        lastPresent = t.end[FRAME_PRESENT];
+
+        for (int s = 0; s < FRAME_STAGES; s++) blend(stageMs[s], stage[s]);
+        blend(queuedMs, queued);
+        blend(latencyMs, total);
+        if (interval > 0.0) blend(intervalMs, interval);
+        frames.fetch_add(1, std::memory_order_relaxed);
+
+        for (int s = 0; s < FRAME_STAGES; s++) sums.stage[s] += stage[s];
+        sums.queued += queued;
+        sums.latency += total;
+    }
+
+    double stage(FrameStage s) const { return stageMs[s].load(std::memory_order_relaxed); }
+    double queued() const { return queuedMs.load(std::memory_order_relaxed); }
+    double latency() const { return latencyMs.load(std::memory_order_relaxed); }
+    double fps() const {
+        double i = intervalMs.load(std::memory_order_relaxed);
+        return i > 0.0 ? 1000.0 / i : 0.0;
+    }
+    uint64_t count() const { return frames.load(std::memory_order_relaxed); }
+
+    // Means over every frame recorded; only once the thread recording them has stopped
+    struct Means {
+        double stage[FRAME_STAGES];
+        double queued, latency;
+    };
+    Means means() const {
+        double n = (double)(std::max)(count(), (uint64_t)1);
+        Means m;
+        for (int s = 0; s < FRAME_STAGES; s++) m.stage[s] = sums.stage[s] / n;
+        m.queued = sums.queued / n;
+        m.latency = sums.latency / n;
+        return m;
+    }
+
+private:
+    static double ms(FrameClock::time_point a, FrameClock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    }
+
+    // About the last 30 frames
+    static void blend(std::atomic<double>& avg, double v) {
+        double a = avg.load(std::memory_order_relaxed);
+        avg.store(a == 0.0 ? v : a + (v - a) / 32.0, std::memory_order_relaxed);
+    }
+
+    FrameClock::time_point lastPresent{};
+    std::atomic<double> stageMs[FRAME_STAGES] = {};
+    std::atomic<double> queuedMs{ 0.0 };
+    std::atomic<double> latencyMs{ 0.0 };
+    std::atomic<double> intervalMs{ 0.0 };
+    std::atomic<uint64_t> frames{ 0 };
+    Means sums = {};
+};
+
+//
+// A bounded queue of slot indices between two stage threads. It never fills: it holds as
+// many entries as there are slots. pop() sleeps on a counter until a slot is posted or
+// the queue is closed.
+//
+class FrameQueue {
+public:
+    explicit FrameQueue(size_t capacity) : ring(capacity) {}
+
+    void push(int slot) {
+        ring.push(slot);
+        posted.fetch_add(1, std::memory_order_release);
+        posted.notify_one();
+    }
+
+    // The next slot, or false once the queue is closed and drained
+    bool pop(int& slot) {
+        for (;;) {
+            uint32_t seen = posted.load(std::memory_order_acquire);
+            if (ring.pop(slot)) return true;
+            if (closed.load(std::memory_order_acquire)) return false;
+            posted.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    void close() {
+        closed.store(true, std::memory_order_release);
+        posted.fetch_add(1, std::memory_order_release);
+        posted.notify_all();
+    }
+
+private:
+    SpscQueue<int> ring;
+    std::atomic<bool> closed{ false };
+    alignas(CACHE_LINE) std::atomic<uint32_t> posted{ 0 };
+};
+
+//
+// The pipeline. run() builds on the calling thread and rasters and presents on two
+// helpers until build returns false; frames already built are still drawn and shown.
+// Frame must have a FrameTimes member named times.
+//
+template <typename Frame, int SLOTS = 3>
+class FramePipeline {
+public:
+    Frame frames[SLOTS];
+
+    template <typename Build, typename Raster, typename Present>
+    void run(FrameLatency& latency, Build&& build, Raster&& raster, Present&& present) {
+        FrameQueue free(SLOTS), built(SLOTS), rastered(SLOTS);
+        for (int s = 0; s < SLOTS; s++) free.push(s);
+
+        std::thread rasterThread([&] {
+            int s;
+            while (built.pop(s)) {
+                Frame& f = frames[s];
+                f.times.begin[FRAME_RASTER] = FrameClock::now();
+                raster(f);
+                f.times.end[FRAME_RASTER] = FrameClock::now();
+                rastered.push(s);
+            }
+            rastered.close();
+        });
+        std::thread presentThread([&] {
+            int s;
+            while (rastered.pop(s)) {
+                Frame& f = frames[s];
+                f.times.begin[FRAME_PRESENT] = FrameClock::now();
+                present(f);
+                f.times.end[FRAME_PRESENT] = FrameClock::now();
+                latency.record(f.times);
+                free.push(s);
+            }
+        });
+
+        int s;
+        while (free.pop(s)) {
+            Frame& f = frames[s];
+            if (!build(f)) break; // sets times.begin[FRAME_BUILD] when it samples the state
+            f.times.end[FRAME_BUILD] = FrameClock::now();
+            built.push(s);
+        }
+        built.close();
+        rasterThread.join();
+        presentThread.join();
+    }
+};
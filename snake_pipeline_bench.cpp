@@ -0,0 +1,213 @@
+// snake_pipeline_bench.cpp
+// Serial frame loop vs the three-stage FramePipeline (snake_pipeline.h) on a large board,
+// with the frame work main.cpp does stood in for by plain memory work: build copies the
+// snake under the state lock and lays out interpolated rectangles, raster fills them into
+// a 32-bit off-screen buffer (background, grid, fruit, body with outlines) and present
+// copies that buffer to a "screen" buffer, as BitBlt would. A game thread moves a long
+// snake round the board at the tick rate. Frames are not paced, so the rate is the most
+// each loop sustains; latency is from sampling the state to presenting it.
+// Compile: g++ snake_pipeline_bench.cpp -std=c++20 -O2 -pthread -o snake_pipeline_bench
+// Run:     ./snake_pipeline_bench [--width 40] [--height 40] [--cell 30] [--seconds 5]
+
+#include "snake_pipeline.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+//
+// Config
+//
+struct PipelineBenchConfig {
+    int width = 40;   // main.cpp's largest board
+    int height = 40;
+    int cell = 30;
+    int seconds = 5;
+    int tickMs = 80;
+};
+
+static PipelineBenchConfig parseArgs(int argc, char** argv) {
+    PipelineBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--cell") && i + 1 < argc) cfg.cell = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) cfg.seconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--tick") && i + 1 < argc) cfg.tickMs = atoi(argv[++i]);
+    }
+    return cfg;
+}
+
+struct BenchPt { int x, y; };
+struct BenchRect { int left, top, right, bottom; uint32_t color; bool outline; };
+
+//
+// Game: a snake of half the board running round a boustrophedon cycle
+//
+struct BenchGame {
+    std::mutex mtx;
+    std::vector<BenchPt> path;
+    std::vector<BenchPt> prev, curr, fruit;
+    FrameClock::time_point tickTime = FrameClock::now();
+    size_t headAt = 0;
+
+    void init(int w, int h) {
+        for (int x = 0; x < w; x++) path.push_back({ x, 0 });
+        for (int x = w - 1; x >= 0; x--) {
+            if ((w - 1 - x) % 2 == 0) for (int y = 1; y < h; y++) path.push_back({ x, y });
+            else for (int y = h - 1; y >= 1; y--) path.push_back({ x, y });
+        }
+        size_t length = path.size() / 2;
+        headAt = length - 1;
+        for (size_t i = 0; i < length; i++) curr.push_back(path[headAt - i]);
+        prev = curr;
+        for (int i = 0; i < 15; i++) fruit.push_back(path[(headAt + 7 + (size_t)i * 37) % path.size()]);
+    }
+
+    void tick() {
+        std::lock_guard<std::mutex> lk(mtx);
+        prev = curr;
+        headAt = (headAt + 1) % path.size();
+        curr.insert(curr.begin(), path[headAt]);
+        curr.pop_back();
+        tickTime = FrameClock::now();
+    }
+};
+
+//
+// The frame, as RenderFrame in main.cpp
+//
+struct BenchFrame {
+    std::vector<BenchPt> prev, curr, fruit;
+    std::vector<BenchRect> rects;
+    std::vector<uint32_t> pixels;
+    FrameTimes times;
+};
+
+struct BenchRenderer {
+    const PipelineBenchConfig& cfg;
+    BenchGame& game;
+    int pw, ph;
+    std::vector<uint32_t> screen;
+
+    BenchRenderer(const PipelineBenchConfig& cfg, BenchGame& game)
+        : cfg(cfg), game(game), pw(cfg.width * cfg.cell), ph(cfg.height * cfg.cell + 40), screen((size_t)pw * ph) {}
+
+    void build(BenchFrame& f) {
+        f.times.begin[FRAME_BUILD] = FrameClock::now();
+        FrameClock::time_point tickTime;
+        {
+            std::lock_guard<std::mutex> lk(game.mtx);
+            f.prev = game.prev;
+            f.curr = game.curr;
+            f.fruit = game.fruit;
+            tickTime = game.tickTime;
+        }
+        float alpha = std::clamp(std::chrono::duration<float, std::milli>(FrameClock::now() - tickTime).count() / cfg.tickMs, 0.0f, 1.0f);
+        int c = cfg.cell;
+        f.rects.clear();
+        for (const BenchPt& p : f.fruit) f.rects.push_back({ p.x * c, p.y * c, p.x * c + c, p.y * c + c, 0xFF4646, false });
+        for (size_t i = 0; i < f.curr.size(); i++) {
+            const BenchPt& a = i < f.prev.size() ? f.prev[i] : f.curr[i];
+            const BenchPt& b = f.curr[i];
+            int x = (int)((a.x + (b.x - a.x) * alpha) * c), y = (int)((a.y + (b.y - a.y) * alpha) * c);
+            uint32_t color = i == 0 ? 0x5ADC5A : i % 2 ? 0x1E8C1E : 0x28AA28;
+            f.rects.push_back({ x + 1, y + 1, x + c - 1, y + c - 1, color, true });
+        }
+    }
+
+    void fill(uint32_t* px, int l, int t, int r, int b, uint32_t color) const {
+        l = (std::max)(l, 0);
+        t = (std::max)(t, 0);
+        r = (std::min)(r, pw);
+        b = (std::min)(b, ph);
+        for (int y = t; y < b; y++) std::fill(px + (size_t)y * pw + l, px + (size_t)y * pw + r, color);
+    }
+
+    void raster(BenchFrame& f) const {
+        f.pixels.resize((size_t)pw * ph);
+        uint32_t* px = f.pixels.data();
+        fill(px, 0, 0, pw, ph, 0x161A1E);
+        for (int x = 0; x <= pw; x += cfg.cell) fill(px, x, 0, x + 1, cfg.height * cfg.cell, 0x282830);
+        for (int y = 0; y <= cfg.height * cfg.cell; y += cfg.cell) fill(px, 0, y, pw, y + 1, 0x282830);
+        for (const BenchRect& r : f.rects) {
+            fill(px, r.left, r.top, r.right, r.bottom, r.color);
+            if (!r.outline) continue;
+            fill(px, r.left, r.top, r.right, r.top + 1, 0x005A00);
+            fill(px, r.left, r.bottom - 1, r.right, r.bottom, 0x005A00);
+            fill(px, r.left, r.top, r.left + 1, r.bottom, 0x005A00);
+            fill(px, r.right - 1, r.top, r.right, r.bottom, 0x005A00);
+        }
+    }
+
+    void present(BenchFrame& f) {
+        std::memcpy(screen.data(), f.pixels.data(), sizeof(uint32_t) * screen.size());
+    }
+};
+
+static void report(const char* what, const FrameLatency& lat, double seconds) {
+    FrameLatency::Means m = lat.means();
+    printf("%-9s %7.1f fps  latency %6.2f ms = build %5.2f + raster %5.2f + present %5.2f + queued %5.2f\n", what,
+        lat.count() / seconds, m.latency, m.stage[FRAME_BUILD], m.stage[FRAME_RASTER], m.stage[FRAME_PRESENT], m.queued);
+}
+
+int main(int argc, char** argv) {
+    PipelineBenchConfig cfg = parseArgs(argc, argv);
+    BenchGame game;
+    game.init(cfg.width, cfg.height);
+    std::atomic<bool> running{ true };
+    std::thread ticker([&] {
+        auto next = FrameClock::now();
+        while (running.load(std::memory_order_relaxed)) {
+            next += std::chrono::milliseconds(cfg.tickMs);
+            std::this_thread::sleep_until(next);
+            game.tick();
+        }
+    });
+
+    BenchRenderer renderer(cfg, game);
+    printf("%dx%d board, %d px cells (%dx%d pixels), snake of %zu, %u hardware threads\n", cfg.width, cfg.height, cfg.cell,
+        renderer.pw, renderer.ph, game.curr.size(), std::thread::hardware_concurrency());
+
+    // Serial: the three stages one after another on one thread
+    {
+        FrameLatency lat;
+        BenchFrame f;
+        auto until = FrameClock::now() + std::chrono::seconds(cfg.seconds);
+        auto t0 = FrameClock::now();
+        while (FrameClock::now() < until) {
+            renderer.build(f);
+            f.times.end[FRAME_BUILD] = f.times.begin[FRAME_RASTER] = FrameClock::now();
+            renderer.raster(f);
+            f.times.end[FRAME_RASTER] = f.times.begin[FRAME_PRESENT] = FrameClock::now();
+            renderer.present(f);
+            f.times.end[FRAME_PRESENT] = FrameClock::now();
+            lat.record(f.times);
+        }
+        report("serial", lat, std::chrono::duration<double>(FrameClock::now() - t0).count());
+    }
+
+    // Pipelined: a thread per stage, three frames in flight
+    {
+        FrameLatency lat;
+        FramePipeline<BenchFrame> pipeline;
+        auto until = FrameClock::now() + std::chrono::seconds(cfg.seconds);
+        auto t0 = FrameClock::now();
+        pipeline.run(lat,
+            [&](BenchFrame& f) {
+                if (FrameClock::now() >= until) return false;
+                renderer.build(f);
+                return true;
+            },
+            [&](BenchFrame& f) { renderer.raster(f); },
+            [&](BenchFrame& f) { renderer.present(f); });
+        report("pipelined", lat, std::chrono::duration<double>(FrameClock::now() - t0).count());
+    }
+
+    running.store(false);
+    ticker.join();
+    return 0;
+}
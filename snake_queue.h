@@ -0,0 +1,141 @@
+// snake_queue.h
+// Bounded lock-free queues for handing work between threads without a mutex.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+static constexpr size_t CACHE_LINE = 64;
+
+// A T with its cache line(s) to itself, so that stores to whatever sits next to it never
+// invalidate it and its stores never invalidate them. It derives from T, so a padded
+// mutex, atomic or cache is used just as the plain one is.
+template <typename T>
+struct alignas(CACHE_LINE) CachePadded : T {
+    using T::T;
+    using T::operator=;
+};
+
+//
+// Multi-producer / multi-consumer ring (Vyukov). Each cell carries a sequence number
+// that tells producers and consumers whose turn it is, so push/pop are one CAS each.
+//
+template <typename T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t minCapacity) {
+        size_t cap = 2;
+        while (cap < minCapacity) cap <<= 1;
+        mask = cap - 1;
+        cells = std::vector<Cell>(cap);
+        for (size_t i = 0; i < cap; i++) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(const T& value) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells[pos & mask];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = value;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // full
+            }
+            else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(T& out) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells[pos & mask];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = c.value;
+                    c.seq.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // empty
+            }
+            else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq{ 0 };
+        T value{};
+    };
+
+    std::vector<Cell> cells;
+    size_t mask = 0;
+    alignas(CACHE_LINE) std::atomic<size_t> head{ 0 };
+    alignas(CACHE_LINE) std::atomic<size_t> tail{ 0 };
+};
+
+//
+// Single-producer / single-consumer ring. Each side caches the other's index so the
+// shared counters are only re-read when the ring looks full or empty.
+//
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t minCapacity) {
+        size_t cap = 2;
+        while (cap < minCapacity) cap <<= 1;
+        mask = cap - 1;
+        items.resize(cap);
+    }
+
+    bool push(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - headCache > mask) {
+            headCache = head.load(std::memory_order_acquire);
+            if (t - headCache > mask) return false;
+        }
+        items[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tailCache) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (h == tailCache) return false;
+        }
+        out = items[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> items;
+    size_t mask = 0;
+    alignas(CACHE_LINE) std::atomic<size_t> head{ 0 };
+    size_t tailCache = 0; // consumer side
+    alignas(CACHE_LINE) std::atomic<size_t> tail{ 0 };
+    size_t headCache = 0; // producer side
+};
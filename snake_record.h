@@ -0,0 +1,497 @@
+// snake_record.h
+// Match recordings for dispute resolution. A recording is the input log of a match (the
+// turns that reached the game, seat changes and restart seeds) plus a keyframe of the
+// whole state every RECORD_KEYFRAME_TICKS ticks. Replaying the log from the start or
+// from any keyframe reproduces every tick, since the game rules are deterministic. The
+// keyframe and end hashes let the replay check itself.
+//
+// The match server (snake_match_server.cpp) appends the records of all its matches to
+// one byte buffer per shard and writes them out on another thread. The replay side
+// (RecordReplay) is used by snake_record_tool.
+//
+// File: magic u32, version u16, shard u16, then records:
+//   type u8, size u32 (payload bytes), recording u32, tick u32, payload
+// Tick t is the match tick that the record affects (inputs, seats, restarts) or follows
+// (keyframes, end). A match's first tick to run is its begin tick + 1.
+//   BEGIN     mode u8 (0 solo, 1 arena), width u16, height u16, fruits u16, seats u8,
+//             respawn u16, tickMs u16, seed u64, unixMs u64 [, solo: player]
+//   SEAT      seat u8, human u8, player (arena: a client took or left the seat)
+//   INPUT     seat u8, action u8 (only turns are logged; other ticks go straight on)
+//   RESTART   seed u64 (solo: a new game instead of this tick's step)
+//   KEYFRAME  hash u64, state
+//   END       hash u64
+// where player = ip u32, port u16, token u32, and state is the solo or arena state below.
+
+#pragma once
+
+#include "snake_arena.h"
+#include "snake_sim.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+static constexpr uint32_t RECORD_MAGIC = 0x524B4E53; // "SNKR"
+static constexpr uint16_t RECORD_VERSION = 1;
+static constexpr int RECORD_FILE_HEADER = 8;
+static constexpr int RECORD_HEADER = 13;
+static constexpr uint32_t RECORD_KEYFRAME_TICKS = 256;
+
+enum RecordType : uint8_t { REC_BEGIN = 1, REC_SEAT, REC_INPUT, REC_RESTART, REC_KEYFRAME, REC_END };
+
+struct RecordBegin {
+    uint8_t mode = 0;
+    uint16_t width = 0, height = 0, fruits = 0;
+    uint8_t seats = 0;
+    uint16_t respawnTicks = 0;
+    uint16_t tickMs = 0;
+    uint64_t seed = 0;
+    uint64_t unixMs = 0;
+};
+
+struct RecordPlayer {
+    uint32_t ip = 0;   // network order, as in sockaddr_in
+    uint16_t port = 0; // network order
+    uint32_t token = 0;
+};
+
+//
+// Writing: records are appended to a byte buffer
+//
+static inline uint8_t* recordPut(std::vector<uint8_t>& out, RecordType type, uint32_t size, uint32_t rec, uint32_t tick) {
+    size_t at = out.size();
+    out.resize(at + RECORD_HEADER + size);
+    uint8_t* p = out.data() + at;
+    p[0] = type;
+    for (int i = 0; i < 4; i++) {
+        p[1 + i] = (uint8_t)(size >> (i * 8));
+        p[5 + i] = (uint8_t)(rec >> (i * 8));
+        p[9 + i] = (uint8_t)(tick >> (i * 8));
+    }
+    return p + RECORD_HEADER;
+}
+
+static inline uint8_t* recordPutN(uint8_t* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) p[i] = (uint8_t)(v >> (i * 8));
+    return p + bytes;
+}
+
+static inline uint64_t recordGetN(const uint8_t*& p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t)p[i] << (i * 8);
+    p += bytes;
+    return v;
+}
+
+static inline void recordFileHeader(std::vector<uint8_t>& out, uint16_t shard) {
+    uint8_t h[RECORD_FILE_HEADER];
+    recordPutN(recordPutN(recordPutN(h, RECORD_MAGIC, 4), RECORD_VERSION, 2), shard, 2);
+    out.insert(out.end(), h, h + RECORD_FILE_HEADER);
+}
+
+static inline uint8_t* recordPutPlayer(uint8_t* p, const RecordPlayer& pl) {
+    std::memcpy(p, &pl.ip, 4); // already in network order
+    std::memcpy(p + 4, &pl.port, 2);
+    return recordPutN(p + 6, pl.token, 4);
+}
+
+static inline const uint8_t* recordGetPlayer(const uint8_t* p, RecordPlayer& pl) {
+    std::memcpy(&pl.ip, p, 4);
+    std::memcpy(&pl.port, p + 4, 2);
+    p += 6;
+    pl.token = (uint32_t)recordGetN(p, 4);
+    return p;
+}
+
+static inline void recordBegin(std::vector<uint8_t>& out, uint32_t rec, uint32_t tick, const RecordBegin& b, const RecordPlayer* solo) {
+    uint8_t* p = recordPut(out, REC_BEGIN, 29 + (solo ? 10 : 0), rec, tick);
+    p = recordPutN(p, b.mode, 1);
+    p = recordPutN(p, b.width, 2);
+    p = recordPutN(p, b.height, 2);
+    p = recordPutN(p, b.fruits, 2);
+    p = recordPutN(p, b.seats, 1);
+    p = recordPutN(p, b.respawnTicks, 2);
+    p = recordPutN(p, b.tickMs, 2);
+    p = recordPutN(p, b.seed, 8);
+    p = recordPutN(p, b.unixMs, 8);
+    if (solo) recordPutPlayer(p, *solo);
+}
+
+static inline void recordSeat(std::vector<uint8_t>& out, uint32_t rec, uint32_t tick, int seat, bool human, const RecordPlayer& pl) {
+    uint8_t* p = recordPut(out, REC_SEAT, 12, rec, tick);
+    p[0] = (uint8_t)seat;
+    p[1] = human ? 1 : 0;
+    recordPutPlayer(p + 2, pl);
+}
+
+static inline void recordInput(std::vector<uint8_t>& out, uint32_t rec, uint32_t tick, int seat, int action) {
+    uint8_t* p = recordPut(out, REC_INPUT, 2, rec, tick);
+    p[0] = (uint8_t)seat;
+    p[1] = (uint8_t)action;
+}
+
+static inline void recordRestart(std::vector<uint8_t>& out, uint32_t rec, uint32_t tick, uint64_t seed) {
+    recordPutN(recordPut(out, REC_RESTART, 8, rec, tick), seed, 8);
+}
+
+static inline void recordEnd(std::vector<uint8_t>& out, uint32_t rec, uint32_t tick, uint64_t hash) {
+    recordPutN(recordPut(out, REC_END, 8, rec, tick), hash, 8);
+}
+
+//
+// Solo state: FNV-1a over everything a step reads, and the keyframe layout
+//   w u16, h u16, fruits u8, dir u8, flags u8 (1 over, 2 won), score u32, ticks u32,
+//   ticksSinceFood u32, rng u64, length u32, cells u16 (head first), foodCount u8, food u16
+//
+static inline uint64_t recordSoloHash(const SnakeSim& g) {
+    uint64_t hv = 0xCBF29CE484222325ull;
+    auto mix = [&](uint64_t v) {
+        for (int i = 0; i < 8; i++) {
+            hv ^= (v >> (i * 8)) & 0xFF;
+            hv *= 0x100000001B3ull;
+        }
+    };
+    mix((uint64_t)g.w | (uint64_t)g.h << 16 | (uint64_t)g.dir << 32 | (uint64_t)g.gameOver << 40 | (uint64_t)g.gameWon << 48);
+    mix((uint64_t)(uint32_t)g.score | (uint64_t)g.ticks << 32);
+    mix(g.ticksSinceFood);
+    mix(g.rng.state);
+    mix(g.length);
+    for (uint32_t i = 0; i < g.length; i++) mix(g.segment(i));
+    for (int i = 0; i < g.foodCount; i++) mix(g.food[i]);
+    return hv;
+}
+
+static inline void recordSoloKeyframe(std::vector<uint8_t>& out, uint32_t rec, uint32_t tick, const SnakeSim& g) {
+    uint8_t* p = recordPut(out, REC_KEYFRAME, 8 + 31 + 2 * g.length + 1 + 2 * (uint32_t)g.foodCount, rec, tick);
+    p = recordPutN(p, recordSoloHash(g), 8);
+    p = recordPutN(p, (uint64_t)g.w, 2);
+    p = recordPutN(p, (uint64_t)g.h, 2);
+    p = recordPutN(p, (uint64_t)g.fruitCount, 1);
+    p = recordPutN(p, g.dir, 1);
+    p = recordPutN(p, (uint64_t)(g.gameOver ? 1 : 0) | (g.gameWon ? 2 : 0), 1);
+    p = recordPutN(p, (uint32_t)g.score, 4);
+    p = recordPutN(p, g.ticks, 4);
+    p = recordPutN(p, g.ticksSinceFood, 4);
+    p = recordPutN(p, g.rng.state, 8);
+    p = recordPutN(p, g.length, 4);
+    for (uint32_t i = 0; i < g.length; i++) p = recordPutN(p, g.segment(i), 2);
+    p = recordPutN(p, (uint64_t)g.foodCount, 1);
+    for (int i = 0; i < g.foodCount; i++) p = recordPutN(p, g.food[i], 2);
+}
+
+// Into a game already bound to storage for w x h; the body is renumbered as in renumber()
+static inline bool recordReadSolo(const uint8_t* p, uint32_t size, SnakeSim& g) {
+    if (size < 39) return false;
+    const uint8_t* end = p + size;
+    p += 8;
+    int w = (int)recordGetN(p, 2), h = (int)recordGetN(p, 2);
+    if (w * h > g.maxCells) return false;
+    g.w = w;
+    g.h = h;
+    g.cells = w * h;
+    g.fruitCount = (int)recordGetN(p, 1);
+    g.dir = (SimDir)(recordGetN(p, 1) & 3);
+    uint32_t flags = (uint32_t)recordGetN(p, 1);
+    g.gameOver = (flags & 1) != 0;
+    g.gameWon = (flags & 2) != 0;
+    g.score = (int)recordGetN(p, 4);
+    g.ticks = (uint32_t)recordGetN(p, 4);
+    g.ticksSinceFood = (uint32_t)recordGetN(p, 4);
+    g.rng.state = recordGetN(p, 8);
+    uint32_t length = (uint32_t)recordGetN(p, 4);
+    if (length == 0 || length > (uint32_t)g.cells || end - p < 2 * (ptrdiff_t)length + 1) return false;
+    std::memset(g.grid, 0, sizeof(uint32_t) * (size_t)g.cells);
+    g.length = length;
+    g.headPos = length - 1;
+    for (uint32_t i = 0; i < length; i++) {
+        uint32_t c = (uint32_t)recordGetN(p, 2);
+        if (c >= (uint32_t)g.cells) return false;
+        g.body[length - 1 - i] = c;
+        g.grid[c] = length - i;
+    }
+    g.tailSerial = 1;
+    g.headSerial = length;
+    g.foodCount = (int)recordGetN(p, 1);
+    if (g.foodCount > SIM_MAX_FOOD || end - p < 2 * g.foodCount) return false;
+    for (int i = 0; i < g.foodCount; i++) g.food[i] = (uint32_t)recordGetN(p, 2);
+    return true;
+}
+
+//
+// Arena state (a SnakeArena::save), with the grid left out since it follows from the rest
+//   ticks u32, rng u64, fruits u16, fruit cells u16, snakes u8, per snake:
+//   flags u8 (1 alive, 2 bot), dir u8, fate u8, action i8, score u32, respawnAt u32,
+//   target u32, rng u64, length u32, cells u16 (head first)
+//
+static inline void recordArenaKeyframe(std::vector<uint8_t>& out, uint32_t rec, uint32_t tick, const SnakeArena& a) {
+    uint32_t size = 8 + 4 + 8 + 2 + 2 * (uint32_t)a.fruits().size() + 1;
+    for (int i = 0; i < a.snakeCount(); i++) size += 28 + 2 * a.snake(i).length;
+    uint8_t* p = recordPut(out, REC_KEYFRAME, size, rec, tick);
+    ArenaState st;
+    a.save(st);
+    p = recordPutN(p, a.stateHash(false), 8);
+    p = recordPutN(p, st.ticks, 4);
+    p = recordPutN(p, st.rng.state, 8);
+    p = recordPutN(p, st.food.size(), 2);
+    for (uint32_t f : st.food) p = recordPutN(p, f, 2);
+    p = recordPutN(p, st.snakes.size(), 1);
+    for (const ArenaSnake& s : st.snakes) {
+        p = recordPutN(p, (uint64_t)(s.alive ? 1 : 0) | (s.bot ? 2 : 0), 1);
+        p = recordPutN(p, s.dir, 1);
+        p = recordPutN(p, s.fate, 1);
+        p = recordPutN(p, (uint8_t)(int8_t)s.action, 1);
+        p = recordPutN(p, (uint32_t)s.score, 4);
+        p = recordPutN(p, s.respawnAt, 4);
+        p = recordPutN(p, s.target, 4);
+        p = recordPutN(p, s.rng.state, 8);
+        p = recordPutN(p, s.length, 4);
+        for (uint32_t k = 0; k < s.length; k++) p = recordPutN(p, s.segment(k), 2);
+    }
+}
+
+static inline bool recordReadArena(const uint8_t* p, uint32_t size, int w, int h, ArenaState& st) {
+    const uint8_t* end = p + size;
+    uint32_t cells = (uint32_t)(w * h);
+    if (size < 23) return false;
+    p += 8;
+    st.ticks = (uint32_t)recordGetN(p, 4);
+    st.rng.state = recordGetN(p, 8);
+    st.grid.assign(cells, ARENA_EMPTY);
+    st.food.resize((size_t)recordGetN(p, 2));
+    if (end - p < 2 * (ptrdiff_t)st.food.size() + 1) return false;
+    for (size_t i = 0; i < st.food.size(); i++) {
+        st.food[i] = (uint32_t)recordGetN(p, 2);
+        if (st.food[i] >= cells) return false;
+        st.grid[st.food[i]] = ARENA_FOOD | (uint32_t)i;
+    }
+    st.snakes.resize((size_t)recordGetN(p, 1));
+    for (size_t i = 0; i < st.snakes.size(); i++) {
+        ArenaSnake& s = st.snakes[i];
+        if (end - p < 28) return false;
+        uint32_t flags = (uint32_t)recordGetN(p, 1);
+        s.alive = (flags & 1) != 0;
+        s.bot = (flags & 2) != 0;
+        s.dir = (SimDir)(recordGetN(p, 1) & 3);
+        s.fate = (ArenaFate)recordGetN(p, 1);
+        s.action = (int8_t)recordGetN(p, 1);
+        s.score = (int)recordGetN(p, 4);
+        s.respawnAt = (uint32_t)recordGetN(p, 4);
+        s.target = (uint32_t)recordGetN(p, 4);
+        s.rng.state = recordGetN(p, 8);
+        s.length = (uint32_t)recordGetN(p, 4);
+        if (s.length > cells || end - p < 2 * (ptrdiff_t)s.length) return false;
+        size_t ring = 8;
+        while (ring <= s.length) ring <<= 1;
+        s.body.assign(ring, 0);
+        s.mask = (uint32_t)ring - 1;
+        s.headPos = s.length ? s.length - 1 : 0;
+        for (uint32_t k = 0; k < s.length; k++) {
+            uint32_t c = (uint32_t)recordGetN(p, 2);
+            if (c >= cells) return false;
+            s.body[s.length - 1 - k] = c;
+            st.grid[c] = (uint32_t)i + 1;
+        }
+    }
+    return true;
+}
+
+//
+// Reading a file: the records in order
+//
+struct RecordHeader {
+    RecordType type;
+    uint32_t size;
+    uint32_t rec;
+    uint32_t tick;
+};
+
+class RecordReader {
+public:
+    RecordReader(const uint8_t* data, size_t size) : p(data), end(data + size) {}
+
+    // False if the file header is not ours
+    bool open(uint16_t& shard) {
+        if (end - p < RECORD_FILE_HEADER) return false;
+        const uint8_t* q = p;
+        if (recordGetN(q, 4) != RECORD_MAGIC || recordGetN(q, 2) != RECORD_VERSION) return false;
+        shard = (uint16_t)recordGetN(q, 2);
+        p = q;
+        return true;
+    }
+
+    // False at the end, or at a record cut short (a log still being written)
+    bool next(RecordHeader& h, const uint8_t*& payload) {
+        if (end - p < RECORD_HEADER) return false;
+        const uint8_t* q = p;
+        h.type = (RecordType)recordGetN(q, 1);
+        h.size = (uint32_t)recordGetN(q, 4);
+        h.rec = (uint32_t)recordGetN(q, 4);
+        h.tick = (uint32_t)recordGetN(q, 4);
+        if ((size_t)(end - q) < h.size) return false;
+        payload = q;
+        p = q + h.size;
+        return true;
+    }
+
+private:
+    const uint8_t* p;
+    const uint8_t* end;
+};
+
+//
+// Replay of one recording: feed it that recording's records in file order. Ticks run
+// lazily, once a record for a later tick shows that the earlier ones are complete.
+//
+class RecordReplay {
+public:
+    RecordBegin begin;
+    RecordPlayer players[256] = {};
+    uint32_t tick = 0;         // last tick run
+    uint32_t firstTick = 0;    // of the state the replay started from
+    bool ended = false;
+    uint64_t keyframesChecked = 0, mismatches = 0, inputs = 0;
+    uint32_t firstMismatch = 0;
+
+    RecordReplay() { clearPending(); }
+
+    // BEGIN starts the replay at the beginning; restore() can then move it to a keyframe
+    bool start(const uint8_t* p, uint32_t size, uint32_t beginTick) {
+        if (size < 29) return false;
+        begin.mode = (uint8_t)recordGetN(p, 1);
+        begin.width = (uint16_t)recordGetN(p, 2);
+        begin.height = (uint16_t)recordGetN(p, 2);
+        begin.fruits = (uint16_t)recordGetN(p, 2);
+        begin.seats = (uint8_t)recordGetN(p, 1);
+        begin.respawnTicks = (uint16_t)recordGetN(p, 2);
+        begin.tickMs = (uint16_t)recordGetN(p, 2);
+        begin.seed = recordGetN(p, 8);
+        begin.unixMs = recordGetN(p, 8);
+        if (begin.width < 4 || begin.height < 4 || begin.width * begin.height > 65536) return false;
+        if (begin.mode == 0 && size >= 39) recordGetPlayer(p, players[0]);
+        if (begin.mode == 0) {
+            storage.assign(SnakeSim::storageWords(begin.width * begin.height), 0);
+            solo.bind(storage.data(), begin.width * begin.height);
+            solo.reset(begin.width, begin.height, begin.fruits, begin.seed);
+        }
+        else {
+            ArenaConfig ac;
+            ac.width = begin.width;
+            ac.height = begin.height;
+            ac.snakes = begin.seats;
+            ac.fruits = begin.fruits;
+            ac.respawnTicks = begin.respawnTicks;
+            ac.seed = begin.seed;
+            board = std::make_unique<SnakeArena>(ac);
+        }
+        tick = firstTick = beginTick;
+        return true;
+    }
+
+    // Jumps to the state in a KEYFRAME (after start); the records after it follow as usual
+    bool restore(const uint8_t* p, uint32_t size, uint32_t at) {
+        bool ok;
+        if (board) {
+            ArenaState st;
+            ok = recordReadArena(p, size, begin.width, begin.height, st);
+            if (ok) board->restore(st);
+        }
+        else {
+            ok = recordReadSolo(p, size, solo);
+        }
+        if (!ok) return false;
+        tick = firstTick = at;
+        clearPending();
+        return true;
+    }
+
+    // Any record of this recording after BEGIN
+    void apply(const RecordHeader& h, const uint8_t* p) {
+        switch (h.type) {
+        case REC_SEAT:
+            if (h.size < 12) return;
+            runTo(h.tick - 1);
+            if (board && p[0] < begin.seats) {
+                board->setBot(p[0], p[1] == 0);
+                recordGetPlayer(p + 2, players[p[0]]);
+            }
+            break;
+        case REC_INPUT:
+            if (h.size < 2) return;
+            runTo(h.tick - 1);
+            pendingTick = h.tick;
+            if (p[0] < LOCAL_SEATS) pendingAction[p[0]] = (int8_t)p[1];
+            inputs++;
+            break;
+        case REC_RESTART:
+            if (h.size < 8) return;
+            runTo(h.tick - 1);
+            pendingTick = h.tick;
+            pendingRestart = true;
+            {
+                const uint8_t* q = p;
+                restartSeed = recordGetN(q, 8);
+            }
+            break;
+        case REC_KEYFRAME:
+        case REC_END:
+            if (h.size < 8) return;
+            runTo(h.tick);
+            {
+                const uint8_t* q = p;
+                uint64_t want = recordGetN(q, 8);
+                keyframesChecked += h.type == REC_KEYFRAME;
+                if (want != hash() && mismatches++ == 0) firstMismatch = h.tick;
+            }
+            ended = ended || h.type == REC_END;
+            break;
+        default: break;
+        }
+    }
+
+    // Runs the ticks up to t that no record has touched yet
+    void runTo(uint32_t t) {
+        while ((int32_t)(t - tick) > 0) step();
+    }
+
+    uint64_t hash() const { return board ? board->stateHash(false) : recordSoloHash(solo); }
+    const SnakeArena* arena() const { return board.get(); }
+    const SnakeSim& soloGame() const { return solo; }
+
+private:
+    static constexpr int LOCAL_SEATS = 256;
+
+    SnakeSim solo;
+    std::vector<uint32_t> storage;
+    std::unique_ptr<SnakeArena> board;
+    uint32_t pendingTick = 0;
+    int8_t pendingAction[LOCAL_SEATS];
+    bool pendingRestart = false;
+    uint64_t restartSeed = 0;
+
+    void clearPending() {
+        std::memset(pendingAction, -1, sizeof(pendingAction));
+        pendingRestart = false;
+        pendingTick = 0;
+    }
+
+    // One server tick (Shard::tickSolo / tickArena) with the inputs logged for it
+    void step() {
+        tick++;
+        bool mine = pendingTick == tick;
+        if (board) {
+            for (int i = 0; i < board->snakeCount(); i++) {
+                if (!board->snake(i).bot) board->setAction(i, mine ? pendingAction[i] : -1);
+            }
+            board->think();
+            board->tick();
+        }
+        else if (mine && pendingRestart) {
+            solo.reset(begin.width, begin.height, begin.fruits, restartSeed);
+        }
+        else {
+            solo.step(mine ? pendingAction[0] : -1);
+        }
+        if (mine) clearPending();
+    }
+};
@@ -0,0 +1,219 @@
+// snake_record_tool.cpp
+// Checks and replays match recordings from snake_match_server (snake_record.h).
+// Without --match it replays every recording in the files from its start. Each keyframe
+// and end hash is checked against the replay, and each keyframe is also decoded on its
+// own to check that a replay could start there. With --match and --tick it jumps to the
+// last keyframe before that tick of one recording, replays up to the tick and prints the
+// board and who played.
+// Compile: g++ snake_record_tool.cpp -std=c++20 -O2 -o snake_record_tool
+// Run:     ./snake_record_tool match-*-shard*.snkrec
+//          ./snake_record_tool match-1700000000-shard0.snkrec --match 12 --tick 900
+
+#include "snake_record.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#endif
+
+//
+// Config
+//
+struct RecordToolConfig {
+    std::vector<const char*> files;
+    uint32_t match = 0; // 0 = check everything
+    uint32_t tick = 0;
+};
+
+static RecordToolConfig parseArgs(int argc, char** argv) {
+    RecordToolConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--match") && i + 1 < argc) cfg.match = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--tick") && i + 1 < argc) cfg.tick = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else cfg.files.push_back(argv[i]);
+    }
+    return cfg;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[1 << 16];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static void printPlayer(int seat, const RecordPlayer& p) {
+    if (p.token == 0) return;
+    in_addr a;
+    a.s_addr = p.ip;
+    printf("  seat %d: %s:%u token %08x\n", seat, inet_ntoa(a), ntohs(p.port), p.token);
+}
+
+static void printBoard(const RecordReplay& r) {
+    int w = r.begin.width, h = r.begin.height;
+    std::vector<char> board((size_t)(w * h), '.');
+    if (const SnakeArena* a = r.arena()) {
+        for (uint32_t f : a->fruits()) board[f] = '*';
+        for (int i = 0; i < a->snakeCount(); i++) {
+            const ArenaSnake& s = a->snake(i);
+            if (!s.alive) continue;
+            for (uint32_t k = 0; k < s.length; k++) board[s.segment(k)] = (char)((k == 0 ? 'A' : 'a') + i % 26);
+            printf("  snake %d: %s, length %u, score %d\n", i, s.bot ? "bot" : "human", s.length, s.score);
+        }
+    }
+    else {
+        const SnakeSim& g = r.soloGame();
+        for (int i = 0; i < g.foodCount; i++) board[g.food[i]] = '*';
+        for (uint32_t k = 0; k < g.length; k++) board[g.segment(k)] = k == 0 ? 'A' : 'a';
+        printf("  length %u, score %d%s\n", g.length, g.score, g.gameOver ? ", game over" : g.gameWon ? ", won" : "");
+    }
+    for (int y = 0; y < h; y++) printf("  %.*s\n", w, &board[(size_t)(y * w)]);
+}
+
+//
+// --match/--tick: the nearest keyframe at or before the tick, then the records after it
+//
+static int showTick(const std::vector<uint8_t>& data, uint32_t match, uint32_t tick) {
+    RecordReader reader(data.data(), data.size());
+    uint16_t shard;
+    if (!reader.open(shard)) return 1;
+    RecordHeader h;
+    const uint8_t* p;
+    const uint8_t* beginPayload = nullptr;
+    RecordHeader beginHeader{};
+    size_t keyframe = SIZE_MAX, index = 0;
+    std::vector<std::pair<RecordHeader, const uint8_t*>> records;
+    while (reader.next(h, p)) {
+        if (h.rec != match) continue;
+        if (h.type == REC_BEGIN) {
+            beginHeader = h;
+            beginPayload = p;
+            records.clear();
+            keyframe = SIZE_MAX;
+            continue;
+        }
+        if (!beginPayload) continue;
+        if (h.type == REC_KEYFRAME && h.tick <= tick) keyframe = records.size();
+        records.push_back({ h, p });
+        if (h.type == REC_END) break;
+    }
+    if (!beginPayload) {
+        printf("no recording %u in shard %u\n", match, shard);
+        return 1;
+    }
+    RecordReplay r;
+    if (!r.start(beginPayload, beginHeader.size, beginHeader.tick)) return 1;
+    if (keyframe != SIZE_MAX) {
+        // Who sat where before the keyframe, without running the ticks up to it
+        for (; index < keyframe; index++) {
+            const uint8_t* q = records[index].second;
+            if (records[index].first.type == REC_SEAT && q[0] < r.begin.seats) recordGetPlayer(q + 2, r.players[q[0]]);
+        }
+        if (!r.restore(records[keyframe].second, records[keyframe].first.size, records[keyframe].first.tick)) {
+            printf("recording %u: the keyframe at tick %u does not decode\n", match, records[keyframe].first.tick);
+            return 1;
+        }
+        index = keyframe + 1;
+    }
+    for (; index < records.size() && records[index].first.tick <= tick; index++) r.apply(records[index].first, records[index].second);
+    if (!r.ended) r.runTo(tick);
+
+    printf("shard %u, recording %u: %s %ux%u, %u ms ticks, seed %llu, from tick %u (%s)\n", shard, match,
+        r.begin.mode ? "arena" : "solo", r.begin.width, r.begin.height, r.begin.tickMs, (unsigned long long)r.begin.seed,
+        r.firstTick, keyframe != SIZE_MAX ? "keyframe" : "start");
+    for (int s = 0; s < (r.begin.mode ? r.begin.seats : 1); s++) printPlayer(s, r.players[s]);
+    printf("tick %u, hash %016llx%s\n", r.tick, (unsigned long long)r.hash(), r.ended && r.tick < tick ? " (the match ended here)" : "");
+    printBoard(r);
+    return r.mismatches ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    RecordToolConfig cfg = parseArgs(argc, argv);
+    if (cfg.files.empty() || (cfg.match && cfg.files.size() != 1)) {
+        printf("usage: snake_record_tool FILE... | FILE --match ID --tick T\n");
+        return 1;
+    }
+    if (cfg.match) {
+        std::vector<uint8_t> data;
+        if (!readFile(cfg.files[0], data)) {
+            printf("cannot read %s\n", cfg.files[0]);
+            return 1;
+        }
+        return showTick(data, cfg.match, cfg.tick);
+    }
+
+    uint64_t recordings = 0, ended = 0, ticks = 0, inputs = 0, keyframes = 0, mismatches = 0, badKeyframes = 0, bytes = 0;
+    double seconds = 0.0;
+    for (const char* path : cfg.files) {
+        std::vector<uint8_t> data;
+        if (!readFile(path, data)) {
+            printf("cannot read %s\n", path);
+            return 1;
+        }
+        bytes += data.size();
+        RecordReader reader(data.data(), data.size());
+        uint16_t shard;
+        if (!reader.open(shard)) {
+            printf("%s: not a recording\n", path);
+            return 1;
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        std::unordered_map<uint32_t, std::unique_ptr<RecordReplay>> live;
+        std::unordered_map<uint32_t, std::pair<const uint8_t*, uint32_t>> begins;
+        RecordHeader h;
+        const uint8_t* p;
+        auto finish = [&](uint32_t rec, RecordReplay& r) {
+            ticks += r.tick - r.firstTick;
+            inputs += r.inputs;
+            keyframes += r.keyframesChecked;
+            ended += r.ended;
+            if (r.mismatches) {
+                mismatches += r.mismatches;
+                printf("%s: recording %u differs from its replay at tick %u\n", path, rec, r.firstMismatch);
+            }
+        };
+        while (reader.next(h, p)) {
+            if (h.type == REC_BEGIN) {
+                auto r = std::make_unique<RecordReplay>();
+                if (!r->start(p, h.size, h.tick)) continue;
+                recordings++;
+                begins[h.rec] = { p, h.size };
+                live[h.rec] = std::move(r);
+                continue;
+            }
+            auto it = live.find(h.rec);
+            if (it == live.end()) continue;
+            it->second->apply(h, p);
+            if (h.type == REC_KEYFRAME) {
+                // The keyframe on its own must give the same state
+                RecordReplay alone;
+                alone.start(begins[h.rec].first, begins[h.rec].second, 0);
+                if (!alone.restore(p, h.size, h.tick) || alone.hash() != it->second->hash()) badKeyframes++;
+            }
+            if (h.type == REC_END) {
+                finish(h.rec, *it->second);
+                live.erase(it);
+                begins.erase(h.rec);
+            }
+        }
+        for (auto& kv : live) finish(kv.first, *kv.second); // still running when the log was cut
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+    printf("%zu files, %.1f MB: %llu recordings (%llu ended), %llu ticks replayed, %llu inputs, %.1f B per tick\n",
+        cfg.files.size(), bytes / 1048576.0, (unsigned long long)recordings, (unsigned long long)ended,
+        (unsigned long long)ticks, (unsigned long long)inputs, ticks ? (double)bytes / ticks : 0.0);
+    printf("%llu keyframes checked, %llu hash mismatches, %llu keyframes that do not decode to their state; replay %.0f ticks/s\n",
+        (unsigned long long)keyframes, (unsigned long long)mismatches, (unsigned long long)badKeyframes,
+        seconds > 0 ? ticks / seconds : 0.0);
+    return mismatches || badKeyframes ? 1 : 0;
+}
@@ -0,0 +1,549 @@
+// snake_render.h
+// Render command buffer. Scene code (snake_scene.h) emits plain commands - filled rects,
+// outlines, text runs, blends and blits of cached surfaces - into a RenderCommands, and a
+// backend plays them: main.cpp's GDI one, RenderSoftware below into 32-bit pixels, or
+// renderPut() into bytes. Nothing in a command points anywhere: text lives in the buffer's
+// own pool and surfaces are named by id, so buffers copy, compare and record as data.
+//
+// RenderOptimizer reorders a buffer so commands of one state - brush colour, pen, font and
+// text colour - run together, but only where painter's order allows: a command never moves
+// past an earlier one it overlaps in another state. It then merges neighbours: repeated
+// fills, fills that join into one rect and stacked blends of one colour. renderDiff() finds
+// the area two buffers draw differently, so a backend can redraw only that.
+//
+// Record (little-endian):
+//   commands u32, text u32 (UTF-16 units),
+//   per command: left, top, right, bottom i32, color u32, arg u32, textLen u16, op u8, param u8, flags u8,
+//   then the text
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+enum RenderOp : uint8_t { RENDER_FILL, RENDER_OUTLINE, RENDER_TEXT, RENDER_BLEND, RENDER_BLIT, RENDER_OPS };
+
+enum RenderTextFlags : uint8_t {
+    RENDER_TEXT_CENTER = 0, // centred in the rect on one line
+    RENDER_TEXT_LEFT = 1,   // from the top left of the rect
+    RENDER_TEXT_RIGHT = 2,  // from the top right of the rect
+    RENDER_TEXT_ALIGN = 3,
+    RENDER_TEXT_BOLD = 4,
+};
+
+static constexpr int RENDER_RECORD_HEADER = 8;
+static constexpr int RENDER_RECORD_CMD = 29;
+
+// Same layout as a Win32 RECT
+struct RenderRect {
+    int32_t left, top, right, bottom;
+};
+
+static inline bool operator==(const RenderRect& a, const RenderRect& b) {
+    return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+// Colours are 0x00BBGGRR, as COLORREF
+static constexpr uint32_t renderRgb(int r, int g, int b) { return (uint32_t)r | (uint32_t)g << 8 | (uint32_t)b << 16; }
+
+struct RenderCmd {
+    RenderRect rect;
+    uint32_t color;   // BLIT: what the surface holds, so a cached copy can be checked
+    uint32_t arg;     // TEXT: offset into the text pool; BLIT: surface id
+    uint16_t textLen;
+    uint8_t op;
+    uint8_t param;    // OUTLINE: pen width; TEXT: font height; BLEND: alpha
+    uint8_t flags;    // TEXT: RenderTextFlags
+    uint8_t pad[3];
+};
+static_assert(std::is_trivially_copyable_v<RenderCmd> && sizeof(RenderCmd) == 32, "RenderCmd is a plain 32-byte record");
+
+class RenderCommands {
+public:
+    std::vector<RenderCmd> cmds;
+    std::vector<wchar_t> text;
+
+    void clear() {
+        cmds.clear();
+        text.clear();
+    }
+
+    void fill(const RenderRect& r, uint32_t color) { push(RENDER_FILL, r, color); }
+
+    // Rectangle() with a hollow brush: a pen of the given width round the rect
+    void outline(const RenderRect& r, uint32_t color, int width) { push(RENDER_OUTLINE, r, color).param = (uint8_t)width; }
+
+    void textRun(const RenderRect& r, const wchar_t* s, int len, uint32_t color, int fontHeight, int flags) {
+        RenderCmd& c = push(RENDER_TEXT, r, color);
+        c.arg = (uint32_t)text.size();
+        c.textLen = (uint16_t)len;
+        c.param = (uint8_t)fontHeight;
+        c.flags = (uint8_t)flags;
+        text.insert(text.end(), s, s + len);
+    }
+
+    void blend(const RenderRect& r, uint32_t color, int alpha) { push(RENDER_BLEND, r, color).param = (uint8_t)alpha; }
+
+    void blit(const RenderRect& r, uint32_t surface, uint32_t key) { push(RENDER_BLIT, r, key).arg = surface; }
+
+    const wchar_t* textOf(const RenderCmd& c) const { return text.data() + c.arg; }
+
+private:
+    RenderCmd& push(RenderOp op, const RenderRect& r, uint32_t color) {
+        RenderCmd c = {};
+        c.rect = r;
+        c.color = color;
+        c.op = op;
+        cmds.push_back(c);
+        return cmds.back();
+    }
+};
+
+// What a command can touch: outlines straddle their rect's edge
+static inline RenderRect renderBounds(const RenderCmd& c) {
+    if (c.op != RENDER_OUTLINE) return c.rect;
+    int in = c.param / 2;
+    return { c.rect.left - in, c.rect.top - in, c.rect.right + in, c.rect.bottom + in };
+}
+
+static inline bool renderIntersects(const RenderRect& a, const RenderRect& b) {
+    return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+static inline void renderUnion(RenderRect& d, const RenderRect& r, bool& any) {
+    if (!any) {
+        d = r;
+        any = true;
+        return;
+    }
+    d.left = (std::min)(d.left, r.left);
+    d.top = (std::min)(d.top, r.top);
+    d.right = (std::max)(d.right, r.right);
+    d.bottom = (std::max)(d.bottom, r.bottom);
+}
+
+//
+// State: what a backend switches to play a command. Fills take a brush, outlines a pen,
+// text a font and a colour; blends and blits carry theirs with them.
+//
+static inline uint64_t renderState(const RenderCmd& c) {
+    switch (c.op) {
+    case RENDER_FILL: return c.color;
+    case RENDER_OUTLINE: return (uint64_t)c.param << 32 | c.color;
+    case RENDER_TEXT: return (uint64_t)(c.flags & RENDER_TEXT_BOLD) << 40 | (uint64_t)c.param << 32 | c.color;
+    case RENDER_BLEND: return (uint64_t)c.param << 32 | c.color;
+    default: return (uint64_t)c.color << 32 | c.arg;
+    }
+}
+
+// State switches a backend makes playing the commands in order
+static inline uint32_t renderStateChanges(const std::vector<RenderCmd>& cmds) {
+    uint64_t brush = UINT64_MAX, pen = UINT64_MAX, font = UINT64_MAX, color = UINT64_MAX;
+    uint32_t changes = 0;
+    auto set = [&](uint64_t& cur, uint64_t v) {
+        if (cur != v) {
+            cur = v;
+            changes++;
+        }
+    };
+    for (const RenderCmd& c : cmds) {
+        if (c.op == RENDER_FILL) set(brush, c.color);
+        else if (c.op == RENDER_OUTLINE) set(pen, renderState(c));
+        else if (c.op == RENDER_TEXT) {
+            set(font, renderState(c) >> 32);
+            set(color, c.color);
+        }
+    }
+    return changes;
+}
+
+struct RenderOptimizeStats {
+    uint32_t commands = 0, merged = 0;            // in, and out after merging
+    uint32_t changesBefore = 0, changesAfter = 0; // state switches
+};
+
+//
+// Optimizer: commands that overlap in different states keep their order; the rest are
+// free. Overlaps are found through a coarse grid of buckets over the buffer's extent. The
+// schedule then drains one state while it has commands ready, and otherwise moves to the
+// state whose next ready command came earliest. Scratch is kept between frames.
+//
+class RenderOptimizer {
+public:
+    RenderOptimizeStats run(RenderCommands& rc) {
+        RenderOptimizeStats st;
+        std::vector<RenderCmd>& v = rc.cmds;
+        uint32_t n = (uint32_t)v.size();
+        st.commands = st.merged = n;
+        st.changesBefore = st.changesAfter = renderStateChanges(v);
+        if (n < 2) return st;
+
+        findOverlaps(v);
+        schedule(v);
+        merge(v);
+        st.merged = (uint32_t)v.size();
+        st.changesAfter = renderStateChanges(v);
+        return st;
+    }
+
+private:
+    static constexpr int MAX_BUCKETS = 64; // a side
+    static constexpr int BIG_BUCKETS = 16;
+
+    static uint64_t key(const RenderCmd& c) { return (uint64_t)c.op << 56 ^ renderState(c); }
+
+    // Order matters between overlapping commands unless they are the same draw in the same
+    // state; blits of one surface at two places are not
+    static bool ordered(const RenderCmd& a, const RenderCmd& b) { return a.op == RENDER_BLIT || key(a) != key(b); }
+
+    void findOverlaps(const std::vector<RenderCmd>& v) {
+        uint32_t n = (uint32_t)v.size();
+        bounds.resize(n);
+        RenderRect extent = {};
+        bool any = false;
+        for (uint32_t i = 0; i < n; i++) {
+            bounds[i] = renderBounds(v[i]);
+            renderUnion(extent, bounds[i], any);
+        }
+        int span = (std::max)(extent.right - extent.left, extent.bottom - extent.top);
+        int size = (std::max)(32, span / MAX_BUCKETS + 1);
+        int bw = (extent.right - extent.left) / size + 1, bh = (extent.bottom - extent.top) / size + 1;
+        if ((int)buckets.size() < bw * bh) buckets.resize((size_t)bw * bh);
+        for (int b = 0; b < bw * bh; b++) buckets[(size_t)b].clear();
+
+        // Commands over many buckets (backgrounds, overlays, rows of text) are checked
+        // against everything directly instead of filling every bucket they cover
+        pairs.clear();
+        big.clear();
+        stamp.assign(n, UINT32_MAX);
+        auto check = [&](uint32_t i, uint32_t j) {
+            if (renderIntersects(bounds[i], bounds[j]) && ordered(v[i], v[j])) pairs.push_back({ i, j });
+        };
+        for (uint32_t j = 0; j < n; j++) {
+            const RenderRect& r = bounds[j];
+            if (r.left >= r.right || r.top >= r.bottom) continue; // draws nothing
+            int x0 = (r.left - extent.left) / size, x1 = (r.right - 1 - extent.left) / size;
+            int y0 = (r.top - extent.top) / size, y1 = (r.bottom - 1 - extent.top) / size;
+            if ((x1 - x0 + 1) * (y1 - y0 + 1) > BIG_BUCKETS) {
+                for (uint32_t i = 0; i < j; i++) check(i, j);
+                big.push_back(j);
+                continue;
+            }
+            for (uint32_t i : big) check(i, j);
+            for (int by = y0; by <= y1; by++) {
+                for (int bx = x0; bx <= x1; bx++) {
+                    std::vector<uint32_t>& bucket = buckets[(size_t)by * bw + bx];
+                    for (uint32_t i : bucket) {
+                        if (stamp[i] == j) continue;
+                        stamp[i] = j;
+                        check(i, j);
+                    }
+                    bucket.push_back(j);
+                }
+            }
+        }
+    }
+
+    void schedule(std::vector<RenderCmd>& v) {
+        uint32_t n = (uint32_t)v.size();
+        // Successors, by counting sort of the pairs
+        first.assign(n + 1, 0);
+        waiting.assign(n, 0);
+        for (const Pair& p : pairs) {
+            first[p.before + 1]++;
+            waiting[p.after]++;
+        }
+        for (uint32_t i = 0; i < n; i++) first[i + 1] += first[i];
+        next.resize(pairs.size());
+        fillAt.assign(first.begin(), first.end() - 1);
+        for (const Pair& p : pairs) next[fillAt[p.before]++] = p.after;
+
+        // One ready queue per state
+        queues.clear();
+        queueOf.resize(n);
+        for (uint32_t i = 0; i < n; i++) {
+            uint64_t k = key(v[i]);
+            size_t q = 0;
+            while (q < queues.size() && queues[q].key != k) q++;
+            if (q == queues.size()) {
+                queues.emplace_back();
+                queues[q].key = k;
+            }
+            queueOf[i] = (uint32_t)q;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (waiting[i] == 0) queues[queueOf[i]].ready.push_back(i);
+        }
+
+        out.clear();
+        size_t cur = SIZE_MAX;
+        while (out.size() < n) {
+            if (cur == SIZE_MAX || queues[cur].head == queues[cur].ready.size()) {
+                cur = SIZE_MAX;
+                for (size_t q = 0; q < queues.size(); q++) {
+                    if (queues[q].head == queues[q].ready.size()) continue;
+                    if (cur == SIZE_MAX || queues[q].ready[queues[q].head] < queues[cur].ready[queues[cur].head]) cur = q;
+                }
+            }
+            uint32_t i = queues[cur].ready[queues[cur].head++];
+            out.push_back(v[i]);
+            for (uint32_t e = first[i]; e < first[i + 1]; e++) {
+                uint32_t s = next[e];
+                if (--waiting[s] == 0) queues[queueOf[s]].ready.push_back(s);
+            }
+        }
+        v.swap(out);
+    }
+
+    static void merge(std::vector<RenderCmd>& v) {
+        size_t out = 0;
+        for (size_t i = 0; i < v.size(); i++) {
+            const RenderCmd& c = v[i];
+            if (out > 0) {
+                RenderCmd& p = v[out - 1];
+                const RenderRect a = p.rect;
+                const RenderRect& b = c.rect;
+                bool same = p.op == c.op && p.color == c.color;
+                if (same && c.op == RENDER_FILL) {
+                    if (a == b) continue;
+                    // One rect continuing the other, across or down
+                    if (a.top == b.top && a.bottom == b.bottom && (a.right == b.left || b.right == a.left)) {
+                        p.rect.left = (std::min)(a.left, b.left);
+                        p.rect.right = (std::max)(a.right, b.right);
+                        continue;
+                    }
+                    if (a.left == b.left && a.right == b.right && (a.bottom == b.top || b.bottom == a.top)) {
+                        p.rect.top = (std::min)(a.top, b.top);
+                        p.rect.bottom = (std::max)(a.bottom, b.bottom);
+                        continue;
+                    }
+                }
+                if (same && c.op == RENDER_BLEND && a == b) {
+                    // Two coats of one colour: 1 - (1 - a)(1 - b)
+                    p.param = (uint8_t)(p.param + c.param - p.param * c.param / 255);
+                    continue;
+                }
+            }
+            v[out++] = c;
+        }
+        v.resize(out);
+    }
+
+    struct Pair {
+        uint32_t before, after;
+    };
+    struct Queue {
+        uint64_t key = 0;
+        std::vector<uint32_t> ready;
+        size_t head = 0;
+    };
+
+    std::vector<RenderRect> bounds;
+    std::vector<std::vector<uint32_t>> buckets;
+    std::vector<uint32_t> stamp, big;
+    std::vector<Pair> pairs;
+    std::vector<uint32_t> first, fillAt, next, waiting, queueOf;
+    std::vector<Queue> queues;
+    std::vector<RenderCmd> out;
+};
+
+//
+// Diff: false if the buffers draw the same; otherwise dirty bounds everything that may
+// differ. Commands are compared in order, so anything after a shift counts.
+//
+static inline bool renderSameCmd(const RenderCommands& a, const RenderCmd& x, const RenderCommands& b, const RenderCmd& y) {
+    if (x.op != y.op || !(x.rect == y.rect) || x.color != y.color || x.param != y.param || x.flags != y.flags) return false;
+    if (x.op != RENDER_TEXT) return x.arg == y.arg;
+    return x.textLen == y.textLen && std::equal(a.textOf(x), a.textOf(x) + x.textLen, b.textOf(y));
+}
+
+static inline bool renderDiff(const RenderCommands& a, const RenderCommands& b, RenderRect& dirty) {
+    bool any = false;
+    size_t n = (std::max)(a.cmds.size(), b.cmds.size());
+    for (size_t i = 0; i < n; i++) {
+        bool inA = i < a.cmds.size(), inB = i < b.cmds.size();
+        if (inA && inB && renderSameCmd(a, a.cmds[i], b, b.cmds[i])) continue;
+        if (inA) renderUnion(dirty, renderBounds(a.cmds[i]), any);
+        if (inB) renderUnion(dirty, renderBounds(b.cmds[i]), any);
+    }
+    return any;
+}
+
+//
+// Recorder
+//
+static inline uint8_t* renderPutN(uint8_t* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) *p++ = (uint8_t)(v >> (8 * i));
+    return p;
+}
+
+static inline uint64_t renderGetN(const uint8_t*& p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t)*p++ << (8 * i);
+    return v;
+}
+
+static inline void renderPut(std::vector<uint8_t>& out, const RenderCommands& rc) {
+    size_t at = out.size();
+    out.resize(at + RENDER_RECORD_HEADER + rc.cmds.size() * RENDER_RECORD_CMD + rc.text.size() * 2);
+    uint8_t* p = out.data() + at;
+    p = renderPutN(p, (uint32_t)rc.cmds.size(), 4);
+    p = renderPutN(p, (uint32_t)rc.text.size(), 4);
+    for (const RenderCmd& c : rc.cmds) {
+        p = renderPutN(p, (uint32_t)c.rect.left, 4);
+        p = renderPutN(p, (uint32_t)c.rect.top, 4);
+        p = renderPutN(p, (uint32_t)c.rect.right, 4);
+        p = renderPutN(p, (uint32_t)c.rect.bottom, 4);
+        p = renderPutN(p, c.color, 4);
+        p = renderPutN(p, c.arg, 4);
+        p = renderPutN(p, c.textLen, 2);
+        *p++ = c.op;
+        *p++ = c.param;
+        *p++ = c.flags;
+    }
+    for (wchar_t ch : rc.text) p = renderPutN(p, (uint16_t)ch, 2);
+}
+
+// One recorded buffer from p, which is moved past it; false if it is cut short or bad
+static inline bool renderGet(const uint8_t*& p, const uint8_t* end, RenderCommands& rc) {
+    if (end - p < RENDER_RECORD_HEADER) return false;
+    const uint8_t* q = p;
+    size_t count = (size_t)renderGetN(q, 4), text = (size_t)renderGetN(q, 4);
+    size_t left = (size_t)(end - q);
+    if (left / RENDER_RECORD_CMD < count || (left - count * RENDER_RECORD_CMD) / 2 < text) return false;
+    rc.clear();
+    rc.cmds.resize(count);
+    for (RenderCmd& c : rc.cmds) {
+        c = {};
+        c.rect.left = (int32_t)renderGetN(q, 4);
+        c.rect.top = (int32_t)renderGetN(q, 4);
+        c.rect.right = (int32_t)renderGetN(q, 4);
+        c.rect.bottom = (int32_t)renderGetN(q, 4);
+        c.color = (uint32_t)renderGetN(q, 4);
+        c.arg = (uint32_t)renderGetN(q, 4);
+        c.textLen = (uint16_t)renderGetN(q, 2);
+        c.op = *q++;
+        c.param = *q++;
+        c.flags = *q++;
+        if (c.op >= RENDER_OPS || (c.op == RENDER_TEXT && (size_t)c.arg + c.textLen > text)) return false;
+    }
+    rc.text.resize(text);
+    for (wchar_t& ch : rc.text) ch = (wchar_t)renderGetN(q, 2);
+    p = q;
+    return true;
+}
+
+//
+// Software backend: into 0x00RRGGBB pixels, clipped to clip. Text needs a font and is
+// left out. Surfaces for blits come from surface(id, key, RenderCommands&), are drawn
+// once into pixels of their own and kept while their key and size hold.
+//
+class RenderSoftware {
+public:
+    template <typename SurfaceFn>
+    void play(const RenderCommands& rc, uint32_t* px, int w, int h, int stride, RenderRect clip, SurfaceFn&& surface) {
+        clip.left = (std::max)(clip.left, 0);
+        clip.top = (std::max)(clip.top, 0);
+        clip.right = (std::min)(clip.right, w);
+        clip.bottom = (std::min)(clip.bottom, h);
+        for (const RenderCmd& c : rc.cmds) {
+            if (!renderIntersects(renderBounds(c), clip)) continue;
+            switch (c.op) {
+            case RENDER_FILL:
+                fill(px, stride, clip, c.rect, pixel(c.color));
+                break;
+            case RENDER_OUTLINE: {
+                RenderRect r = renderBounds(c);
+                int pw = c.param;
+                uint32_t p = pixel(c.color);
+                fill(px, stride, clip, { r.left, r.top, r.right, r.top + pw }, p);
+                fill(px, stride, clip, { r.left, r.bottom - pw, r.right, r.bottom }, p);
+                fill(px, stride, clip, { r.left, r.top, r.left + pw, r.bottom }, p);
+                fill(px, stride, clip, { r.right - pw, r.top, r.right, r.bottom }, p);
+                break;
+            }
+            case RENDER_BLEND:
+                blend(px, stride, clip, c.rect, pixel(c.color), c.param);
+                break;
+            case RENDER_BLIT:
+                blit(px, stride, clip, c, surface);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+private:
+    struct Surface {
+        uint32_t id = 0, key = 0;
+        int w = 0, h = 0;
+        std::vector<uint32_t> px;
+    };
+
+    static uint32_t pixel(uint32_t colorref) {
+        return (colorref & 0xFF) << 16 | (colorref & 0xFF00) | (colorref >> 16 & 0xFF);
+    }
+
+    static bool clipTo(const RenderRect& clip, RenderRect& r) {
+        r.left = (std::max)(r.left, clip.left);
+        r.top = (std::max)(r.top, clip.top);
+        r.right = (std::min)(r.right, clip.right);
+        r.bottom = (std::min)(r.bottom, clip.bottom);
+        return r.left < r.right && r.top < r.bottom;
+    }
+
+    static void fill(uint32_t* px, int stride, const RenderRect& clip, RenderRect r, uint32_t p) {
+        if (!clipTo(clip, r)) return;
+        for (int y = r.top; y < r.bottom; y++) std::fill(px + (size_t)y * stride + r.left, px + (size_t)y * stride + r.right, p);
+    }
+
+    static void blend(uint32_t* px, int stride, const RenderRect& clip, RenderRect r, uint32_t p, int alpha) {
+        if (!clipTo(clip, r)) return;
+        uint32_t a = (uint32_t)alpha, na = 255 - a;
+        uint32_t prb = (p & 0xFF00FF) * a, pg = (p & 0x00FF00) * a;
+        for (int y = r.top; y < r.bottom; y++) {
+            uint32_t* row = px + (size_t)y * stride;
+            for (int x = r.left; x < r.right; x++) {
+                uint32_t d = row[x];
+                row[x] = (((d & 0xFF00FF) * na + prb) >> 8 & 0xFF00FF) | (((d & 0x00FF00) * na + pg) >> 8 & 0x00FF00);
+            }
+        }
+    }
+
+    template <typename SurfaceFn>
+    void blit(uint32_t* px, int stride, const RenderRect& clip, const RenderCmd& c, SurfaceFn& surface) {
+        int w = c.rect.right - c.rect.left, h = c.rect.bottom - c.rect.top;
+        if (w <= 0 || h <= 0) return;
+        Surface* s = nullptr;
+        for (Surface& k : surfaces) {
+            if (k.id == c.arg) s = &k;
+        }
+        if (!s) {
+            surfaces.emplace_back();
+            s = &surfaces.back();
+            s->id = c.arg;
+        }
+        if (s->key != c.color || s->w != w || s->h != h || s->px.empty()) {
+            s->key = c.color;
+            s->w = w;
+            s->h = h;
+            s->px.assign((size_t)w * h, 0);
+            RenderCommands sc;
+            surface(c.arg, c.color, sc);
+            RenderSoftware inner;
+            inner.play(sc, s->px.data(), w, h, w, { 0, 0, w, h }, surface);
+        }
+        RenderRect r = c.rect;
+        if (!clipTo(clip, r)) return;
+        for (int y = r.top; y < r.bottom; y++) {
+            const uint32_t* src = s->px.data() + (size_t)(y - c.rect.top) * s->w + (r.left - c.rect.left);
+            std::memcpy(px + (size_t)y * stride + r.left, src, sizeof(uint32_t) * (size_t)(r.right - r.left));
+        }
+    }
+
+    std::vector<Surface> surfaces;
+};
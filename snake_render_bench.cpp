@@ -0,0 +1,221 @@
+// snake_render_bench.cpp
+// The game's scenes (snake_scene.h) as render commands (snake_render.h), frame by frame:
+// commands emitted and left after RenderOptimizer, the state switches that saves, and the
+// cost of building, optimizing, recording and software-rastering them, with and without
+// SceneCache and diffing each frame against the last. Every frame is also rastered as
+// emitted: "delta" is the largest channel difference the optimizer made (merged blends
+// round once instead of per coat), and "same" says whether the diffed raster matched the
+// full one on every frame. Text is not rastered here.
+// Compile: g++ snake_render_bench.cpp -std=c++20 -O2 -o snake_render_bench
+// Run:     ./snake_render_bench [--width 40] [--height 40] [--cell 30] [--frames 480]
+
+#include "snake_scene.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//
+// Config
+//
+struct RenderBenchConfig {
+    int width = 40;   // main.cpp's largest board
+    int height = 40;
+    int cell = 30;
+    int frames = 480; // two seconds at 240 fps
+    int framesPerTick = 19; // 80 ms ticks at 240 fps
+};
+
+static RenderBenchConfig parseArgs(int argc, char** argv) {
+    RenderBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--cell") && i + 1 < argc) cfg.cell = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc) cfg.frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--frames-per-tick") && i + 1 < argc) cfg.framesPerTick = atoi(argv[++i]);
+    }
+    return cfg;
+}
+
+using BenchClock = std::chrono::steady_clock;
+
+static double usSince(BenchClock::time_point t) {
+    return std::chrono::duration<double, std::micro>(BenchClock::now() - t).count();
+}
+
+//
+// Scenes: what SceneInput main.cpp's build stage would fill in on frame f
+//
+enum BenchScene { BENCH_MENU, BENCH_MENU_MOUSE, BENCH_SETTINGS, BENCH_PLAYING, BENCH_PAUSED, BENCH_GAME_OVER, BENCH_SCENES };
+static const char* benchSceneNames[BENCH_SCENES] = { "menu", "menu+mouse", "settings", "playing", "paused", "game over" };
+
+struct BenchBoard {
+    std::vector<RenderRect> path; // a boustrophedon cycle of cells
+    int cell = 0;
+
+    void init(const RenderBenchConfig& cfg) {
+        cell = cfg.cell;
+        std::vector<std::pair<int, int>> cells;
+        for (int x = 0; x < cfg.width; x++) cells.push_back({ x, 0 });
+        for (int x = cfg.width - 1; x >= 0; x--) {
+            if ((cfg.width - 1 - x) % 2 == 0) for (int y = 1; y < cfg.height; y++) cells.push_back({ x, y });
+            else for (int y = cfg.height - 1; y >= 1; y--) cells.push_back({ x, y });
+        }
+        for (auto& c : cells) path.push_back({ c.first * cell, c.second * cell, 0, 0 });
+    }
+
+    // The snake of half the board, interpolated a fraction of the way into the tick
+    void snake(int tick, float alpha, std::vector<RenderRect>& out) const {
+        size_t n = path.size(), length = n / 2;
+        out.clear();
+        for (size_t i = 0; i < length; i++) {
+            const RenderRect& b = path[((size_t)tick + length - 1 - i) % n];
+            const RenderRect& a = path[((size_t)tick + length - 2 - i + n) % n];
+            int x = (int)(a.left + (b.left - a.left) * alpha), y = (int)(a.top + (b.top - a.top) * alpha);
+            out.push_back({ x + 1, y + 1, x + cell - 1, y + cell - 1 });
+        }
+    }
+};
+
+static void benchInput(const RenderBenchConfig& cfg, const BenchBoard& board, BenchScene scene, int frame, SceneInput& in) {
+    in.gridW = cfg.width;
+    in.gridH = cfg.height;
+    in.cell = cfg.cell;
+    in.client = { 0, 0, cfg.width * cfg.cell, cfg.height * cfg.cell + 40 };
+    in.fps = 240;
+    in.cellSize = cfg.cell;
+    in.gridWidth = cfg.width;
+    in.gridHeight = cfg.height;
+    in.fruitCount = 15;
+    in.speedName = L"Hard";
+    in.started = true;
+    in.score = 4200;
+    in.mouseX = in.mouseY = 0;
+    in.screen = scene == BENCH_MENU || scene == BENCH_MENU_MOUSE ? SCENE_MENU : scene == BENCH_SETTINGS ? SCENE_SETTINGS : SCENE_PLAYING;
+    if (scene == BENCH_MENU_MOUSE) {
+        // Across the buttons, a pixel a frame
+        in.mouseX = in.client.right / 2;
+        in.mouseY = frame % in.client.bottom;
+    }
+    in.paused = scene == BENCH_PAUSED;
+    in.gameOver = scene == BENCH_GAME_OVER;
+
+    int tick = scene == BENCH_PLAYING ? frame / cfg.framesPerTick : 0;
+    float alpha = scene == BENCH_PLAYING ? (float)(frame % cfg.framesPerTick) / cfg.framesPerTick : 1.0f;
+    in.segments.clear();
+    in.fruits.clear();
+    if (in.screen != SCENE_PLAYING) return;
+    board.snake(tick, alpha, in.segments);
+    for (int i = 0; i < 15; i++) {
+        const RenderRect& p = board.path[((size_t)tick + board.path.size() / 2 + 7 + (size_t)i * 37) % board.path.size()];
+        in.fruits.push_back({ p.left, p.top, p.left + cfg.cell, p.top + cfg.cell });
+    }
+}
+
+//
+// One scene, frame by frame
+//
+struct BenchTotals {
+    double emitted = 0, merged = 0, changesBefore = 0, changesAfter = 0;
+    double buildUs = 0, optimizeUs = 0, cachedUs = 0, recordBytes = 0;
+    double rasterRawUs = 0, rasterUs = 0, diffUs = 0, dirtyShare = 0;
+    int cacheHits = 0, skipped = 0;
+    int maxDelta = 0;      // largest channel difference, optimized against as emitted
+    bool diffSame = true;  // diffed frames match full ones
+};
+
+static int channelDelta(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+    int most = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        for (int s = 0; s < 24; s += 8) most = (std::max)(most, abs((int)(a[i] >> s & 0xFF) - (int)(b[i] >> s & 0xFF)));
+    }
+    return most;
+}
+
+static void runScene(const RenderBenchConfig& cfg, const BenchBoard& board, BenchScene scene) {
+    SceneInput in;
+    RenderCommands raw, opt, cached, drawn;
+    RenderOptimizer optimizer;
+    SceneCache cache;
+    RenderOptimizeStats cacheStats;
+    RenderSoftware softRaw, soft, softDiff;
+    std::vector<uint8_t> record;
+    int w = cfg.width * cfg.cell, h = cfg.height * cfg.cell + 40;
+    std::vector<uint32_t> pxRaw((size_t)w * h), px((size_t)w * h), pxDiff((size_t)w * h);
+    RenderRect all = { 0, 0, w, h };
+    BenchTotals t;
+
+    for (int f = 0; f < cfg.frames; f++) {
+        benchInput(cfg, board, scene, f, in);
+
+        auto t0 = BenchClock::now();
+        raw.clear();
+        sceneBuild(in, raw);
+        t.buildUs += usSince(t0);
+
+        opt.cmds = raw.cmds;
+        opt.text = raw.text;
+        t0 = BenchClock::now();
+        RenderOptimizeStats st = optimizer.run(opt);
+        t.optimizeUs += usSince(t0);
+        t.emitted += st.commands;
+        t.merged += st.merged;
+        t.changesBefore += st.changesBefore;
+        t.changesAfter += st.changesAfter;
+
+        t0 = BenchClock::now();
+        if (cache.build(in, cached, cacheStats)) t.cacheHits++;
+        t.cachedUs += usSince(t0);
+
+        record.clear();
+        renderPut(record, opt);
+        t.recordBytes += (double)record.size();
+
+        t0 = BenchClock::now();
+        softRaw.play(raw, pxRaw.data(), w, h, w, all, sceneSurface);
+        t.rasterRawUs += usSince(t0);
+        t0 = BenchClock::now();
+        soft.play(opt, px.data(), w, h, w, all, sceneSurface);
+        t.rasterUs += usSince(t0);
+
+        // The diffed frame redraws only what changed since the last
+        t0 = BenchClock::now();
+        RenderRect dirty;
+        if (drawn.cmds.empty()) softDiff.play(opt, pxDiff.data(), w, h, w, all, sceneSurface);
+        else if (renderDiff(drawn, opt, dirty)) {
+            softDiff.play(opt, pxDiff.data(), w, h, w, dirty, sceneSurface);
+            dirty.left = (std::max)(dirty.left, 0);
+            dirty.top = (std::max)(dirty.top, 0);
+            dirty.right = (std::min)(dirty.right, w);
+            dirty.bottom = (std::min)(dirty.bottom, h);
+            t.dirtyShare += (double)(dirty.right - dirty.left) * (dirty.bottom - dirty.top) / ((double)w * h);
+        } else t.skipped++;
+        t.diffUs += usSince(t0);
+        drawn.cmds = opt.cmds;
+        drawn.text = opt.text;
+
+        t.maxDelta = (std::max)(t.maxDelta, channelDelta(pxRaw, px));
+        if (px != pxDiff) t.diffSame = false;
+    }
+
+    double n = cfg.frames;
+    printf("%-10s %6.0f -> %-5.0f %5.0f -> %-5.0f %7.1f %8.1f %7.1f %5.0f%% %8.0f %8.0f %8.0f %8.0f %5.1f%% %4.0f%% %5d %s\n",
+        benchSceneNames[scene], t.emitted / n, t.merged / n, t.changesBefore / n, t.changesAfter / n, t.buildUs / n,
+        t.optimizeUs / n, t.cachedUs / n, 100.0 * t.cacheHits / n, t.recordBytes / n, t.rasterRawUs / n, t.rasterUs / n,
+        t.diffUs / n, 100.0 * t.dirtyShare / n, 100.0 * t.skipped / n, t.maxDelta, t.diffSame ? "yes" : "NO");
+}
+
+int main(int argc, char** argv) {
+    RenderBenchConfig cfg = parseArgs(argc, argv);
+    BenchBoard board;
+    board.init(cfg);
+    printf("%dx%d board, %d px cells, %d frames a scene, a tick every %d frames; times in us a frame\n", cfg.width, cfg.height,
+        cfg.cell, cfg.frames, cfg.framesPerTick);
+    printf("%-10s %15s %14s %7s %8s %7s %6s %8s %8s %8s %8s %6s %5s %5s %s\n", "scene", "commands", "state switches", "build",
+        "optimize", "cached", "hits", "bytes", "raw", "raster", "diffed", "dirty", "skip", "delta", "same");
+    for (int s = 0; s < BENCH_SCENES; s++) runScene(cfg, board, (BenchScene)s);
+    return 0;
+}
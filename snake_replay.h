@@ -0,0 +1,271 @@
+// snake_replay.h
+// Prioritized experience replay for off-policy training on the headless simulator.
+// Transitions are fixed-size compact records (head cell + 2-bit moves down the body + food),
+// kept in a ring that any number of producer threads append to without a lock. A sum-tree
+// of fixed-point priorities, updated with atomic adds, drives proportional sampling.
+
+#pragma once
+
+#include "snake_sim.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+//
+// Record layout: ReplayHeader | food[maxFood] | nextFood[maxFood] | moves (4 per byte)
+// The next state is not stored: it is the state stepped with the action, with nextFood
+// (which the step's random placement produced) put back.
+//
+struct ReplayHeader {
+    uint32_t head;
+    uint32_t length;
+    uint8_t dir;
+    uint8_t action;
+    uint8_t done;
+    uint8_t foodCount;
+    uint8_t nextFoodCount;
+    uint8_t pad[3];
+    float reward;
+};
+
+struct ReplaySample {
+    uint64_t slot;
+    uint32_t version; // of the record when sampled, so late priority updates can be dropped
+    double probability;
+};
+
+class ReplayBuffer {
+public:
+    // capacity transitions of boards up to w x h with up to maxFood fruits.
+    // Stored priorities are priority^alpha.
+    ReplayBuffer(size_t capacity, int w, int h, int maxFood, double alpha)
+        : capacity(capacity), w(w), h(h), maxFood(maxFood), alpha(alpha) {
+        size_t moveBytes = ((size_t)w * h + 3) / 4;
+        recordBytes = (sizeof(ReplayHeader) + sizeof(uint32_t) * 2 * maxFood + moveBytes + 7) & ~(size_t)7;
+        records.reset(new uint8_t[recordBytes * capacity]);
+        versions.reset(new std::atomic<uint32_t>[capacity]);
+        for (size_t i = 0; i < capacity; i++) versions[i].store(0, std::memory_order_relaxed);
+
+        leaves = 1;
+        while (leaves < capacity) leaves <<= 1;
+        tree.reset(new std::atomic<uint64_t>[leaves * 2]);
+        for (size_t i = 0; i < leaves * 2; i++) tree[i].store(0, std::memory_order_relaxed);
+    }
+
+    size_t size() const { return (size_t)std::min<uint64_t>(cursor.load(std::memory_order_relaxed), capacity); }
+    size_t bytesPerRecord() const { return recordBytes; }
+    double totalPriority() const { return fromFixed(tree[1].load(std::memory_order_acquire)); }
+
+    //
+    // Producers (any thread)
+    //
+    // Append the transition before --action--> after. New records get the largest priority
+    // seen so far so each is sampled at least once soon.
+    uint64_t add(const SnakeSim& before, int action, float reward, bool done, const SnakeSim& after) {
+        uint64_t seq = cursor.fetch_add(1, std::memory_order_relaxed);
+        size_t slot = (size_t)(seq % capacity);
+
+        // Seqlock: odd while writing. A writer that laps a stalled one waits its turn.
+        std::atomic<uint32_t>& ver = versions[slot];
+        uint32_t v = ver.load(std::memory_order_relaxed);
+        for (;;) {
+            if ((v & 1) == 0 && ver.compare_exchange_weak(v, v + 1, std::memory_order_acquire)) break;
+            v = ver.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        encode(record(slot), before, action, reward, done, after);
+        ver.store(v + 2, std::memory_order_release);
+
+        setLeaf(slot, maxPriority.load(std::memory_order_relaxed));
+        return slot;
+    }
+
+    //
+    // Sampler
+    //
+    // Proportional, stratified sampling of n records; each is copied to recordsOut
+    // (n * bytesPerRecord()) under its seqlock so a concurrent overwrite is never seen torn.
+    // Returns how many were sampled (fewer only if the buffer is empty).
+    int sample(int n, SimRng& rng, ReplaySample* out, uint8_t* recordsOut) const {
+        uint64_t total = tree[1].load(std::memory_order_acquire);
+        if (total == 0 || n <= 0) return 0;
+
+        uint64_t segment = total / (uint64_t)n;
+        int got = 0;
+        for (int i = 0, tries = 0; i < n && tries < n * 8; tries++) {
+            uint64_t target = segment * (uint64_t)i + (segment ? rng.next() % segment : 0);
+            size_t slot = findLeaf(target);
+            uint64_t p = tree[leaves + slot].load(std::memory_order_acquire);
+            if (p == 0 || slot >= capacity) continue; // raced with an update; draw again
+
+            const std::atomic<uint32_t>& ver = versions[slot];
+            uint32_t v0 = ver.load(std::memory_order_acquire);
+            if (v0 & 1) continue;
+            std::memcpy(recordsOut + recordBytes * got, record(slot), recordBytes);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (ver.load(std::memory_order_relaxed) != v0) continue;
+
+            out[got++] = { slot, v0, double(p) / double(total) };
+            i++;
+        }
+        return got;
+    }
+
+    // New priority (e.g. |TD error| + eps) for a sampled record; ignored if it was overwritten
+    void updatePriority(const ReplaySample& s, double priority) {
+        if (versions[s.slot].load(std::memory_order_acquire) != s.version) return;
+        uint64_t p = toFixed(std::pow(priority, alpha));
+        uint64_t seen = maxPriority.load(std::memory_order_relaxed);
+        while (p > seen && !maxPriority.compare_exchange_weak(seen, p, std::memory_order_relaxed)) {}
+        setLeaf((size_t)s.slot, p);
+
+        // add() may have overwritten the slot between the check and the swap, and its leaf
+        // then holds the old record's priority: give the new one back the largest. Either
+        // our swap came after add()'s, and so sees its version, or add()'s comes last.
+        if (versions[s.slot].load(std::memory_order_acquire) != s.version)
+            setLeaf((size_t)s.slot, maxPriority.load(std::memory_order_relaxed));
+    }
+
+    //
+    // Decoding
+    //
+    // Rebuild the state (next = false) or the next state (next = true) of a record into
+    // g, which must be bound to storage for at least w * h cells.
+    void decode(const uint8_t* rec, SnakeSim& g, bool next) const {
+        ReplayHeader hd;
+        std::memcpy(&hd, rec, sizeof(hd));
+        const uint32_t* food = (const uint32_t*)(rec + sizeof(ReplayHeader));
+        const uint32_t* nextFood = food + maxFood;
+        const uint8_t* moves = (const uint8_t*)(nextFood + maxFood);
+
+        g.w = w;
+        g.h = h;
+        g.cells = w * h;
+        g.fruitCount = std::max<int>(1, hd.foodCount);
+        std::memset(g.grid, 0, sizeof(uint32_t) * (size_t)g.cells);
+        g.length = hd.length;
+        g.headPos = hd.length - 1;
+        g.tailSerial = 1;
+        g.headSerial = hd.length;
+        g.dir = (SimDir)hd.dir;
+        g.gameOver = false;
+        g.gameWon = false;
+
+        uint32_t c = hd.head;
+        for (uint32_t i = 0; i < hd.length; i++) {
+            g.body[(g.headPos - i) & g.ringMask] = c;
+            g.grid[c] = hd.length - i;
+            if (i + 1 < hd.length) {
+                int m = (moves[i >> 2] >> ((i & 3) * 2)) & 3;
+                c = stepCell(c, m);
+            }
+        }
+        g.foodCount = hd.foodCount;
+        std::memcpy(g.food, food, sizeof(uint32_t) * hd.foodCount);
+
+        if (next && !hd.done) {
+            g.step(hd.action);
+            g.foodCount = hd.nextFoodCount;
+            std::memcpy(g.food, nextFood, sizeof(uint32_t) * hd.nextFoodCount);
+        }
+    }
+
+    static ReplayHeader header(const uint8_t* rec) {
+        ReplayHeader hd;
+        std::memcpy(&hd, rec, sizeof(hd));
+        return hd;
+    }
+
+private:
+    static constexpr double FIXED_ONE = 16777216.0; // priorities are stored as 40.24 fixed point
+
+    static uint64_t toFixed(double p) { return (uint64_t)std::llround(std::max(p, 1e-6) * FIXED_ONE); }
+    static double fromFixed(uint64_t v) { return double(v) / FIXED_ONE; }
+
+    uint8_t* record(size_t slot) const { return records.get() + recordBytes * slot; }
+
+    uint32_t stepCell(uint32_t c, int move) const {
+        switch (move) {
+        case SIM_UP:   return c - (uint32_t)w;
+        case SIM_DOWN: return c + (uint32_t)w;
+        case SIM_LEFT: return c - 1;
+        default:       return c + 1;
+        }
+    }
+
+    int moveBetween(uint32_t from, uint32_t to) const {
+        if (to + (uint32_t)w == from) return SIM_UP;
+        if (to == from + (uint32_t)w) return SIM_DOWN;
+        if (to + 1 == from) return SIM_LEFT;
+        return SIM_RIGHT;
+    }
+
+    void encode(uint8_t* rec, const SnakeSim& g, int action, float reward, bool done, const SnakeSim& after) const {
+        ReplayHeader hd{};
+        hd.head = g.head();
+        hd.length = g.length;
+        hd.dir = (uint8_t)g.dir;
+        hd.action = (uint8_t)action;
+        hd.done = done ? 1 : 0;
+        hd.foodCount = (uint8_t)std::min(g.foodCount, maxFood);
+        hd.nextFoodCount = (uint8_t)std::min(after.foodCount, maxFood);
+        hd.reward = reward;
+        std::memcpy(rec, &hd, sizeof(hd));
+
+        uint32_t* food = (uint32_t*)(rec + sizeof(ReplayHeader));
+        uint32_t* nextFood = food + maxFood;
+        std::memcpy(food, g.food, sizeof(uint32_t) * hd.foodCount);
+        std::memcpy(nextFood, after.food, sizeof(uint32_t) * hd.nextFoodCount);
+
+        // Body as moves from each segment to the next, 2 bits each
+        uint8_t* moves = (uint8_t*)(nextFood + maxFood);
+        std::memset(moves, 0, ((size_t)w * h + 3) / 4);
+        uint32_t prev = g.segment(0);
+        for (uint32_t i = 0; i + 1 < g.length; i++) {
+            uint32_t c = g.segment(i + 1);
+            moves[i >> 2] |= (uint8_t)(moveBetween(prev, c) << ((i & 3) * 2));
+            prev = c;
+        }
+    }
+
+    // Lock-free sum-tree: swap the leaf, then add the difference on every ancestor.
+    // Adds commute, so concurrent updates always converge to the exact sums.
+    void setLeaf(size_t slot, uint64_t p) {
+        size_t node = leaves + slot;
+        uint64_t old = tree[node].exchange(p, std::memory_order_acq_rel);
+        uint64_t delta = p - old; // modular: works for decreases too
+        if (delta == 0) return;
+        for (node >>= 1; node >= 1; node >>= 1) tree[node].fetch_add(delta, std::memory_order_acq_rel);
+    }
+
+    size_t findLeaf(uint64_t target) const {
+        size_t node = 1;
+        while (node < leaves) {
+            uint64_t left = tree[node * 2].load(std::memory_order_acquire);
+            if (target < left) {
+                node = node * 2;
+            }
+            else {
+                target -= left;
+                node = node * 2 + 1;
+            }
+        }
+        return node - leaves;
+    }
+
+    size_t capacity;
+    int w, h, maxFood;
+    double alpha;
+    size_t recordBytes = 0;
+    size_t leaves = 0;
+    std::unique_ptr<uint8_t[]> records;
+    std::unique_ptr<std::atomic<uint32_t>[]> versions;
+    std::unique_ptr<std::atomic<uint64_t>[]> tree;
+    alignas(64) std::atomic<uint64_t> cursor{ 0 };
+    alignas(64) std::atomic<uint64_t> maxPriority{ (uint64_t)FIXED_ONE };
+};
@@ -0,0 +1,201 @@
+// snake_rollback.h
+// Rollback netcode for head-to-head play on a SnakeArena, in the style of GGPO. Every
+// peer runs the whole game. Only inputs cross the network. A tick whose remote inputs
+// have not arrived runs on a prediction: the player's last known action. When the real
+// input arrives and differs, the peer restores the state saved before that tick and
+// replays up to the present in the same frame. The arena tick is deterministic, so the
+// peers agree on every tick once its inputs are known to all of them.
+//
+// Ticks are numbered from 1; the actions of tick t are applied by the t-th arena tick.
+
+#pragma once
+
+#include "snake_arena.h"
+#include "snake_net.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+static constexpr int ROLLBACK_MAX_PLAYERS = 4;
+static constexpr int ROLLBACK_WINDOW = 16;   // most ticks the game may run ahead of any player's input
+static constexpr int ROLLBACK_RING = 32;     // saved states and inputs kept (> ROLLBACK_WINDOW + 1)
+static constexpr int ROLLBACK_MAX_DELAY = 8; // local input delay, in ticks
+
+struct RollbackStats {
+    uint64_t ticks = 0;        // first-time ticks
+    uint64_t rollbacks = 0;
+    uint64_t replayed = 0;     // ticks simulated again after a restore
+    uint32_t maxDepth = 0;     // most ticks replayed by one rollback
+    uint64_t stalls = 0;       // frames that could not advance (input too far behind)
+    double tickSeconds = 0.0;  // first-time ticks, including the save before each
+    double rollbackSeconds = 0.0; // restores and replays
+    double maxRollbackSeconds = 0.0;
+};
+
+//
+// One peer
+//
+class RollbackSession {
+public:
+    // cfg.snakes is the number of players; local is this peer's player
+    RollbackSession(const ArenaConfig& cfg, int local, int inputDelay)
+        : arena(cfg), players(cfg.snakes), local(local), delay(inputDelay) {
+        for (int p = 0; p < players; p++) arena.setBot(p, false);
+        // Ticks inside the input delay have no input from anyone
+        for (int t = 0; t < ROLLBACK_RING; t++) {
+            for (int p = 0; p < players; p++) inputs[t][p] = used[t][p] = -1;
+        }
+        for (int p = 0; p < players; p++) confirmed[p] = (uint32_t)delay;
+        for (ArenaState& s : states) arena.save(s); // allocate once, up front
+    }
+
+    const SnakeArena& game() const { return arena; }
+    int localPlayer() const { return local; }
+    int playerCount() const { return players; }
+    const RollbackStats& stats() const { return stat; }
+
+    // Newest tick with input from player p (the local player's runs ahead by the delay)
+    uint32_t confirmedTick(int p) const { return confirmed[p]; }
+
+    // The local action for the tick `delay` ticks after the next one; false (and dropped)
+    // while the game is stalled and that tick already has one
+    bool addLocalInput(int action) {
+        uint32_t t = confirmed[local] + 1;
+        if (t > arena.tickCount() + 1 + (uint32_t)delay) return false;
+        inputs[t % ROLLBACK_RING][local] = (int8_t)action;
+        confirmed[local] = t;
+        return true;
+    }
+
+    // Inputs of a remote player must arrive in tick order; repeats are ignored, and so are
+    // ticks too far ahead for the ring (the sender repeats them until acknowledged). A
+    // mismatch with what was predicted schedules a rollback for the next advance().
+    void addRemoteInput(int p, uint32_t tick, int action) {
+        if (p == local || tick != confirmed[p] + 1) return;
+        if (tick > arena.tickCount() + (ROLLBACK_RING - ROLLBACK_WINDOW - 1)) return;
+        inputs[tick % ROLLBACK_RING][p] = (int8_t)action;
+        confirmed[p] = tick;
+        if (tick <= arena.tickCount() && used[tick % ROLLBACK_RING][p] != action && (rollbackTo == 0 || tick < rollbackTo)) {
+            rollbackTo = tick;
+        }
+    }
+
+    // Runs any pending rollback, then the next tick unless some player is too far behind
+    bool advance() {
+        uint32_t next = arena.tickCount() + 1;
+        for (int p = 0; p < players; p++) {
+            if (next > confirmed[p] + ROLLBACK_WINDOW || (p == local && next > confirmed[p])) {
+                stat.stalls++;
+                return false;
+            }
+        }
+        if (rollbackTo != 0) rollback();
+        auto t0 = RollbackClock::now();
+        simulate(next);
+        stat.tickSeconds += secondsSince(t0);
+        stat.ticks++;
+        return true;
+    }
+
+    // Newest tick every peer agrees on: all its inputs are known and it ran with them
+    uint32_t syncedTick() const {
+        uint32_t t = rollbackTo ? rollbackTo - 1 : arena.tickCount();
+        for (int p = 0; p < players; p++) t = std::min(t, confirmed[p]);
+        return t;
+    }
+
+    // stateHash(false) after tick t, for t within ROLLBACK_RING of the current tick
+    uint64_t tickHash(uint32_t t) const { return hashes[t % ROLLBACK_RING]; }
+
+    //
+    // Input packet: type, player, ack u32 (newest tick received from the destination's
+    // player), first tick u32, count u8, then count actions in 3 bits (action + 1).
+    // Each packet repeats every input the destination has not acknowledged, so loss and
+    // reordering only add latency.
+    //
+    static constexpr uint8_t ROLLBACK_INPUT = 0x40;
+
+    int writeInputs(uint8_t* out, int cap, int toPlayer) const {
+        uint32_t first = std::max(acked[toPlayer], (uint32_t)delay) + 1;
+        int count = (int)std::min<uint32_t>(confirmed[local] + 1 - first, ROLLBACK_RING - 1);
+        if (cap < 11 + (count * 3 + 7) / 8) return 0;
+        out[0] = ROLLBACK_INPUT;
+        out[1] = (uint8_t)local;
+        netPut32(out + 2, confirmed[toPlayer]);
+        netPut32(out + 6, first);
+        out[10] = (uint8_t)count;
+        NetBitWriter bw(out + 11, (size_t)(cap - 11));
+        for (int k = 0; k < count; k++) bw.put((uint32_t)(inputs[(first + k) % ROLLBACK_RING][local] + 1), 3);
+        return 11 + (int)bw.finish();
+    }
+
+    bool readInputs(const uint8_t* p, int n) {
+        if (n < 11 || p[0] != ROLLBACK_INPUT || p[1] >= players || p[1] == local) return false;
+        int from = p[1];
+        uint32_t ack = netGet32(p + 2);
+        if (ack > acked[from] && ack <= confirmed[local]) acked[from] = ack;
+        uint32_t first = netGet32(p + 6);
+        int count = p[10];
+        NetBitReader br(p + 11, (size_t)(n - 11));
+        for (int k = 0; k < count; k++) {
+            int action = (int)br.get(3) - 1;
+            if (!br.ok) return false;
+            addRemoteInput(from, first + (uint32_t)k, action);
+        }
+        return true;
+    }
+
+private:
+    using RollbackClock = std::chrono::steady_clock;
+
+    static double secondsSince(RollbackClock::time_point t) {
+        return std::chrono::duration<double>(RollbackClock::now() - t).count();
+    }
+
+    // Confirmed input, or the player's last known action
+    int inputFor(int p, uint32_t t) const {
+        return inputs[std::min(t, confirmed[p]) % ROLLBACK_RING][p];
+    }
+
+    void simulate(uint32_t t) {
+        arena.save(states[t % ROLLBACK_RING]);
+        for (int p = 0; p < players; p++) {
+            int a = inputFor(p, t);
+            used[t % ROLLBACK_RING][p] = (int8_t)a;
+            arena.setAction(p, a);
+        }
+        arena.tick();
+        hashes[t % ROLLBACK_RING] = arena.stateHash(false);
+    }
+
+    // Back to the state before the first mispredicted tick, then forward again
+    void rollback() {
+        auto t0 = RollbackClock::now();
+        uint32_t now = arena.tickCount();
+        arena.restore(states[rollbackTo % ROLLBACK_RING]);
+        for (uint32_t t = rollbackTo; t <= now; t++) simulate(t);
+        uint32_t depth = now - rollbackTo + 1;
+        rollbackTo = 0;
+
+        double secs = secondsSince(t0);
+        stat.rollbacks++;
+        stat.replayed += depth;
+        stat.maxDepth = std::max(stat.maxDepth, depth);
+        stat.rollbackSeconds += secs;
+        stat.maxRollbackSeconds = std::max(stat.maxRollbackSeconds, secs);
+    }
+
+    SnakeArena arena;
+    int players;
+    int local;
+    int delay;
+    int8_t inputs[ROLLBACK_RING][ROLLBACK_MAX_PLAYERS]; // by tick: confirmed actions
+    int8_t used[ROLLBACK_RING][ROLLBACK_MAX_PLAYERS];   // by tick: what the simulation ran with
+    uint32_t confirmed[ROLLBACK_MAX_PLAYERS] = {};
+    uint32_t acked[ROLLBACK_MAX_PLAYERS] = {};          // newest local tick each peer has
+    uint32_t rollbackTo = 0;                            // first mispredicted tick, 0 = none
+    ArenaState states[ROLLBACK_RING];                   // by tick: state before it
+    uint64_t hashes[ROLLBACK_RING] = {};
+    RollbackStats stat;
+};
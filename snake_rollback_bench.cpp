@@ -0,0 +1,223 @@
+// snake_rollback_bench.cpp
+// Loopback harness for the rollback netcode (snake_rollback.h). Peers run in one process
+// on a virtual clock and exchange real input packets through a link with latency, jitter
+// and loss. Every tick the peers agree on is checked against a reference arena that ran
+// with the true inputs only; the rollback cost is measured per replayed tick.
+// Compile: g++ snake_rollback_bench.cpp -std=c++20 -O2 -o snake_rollback_bench
+// Run:     ./snake_rollback_bench --players 2 --latency 80 --jitter 30 [--loss 0.05] [--delay 2]
+
+#include "snake_rollback.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <vector>
+
+//
+// Config
+//
+struct RollbackBenchConfig {
+    ArenaConfig arena;
+    int frames = 20000;
+    double frameMs = 16.0;   // one tick per frame
+    double latencyMs = 80.0; // one way
+    double jitterMs = 30.0;  // uniform +-
+    double loss = 0.0;
+    int delay = 2;           // local input delay in ticks
+    uint64_t seed = 1;
+};
+
+static RollbackBenchConfig parseArgs(int argc, char** argv) {
+    RollbackBenchConfig cfg;
+    cfg.arena.width = 32;
+    cfg.arena.height = 32;
+    cfg.arena.snakes = 2;
+    cfg.arena.fruits = 16;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--players") && i + 1 < argc) cfg.arena.snakes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.arena.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.arena.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fruits") && i + 1 < argc) cfg.arena.fruits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--respawn") && i + 1 < argc) cfg.arena.respawnTicks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc) cfg.frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--frame-ms") && i + 1 < argc) cfg.frameMs = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--latency") && i + 1 < argc) cfg.latencyMs = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--jitter") && i + 1 < argc) cfg.jitterMs = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--loss") && i + 1 < argc) cfg.loss = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--delay") && i + 1 < argc) cfg.delay = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.seed = strtoull(argv[++i], nullptr, 10);
+    }
+    cfg.arena.seed = cfg.seed;
+    return cfg;
+}
+
+//
+// Link: packets are delivered at send time + latency + jitter unless dropped, so jitter
+// larger than the frame time reorders them
+//
+struct LinkPacket {
+    double deliverAt;
+    uint64_t order;
+    int to;
+    std::vector<uint8_t> bytes;
+
+    bool operator>(const LinkPacket& o) const { return deliverAt != o.deliverAt ? deliverAt > o.deliverAt : order > o.order; }
+};
+
+class LagLink {
+public:
+    LagLink(const RollbackBenchConfig& cfg) : cfg(cfg) { rng.state = cfg.seed ^ 0x4C494E4B; }
+
+    void send(double now, int to, const uint8_t* data, int n) {
+        sent++;
+        bytes += (uint64_t)n;
+        if (rng.below(1u << 24) < (uint32_t)(cfg.loss * (1u << 24))) {
+            dropped++;
+            return;
+        }
+        double jitter = cfg.jitterMs * ((double)rng.below(1u << 24) / (1u << 23) - 1.0);
+        double at = now + std::max(0.0, cfg.latencyMs + jitter);
+        queue.push(LinkPacket{ at, sent, to, std::vector<uint8_t>(data, data + n) });
+    }
+
+    template <typename Fn>
+    void deliver(double now, Fn&& fn) {
+        while (!queue.empty() && queue.top().deliverAt <= now) {
+            const LinkPacket& p = queue.top();
+            fn(p.to, p.bytes.data(), (int)p.bytes.size());
+            queue.pop();
+        }
+    }
+
+    uint64_t sent = 0, dropped = 0, bytes = 0;
+
+private:
+    const RollbackBenchConfig& cfg;
+    SimRng rng;
+    std::priority_queue<LinkPacket, std::vector<LinkPacket>, std::greater<LinkPacket>> queue;
+};
+
+//
+// Player bot: heads for the nearest fruit on its peer's (possibly predicted) board and
+// avoids walls and snakes. It holds a direction every tick like a held key.
+//
+static int playerAction(const SnakeArena& a, int id, SimRng& rng) {
+    const ArenaSnake& s = a.snake(id);
+    if (!s.alive) return -1;
+    static const int dx[4] = { 0, 0, -1, 1 }, dy[4] = { -1, 1, 0, 0 };
+    int w = a.width(), h = a.height();
+    int hx = (int)(s.head() % (uint32_t)w), hy = (int)(s.head() / (uint32_t)w);
+    int tx = hx, ty = hy, nearest = INT32_MAX;
+    for (uint32_t f : a.fruits()) {
+        int d = std::abs((int)(f % (uint32_t)w) - hx) + std::abs((int)(f / (uint32_t)w) - hy);
+        if (d < nearest) {
+            nearest = d;
+            tx = (int)(f % (uint32_t)w);
+            ty = (int)(f / (uint32_t)w);
+        }
+    }
+    int best = s.dir, bestScore = INT32_MIN;
+    for (int d = 0; d < 4; d++) {
+        if (d == simOpposite(s.dir)) continue;
+        int x = hx + dx[d], y = hy + dy[d];
+        int score = (int)rng.below(3);
+        if (x < 0 || x >= w || y < 0 || y >= h || arenaIsSnake(a.cell((uint32_t)(y * w + x)))) score -= 1000000;
+        score -= (std::abs(tx - x) + std::abs(ty - y)) * 4;
+        if (score > bestScore) {
+            bestScore = score;
+            best = d;
+        }
+    }
+    return best;
+}
+
+using BenchClock = std::chrono::steady_clock;
+
+// Cost of one save plus one restore of this arena
+static double saveRestoreMicros(const ArenaConfig& cfg) {
+    SnakeArena a(cfg);
+    ArenaState s;
+    a.save(s);
+    const int reps = 20000;
+    auto t0 = BenchClock::now();
+    for (int i = 0; i < reps; i++) {
+        a.save(s);
+        a.restore(s);
+    }
+    return std::chrono::duration<double>(BenchClock::now() - t0).count() / reps * 1e6;
+}
+
+int main(int argc, char** argv) {
+    RollbackBenchConfig cfg = parseArgs(argc, argv);
+    int players = cfg.arena.snakes;
+    if (players < 2 || players > ROLLBACK_MAX_PLAYERS || cfg.arena.width < 8 || cfg.arena.height < 8 || cfg.frames < 1 ||
+        cfg.frameMs <= 0.0 || cfg.delay < 0 || cfg.delay > ROLLBACK_MAX_DELAY || cfg.loss < 0.0 || cfg.loss >= 1.0) {
+        printf("invalid settings (2..%d players, delay 0..%d)\n", ROLLBACK_MAX_PLAYERS, ROLLBACK_MAX_DELAY);
+        return 1;
+    }
+
+    std::vector<RollbackSession> peers;
+    std::vector<SimRng> bots((size_t)players);
+    std::vector<std::vector<int8_t>> truth((size_t)players);      // each player's real inputs, by tick
+    std::vector<std::vector<uint64_t>> agreed((size_t)players);   // each peer's hash of its synced ticks
+    for (int p = 0; p < players; p++) {
+        peers.emplace_back(cfg.arena, p, cfg.delay);
+        bots[p].state = cfg.seed * 0x9E3779B97F4A7C15ull + (uint64_t)p;
+        truth[p].assign((size_t)cfg.delay + 1, -1);
+        agreed[p].push_back(0);
+    }
+
+    LagLink link(cfg);
+    uint8_t packet[256];
+    for (int f = 0; f < cfg.frames; f++) {
+        double now = f * cfg.frameMs;
+        link.deliver(now, [&](int to, const uint8_t* data, int n) { peers[to].readInputs(data, n); });
+        for (int p = 0; p < players; p++) {
+            RollbackSession& peer = peers[p];
+            int action = playerAction(peer.game(), p, bots[p]);
+            if (peer.addLocalInput(action)) truth[p].push_back((int8_t)action);
+            peer.advance();
+            for (int q = 0; q < players; q++) {
+                if (q == p) continue;
+                int n = peer.writeInputs(packet, sizeof(packet), q);
+                if (n > 0) link.send(now, q, packet, n);
+            }
+            for (uint32_t t = (uint32_t)agreed[p].size(); t <= peer.syncedTick(); t++) agreed[p].push_back(peer.tickHash(t));
+        }
+    }
+
+    // Reference: one arena fed only the real inputs
+    size_t synced = SIZE_MAX;
+    for (int p = 0; p < players; p++) synced = std::min(synced, agreed[p].size() - 1);
+    SnakeArena reference(cfg.arena);
+    for (int p = 0; p < players; p++) reference.setBot(p, false);
+    uint64_t mismatches = 0;
+    for (size_t t = 1; t <= synced; t++) {
+        for (int p = 0; p < players; p++) reference.setAction(p, truth[p][t]);
+        reference.tick();
+        uint64_t h = reference.stateHash(false);
+        for (int p = 0; p < players; p++) {
+            if (agreed[p][t] != h && mismatches++ < 5) printf("tick %zu: peer %d disagrees with the reference\n", t, p);
+        }
+    }
+
+    printf("%d players on %dx%d, %d fruits: %d frames of %.1f ms, latency %.0f +- %.0f ms, loss %.1f%%, input delay %d\n",
+        players, cfg.arena.width, cfg.arena.height, cfg.arena.fruits, cfg.frames, cfg.frameMs, cfg.latencyMs, cfg.jitterMs,
+        cfg.loss * 100.0, cfg.delay);
+    printf("link: %llu packets, %.1f B each, %llu dropped\n", (unsigned long long)link.sent,
+        link.sent ? (double)link.bytes / link.sent : 0.0, (unsigned long long)link.dropped);
+    for (int p = 0; p < players; p++) {
+        const RollbackStats& st = peers[p].stats();
+        printf("peer %d: %llu ticks, %llu stalled frames, %llu rollbacks (%.1f per 100 ticks), depth mean %.1f max %u\n", p,
+            (unsigned long long)st.ticks, (unsigned long long)st.stalls, (unsigned long long)st.rollbacks,
+            st.ticks ? 100.0 * st.rollbacks / st.ticks : 0.0, st.rollbacks ? (double)st.replayed / st.rollbacks : 0.0, st.maxDepth);
+        printf("        tick %.2f us (with save), replay %.2f us per replayed tick, worst rollback %.1f us = %.2f%% of a frame\n",
+            st.ticks ? st.tickSeconds / st.ticks * 1e6 : 0.0, st.replayed ? st.rollbackSeconds / st.replayed * 1e6 : 0.0,
+            st.maxRollbackSeconds * 1e6, st.maxRollbackSeconds * 1e3 / cfg.frameMs * 100.0);
+    }
+    printf("save + restore %.2f us\n", saveRestoreMicros(cfg.arena));
+    printf("%zu ticks agreed by every peer, %llu differ from the reference\n", synced, (unsigned long long)mismatches);
+    return mismatches || synced == 0 ? 1 : 0;
+}
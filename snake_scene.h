@@ -0,0 +1,283 @@
+// snake_scene.h
+// The game's screens as render commands (snake_render.h): the menu, the settings and the
+// board with its overlays, laid out from a SceneInput that the build stage fills from
+// its snapshot. There is no GDI here, so the same scene plays on any backend: main.cpp's
+// GDI one, or the software one in snake_render_bench.cpp. Sizes scale with the board.
+//
+// The board's grid lines never change while the board keeps its size, so they are one blit
+// of a cached surface (SCENE_SURFACE_GRID) rather than a line per row and column.
+// SceneCache keeps the last buffer it built and hands it out again while the input stays
+// the same, which is every frame of a menu that nobody touches.
+
+#pragma once
+
+#include "snake_render.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+enum SceneScreen { SCENE_MENU, SCENE_SETTINGS, SCENE_PLAYING };
+
+enum SceneSurface : uint32_t { SCENE_SURFACE_GRID = 1 };
+
+struct SceneInput {
+    int screen = SCENE_MENU;
+    int gridW = 10, gridH = 10, cell = 80; // the board as laid out (GRID_W, GRID_H, CELL)
+    RenderRect client = {};
+    int mouseX = 0, mouseY = 0;
+    int menuSelection = 0, pauseSelection = 0, gameOverSelection = 0, settingSelection = 0;
+    int fps = 0, cellSize = 0, gridWidth = 0, gridHeight = 0, fruitCount = 0; // as the settings show them
+    const wchar_t* speedName = L"";
+    int score = 0;
+    bool gameOver = false, gameWon = false, paused = false, started = false;
+    bool snakeHidden = false; // blinking off, as the snake dies
+    int countdown = 0;        // 3, 2, 1 over the board before play picks up; 0 for none
+    int fade = 0;             // background over everything, 0-255, as a new screen comes in
+    std::vector<RenderRect> segments; // interpolated, head first
+    std::vector<RenderRect> fruits;
+};
+
+static inline bool sceneSameInput(const SceneInput& a, const SceneInput& b) {
+    return a.screen == b.screen && a.gridW == b.gridW && a.gridH == b.gridH && a.cell == b.cell && a.client == b.client &&
+        a.mouseX == b.mouseX && a.mouseY == b.mouseY && a.menuSelection == b.menuSelection &&
+        a.pauseSelection == b.pauseSelection && a.gameOverSelection == b.gameOverSelection &&
+        a.settingSelection == b.settingSelection && a.fps == b.fps && a.cellSize == b.cellSize &&
+        a.gridWidth == b.gridWidth && a.gridHeight == b.gridHeight && a.fruitCount == b.fruitCount &&
+        a.speedName == b.speedName && a.score == b.score && a.gameOver == b.gameOver && a.gameWon == b.gameWon &&
+        a.paused == b.paused && a.started == b.started && a.snakeHidden == b.snakeHidden && a.countdown == b.countdown &&
+        a.fade == b.fade && a.segments == b.segments && a.fruits == b.fruits;
+}
+
+//
+// Colours
+//
+static constexpr uint32_t SCENE_BACKGROUND = renderRgb(22, 26, 30);
+static constexpr uint32_t SCENE_GRID = renderRgb(40, 40, 48);
+static constexpr uint32_t SCENE_FOOD = renderRgb(255, 70, 70);
+static constexpr uint32_t SCENE_HEAD = renderRgb(90, 220, 90);
+static constexpr uint32_t SCENE_HEAD_EDGE = renderRgb(0, 110, 0);
+static constexpr uint32_t SCENE_BODY1 = renderRgb(40, 170, 40);
+static constexpr uint32_t SCENE_BODY2 = renderRgb(30, 140, 30);
+static constexpr uint32_t SCENE_BODY_EDGE = renderRgb(0, 90, 0);
+static constexpr uint32_t SCENE_GREEN = renderRgb(90, 220, 90);
+static constexpr uint32_t SCENE_HOVER = renderRgb(120, 255, 120);
+static constexpr uint32_t SCENE_TEXT = renderRgb(220, 220, 220);
+static constexpr uint32_t SCENE_DIM = renderRgb(180, 180, 180);
+static constexpr uint32_t SCENE_DIMMER = renderRgb(150, 150, 150);
+static constexpr uint32_t SCENE_RED = renderRgb(220, 90, 90);
+static constexpr uint32_t SCENE_SHADE = renderRgb(0, 0, 0);
+
+//
+// Pieces
+//
+static inline void sceneText(RenderCommands& rc, const RenderRect& r, const wchar_t* s, uint32_t color, int size, int flags) {
+    rc.textRun(r, s, (int)wcslen(s), color, size, flags);
+}
+
+// Text from (x, y), as TextOutW: the rect runs to the right of the window
+static inline void sceneTextAt(RenderCommands& rc, const SceneInput& in, int x, int y, const wchar_t* s, uint32_t color, int size) {
+    RenderRect r = { x, y, (std::max)(in.client.right, x + 1), y + size + size / 4 };
+    sceneText(rc, r, s, color, size, RENDER_TEXT_LEFT);
+}
+
+static inline bool sceneHover(const SceneInput& in, int left, int top, int right, int bottom) {
+    return in.mouseX >= left && in.mouseX <= right && in.mouseY >= top && in.mouseY <= bottom;
+}
+
+static inline void sceneButton(RenderCommands& rc, const RenderRect& r, const wchar_t* label, bool lit, bool red, int fontSize) {
+    uint32_t fill = red ? (lit ? renderRgb(200, 50, 50) : renderRgb(170, 40, 40)) : (lit ? renderRgb(50, 200, 50) : renderRgb(40, 170, 40));
+    rc.fill(r, fill);
+    rc.outline(r, red ? SCENE_RED : SCENE_GREEN, lit ? 3 : 2);
+    sceneText(rc, r, label, SCENE_TEXT, fontSize, RENDER_TEXT_CENTER);
+}
+
+// Two buttons under an overlay's text: a green one and a red "Main Menu"
+static inline void sceneOverlayButtons(RenderCommands& rc, const SceneInput& in, int startY, const wchar_t* first, int selection) {
+    int w = in.gridW * in.cell, h = in.gridH * in.cell;
+    int fontSize = (std::max)(18, (std::min)(24, w / 18));
+    int buttonWidth = (std::max)(140, (std::min)(200, w - 100));
+    int buttonHeight = (std::max)(35, (std::min)(50, h / 9));
+    int centerX = w / 2;
+    int spacing = (std::max)(50, buttonHeight + 15);
+    sceneButton(rc, { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight }, first, selection == 0, false, fontSize);
+    startY += spacing;
+    sceneButton(rc, { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight }, L"Main Menu", selection == 1, true, fontSize);
+}
+
+//
+// Screens
+//
+static inline void sceneMenu(RenderCommands& rc, const SceneInput& in) {
+    int w = in.gridW * in.cell, h = in.gridH * in.cell;
+
+    int titleSize = (std::max)(32, (std::min)(64, w / 8));
+    int titleY = (std::max)(60, h / 6);
+    sceneText(rc, { 0, titleY, w, titleY + titleSize + 20 }, L"SNAKE", SCENE_GREEN, titleSize, RENDER_TEXT_CENTER | RENDER_TEXT_BOLD);
+
+    int fontSize = (std::max)(18, (std::min)(28, w / 16));
+    int buttonWidth = (std::max)(140, (std::min)(220, w - 100));
+    int buttonHeight = (std::max)(35, (std::min)(55, h / 9));
+    int centerX = w / 2;
+    int startY = (std::max)(140, (h - (3 * buttonHeight + 2 * 65)) / 2);
+    int spacing = (std::max)(55, buttonHeight + 15);
+
+    static const wchar_t* labels[3] = { L"Play", L"Settings", L"Exit" };
+    for (int i = 0; i < 3; i++) {
+        RenderRect r = { centerX - buttonWidth / 2, startY, centerX + buttonWidth / 2, startY + buttonHeight };
+        bool lit = in.menuSelection == i || sceneHover(in, r.left, r.top, r.right, r.bottom);
+        sceneButton(rc, r, labels[i], lit, i == 2, fontSize);
+        startY += spacing;
+    }
+}
+
+static inline void sceneSettings(RenderCommands& rc, const SceneInput& in) {
+    int w = in.gridW * in.cell, h = in.gridH * in.cell;
+
+    int titleSize = (std::max)(32, (std::min)(64, w / 8));
+    sceneText(rc, { 0, 40, w, 100 }, L"SETTINGS", SCENE_GREEN, titleSize, RENDER_TEXT_CENTER | RENDER_TEXT_BOLD);
+
+    int fontSize = (std::max)(16, (std::min)(22, w / 20));
+    int leftCol = (std::max)(30, w / 10);
+    int rightCol = (std::max)(200, w / 2);
+    int startY = (std::max)(120, h / 4);
+    int rowHeight = (std::max)(35, (std::min)(50, h / 10));
+    int arrowLeftX = rightCol - 30;
+    int arrowRightX = rightCol + 50;
+    int arrowWidth = 20;
+
+    std::wstring values[6] = { std::to_wstring(in.fps), std::to_wstring(in.cellSize), std::to_wstring(in.gridWidth),
+        std::to_wstring(in.gridHeight), in.speedName, std::to_wstring(in.fruitCount) };
+    static const wchar_t* labels[6] = { L"FPS:", L"Cell Size:", L"Grid Width:", L"Grid Height:", L"Speed:", L"Fruit Count:" };
+    for (int i = 0; i < 6; i++) {
+        if (i > 0) startY += rowHeight;
+        bool selected = in.settingSelection == i;
+        sceneTextAt(rc, in, leftCol, startY, labels[i], selected ? SCENE_GREEN : SCENE_DIM, fontSize);
+        bool leftHover = sceneHover(in, arrowLeftX, startY, arrowLeftX + arrowWidth, startY + rowHeight);
+        sceneTextAt(rc, in, arrowLeftX, startY, L"<", leftHover ? SCENE_HOVER : SCENE_GREEN, fontSize);
+        sceneTextAt(rc, in, rightCol, startY, values[i].c_str(), selected ? SCENE_TEXT : SCENE_DIMMER, fontSize);
+        bool rightHover = sceneHover(in, arrowRightX, startY, arrowRightX + arrowWidth, startY + rowHeight);
+        sceneTextAt(rc, in, arrowRightX, startY, L">", rightHover ? SCENE_HOVER : SCENE_GREEN, fontSize);
+    }
+
+    startY += rowHeight + 20;
+    sceneText(rc, { 0, startY, w, startY + 30 }, L"< Back to Menu", in.settingSelection == 6 ? SCENE_RED : SCENE_DIM, fontSize,
+        RENDER_TEXT_CENTER);
+}
+
+static inline void scenePlaying(RenderCommands& rc, const SceneInput& in) {
+    int w = in.gridW * in.cell, h = in.gridH * in.cell;
+    RenderRect board = { 0, 0, w, h };
+
+    rc.blit({ 0, 0, w + 1, h + 1 }, SCENE_SURFACE_GRID, (uint32_t)in.gridW | (uint32_t)in.gridH << 8 | (uint32_t)in.cell << 16);
+    for (const RenderRect& r : in.fruits) rc.fill(r, SCENE_FOOD);
+    for (size_t i = 0; i < (in.snakeHidden ? 0 : in.segments.size()); i++) {
+        const RenderRect& r = in.segments[i];
+        if (i == 0) {
+            rc.fill(r, SCENE_HEAD);
+            rc.outline(r, SCENE_HEAD_EDGE, 1);
+        } else {
+            rc.fill(r, i % 2 == 0 ? SCENE_BODY1 : SCENE_BODY2);
+            rc.outline(r, SCENE_BODY_EDGE, 1);
+        }
+    }
+
+    std::wstring scoreTxt = L"Score: " + std::to_wstring(in.score);
+    if (in.gameOver) scoreTxt += L"    (Press R to restart)";
+    RenderRect shadow = { 13, h + 9, (std::max)(in.client.right, 14), h + 9 + 25 };
+    RenderRect text = { 12, h + 8, (std::max)(in.client.right, 13), h + 8 + 25 };
+    rc.textRun(shadow, scoreTxt.c_str(), (int)scoreTxt.size(), renderRgb(30, 30, 30), 20, RENDER_TEXT_LEFT | RENDER_TEXT_BOLD);
+    rc.textRun(text, scoreTxt.c_str(), (int)scoreTxt.size(), renderRgb(230, 230, 230), 20, RENDER_TEXT_LEFT | RENDER_TEXT_BOLD);
+
+    // Paused: three coats of shade over the board
+    if (in.paused && in.started) {
+        for (int i = 0; i < 3; i++) rc.blend(board, SCENE_SHADE, 100);
+        int size = (std::max)(32, (std::min)(48, w / 10));
+        int pauseY = (std::max)(60, h / 6);
+        sceneText(rc, { 0, pauseY, w, pauseY + size + 20 }, L"PAUSED", SCENE_TEXT, size, RENDER_TEXT_CENTER | RENDER_TEXT_BOLD);
+        sceneOverlayButtons(rc, in, (std::max)(140, pauseY + size + 60), L"Resume", in.pauseSelection);
+    }
+
+    // Not started: two, for a lighter shade
+    if (!in.started) {
+        for (int i = 0; i < 2; i++) rc.blend(board, SCENE_SHADE, 100);
+        int size = (std::max)(24, (std::min)(36, w / 12));
+        sceneText(rc, { 0, h / 2 - 60, w, h / 2 }, L"SNAKE", SCENE_TEXT, size, RENDER_TEXT_CENTER | RENDER_TEXT_BOLD);
+        int small = (std::max)(14, (std::min)(20, w / 22));
+        sceneText(rc, { 0, h / 2 + 10, w, h / 2 + 50 }, L"Press any arrow key to start", SCENE_TEXT, small, RENDER_TEXT_CENTER);
+    }
+
+    // Counting down to play: one coat and the number
+    if (in.countdown > 0 && !in.paused) {
+        rc.blend(board, SCENE_SHADE, 100);
+        wchar_t digit[2] = { (wchar_t)(L'0' + in.countdown % 10), 0 };
+        int size = (std::max)(48, (std::min)(96, w / 5));
+        sceneText(rc, { 0, h / 2 - size, w, h / 2 + size }, digit, SCENE_TEXT, size, RENDER_TEXT_CENTER | RENDER_TEXT_BOLD);
+    }
+
+    if (in.gameOver || in.gameWon) {
+        rc.blend(board, SCENE_SHADE, 128);
+        int size = (std::max)(32, (std::min)(48, w / 10));
+        int titleY = (std::max)(40, h / 8);
+        sceneText(rc, { 0, titleY, w, titleY + size + 20 }, in.gameWon ? L"YOU WIN!" : L"GAME OVER", in.gameWon ? SCENE_GREEN : SCENE_TEXT,
+            size, RENDER_TEXT_CENTER | RENDER_TEXT_BOLD);
+        std::wstring scoreLine = (in.gameWon ? L"Perfect Score: " : L"Score: ") + std::to_wstring(in.score);
+        int scoreY = titleY + size + 40;
+        rc.textRun({ 0, scoreY, w, scoreY + 30 }, scoreLine.c_str(), (int)scoreLine.size(), SCENE_TEXT, (std::max)(18, (std::min)(24, w / 18)),
+            RENDER_TEXT_CENTER);
+        sceneOverlayButtons(rc, in, (std::max)(140, scoreY + 50), in.gameWon ? L"Play Again" : L"Restart", in.gameOverSelection);
+    }
+}
+
+// The whole window, in painter's order
+static inline void sceneBuild(const SceneInput& in, RenderCommands& rc) {
+    rc.fill(in.client, SCENE_BACKGROUND);
+    if (in.screen == SCENE_MENU) sceneMenu(rc, in);
+    else if (in.screen == SCENE_SETTINGS) sceneSettings(rc, in);
+    else scenePlaying(rc, in);
+    if (in.fade > 0) rc.blend(in.client, SCENE_BACKGROUND, (std::min)(in.fade, 255));
+}
+
+// Surfaces that scene blits name, for backends to draw and keep
+static inline void sceneSurface(uint32_t id, uint32_t key, RenderCommands& rc) {
+    if (id != SCENE_SURFACE_GRID) return;
+    int gridW = (int)(key & 0xFF), gridH = (int)(key >> 8 & 0xFF), cell = (int)(key >> 16);
+    int w = gridW * cell, h = gridH * cell;
+    rc.fill({ 0, 0, w + 1, h + 1 }, SCENE_BACKGROUND);
+    for (int x = 0; x <= w; x += cell) rc.fill({ x, 0, x + 1, h }, SCENE_GRID);
+    for (int y = 0; y <= h; y += cell) rc.fill({ 0, y, w, y + 1 }, SCENE_GRID);
+}
+
+//
+// Cache: the last input and what it built
+//
+class SceneCache {
+public:
+    // Fills out for in; true if it is the buffer built for the same input before
+    bool build(const SceneInput& in, RenderCommands& out, RenderOptimizeStats& stats) {
+        if (valid && sceneSameInput(in, last)) {
+            out.cmds = built.cmds;
+            out.text = built.text;
+            stats = builtStats;
+            return true;
+        }
+        out.clear();
+        sceneBuild(in, out);
+        stats = optimizer.run(out);
+        last = in;
+        built.cmds = out.cmds;
+        built.text = out.text;
+        builtStats = stats;
+        valid = true;
+        return false;
+    }
+
+private:
+    RenderOptimizer optimizer;
+    SceneInput last;
+    RenderCommands built;
+    RenderOptimizeStats builtStats;
+    bool valid = false;
+};
@@ -0,0 +1,367 @@
+// snake_server.cpp
+// Headless authoritative server (see snake_net.h). Every client gets its own game, run at
+// the same tick interval as the window game, and one delta snapshot per tick. Any number
+// of spectators can WATCH a game; they share one stream per game (see snake_spectate.h).
+// Compile: g++ snake_server.cpp -std=c++20 -O2 -o snake_server
+// Run:     ./snake_server --port 7777 [--tick-ms 120] [--width 20 --height 20 --fruits 1]
+//          then snake_net_bench for clients, a loss proxy and client-side numbers,
+//          or snake_spectate_bench for spectators
+
+#include "snake_spectate.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+//
+// Config
+//
+struct ServerConfig {
+    const char* ip = "127.0.0.1";
+    int port = 7777;
+    int tickMs = 120;          // TICK_INTERVAL_MS_VALUE in main.cpp
+    int width = 20;
+    int height = 20;
+    int fruits = 1;
+    int restartTicks = 8;      // game-over screen before a new episode
+    int timeoutMs = 5000;      // silence before a client is dropped
+    int statsSeconds = 5;
+    int seconds = 0;           // 0 = run until killed
+    uint64_t seed = 1;
+};
+
+static ServerConfig parseArgs(int argc, char** argv) {
+    ServerConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--ip") && i + 1 < argc) cfg.ip = argv[++i];
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) cfg.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--tick-ms") && i + 1 < argc) cfg.tickMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fruits") && i + 1 < argc) cfg.fruits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--restart") && i + 1 < argc) cfg.restartTicks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--timeout-ms") && i + 1 < argc) cfg.timeoutMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--stats") && i + 1 < argc) cfg.statsSeconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) cfg.seconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.seed = strtoull(argv[++i], nullptr, 10);
+    }
+    return cfg;
+}
+
+using ServerClock = std::chrono::steady_clock;
+
+// Process CPU time (user + system) in seconds
+static double cpuSeconds() {
+#if defined(_WIN32)
+    FILETIME create, exit, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &create, &exit, &kernel, &user);
+    auto secs = [](FILETIME f) { return (double)((uint64_t)f.dwHighDateTime << 32 | f.dwLowDateTime) * 1e-7; };
+    return secs(kernel) + secs(user);
+#else
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+// Resident memory in bytes (0 where unknown)
+static size_t residentBytes() {
+#if defined(_WIN32)
+    return 0;
+#else
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long pages = 0, resident = 0;
+    int n = fscanf(f, "%lu %lu", &pages, &resident);
+    fclose(f);
+    return n == 2 ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+//
+// Server
+//
+class SnakeServer {
+public:
+    explicit SnakeServer(const ServerConfig& cfg) : cfg(cfg) { rng.state = cfg.seed; }
+
+    bool open() {
+        sock = netOpenUdp(cfg.ip, (uint16_t)cfg.port, 8 << 20);
+        return sock != NET_INVALID_SOCKET;
+    }
+
+    void run() {
+        auto interval = std::chrono::milliseconds(cfg.tickMs);
+        auto start = ServerClock::now();
+        auto nextTick = start + interval;
+        auto nextStats = start + std::chrono::seconds(cfg.statsSeconds);
+        double cpuMark = cpuSeconds();
+
+        for (;;) {
+            // Take packets until the tick is due
+            for (;;) {
+                auto now = ServerClock::now();
+                if (now >= nextTick) break;
+                int waitMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(nextTick - now).count();
+                if (netWait(sock, waitMs)) drain();
+            }
+            drain();
+            tick++;
+            step();
+            nextTick += interval;
+            if (ServerClock::now() > nextTick) nextTick = ServerClock::now() + interval; // fell behind; don't burst
+
+            if (ServerClock::now() >= nextStats) {
+                double cpu = cpuSeconds();
+                report(cpu - cpuMark);
+                cpuMark = cpu;
+                nextStats += std::chrono::seconds(cfg.statsSeconds);
+            }
+            if (cfg.seconds > 0 && ServerClock::now() - start >= std::chrono::seconds(cfg.seconds)) break;
+        }
+    }
+
+private:
+    const ServerConfig& cfg;
+    NetSocket sock = NET_INVALID_SOCKET;
+    SimRng rng;
+    uint32_t tick = 1;
+    std::vector<std::unique_ptr<NetSession>> sessions;
+    std::unordered_map<uint64_t, size_t> byAddr;
+    uint32_t nextMatchId = 1;
+    uint32_t featured = 0; // longest-running match, 0 = look it up again
+
+    // Spectators: one stream per watched game, by match id
+    NetBufferPool buffers;
+    std::unordered_map<uint32_t, std::unique_ptr<SpectatorStream>> streams;
+    ServerClock::time_point nextExpiry = ServerClock::now();
+
+    // Since the last report
+    uint64_t ticksRun = 0, clientTicks = 0, bytesSent = 0, keyframesSent = 0, packetsIn = 0, bytesIn = 0;
+    uint64_t catchupPackets = 0, viewerTicks = 0;
+    double fanoutSeconds = 0.0, spectateSeconds = 0.0; // publishing; all spectator work
+    int joined = 0, left = 0;
+
+    NetSession* find(const NetAddr& from, uint32_t token) {
+        auto it = byAddr.find(from.key());
+        if (it == byAddr.end()) return nullptr;
+        NetSession* s = sessions[it->second].get();
+        return s->token == token ? s : nullptr;
+    }
+
+    void drain() {
+        uint8_t buf[NET_MAX_PACKET];
+        NetAddr from;
+        int n;
+        while ((n = netRecv(sock, from, buf, sizeof(buf))) > 0) {
+            if (buf[0] == NET_WATCH && n >= 6) {
+                double t0 = cpuSeconds();
+                watch(from, netGet32(buf + 1), buf[5] != 0);
+                spectateSeconds += cpuSeconds() - t0;
+                continue;
+            }
+            packetsIn++;
+            bytesIn += (uint64_t)n;
+            if (buf[0] == NET_HELLO && n >= 9 && netGet32(buf + 1) == NET_MAGIC) hello(from, netGet32(buf + 5));
+            else if (buf[0] == NET_INPUT && n >= 12) input(from, buf, n);
+            else if (buf[0] == NET_BYE && n >= 5) bye(from, netGet32(buf + 1));
+        }
+    }
+
+    void hello(const NetAddr& from, uint32_t nonce) {
+        NetSession* s;
+        auto it = byAddr.find(from.key());
+        if (it != byAddr.end()) {
+            s = sessions[it->second].get(); // WELCOME was lost; repeat it
+        }
+        else {
+            sessions.push_back(std::make_unique<NetSession>());
+            s = sessions.back().get();
+            byAddr[from.key()] = sessions.size() - 1;
+            s->addr = from;
+            s->token = (uint32_t)rng.next() | 1;
+            s->matchId = nextMatchId++;
+            s->start(cfg.width, cfg.height, cfg.fruits, rng.next());
+            s->record(tick);
+            joined++;
+        }
+        s->lastHeard = ServerClock::now();
+
+        uint8_t out[16];
+        out[0] = NET_WELCOME;
+        netPut32(out + 1, s->token);
+        netPut32(out + 5, nonce);
+        netPut16(out + 9, (uint16_t)cfg.width);
+        netPut16(out + 11, (uint16_t)cfg.height);
+        out[13] = (uint8_t)cfg.fruits;
+        netPut16(out + 14, (uint16_t)cfg.tickMs);
+        netSend(sock, from, out, 16);
+    }
+
+    void input(const NetAddr& from, const uint8_t* p, int n) {
+        NetSession* s = find(from, netGet32(p + 1));
+        if (!s) return;
+        s->lastHeard = ServerClock::now();
+        uint32_t ack = netGet32(p + 5);
+        if (ack == 0 || (int32_t)(ack - s->ackTick) > 0) s->ackTick = ack; // 0 asks for a keyframe
+        int count = p[11];
+        if (count > NET_INPUT_REDUNDANCY || n < 12 + (count * 2 + 7) / 8) return;
+        NetBitReader br(p + 12, (size_t)(n - 12));
+        uint8_t dirs[NET_INPUT_REDUNDANCY];
+        for (int i = 0; i < count; i++) dirs[i] = (uint8_t)br.get(2);
+        s->receiveInput(netGet16(p + 9), count, dirs);
+    }
+
+    void bye(const NetAddr& from, uint32_t token) {
+        auto it = byAddr.find(from.key());
+        if (it != byAddr.end() && sessions[it->second]->token == token) remove(it->second);
+    }
+
+    // Match 0 means the longest-running game, the one with the smallest id
+    void watch(const NetAddr& from, uint32_t matchId, bool resync) {
+        if (matchId == 0) {
+            if (featured == 0) {
+                for (const auto& s : sessions) {
+                    if (featured == 0 || s->matchId < featured) featured = s->matchId;
+                }
+            }
+            matchId = featured;
+            if (matchId == 0) return;
+        }
+        auto it = streams.find(matchId);
+        if (it == streams.end()) {
+            bool exists = false;
+            for (const auto& s : sessions) exists = exists || s->matchId == matchId;
+            if (!exists) return;
+            it = streams.emplace(matchId, std::make_unique<SpectatorStream>(buffers)).first;
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(ServerClock::now().time_since_epoch()).count();
+        catchupPackets += (uint64_t)it->second->watch(sock, from, resync, (uint64_t)ms);
+    }
+
+    // Swap-remove, keeping byAddr pointing at the moved session
+    void remove(size_t i) {
+        streams.erase(sessions[i]->matchId);
+        if (sessions[i]->matchId == featured) featured = 0;
+        byAddr.erase(sessions[i]->addr.key());
+        if (i + 1 != sessions.size()) {
+            sessions[i] = std::move(sessions.back());
+            byAddr[sessions[i]->addr.key()] = i;
+        }
+        sessions.pop_back();
+        left++;
+    }
+
+    void step() {
+        auto now = ServerClock::now();
+        auto timeout = std::chrono::milliseconds(cfg.timeoutMs);
+        uint8_t out[NET_MAX_PACKET];
+        ticksRun++;
+        for (size_t i = 0; i < sessions.size();) {
+            NetSession& s = *sessions[i];
+            if (now - s.lastHeard > timeout) {
+                remove(i);
+                continue;
+            }
+            if (!s.game.done()) s.game.step(s.nextAction());
+            else if (s.overSince == 0) s.overSince = tick;
+            else if (tick - s.overSince >= (uint32_t)cfg.restartTicks) s.start(cfg.width, cfg.height, cfg.fruits, rng.next());
+            s.record(tick);
+
+            bool keyframe = false;
+            int bytes = s.writeSnapshot(tick, out, &keyframe);
+            if (bytes > 0) {
+                netSend(sock, s.addr, out, bytes);
+                bytesSent += (uint64_t)bytes;
+                keyframesSent += keyframe;
+            }
+            if (!streams.empty()) {
+                auto it = streams.find(s.matchId);
+                if (it != streams.end()) {
+                    double t0 = cpuSeconds();
+                    it->second->publish(sock, s, tick);
+                    double spent = cpuSeconds() - t0;
+                    fanoutSeconds += spent;
+                    spectateSeconds += spent;
+                    viewerTicks += it->second->viewerCount();
+                }
+            }
+            clientTicks++;
+            i++;
+        }
+
+        // Viewers that stopped sending WATCH
+        if (now >= nextExpiry && !streams.empty()) {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+            for (auto it = streams.begin(); it != streams.end();) {
+                it->second->expire((uint64_t)ms);
+                if (it->second->viewerCount() == 0) it = streams.erase(it);
+                else ++it;
+            }
+            nextExpiry = now + std::chrono::seconds(1);
+        }
+    }
+
+    void report(double cpu) {
+        double perClient = clientTicks ? (double)bytesSent / clientTicks : 0.0;
+        double cpuPerTick = ticksRun ? (std::max)(cpu - spectateSeconds, 0.0) / ticksRun : 0.0; // players only
+        double clientsPerTick = ticksRun ? (double)clientTicks / ticksRun : 0.0;
+        printf("tick %u  %zu clients (+%d -%d)  %.1f B/client/tick (%.1f with UDP/IP)  keyframes %.2f%%  in %.1f B/client/tick\n",
+            tick, sessions.size(), joined, left, perClient, perClient + 28.0,
+            clientTicks ? 100.0 * keyframesSent / clientTicks : 0.0, clientTicks ? (double)bytesIn / clientTicks : 0.0);
+        if (clientsPerTick > 0) {
+            printf("          cpu %.3f ms/tick  = %.3f ms/tick per 1000 clients (%.2f%% of one core at %d ms ticks)\n",
+                cpuPerTick * 1e3, cpuPerTick * 1e3 * 1000.0 / clientsPerTick,
+                cpuPerTick * 1000.0 / clientsPerTick * 1e5 / cfg.tickMs, cfg.tickMs);
+        }
+        if (!streams.empty() || viewerTicks) {
+            size_t viewers = 0, viewerBytes = 0;
+            for (const auto& kv : streams) {
+                viewers += kv.second->viewerCount();
+                viewerBytes += kv.second->viewerBytes();
+            }
+            double perViewerTick = viewerTicks ? fanoutSeconds / viewerTicks : 0.0;
+            printf("          %zu spectators on %zu streams: fan-out %.1f us per viewer-tick = %.2f ms/tick per 10k viewers"
+                " (%.1f%% of one core at %d ms ticks)\n", viewers, streams.size(), perViewerTick * 1e6,
+                perViewerTick * 1e4 * 1e3, perViewerTick * 1e4 * 1e5 / cfg.tickMs, cfg.tickMs);
+            printf("          with WATCH handling and catch-up: %.2f ms/tick, %llu catch-up packets\n",
+                ticksRun ? spectateSeconds * 1e3 / ticksRun : 0.0, (unsigned long long)catchupPackets);
+            printf("          memory: %zu packet buffers (%zu live, %.1f KB), viewer state %.1f KB = %.1f B/viewer, process RSS %.1f MB\n",
+                buffers.allocated(), buffers.live(), buffers.bytes() / 1024.0, viewerBytes / 1024.0,
+                viewers ? (double)viewerBytes / viewers : 0.0, residentBytes() / 1048576.0);
+        }
+        fflush(stdout);
+        ticksRun = clientTicks = bytesSent = keyframesSent = packetsIn = bytesIn = 0;
+        catchupPackets = viewerTicks = 0;
+        fanoutSeconds = spectateSeconds = 0.0;
+        joined = left = 0;
+    }
+};
+
+int main(int argc, char** argv) {
+    ServerConfig cfg = parseArgs(argc, argv);
+    if (cfg.width < 4 || cfg.height < 4 || cfg.width > NET_MAX_SIDE || cfg.height > NET_MAX_SIDE || cfg.fruits < 1 ||
+        cfg.fruits > SIM_MAX_FOOD || cfg.tickMs < 1 || cfg.statsSeconds < 1) {
+        printf("invalid settings (board sides 4..%d, fruits 1..%d)\n", NET_MAX_SIDE, SIM_MAX_FOOD);
+        return 1;
+    }
+    if (!netInit()) return 1;
+    SnakeServer server(cfg);
+    if (!server.open()) {
+        printf("cannot bind %s:%d\n", cfg.ip, cfg.port);
+        return 1;
+    }
+    printf("serving %dx%d, %d fruit, %d ms ticks on %s:%d\n", cfg.width, cfg.height, cfg.fruits, cfg.tickMs, cfg.ip, cfg.port);
+    fflush(stdout);
+    server.run();
+    return 0;
+}
@@ -0,0 +1,276 @@
+// snake_share_bench.cpp
+// False sharing between main.cpp's threads. The window thread stores the mouse position
+// and the frame latency, the build job stores its scene cache and reads the flags, the
+// mouse and the latency, and the raster job stores its GDI state. This bench runs those
+// stores and loads on three threads under load, in two layouts: packed, as the statics
+// sat before (declared together, so lines are shared by whoever lands on them), and by
+// writer, as main.cpp lays them out now (CachePadded, snake_queue.h). It prints which
+// fields share a line in each layout, the operations each thread got through, and, where
+// the kernel exposes hardware counters, cache misses per operation (perf_event_open).
+// The threads are pinned to separate cores when there are three; with fewer they take
+// turns on one core, which cannot false-share, and the two layouts come out even.
+// Compile: g++ snake_share_bench.cpp -std=c++20 -O2 -pthread -o snake_share_bench
+// Run:     ./snake_share_bench [--ms 500] [--rounds 3] [--layout packed|padded|both]
+// Profile: perf c2c record -- ./snake_share_bench --layout packed; perf c2c report
+//          (shared lines with HITM counts; compare against --layout padded)
+
+#include "snake_queue.h"
+
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+//
+// Config
+//
+struct ShareBenchConfig {
+    int ms = 500;   // per thread set, per round
+    int rounds = 3; // best of
+    bool packed = true, padded = true;
+};
+
+static ShareBenchConfig parseArgs(int argc, char** argv) {
+    ShareBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--ms") && i + 1 < argc) cfg.ms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rounds") && i + 1 < argc) cfg.rounds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--layout") && i + 1 < argc) {
+            const char* l = argv[++i];
+            cfg.packed = !strcmp(l, "packed") || !strcmp(l, "both");
+            cfg.padded = !strcmp(l, "padded") || !strcmp(l, "both");
+        }
+    }
+    return cfg;
+}
+
+//
+// The two layouts. Every field the threads touch in the loop is atomic, so each store
+// and load reaches memory; relaxed, as main.cpp's are.
+//
+struct PackedState {
+    std::mutex stateMtx;
+    std::atomic_bool running{ true };
+    std::atomic<uint32_t> mousePos{ 0 };      // window
+    std::atomic<bool> serialRender{ false };  // read by build
+    std::atomic<bool> showFrameStats{ true }; // read by build
+    std::atomic<double> latency{ 0.0 };       // window (present)
+    std::atomic<uint64_t> frames{ 0 };        // window (present)
+    std::atomic<uint64_t> sceneHash{ 0 };     // build
+    std::atomic<uint64_t> gdiObjects{ 0 };    // raster
+    int score = 0;                            // window, under stateMtx
+};
+
+struct PaddedState {
+    CachePadded<std::mutex> stateMtx;
+    CachePadded<std::atomic_bool> running{ true };
+    CachePadded<std::atomic<uint32_t>> mousePos;
+    std::atomic<bool> serialRender{ false };
+    std::atomic<bool> showFrameStats{ true };
+    int score = 0;
+    struct alignas(CACHE_LINE) {
+        std::atomic<double> latency{ 0.0 };
+        std::atomic<uint64_t> frames{ 0 };
+    } present;
+    CachePadded<std::atomic<uint64_t>> sceneHash;
+    CachePadded<std::atomic<uint64_t>> gdiObjects;
+};
+
+// The fields by name, whichever layout holds them
+static std::atomic<double>& latencyOf(PackedState& s) { return s.latency; }
+static std::atomic<uint64_t>& framesOf(PackedState& s) { return s.frames; }
+static std::atomic<double>& latencyOf(PaddedState& s) { return s.present.latency; }
+static std::atomic<uint64_t>& framesOf(PaddedState& s) { return s.present.frames; }
+
+template <typename State>
+static void printLayout(const char* name, State& s) {
+    auto line = [&s](const void* p) { return (int)(((const char*)p - (const char*)&s) / (ptrdiff_t)CACHE_LINE); };
+    printf("%-7s %zu bytes; from its start, line of stateMtx %d, running %d, mousePos %d, flags %d, latency %d, frames %d, "
+        "sceneHash %d, gdiObjects %d\n",
+        name, sizeof(State), line(&s.stateMtx), line(&s.running), line(&s.mousePos), line(&s.serialRender),
+        line(&latencyOf(s)), line(&framesOf(s)), line(&s.sceneHash), line(&s.gdiObjects));
+}
+
+//
+// Hardware counters for the calling thread, when there are any
+//
+class MissCounter {
+public:
+    MissCounter() {
+        perf_event_attr a;
+        memset(&a, 0, sizeof(a));
+        a.size = sizeof(a);
+        a.type = PERF_TYPE_HARDWARE;
+        a.config = PERF_COUNT_HW_CACHE_MISSES;
+        a.exclude_kernel = 1;
+        a.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+    }
+    ~MissCounter() {
+        if (fd >= 0) close(fd);
+    }
+
+    bool available() const { return fd >= 0; }
+
+    uint64_t read() const {
+        uint64_t v = 0;
+        if (fd >= 0 && ::read(fd, &v, sizeof(v)) != (ssize_t)sizeof(v)) v = 0;
+        return v;
+    }
+
+private:
+    int fd;
+};
+
+static void pinTo(int core) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+//
+// The threads' loops
+//
+struct ThreadResult {
+    uint64_t ops = 0, misses = 0;
+    bool counted = false;
+};
+
+template <typename State>
+static void windowLoop(State& s, const std::atomic<bool>& stop, ThreadResult& r) {
+    MissCounter mc;
+    uint64_t m0 = mc.read(), i = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        s.mousePos.store((uint32_t)i * 0x10003u, std::memory_order_relaxed);
+        std::atomic<double>& lat = latencyOf(s);
+        double a = lat.load(std::memory_order_relaxed);
+        lat.store(a + ((double)(i & 15) - a) / 32.0, std::memory_order_relaxed);
+        std::atomic<uint64_t>& frames = framesOf(s);
+        frames.store(frames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if ((++i & 1023) == 0) {
+            std::lock_guard<std::mutex> lk(s.stateMtx);
+            s.score++;
+        }
+    }
+    r = { i, mc.read() - m0, mc.available() };
+}
+
+template <typename State>
+static void buildLoop(State& s, const std::atomic<bool>& stop, ThreadResult& r) {
+    MissCounter mc;
+    uint64_t m0 = mc.read(), i = 0, h = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (!s.running.load(std::memory_order_relaxed)) break;
+        h = h * 31 + s.mousePos.load(std::memory_order_relaxed);
+        if (!s.serialRender.load(std::memory_order_relaxed) && s.showFrameStats.load(std::memory_order_relaxed))
+            h += (uint64_t)latencyOf(s).load(std::memory_order_relaxed) + framesOf(s).load(std::memory_order_relaxed);
+        s.sceneHash.store(h, std::memory_order_relaxed);
+        if ((++i & 1023) == 0) {
+            std::lock_guard<std::mutex> lk(s.stateMtx);
+            h += (uint64_t)s.score;
+        }
+    }
+    r = { i, mc.read() - m0, mc.available() };
+}
+
+template <typename State>
+static void rasterLoop(State& s, const std::atomic<bool>& stop, ThreadResult& r) {
+    MissCounter mc;
+    uint64_t m0 = mc.read(), i = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (!s.running.load(std::memory_order_relaxed)) break;
+        s.gdiObjects.store(s.gdiObjects.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        i++;
+    }
+    r = { i, mc.read() - m0, mc.available() };
+}
+
+struct LayoutResult {
+    ThreadResult window, build, raster;
+};
+
+template <typename State>
+static LayoutResult runLayout(const ShareBenchConfig& cfg, bool pin) {
+    LayoutResult best;
+    for (int round = 0; round < cfg.rounds; round++) {
+        State* s = new State();
+        std::atomic<bool> stop{ false };
+        LayoutResult r;
+        std::thread tw([&] {
+            if (pin) pinTo(0);
+            windowLoop(*s, stop, r.window);
+        });
+        std::thread tb([&] {
+            if (pin) pinTo(1);
+            buildLoop(*s, stop, r.build);
+        });
+        std::thread tr([&] {
+            if (pin) pinTo(2);
+            rasterLoop(*s, stop, r.raster);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(cfg.ms));
+        stop.store(true);
+        tw.join();
+        tb.join();
+        tr.join();
+        delete s;
+        if (r.window.ops + r.build.ops + r.raster.ops > best.window.ops + best.build.ops + best.raster.ops) best = r;
+    }
+    return best;
+}
+
+static void printRow(const char* name, const ThreadResult& t, int ms) {
+    printf("  %-8s %9.1f Mops/s", name, (double)t.ops / (ms * 1000.0));
+    if (t.counted) printf("  %7.3f misses/op\n", t.ops ? (double)t.misses / (double)t.ops : 0.0);
+    else printf("  misses n/a\n");
+}
+
+static void printResult(const char* name, const LayoutResult& r, int ms) {
+    printf("%s\n", name);
+    printRow("window", r.window, ms);
+    printRow("build", r.build, ms);
+    printRow("raster", r.raster, ms);
+}
+
+int main(int argc, char** argv) {
+    ShareBenchConfig cfg = parseArgs(argc, argv);
+    unsigned cores = std::thread::hardware_concurrency();
+    bool pin = cores >= 3;
+    MissCounter probe;
+    printf("%u hardware threads (%s); %d ms per round, best of %d; hardware counters %s\n", cores,
+        pin ? "threads pinned to cores 0, 1, 2" : "threads share the cores, no false sharing possible", cfg.ms, cfg.rounds,
+        probe.available() ? "on" : "unavailable");
+
+    PackedState* packed = new PackedState();
+    PaddedState* padded = new PaddedState();
+    printLayout("packed", *packed);
+    printLayout("padded", *padded);
+    delete packed;
+    delete padded;
+
+    LayoutResult a, b;
+    if (cfg.packed) {
+        a = runLayout<PackedState>(cfg, pin);
+        printResult("packed", a, cfg.ms);
+    }
+    if (cfg.padded) {
+        b = runLayout<PaddedState>(cfg, pin);
+        printResult("padded", b, cfg.ms);
+    }
+    if (cfg.packed && cfg.padded && a.build.ops) {
+        printf("padded / packed: window %.2fx, build %.2fx, raster %.2fx\n",
+            a.window.ops ? (double)b.window.ops / (double)a.window.ops : 0.0, (double)b.build.ops / (double)a.build.ops,
+            a.raster.ops ? (double)b.raster.ops / (double)a.raster.ops : 0.0);
+    }
+    return 0;
+}
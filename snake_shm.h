@@ -0,0 +1,403 @@
+// snake_shm.h
+// Shared-memory ring for streaming env batches to a trainer in another process (Linux only).
+// The ring lives in a memfd; observations are encoded straight into it by the simulator and
+// read in place by the trainer, which writes its actions back into the same slot.
+// Each side blocks on a futex only when the other is behind, and either process may
+// restart: whoever is still alive keeps the memfd mapped and hands it to the newcomer
+// over an abstract unix socket.
+
+#pragma once
+
+#if !defined(__linux__)
+#error "snake_shm.h needs memfd and futex (Linux)"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+static constexpr uint32_t SHM_MAGIC = 0x534E4B52; // "SNKR"
+static constexpr uint32_t SHM_VERSION = 1;
+static constexpr size_t SHM_PAGE = 4096;
+
+// Slot flags
+enum : uint32_t {
+    SHM_SLOT_FRESH = 1, // first batch from a (re)started simulator: actions for it are not stepped
+};
+
+//
+// Geometry, fixed by the simulator that creates the ring
+//
+struct ShmRingConfig {
+    uint32_t slots = 4;   // batches in flight
+    uint32_t batch = 64;  // games per batch
+    uint32_t channels = 4;
+    uint32_t width = 10;
+    uint32_t height = 10;
+};
+
+struct alignas(64) ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    ShmRingConfig cfg;
+    uint32_t slotBytes;
+    uint32_t obsOffset, rewardOffset, doneOffset, actionOffset;
+
+    // Monotonic batch counters, also the futex words. Slot of batch s is s % slots.
+    alignas(64) std::atomic<uint32_t> produced;
+    std::atomic<uint32_t> producedWaiters;
+    alignas(64) std::atomic<uint32_t> consumed;
+    std::atomic<uint32_t> consumedWaiters;
+    alignas(64) std::atomic<uint32_t> producerPid;
+    std::atomic<uint32_t> consumerPid;
+};
+
+struct ShmSlotHeader {
+    uint32_t seq;
+    uint32_t flags;
+    uint32_t count;
+};
+
+// Pointers into one slot
+struct ShmBatch {
+    uint32_t seq;
+    uint32_t flags;
+    uint32_t count;
+    float* obs;       // [batch][channels][height][width]
+    float* reward;
+    uint8_t* done;
+    int32_t* actions;
+};
+
+//
+// Futex helpers (shared, not private: the word lives in another process's mapping too)
+//
+static inline void shmFutexWait(std::atomic<uint32_t>* word, uint32_t seen, int timeoutMs) {
+    timespec ts{ timeoutMs / 1000, (long)(timeoutMs % 1000) * 1000000L };
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, seen, &ts, nullptr, 0);
+}
+
+static inline void shmFutexWake(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+// Wait until pred() holds: spin briefly, then sleep on the futex; the waker only makes the
+// syscall when someone has registered as a waiter.
+template <typename Pred>
+static inline void shmWaitFor(std::atomic<uint32_t>* word, std::atomic<uint32_t>* waiters, Pred pred) {
+    for (int spin = 0; spin < 2000; spin++) {
+        if (pred()) return;
+    }
+    while (!pred()) {
+        waiters->fetch_add(1);
+        uint32_t seen = word->load();
+        if (!pred()) shmFutexWait(word, seen, 100);
+        waiters->fetch_sub(1);
+    }
+}
+
+static inline void shmBump(std::atomic<uint32_t>* word, std::atomic<uint32_t>* waiters) {
+    word->fetch_add(1);
+    if (waiters->load() != 0) shmFutexWake(word);
+}
+
+//
+// fd hand-off over an abstract unix socket ("\0snake-shm-<name>")
+//
+static inline socklen_t shmSocketAddr(const char* name, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    int n = snprintf(addr.sun_path + 1, sizeof(addr.sun_path) - 1, "snake-shm-%s", name);
+    return (socklen_t)(offsetof(sockaddr_un, sun_path) + 1 + n);
+}
+
+static inline bool shmSendFd(int sock, int fd) {
+    char byte = 0;
+    iovec iov{ &byte, 1 };
+    alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int))];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+    cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) == 1;
+}
+
+static inline int shmRecvFd(int sock) {
+    char byte;
+    iovec iov{ &byte, 1 };
+    alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int))];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+    if (recvmsg(sock, &msg, 0) != 1) return -1;
+    cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    if (!cm || cm->cmsg_type != SCM_RIGHTS) return -1;
+    int fd;
+    std::memcpy(&fd, CMSG_DATA(cm), sizeof(int));
+    return fd;
+}
+
+// Ask whoever holds the ring for its memfd; -1 if nobody is serving
+static inline int shmFetchFd(const char* name) {
+    sockaddr_un addr;
+    socklen_t len = shmSocketAddr(name, addr);
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return -1;
+    int fd = -1;
+    if (connect(sock, (sockaddr*)&addr, len) == 0) fd = shmRecvFd(sock);
+    close(sock);
+    return fd;
+}
+
+//
+// One side's view of the ring
+//
+class ShmRing {
+public:
+    enum Role { PRODUCER, CONSUMER };
+
+    ~ShmRing() {
+        stopServing = true;
+        if (server.joinable()) server.join();
+        if (base) munmap(base, mapBytes);
+        if (memfd >= 0) close(memfd);
+    }
+
+    // The simulator attaches with its geometry and creates the ring if nobody has one.
+    // The trainer passes cfg = nullptr and waits up to timeoutMs for a ring to appear.
+    // Returns nullptr on a geometry mismatch or timeout.
+    static ShmRing* attach(const char* name, Role role, const ShmRingConfig* cfg, int timeoutMs = 10000) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        ShmRing* ring = new ShmRing();
+        ring->role = role;
+        snprintf(ring->name, sizeof(ring->name), "%s", name);
+
+        for (;;) {
+            int fd = shmFetchFd(name);
+            if (fd >= 0) {
+                if (!ring->map(fd, cfg)) {
+                    delete ring;
+                    return nullptr;
+                }
+                break;
+            }
+            if (cfg && ring->create(*cfg)) break;
+            if (std::chrono::steady_clock::now() >= deadline) {
+                delete ring;
+                return nullptr;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+
+        ShmRingHeader* h = ring->header();
+        if (role == PRODUCER) {
+            h->producerPid.store((uint32_t)getpid());
+            // A restarted simulator resumes after the last batch it published; its first
+            // round of slots is marked fresh so stale actions are never applied.
+            ring->nextSeq = h->produced.load();
+            ring->freshUntil = ring->nextSeq + h->cfg.slots;
+        }
+        else {
+            h->consumerPid.store((uint32_t)getpid());
+        }
+        ring->server = std::thread([ring] { ring->serve(); });
+        return ring;
+    }
+
+    const ShmRingConfig& config() const { return header()->cfg; }
+
+    //
+    // Simulator side
+    //
+    // Next slot to fill. Blocks while the trainer still owes actions for the batch that used
+    // it last; those actions are in batch.actions. freshStart is true when there are none
+    // (ring start or simulator restart) and the games should be reset instead of stepped.
+    ShmBatch beginProduce(bool& freshStart) {
+        ShmRingHeader* h = header();
+        uint32_t seq = nextSeq;
+        uint32_t previous = seq - h->cfg.slots;
+        shmWaitFor(&h->consumed, &h->consumedWaiters,
+            [&] { return (int32_t)(h->consumed.load() - previous) > 0; });
+        freshStart = (int32_t)(seq - freshUntil) < 0;
+        return batch(seq);
+    }
+
+    void publish(uint32_t count, bool fresh) {
+        ShmRingHeader* h = header();
+        ShmSlotHeader* sh = slotHeader(nextSeq);
+        sh->seq = nextSeq;
+        sh->count = count;
+        sh->flags = fresh ? (uint32_t)SHM_SLOT_FRESH : 0u;
+        nextSeq++;
+        shmBump(&h->produced, &h->producedWaiters);
+    }
+
+    //
+    // Trainer side
+    //
+    // Oldest batch without actions; read obs in place, fill actions, then release()
+    ShmBatch beginConsume() {
+        ShmRingHeader* h = header();
+        uint32_t seq = h->consumed.load();
+        shmWaitFor(&h->produced, &h->producedWaiters,
+            [&] { return (int32_t)(h->produced.load() - seq) > 0; });
+        return batch(seq);
+    }
+
+    // Non-blocking variant: false if nothing is pending
+    bool tryConsume(ShmBatch& out) {
+        ShmRingHeader* h = header();
+        uint32_t seq = h->consumed.load();
+        if ((int32_t)(h->produced.load() - seq) <= 0) return false;
+        out = batch(seq);
+        return true;
+    }
+
+    void release() {
+        ShmRingHeader* h = header();
+        shmBump(&h->consumed, &h->consumedWaiters);
+    }
+
+private:
+    ShmRing() = default;
+
+    ShmRingHeader* header() const { return (ShmRingHeader*)base; }
+
+    ShmSlotHeader* slotHeader(uint32_t seq) const {
+        ShmRingHeader* h = header();
+        return (ShmSlotHeader*)(base + SHM_PAGE + (size_t)(seq % h->cfg.slots) * h->slotBytes);
+    }
+
+    ShmBatch batch(uint32_t seq) const {
+        ShmRingHeader* h = header();
+        char* slot = (char*)slotHeader(seq);
+        ShmSlotHeader* sh = (ShmSlotHeader*)slot;
+        return { seq, sh->flags, sh->count,
+            (float*)(slot + h->obsOffset), (float*)(slot + h->rewardOffset),
+            (uint8_t*)(slot + h->doneOffset), (int32_t*)(slot + h->actionOffset) };
+    }
+
+    static size_t alignUp(size_t v, size_t a) { return (v + a - 1) / a * a; }
+
+    bool create(const ShmRingConfig& cfg) {
+        int fd = (int)syscall(SYS_memfd_create, "snake-shm", 1u /* MFD_CLOEXEC */);
+        if (fd < 0) return false;
+
+        // Slot: header | obs | reward | done | actions, each section cache-line aligned
+        size_t n = cfg.batch;
+        size_t obsOff = 64;
+        size_t rewardOff = alignUp(obsOff + sizeof(float) * n * cfg.channels * cfg.width * cfg.height, 64);
+        size_t doneOff = alignUp(rewardOff + sizeof(float) * n, 64);
+        size_t actionOff = alignUp(doneOff + n, 64);
+        size_t slotBytes = alignUp(actionOff + sizeof(int32_t) * n, SHM_PAGE);
+        size_t bytes = SHM_PAGE + slotBytes * cfg.slots;
+        if (ftruncate(fd, (off_t)bytes) != 0) {
+            close(fd);
+            return false;
+        }
+
+        char* mem = (char*)mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mem == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        ShmRingHeader* h = new (mem) ShmRingHeader();
+        h->cfg = cfg;
+        h->slotBytes = (uint32_t)slotBytes;
+        h->obsOffset = (uint32_t)obsOff;
+        h->rewardOffset = (uint32_t)rewardOff;
+        h->doneOffset = (uint32_t)doneOff;
+        h->actionOffset = (uint32_t)actionOff;
+        h->produced.store(0);
+        h->consumed.store(0);
+        h->version = SHM_VERSION;
+        std::atomic_thread_fence(std::memory_order_release);
+        h->magic = SHM_MAGIC;
+
+        memfd = fd;
+        base = mem;
+        mapBytes = bytes;
+        return true;
+    }
+
+    bool map(int fd, const ShmRingConfig* cfg) {
+        off_t bytes = lseek(fd, 0, SEEK_END);
+        if (bytes < (off_t)SHM_PAGE) {
+            close(fd);
+            return false;
+        }
+        char* mem = (char*)mmap(nullptr, (size_t)bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mem == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        memfd = fd;
+        base = mem;
+        mapBytes = (size_t)bytes;
+
+        const ShmRingHeader* h = header();
+        if (h->magic != SHM_MAGIC || h->version != SHM_VERSION) return false;
+        if (cfg && (cfg->slots != h->cfg.slots || cfg->batch != h->cfg.batch || cfg->channels != h->cfg.channels ||
+            cfg->width != h->cfg.width || cfg->height != h->cfg.height)) {
+            return false;
+        }
+        return true;
+    }
+
+    // Keep handing the memfd to whoever connects. Only one live process can own the
+    // abstract name; the other keeps retrying so it takes over if the owner exits.
+    void serve() {
+        sockaddr_un addr;
+        socklen_t len = shmSocketAddr(name, addr);
+        while (!stopServing) {
+            int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (sock < 0) return;
+            if (bind(sock, (sockaddr*)&addr, len) != 0 || listen(sock, 8) != 0) {
+                close(sock);
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            while (!stopServing) {
+                pollfd pfd{ sock, POLLIN, 0 };
+                if (poll(&pfd, 1, 100) <= 0) continue;
+                int client = accept4(sock, nullptr, nullptr, SOCK_CLOEXEC);
+                if (client < 0) continue;
+                shmSendFd(client, memfd);
+                close(client);
+            }
+            close(sock);
+        }
+    }
+
+    Role role = PRODUCER;
+    char name[64] = {};
+    int memfd = -1;
+    char* base = nullptr;
+    size_t mapBytes = 0;
+    uint32_t nextSeq = 0;
+    uint32_t freshUntil = 0;
+    std::atomic_bool stopServing{ false };
+    std::thread server;
+};
@@ -0,0 +1,145 @@
+// snake_shm_bench.cpp
+// Simulator side of the shared-memory ring: steps env groups straight into the ring slots
+// and measures throughput and round-trip latency against a trainer process.
+// Compile: g++ snake_shm_bench.cpp snake_env.cpp -std=c++20 -O2 -pthread -o snake_shm_bench
+// Run:     ./snake_shm_bench --fork            (built-in trainer that answers with random actions)
+//          ./snake_shm_bench --name snake      (then start ./snake_shm_consumer snake)
+
+#include "snake_shm.h"
+#include "snake_env.h"
+#include "snake_sim.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <sys/wait.h>
+
+//
+// Config
+//
+struct ShmBenchConfig {
+    const char* name = "snake-bench";
+    int slots = 4;
+    int batch = 256;
+    int width = 10;
+    int height = 10;
+    double seconds = 5.0;
+    bool fork = false;
+};
+
+static ShmBenchConfig parseArgs(int argc, char** argv) {
+    ShmBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--name") && i + 1 < argc) cfg.name = argv[++i];
+        else if (!strcmp(argv[i], "--slots") && i + 1 < argc) cfg.slots = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--batch") && i + 1 < argc) cfg.batch = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) cfg.seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--fork")) cfg.fork = true;
+    }
+    return cfg;
+}
+
+// Minimal trainer for --fork: random actions, no policy cost, so only transport is timed
+static int runChildConsumer(const char* name) {
+    ShmRing* ring = ShmRing::attach(name, ShmRing::CONSUMER, nullptr, 10000);
+    if (!ring) return 1;
+    SimRng rng{ 99 };
+    for (;;) {
+        ShmBatch b = ring->beginConsume();
+        if (b.count == 0) break; // producer's stop marker
+        for (uint32_t i = 0; i < b.count; i++) b.actions[i] = (int32_t)rng.below(4);
+        ring->release();
+    }
+    ring->release();
+    delete ring;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    ShmBenchConfig cfg = parseArgs(argc, argv);
+
+    ShmRingConfig rc;
+    rc.slots = (uint32_t)cfg.slots;
+    rc.batch = (uint32_t)cfg.batch;
+    rc.channels = SNAKE_ENV_CHANNELS;
+    rc.width = (uint32_t)cfg.width;
+    rc.height = (uint32_t)cfg.height;
+
+    ShmRing* ring = ShmRing::attach(cfg.name, ShmRing::PRODUCER, &rc, 1000);
+    if (!ring) {
+        printf("could not create or attach ring %s\n", cfg.name);
+        return 1;
+    }
+
+    pid_t child = -1;
+    if (cfg.fork) {
+        child = fork();
+        if (child == 0) {
+            // The child must not reuse the parent's ring object (its server thread is not forked)
+            _exit(runChildConsumer(cfg.name));
+        }
+    }
+
+    // One env group per slot: the slot's actions always belong to the same games
+    SnakeEnvSettings s;
+    env_default_settings(&s);
+    s.gridWidth = cfg.width;
+    s.gridHeight = cfg.height;
+    std::vector<SnakeEnv*> groups;
+    for (int i = 0; i < cfg.slots; i++) {
+        s.seed = (uint64_t)i + 1;
+        groups.push_back(env_create(cfg.batch, &s));
+    }
+
+    using clock = std::chrono::steady_clock;
+    std::vector<clock::time_point> publishedAt(cfg.slots);
+    std::vector<double> rtt;
+    long long steps = 0;
+    auto t0 = clock::now();
+    auto stopAt = t0 + std::chrono::duration<double>(cfg.seconds);
+
+    while (clock::now() < stopAt) {
+        bool fresh;
+        ShmBatch b = ring->beginProduce(fresh);
+        int slot = (int)(b.seq % (uint32_t)cfg.slots);
+        SnakeEnv* env = groups[slot];
+        if (fresh) {
+            env_reset(env, b.obs);
+            std::fill(b.reward, b.reward + cfg.batch, 0.0f);
+            std::fill(b.done, b.done + cfg.batch, 0);
+        }
+        else {
+            // Time from publishing this slot's last batch until its actions were back
+            rtt.push_back(std::chrono::duration<double, std::micro>(clock::now() - publishedAt[slot]).count());
+            env_step(env, b.actions, b.obs, b.reward, b.done);
+            steps += cfg.batch;
+        }
+        publishedAt[slot] = clock::now();
+        ring->publish((uint32_t)cfg.batch, fresh);
+    }
+    double secs = std::chrono::duration<double>(clock::now() - t0).count();
+
+    if (child > 0) {
+        bool fresh;
+        ring->beginProduce(fresh);
+        ring->publish(0, false); // stop marker
+        waitpid(child, nullptr, 0);
+    }
+
+    std::sort(rtt.begin(), rtt.end());
+    auto pct = [&](double p) { return rtt.empty() ? 0.0 : rtt[std::min(rtt.size() - 1, size_t(p * rtt.size()))]; };
+    double bytes = double(steps) * (SNAKE_ENV_CHANNELS * cfg.width * cfg.height * 4 + 4 + 1 + 4);
+    printf("%d slots x %d games %dx%d: %.2f M steps/s, %.2f GB/s through the ring\n",
+        cfg.slots, cfg.batch, cfg.width, cfg.height, steps / secs / 1e6, bytes / secs / 1e9);
+    printf("round trip us: p50 %.1f  p99 %.1f  max %.1f\n", pct(0.50), pct(0.99), rtt.empty() ? 0.0 : rtt.back());
+
+    for (SnakeEnv* env : groups) env_destroy(env);
+    delete ring;
+    return 0;
+}
@@ -0,0 +1,88 @@
+// snake_shm_consumer.cpp
+// Reference trainer side of the shared-memory ring in snake_shm.h: reads observation batches
+// in place and answers each with actions (greedy towards the nearest fruit).
+// Compile: g++ snake_shm_consumer.cpp -std=c++20 -O2 -pthread -o snake_shm_consumer
+// Run:     ./snake_shm_consumer [name] [batches]   (start the simulator with the same name)
+
+#include "snake_shm.h"
+#include "snake_obs.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+//
+// Policy: head and food are read straight from the observation planes
+//
+static int32_t greedyAction(const float* obs, int w, int h) {
+    const float* head = obs + (size_t)OBS_HEAD * w * h;
+    const float* body = obs + (size_t)OBS_BODY * w * h;
+    const float* food = obs + (size_t)OBS_FOOD * w * h;
+    int hx = 0, hy = 0, fx = -1, fy = -1;
+    for (int c = 0; c < w * h; c++) {
+        if (head[c] != 0.0f) { hx = c % w; hy = c / w; }
+        if (food[c] != 0.0f && fx < 0) { fx = c % w; fy = c / w; }
+    }
+
+    // Prefer moves that close the distance, never into a wall or the body
+    static const int dx[4] = { 0, 0, -1, 1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    int best = SIM_RIGHT;
+    int bestScore = -1000000;
+    for (int a = 0; a < 4; a++) {
+        int x = hx + dx[a], y = hy + dy[a];
+        int score = 0;
+        if (x < 0 || x >= w || y < 0 || y >= h || body[y * w + x] != 0.0f) score -= 100000;
+        if (fx >= 0) score -= abs(fx - x) + abs(fy - y);
+        if (score > bestScore) { bestScore = score; best = a; }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    const char* name = argc > 1 ? argv[1] : "snake";
+    long long limit = argc > 2 ? atoll(argv[2]) : 0;
+    setvbuf(stdout, nullptr, _IOLBF, 0); // progress lines survive being killed
+
+    ShmRing* ring = ShmRing::attach(name, ShmRing::CONSUMER, nullptr, 30000);
+    if (!ring) {
+        printf("no ring named %s\n", name);
+        return 1;
+    }
+    const ShmRingConfig& cfg = ring->config();
+    size_t obsStride = (size_t)cfg.channels * cfg.width * cfg.height;
+    printf("attached: %u slots x %u games, %ux%u\n", cfg.slots, cfg.batch, cfg.width, cfg.height);
+
+    using clock = std::chrono::steady_clock;
+    auto lastReport = clock::now();
+    long long batches = 0, steps = 0, episodes = 0;
+    double rewardSum = 0.0;
+
+    while (limit == 0 || batches < limit) {
+        ShmBatch b = ring->beginConsume();
+        for (uint32_t i = 0; i < b.count; i++) {
+            b.actions[i] = greedyAction(b.obs + obsStride * i, (int)cfg.width, (int)cfg.height);
+            if (!(b.flags & SHM_SLOT_FRESH)) {
+                rewardSum += b.reward[i];
+                episodes += b.done[i];
+            }
+        }
+        ring->release();
+        batches++;
+        steps += b.count;
+
+        auto now = clock::now();
+        if (now - lastReport >= std::chrono::seconds(1)) {
+            double secs = std::chrono::duration<double>(now - lastReport).count();
+            printf("%.2f M steps/s, %lld episodes, mean reward/step %.4f\n",
+                steps / secs / 1e6, episodes, steps ? rewardSum / steps : 0.0);
+            lastReport = now;
+            steps = 0;
+            episodes = 0;
+            rewardSum = 0.0;
+        }
+    }
+
+    delete ring;
+    return 0;
+}
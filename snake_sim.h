@@ -0,0 +1,236 @@
+// snake_sim.h
+// Headless Snake simulation - the same tick rules as tickLocked in main.cpp,
+// without the window, locks or wall-clock timing. Shared by the training env and tools.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+//
+// Deterministic RNG (splitmix64)
+// The game uses std::mt19937 + uniform_int_distribution, whose output differs
+// between standard libraries, so headless runs use their own generator.
+//
+struct SimRng {
+    uint64_t state = 0;
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Value in [0, n)
+    uint32_t below(uint32_t n) {
+        return (uint32_t)(((next() >> 32) * (uint64_t)n) >> 32);
+    }
+};
+
+//
+// Types
+//
+enum SimDir : uint8_t { SIM_UP, SIM_DOWN, SIM_LEFT, SIM_RIGHT }; // same order as Direction
+
+enum SimResult : uint8_t { SIM_MOVED, SIM_ATE, SIM_DIED, SIM_WON };
+
+static constexpr int SIM_MAX_FOOD = 32;
+
+static inline SimDir simOpposite(SimDir d) {
+    static const SimDir opp[4] = { SIM_DOWN, SIM_UP, SIM_RIGHT, SIM_LEFT };
+    return opp[d];
+}
+
+//
+// One game
+// The body is a ring of cell indices (head at body[headPos]) plus a per-cell serial:
+// each new head gets ++headSerial, so a cell is occupied iff grid[c] >= tailSerial and
+// its age is headSerial - grid[c]. Popping the tail is just ++tailSerial - collision,
+// growth and food checks never scan the body.
+// Storage is bound from outside so many games can share one arena.
+//
+struct SnakeSim {
+    int w = 0, h = 0, cells = 0;
+    int fruitCount = 1;
+
+    uint32_t* grid = nullptr; // serial per cell
+    uint32_t* body = nullptr; // ring of cell indices
+    uint32_t ringMask = 0;
+    int maxCells = 0;
+
+    uint32_t headPos = 0;
+    uint32_t length = 0;
+    uint32_t headSerial = 0;
+    uint32_t tailSerial = 0;
+
+    uint32_t food[SIM_MAX_FOOD];
+    int foodCount = 0;
+
+    SimDir dir = SIM_RIGHT;
+    int score = 0;
+    uint32_t ticks = 0;
+    uint32_t ticksSinceFood = 0;
+    bool gameOver = false;
+    bool gameWon = false;
+    SimRng rng;
+
+    static uint32_t ringCapacity(int maxCells) {
+        uint32_t cap = 1;
+        while (cap < (uint32_t)maxCells) cap <<= 1;
+        return cap;
+    }
+
+    // uint32 words of storage needed for boards up to maxCells
+    static size_t storageWords(int maxCells) {
+        return (size_t)maxCells + ringCapacity(maxCells);
+    }
+
+    void bind(uint32_t* mem, int capacityCells) {
+        maxCells = capacityCells;
+        grid = mem;
+        body = mem + capacityCells;
+        ringMask = ringCapacity(capacityCells) - 1;
+    }
+
+    // Move the game, mid-episode, to storage for boards up to capacityCells (no smaller
+    // than the current board). The body keeps headPos, so it is only re-spread on the new ring.
+    void rebind(uint32_t* mem, int capacityCells) {
+        uint32_t* newBody = mem + capacityCells;
+        uint32_t newMask = ringCapacity(capacityCells) - 1;
+        std::memcpy(mem, grid, sizeof(uint32_t) * (size_t)cells);
+        for (uint32_t i = 0; i < length; i++) newBody[(headPos - i) & newMask] = segment(i);
+        bind(mem, capacityCells);
+    }
+
+    // Segment i counted from the head (0 = head)
+    uint32_t segment(uint32_t i) const { return body[(headPos - i) & ringMask]; }
+    uint32_t head() const { return body[headPos]; }
+    bool occupied(uint32_t c) const { return grid[c] >= tailSerial; }
+    bool done() const { return gameOver || gameWon; }
+
+    bool hasFood(uint32_t c) const {
+        for (int i = 0; i < foodCount; i++) {
+            if (food[i] == c) return true;
+        }
+        return false;
+    }
+
+    // Same as placeOneFoodLocked: up to 1000 random tries, skipping snake and food
+    void placeOneFood() {
+        if (foodCount >= SIM_MAX_FOOD) return;
+        for (int attempts = 0; attempts < 1000; attempts++) {
+            uint32_t x = rng.below((uint32_t)w);
+            uint32_t y = rng.below((uint32_t)h);
+            uint32_t c = y * (uint32_t)w + x;
+            if (!occupied(c) && !hasFood(c)) {
+                food[foodCount++] = c;
+                return;
+            }
+        }
+    }
+
+    // Same as resetGameLocked: 3 segments centred, heading right, food placed
+    void reset(int width, int height, int fruits, uint64_t seed) {
+        w = width;
+        h = height;
+        cells = w * h;
+        fruitCount = std::clamp(fruits, 1, SIM_MAX_FOOD);
+        rng.state = seed;
+
+        std::memset(grid, 0, sizeof(uint32_t) * (size_t)cells);
+        int sx = w / 2;
+        int sy = h / 2;
+        headPos = 2;
+        length = 3;
+        body[0] = (uint32_t)(sy * w + sx - 2);
+        body[1] = (uint32_t)(sy * w + sx - 1);
+        body[2] = (uint32_t)(sy * w + sx);
+        grid[body[0]] = 1;
+        grid[body[1]] = 2;
+        grid[body[2]] = 3;
+        tailSerial = 1;
+        headSerial = 3;
+
+        dir = SIM_RIGHT;
+        score = 0;
+        ticks = 0;
+        ticksSinceFood = 0;
+        gameOver = false;
+        gameWon = false;
+
+        foodCount = 0;
+        int numFood = (std::min)(fruitCount, cells - (int)length); // parenthesized: windows.h defines min
+        for (int i = 0; i < numFood; i++) placeOneFood();
+    }
+
+    // Serials are 32-bit; renumber the live body before they wrap (every ~4e9 ticks)
+    void renumber() {
+        std::memset(grid, 0, sizeof(uint32_t) * (size_t)cells);
+        for (uint32_t i = 0; i < length; i++) grid[segment(i)] = length - i;
+        tailSerial = 1;
+        headSerial = length;
+    }
+
+    // One tick of tickLocked. The action is a SimDir; like WndProc, a turn
+    // that reverses the current heading is ignored. Anything else keeps going straight.
+    SimResult step(int action) {
+        if (gameOver) return SIM_DIED;
+        if (gameWon) return SIM_WON;
+
+        if (action >= SIM_UP && action <= SIM_RIGHT && (SimDir)action != simOpposite(dir)) {
+            dir = (SimDir)action;
+        }
+        ticks++;
+        ticksSinceFood++;
+
+        uint32_t hc = head();
+        int x = (int)(hc % (uint32_t)w);
+        int y = (int)(hc / (uint32_t)w);
+        switch (dir) {
+        case SIM_UP:    y -= 1; break;
+        case SIM_DOWN:  y += 1; break;
+        case SIM_LEFT:  x -= 1; break;
+        case SIM_RIGHT: x += 1; break;
+        }
+
+        // collision check (the current tail counts, as in the game)
+        if (x < 0 || x >= w || y < 0 || y >= h) {
+            gameOver = true;
+            return SIM_DIED;
+        }
+        uint32_t nc = (uint32_t)(y * w + x);
+        if (occupied(nc)) {
+            gameOver = true;
+            return SIM_DIED;
+        }
+
+        if (headSerial == UINT32_MAX) renumber();
+        headPos = (headPos + 1) & ringMask;
+        body[headPos] = nc;
+        grid[nc] = ++headSerial;
+        length++;
+
+        // Check if ate any food (keep the order of the rest, like food.erase)
+        for (int i = 0; i < foodCount; i++) {
+            if (food[i] == nc) {
+                std::memmove(&food[i], &food[i + 1], sizeof(uint32_t) * (size_t)(foodCount - i - 1));
+                foodCount--;
+                score += 10;
+                ticksSinceFood = 0;
+
+                if (length >= (uint32_t)cells) {
+                    gameWon = true;
+                    return SIM_WON;
+                }
+                placeOneFood();
+                return SIM_ATE;
+            }
+        }
+
+        length--;
+        tailSerial++;
+        return SIM_MOVED;
+    }
+};
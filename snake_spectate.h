@@ -0,0 +1,171 @@
+// snake_spectate.h
+// Spectator fan-out. Every viewer of a match receives the same stream: a keyframe every
+// SPECTATE_KEYFRAME_INTERVAL ticks and, in between, each tick encoded against the one
+// before. Each packet is encoded once into a reference-counted buffer and sent to all
+// viewers with netSendMany, so no viewer costs a copy. The stream keeps the newest
+// keyframe and the deltas after it; a viewer who joins late or falls behind gets those
+// first and then follows live. Viewers decode with NetReplica like players do.
+// A stream and its buffer pool belong to one thread (the server loop).
+
+#pragma once
+
+#include "snake_net.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+static constexpr uint32_t SPECTATE_KEYFRAME_INTERVAL = 32; // < NET_HISTORY, so every delta's base is still there
+static constexpr int SPECTATE_TIMEOUT_MS = 5000;
+
+//
+// Reference-counted packet buffers, recycled through a free list
+//
+struct NetBuffer {
+    uint32_t refs = 0;
+    uint32_t tick = 0;
+    int size = 0;
+    bool keyframe = false;
+    NetBuffer* nextFree = nullptr;
+    uint8_t data[NET_MAX_PACKET];
+};
+
+class NetBufferPool {
+public:
+    // A buffer with one reference
+    NetBuffer* acquire() {
+        NetBuffer* b = freeList;
+        if (b) {
+            freeList = b->nextFree;
+        }
+        else {
+            storage.push_back(std::make_unique<NetBuffer>());
+            b = storage.back().get();
+        }
+        b->refs = 1;
+        inUse++;
+        return b;
+    }
+
+    NetBuffer* retain(NetBuffer* b) {
+        b->refs++;
+        return b;
+    }
+
+    void release(NetBuffer* b) {
+        if (--b->refs != 0) return;
+        b->nextFree = freeList;
+        freeList = b;
+        inUse--;
+    }
+
+    size_t allocated() const { return storage.size(); }
+    size_t live() const { return inUse; }
+    size_t bytes() const { return storage.size() * sizeof(NetBuffer); }
+
+private:
+    std::vector<std::unique_ptr<NetBuffer>> storage;
+    NetBuffer* freeList = nullptr;
+    size_t inUse = 0;
+};
+
+//
+// One match's viewers and the packets a newcomer needs
+//
+class SpectatorStream {
+public:
+    explicit SpectatorStream(NetBufferPool& pool) : pool(pool) {}
+
+    ~SpectatorStream() { dropHistory(); }
+
+    SpectatorStream(const SpectatorStream&) = delete;
+    SpectatorStream& operator=(const SpectatorStream&) = delete;
+
+    size_t viewerCount() const { return viewers.size(); }
+
+    // Encodes this tick of the match once and sends it to every viewer; returns datagrams sent
+    int publish(NetSocket sock, NetSession& match, uint32_t tick) {
+        bool key = keyframe == nullptr || tick - keyframe->tick >= SPECTATE_KEYFRAME_INTERVAL || lastTick == 0;
+        NetBuffer* b = pool.acquire();
+        b->tick = tick;
+        b->size = match.encodeSnapshot(tick, key ? 0 : lastTick, b->data, &b->keyframe);
+        lastTick = tick;
+        if (b->size == 0) {
+            pool.release(b);
+            return 0;
+        }
+        if (b->keyframe) {
+            dropHistory();
+            keyframe = pool.retain(b);
+        }
+        else {
+            deltas.push_back(pool.retain(b));
+        }
+        int sent = netSendMany(sock, addrs.data(), (int)addrs.size(), b->data, b->size);
+        pool.release(b);
+        return sent;
+    }
+
+    // WATCH from addr: a new viewer (or one asking to resync) gets the keyframe and the
+    // deltas after it; otherwise it is just a heartbeat. Returns datagrams sent.
+    int watch(NetSocket sock, const NetAddr& addr, bool resync, uint64_t nowMs) {
+        auto it = viewers.find(addr.key());
+        bool fresh = it == viewers.end();
+        if (fresh) {
+            viewers[addr.key()] = addrs.size();
+            addrs.push_back(addr);
+            heard.push_back(nowMs);
+        }
+        else {
+            heard[it->second] = nowMs;
+        }
+        if (!(fresh || resync) || !keyframe) return 0;
+        int sent = netSend(sock, addr, keyframe->data, keyframe->size) > 0;
+        for (NetBuffer* d : deltas) sent += netSend(sock, addr, d->data, d->size) > 0;
+        return sent;
+    }
+
+    // Drops viewers silent for SPECTATE_TIMEOUT_MS; returns how many
+    int expire(uint64_t nowMs) {
+        int dropped = 0;
+        for (size_t i = 0; i < addrs.size();) {
+            if (nowMs - heard[i] <= (uint64_t)SPECTATE_TIMEOUT_MS) {
+                i++;
+                continue;
+            }
+            viewers.erase(addrs[i].key());
+            if (i + 1 != addrs.size()) {
+                addrs[i] = addrs.back();
+                heard[i] = heard.back();
+                viewers[addrs[i].key()] = i;
+            }
+            addrs.pop_back();
+            heard.pop_back();
+            dropped++;
+        }
+        return dropped;
+    }
+
+    // Bytes of per-viewer state (the address list, heartbeats and lookup table)
+    size_t viewerBytes() const {
+        return addrs.capacity() * sizeof(NetAddr) + heard.capacity() * sizeof(uint64_t) +
+            viewers.size() * (sizeof(uint64_t) + sizeof(size_t) + 2 * sizeof(void*)) + viewers.bucket_count() * sizeof(void*);
+    }
+
+private:
+    NetBufferPool& pool;
+    NetBuffer* keyframe = nullptr;
+    std::vector<NetBuffer*> deltas; // after the keyframe, in tick order
+    uint32_t lastTick = 0;
+    std::vector<NetAddr> addrs;     // contiguous for netSendMany
+    std::vector<uint64_t> heard;    // last WATCH, ms
+    std::unordered_map<uint64_t, size_t> viewers;
+
+    void dropHistory() {
+        if (keyframe) pool.release(keyframe);
+        keyframe = nullptr;
+        for (NetBuffer* d : deltas) pool.release(d);
+        deltas.clear();
+    }
+};
@@ -0,0 +1,237 @@
+// snake_spectate_bench.cpp
+// Loopback spectators for snake_server: one bot player keeps a game going while N viewers
+// WATCH it, joining over a few seconds so most of them arrive late and catch up from the
+// stream's keyframe. Every viewer checks that ticks arrive in order and asks to resync on a
+// gap; every k-th one also rebuilds the game with NetReplica and verifies each snapshot.
+// The server prints the fan-out CPU and memory; this prints what the viewers saw.
+// Linux only (epoll).
+// Compile: g++ snake_spectate_bench.cpp -std=c++20 -O2 -o snake_spectate_bench
+// Run:     ./snake_server --port 7777 &
+//          ./snake_spectate_bench --port 7777 --viewers 10000 --seconds 20
+
+#include "snake_net.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+//
+// Config
+//
+struct SpectateBenchConfig {
+    const char* ip = "127.0.0.1";
+    int port = 7777;
+    int viewers = 1000;
+    int seconds = 20;
+    int joinSeconds = 5;   // viewers join evenly over this long
+    int verifyEvery = 16;  // every k-th viewer runs a full replica
+    uint64_t seed = 1;
+};
+
+static SpectateBenchConfig parseArgs(int argc, char** argv) {
+    SpectateBenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--ip") && i + 1 < argc) cfg.ip = argv[++i];
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) cfg.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--viewers") && i + 1 < argc) cfg.viewers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) cfg.seconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--join") && i + 1 < argc) cfg.joinSeconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--verify-every") && i + 1 < argc) cfg.verifyEvery = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.seed = strtoull(argv[++i], nullptr, 10);
+    }
+    return cfg;
+}
+
+using BenchClock = std::chrono::steady_clock;
+
+struct Viewer {
+    NetSocket sock = NET_INVALID_SOCKET;
+    bool joined = false;
+    uint32_t lastTick = 0;       // newest tick seen, 0 = waiting for a keyframe
+    uint32_t firstTick = 0;
+    uint64_t packets = 0, bytes = 0, gaps = 0;
+    BenchClock::time_point nextWatch;
+    std::unique_ptr<NetReplica> replica; // verifying viewers only
+};
+
+static void sendWatch(Viewer& v, const NetAddr& server, bool resync) {
+    uint8_t out[6];
+    out[0] = NET_WATCH;
+    netPut32(out + 1, 0);
+    out[5] = resync ? 1 : 0;
+    netSend(v.sock, server, out, 6);
+}
+
+// The snapshot stream of one viewer: ticks must follow each other unless a keyframe restarts it
+static void receive(Viewer& v, const NetAddr& server, const uint8_t* p, int n, int w, int h) {
+    if (n < NET_SNAPSHOT_HEADER || p[0] != NET_SNAPSHOT) return;
+    uint32_t tick = netGet32(p + 1);
+    bool keyframe = p[5] == 0;
+    v.packets++;
+    v.bytes += (uint64_t)n;
+    if (v.firstTick == 0) v.firstTick = tick;
+    if (v.lastTick != 0 && (int32_t)(tick - v.lastTick) <= 0) return; // catch-up overlapping live
+    bool follows = keyframe || (v.lastTick != 0 && tick - p[5] == v.lastTick);
+    if (v.replica) {
+        if (v.replica->w == 0) v.replica->configure(w, h);
+        follows = v.replica->apply(p, n);
+    }
+    if (!follows) {
+        if (v.lastTick != 0) {
+            v.gaps++;
+            sendWatch(v, server, true);
+            v.lastTick = 0;
+        }
+        return;
+    }
+    v.lastTick = tick;
+}
+
+int main(int argc, char** argv) {
+    SpectateBenchConfig cfg = parseArgs(argc, argv);
+    if (cfg.viewers < 1 || cfg.seconds < 1 || cfg.joinSeconds < 0 || cfg.verifyEvery < 1) {
+        printf("invalid settings\n");
+        return 1;
+    }
+    rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    NetAddr server = netAddr(cfg.ip, (uint16_t)cfg.port);
+    int ep = epoll_create1(0);
+
+    // The player: turns at random now and then, and acks so the server keeps sending deltas
+    NetSocket player = netOpenUdp("127.0.0.1", 0);
+    uint32_t token = 0, nonce = 0x5EEDu;
+    int w = 0, h = 0;
+    NetReplica game;
+    uint16_t inputSeq = 0;
+    uint8_t inputs[NET_INPUT_REDUNDANCY] = {};
+    SimRng rng;
+    rng.state = cfg.seed;
+    {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = UINT32_MAX;
+        epoll_ctl(ep, EPOLL_CTL_ADD, player, &ev);
+    }
+
+    std::vector<Viewer> viewers((size_t)cfg.viewers);
+    for (size_t i = 0; i < viewers.size(); i++) {
+        Viewer& v = viewers[i];
+        v.sock = netOpenUdp("127.0.0.1", 0, 64 << 10);
+        if (v.sock == NET_INVALID_SOCKET) {
+            printf("cannot open %d sockets\n", cfg.viewers);
+            return 1;
+        }
+        if (i % (size_t)cfg.verifyEvery == 0) v.replica = std::make_unique<NetReplica>();
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t)i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, v.sock, &ev);
+    }
+
+    auto start = BenchClock::now();
+    auto end = start + std::chrono::seconds(cfg.seconds);
+    auto lastHello = start - std::chrono::seconds(1);
+    size_t nextJoin = 0;
+    uint64_t playerTicks = 0;
+    uint8_t buf[NET_MAX_PACKET];
+    NetAddr from;
+    std::vector<epoll_event> events(1024);
+    while (BenchClock::now() < end) {
+        auto now = BenchClock::now();
+        if (token == 0 && now - lastHello > std::chrono::milliseconds(500)) {
+            uint8_t hello[9] = { NET_HELLO };
+            netPut32(hello + 1, NET_MAGIC);
+            netPut32(hello + 5, nonce);
+            netSend(player, server, hello, 9);
+            lastHello = now;
+        }
+        // Viewers join evenly over the join window once the game exists, then WATCH every second
+        if (token != 0) {
+            double joinAt = cfg.joinSeconds * 1.0;
+            size_t due = joinAt <= 0.0 ? viewers.size()
+                : (size_t)std::min<double>((double)viewers.size(), viewers.size() * std::chrono::duration<double>(now - start).count() / joinAt);
+            for (; nextJoin < due; nextJoin++) {
+                Viewer& v = viewers[nextJoin];
+                sendWatch(v, server, false);
+                v.joined = true;
+                v.nextWatch = now + std::chrono::seconds(1);
+            }
+            for (size_t i = 0; i < nextJoin; i++) {
+                if (now >= viewers[i].nextWatch) {
+                    sendWatch(viewers[i], server, false);
+                    viewers[i].nextWatch = now + std::chrono::seconds(1);
+                }
+            }
+        }
+
+        int n = epoll_wait(ep, events.data(), (int)events.size(), 5);
+        for (int e = 0; e < n; e++) {
+            uint32_t id = events[e].data.u32;
+            int len;
+            if (id == UINT32_MAX) {
+                while ((len = netRecv(player, from, buf, sizeof(buf))) > 0) {
+                    if (buf[0] == NET_WELCOME && len >= 16 && netGet32(buf + 5) == nonce && token == 0) {
+                        token = netGet32(buf + 1);
+                        w = netGet16(buf + 9);
+                        h = netGet16(buf + 11);
+                        game.configure(w, h);
+                    }
+                    else if (buf[0] == NET_SNAPSHOT && token != 0 && game.apply(buf, len)) {
+                        playerTicks++;
+                        if (rng.below(4) == 0) inputs[++inputSeq % NET_INPUT_REDUNDANCY] = (uint8_t)rng.below(4);
+                        uint8_t in[12 + NET_INPUT_REDUNDANCY];
+                        int count = std::min<int>((int16_t)(inputSeq - game.inputAck), NET_INPUT_REDUNDANCY);
+                        if (count < 0) count = 0;
+                        in[0] = NET_INPUT;
+                        netPut32(in + 1, token);
+                        netPut32(in + 5, game.ackTick());
+                        netPut16(in + 9, inputSeq);
+                        in[11] = (uint8_t)count;
+                        NetBitWriter bw(in + 12, NET_INPUT_REDUNDANCY);
+                        for (int k = 0; k < count; k++) bw.put(inputs[(uint16_t)(inputSeq - k) % NET_INPUT_REDUNDANCY], 2);
+                        netSend(player, server, in, 12 + (int)bw.finish());
+                    }
+                }
+                continue;
+            }
+            Viewer& v = viewers[id];
+            while ((len = netRecv(v.sock, from, buf, sizeof(buf))) > 0) receive(v, server, buf, len, w, h);
+        }
+    }
+
+    uint64_t packets = 0, bytes = 0, gaps = 0, spanned = 0, failures = 0, verified = 0;
+    int watching = 0;
+    for (Viewer& v : viewers) {
+        packets += v.packets;
+        bytes += v.bytes;
+        gaps += v.gaps;
+        watching += v.lastTick != 0;
+        if (v.firstTick && v.lastTick) spanned += v.lastTick - v.firstTick + 1;
+        if (v.replica) {
+            failures += v.replica->checkFailures;
+            verified += v.replica->deltas + v.replica->keyframes;
+        }
+        netClose(v.sock);
+    }
+    uint8_t bye[5] = { NET_BYE };
+    netPut32(bye + 1, token);
+    if (token) netSend(player, server, bye, 5);
+    netClose(player);
+
+    printf("%d viewers, %d following at the end, %d s (joined over %d s)\n", cfg.viewers, watching, cfg.seconds, cfg.joinSeconds);
+    printf("%llu snapshots to viewers = %.3f per viewer-tick, %.1f B each, %llu gaps resynced\n", (unsigned long long)packets,
+        spanned ? (double)packets / spanned : 0.0, packets ? (double)bytes / packets : 0.0, (unsigned long long)gaps);
+    printf("%llu snapshots verified by replicas, %llu check failures; player saw %llu ticks\n", (unsigned long long)verified,
+        (unsigned long long)failures, (unsigned long long)playerTicks);
+    return failures ? 1 : 0;
+}
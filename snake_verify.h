@@ -0,0 +1,236 @@
+// snake_verify.h
+// Score verification: a submitted score comes with the game's settings, seed and input
+// log, and is accepted only if re-simulating the log under that seed with the rules of
+// main.cpp's tickLocked (SnakeSim) ends the game on the claimed tick with the claimed score and
+// length. The log holds the turns as they reached the game: at most one per tick, applied
+// at the start of that tick, never a reversal of the heading (WndProc drops those). The
+// replay stops at the first input that could not have happened.
+//
+// VerifyFarm checks a batch of submissions on an ArenaWorkers pool, one job per
+// submission, each worker re-simulating on its own board storage.
+//
+// Submission (little-endian, as snake_record.h):
+//   player u32, width u16, height u16, fruits u16, seed u64,
+//   score i32, length u16, ticks u32 (the tick the game ended on), turns u32,
+//   then per turn: tick u32 (1 = the first tick), dir u8 (SimDir)
+// File: magic u32, version u16, then per submission: size u32, submission
+
+#pragma once
+
+#include "snake_arena.h"
+#include "snake_record.h"
+#include "snake_sim.h"
+
+#include <cstdint>
+#include <vector>
+
+static constexpr uint32_t VERIFY_MAGIC = 0x564B4E53; // "SNKV"
+static constexpr uint16_t VERIFY_VERSION = 1;
+static constexpr int VERIFY_FILE_HEADER = 6;
+static constexpr int VERIFY_HEADER = 32;
+static constexpr int VERIFY_TURN_BYTES = 5;
+static constexpr int VERIFY_MIN_SIDE = 4;
+static constexpr int VERIFY_MAX_SIDE = 64;
+static constexpr int VERIFY_MAX_CELLS = VERIFY_MAX_SIDE * VERIFY_MAX_SIDE;
+
+enum VerifyReason : uint8_t {
+    VERIFY_OK,
+    VERIFY_MALFORMED,     // truncated, a bad direction or turns out of order
+    VERIFY_SETTINGS,      // board or fruit count the game does not offer
+    VERIFY_TOO_LONG,      // more ticks than the farm will run
+    VERIFY_REVERSAL,      // a turn straight back into the neck
+    VERIFY_MID_TICK,      // a second turn in one tick: it was applied after the tick's move
+    VERIFY_AFTER_END,     // a turn after the game was over
+    VERIFY_NOT_OVER,      // still alive on the claimed last tick
+    VERIFY_ENDED_EARLY,   // died or won before the claimed last tick
+    VERIFY_SCORE,         // the game ended, with another score
+    VERIFY_LENGTH,        // same score, another length
+    VERIFY_REASONS
+};
+
+static inline const char* verifyReasonName(int r) {
+    static const char* names[VERIFY_REASONS] = { "ok", "malformed", "bad settings", "too long", "reversal", "turn mid-tick",
+        "turn after the end", "not over", "ended early", "score differs", "length differs" };
+    return r >= 0 && r < VERIFY_REASONS ? names[r] : "?";
+}
+
+struct VerifyTurn {
+    uint32_t tick;
+    uint8_t dir;
+};
+
+struct VerifyClaim {
+    uint32_t player = 0;
+    uint16_t width = 0, height = 0, fruits = 0;
+    uint64_t seed = 0;
+    int32_t score = 0;
+    uint16_t length = 0;
+    uint32_t ticks = 0;
+};
+
+struct VerifyVerdict {
+    VerifyReason reason = VERIFY_OK;
+    uint32_t tick = 0;    // where the replay stopped
+    uint32_t turns = 0;   // turns applied before it stopped
+};
+
+//
+// Encoding
+//
+static inline void verifyPut(std::vector<uint8_t>& out, const VerifyClaim& c, const VerifyTurn* turns, uint32_t count) {
+    size_t at = out.size();
+    out.resize(at + VERIFY_HEADER + (size_t)count * VERIFY_TURN_BYTES);
+    uint8_t* p = out.data() + at;
+    p = recordPutN(p, c.player, 4);
+    p = recordPutN(p, c.width, 2);
+    p = recordPutN(p, c.height, 2);
+    p = recordPutN(p, c.fruits, 2);
+    p = recordPutN(p, c.seed, 8);
+    p = recordPutN(p, (uint32_t)c.score, 4);
+    p = recordPutN(p, c.length, 2);
+    p = recordPutN(p, c.ticks, 4);
+    p = recordPutN(p, count, 4);
+    for (uint32_t i = 0; i < count; i++) {
+        p = recordPutN(p, turns[i].tick, 4);
+        *p++ = turns[i].dir;
+    }
+}
+
+// The claim and turn count of a submission; false if it is shorter than they say
+static inline bool verifyGetClaim(const uint8_t* p, size_t n, VerifyClaim& c, uint32_t& turns) {
+    if (n < (size_t)VERIFY_HEADER) return false;
+    c.player = (uint32_t)recordGetN(p, 4);
+    c.width = (uint16_t)recordGetN(p, 2);
+    c.height = (uint16_t)recordGetN(p, 2);
+    c.fruits = (uint16_t)recordGetN(p, 2);
+    c.seed = recordGetN(p, 8);
+    c.score = (int32_t)recordGetN(p, 4);
+    c.length = (uint16_t)recordGetN(p, 2);
+    c.ticks = (uint32_t)recordGetN(p, 4);
+    turns = (uint32_t)recordGetN(p, 4);
+    return (n - VERIFY_HEADER) / VERIFY_TURN_BYTES >= turns;
+}
+
+//
+// One submission. sim must be bound to storage for VERIFY_MAX_CELLS cells.
+//
+static inline VerifyVerdict verifySubmission(const uint8_t* data, size_t n, SnakeSim& sim, uint32_t maxTicks) {
+    VerifyVerdict v;
+    VerifyClaim c;
+    uint32_t count;
+    if (!verifyGetClaim(data, n, c, count)) {
+        v.reason = VERIFY_MALFORMED;
+        return v;
+    }
+    if (c.width < VERIFY_MIN_SIDE || c.height < VERIFY_MIN_SIDE || c.width > VERIFY_MAX_SIDE || c.height > VERIFY_MAX_SIDE ||
+        c.fruits < 1 || c.fruits > SIM_MAX_FOOD) {
+        v.reason = VERIFY_SETTINGS;
+        return v;
+    }
+    if (c.ticks > maxTicks) {
+        v.reason = VERIFY_TOO_LONG;
+        return v;
+    }
+
+    sim.reset(c.width, c.height, c.fruits, c.seed);
+    const uint8_t* turn = data + VERIFY_HEADER;
+    const uint8_t* end = turn + (size_t)count * VERIFY_TURN_BYTES;
+    auto turnTick = [](const uint8_t* t) { return (uint32_t)t[0] | (uint32_t)t[1] << 8 | (uint32_t)t[2] << 16 | (uint32_t)t[3] << 24; };
+    auto stop = [&](VerifyReason r) {
+        v.reason = r;
+        v.tick = sim.ticks + 1;
+        v.turns = (uint32_t)((turn - (data + VERIFY_HEADER)) / VERIFY_TURN_BYTES);
+        return v;
+    };
+
+    while (!sim.done() && sim.ticks < c.ticks) {
+        uint32_t tick = sim.ticks + 1;
+        int action = -1;
+        if (turn < end) {
+            uint32_t at = turnTick(turn);
+            if (at < tick) return stop(VERIFY_MALFORMED); // out of order, or tick 0
+            if (at == tick) {
+                action = turn[4];
+                if (action > SIM_RIGHT) return stop(VERIFY_MALFORMED);
+                if ((SimDir)action == simOpposite(sim.dir)) return stop(VERIFY_REVERSAL);
+                turn += VERIFY_TURN_BYTES;
+                if (turn < end && turnTick(turn) == tick) return stop(VERIFY_MID_TICK);
+            }
+        }
+        sim.step(action);
+    }
+
+    v.tick = sim.ticks;
+    v.turns = (uint32_t)((turn - (data + VERIFY_HEADER)) / VERIFY_TURN_BYTES);
+    if (turn < end) v.reason = VERIFY_AFTER_END;
+    else if (!sim.done()) v.reason = VERIFY_NOT_OVER;
+    else if (sim.ticks != c.ticks) v.reason = VERIFY_ENDED_EARLY;
+    else if (sim.score != c.score) v.reason = VERIFY_SCORE;
+    else if (sim.length != c.length) v.reason = VERIFY_LENGTH;
+    return v;
+}
+
+//
+// Farm: a batch at a time over a worker pool
+//
+struct VerifyItem {
+    const uint8_t* data;
+    size_t size;
+};
+
+class VerifyFarm {
+public:
+    explicit VerifyFarm(int threads, uint32_t maxTicks = 10000000) : pool(threads), maxTicks(maxTicks) {
+        boards.resize((size_t)pool.size());
+        storage.resize((size_t)pool.size());
+        for (int t = 0; t < pool.size(); t++) {
+            storage[(size_t)t].resize(SnakeSim::storageWords(VERIFY_MAX_CELLS));
+            boards[(size_t)t].bind(storage[(size_t)t].data(), VERIFY_MAX_CELLS);
+        }
+    }
+
+    int threads() const { return pool.size(); }
+
+    // Fills out[i] for items[i]; returns the ticks simulated
+    uint64_t run(const VerifyItem* items, int count, VerifyVerdict* out) {
+        std::vector<uint64_t> ticks((size_t)pool.size() * TICK_STRIDE, 0);
+        pool.run(count, [&](int t, int i) {
+            out[i] = verifySubmission(items[i].data, items[i].size, boards[(size_t)t], maxTicks);
+            ticks[(size_t)t * TICK_STRIDE] += boards[(size_t)t].ticks;
+        });
+        uint64_t total = 0;
+        for (int t = 0; t < pool.size(); t++) total += ticks[(size_t)t * TICK_STRIDE];
+        return total;
+    }
+
+private:
+    static constexpr size_t TICK_STRIDE = CACHE_LINE / sizeof(uint64_t); // a line per thread
+
+    ArenaWorkers pool;
+    uint32_t maxTicks;
+    std::vector<SnakeSim> boards;
+    std::vector<std::vector<uint32_t>> storage;
+};
+
+//
+// Files
+//
+static inline void verifyFileHeader(std::vector<uint8_t>& out) {
+    uint8_t h[VERIFY_FILE_HEADER];
+    recordPutN(recordPutN(h, VERIFY_MAGIC, 4), VERIFY_VERSION, 2);
+    out.insert(out.end(), h, h + VERIFY_FILE_HEADER);
+}
+
+// Splits a file's bytes into submissions; false if it is not a submission file
+static inline bool verifySplit(const std::vector<uint8_t>& file, std::vector<VerifyItem>& out) {
+    const uint8_t* p = file.data();
+    const uint8_t* end = p + file.size();
+    if (file.size() < (size_t)VERIFY_FILE_HEADER || recordGetN(p, 4) != VERIFY_MAGIC || recordGetN(p, 2) != VERIFY_VERSION) return false;
+    while (end - p >= 4) {
+        size_t size = (size_t)recordGetN(p, 4);
+        if (size > (size_t)(end - p)) break; // cut short while being written
+        out.push_back({ p, size });
+        p += size;
+    }
+    return true;
+}
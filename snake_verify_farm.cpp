@@ -0,0 +1,350 @@
+// snake_verify_farm.cpp
+// Verification farm for submitted scores (snake_verify.h). Submissions are taken in
+// batches and re-simulated on a worker pool; each batch's verdicts are tallied by reason.
+// Without files it makes its own: bot games played honestly, a share of them then doctored
+// the ways a cheater would (a reversal, a second turn in a tick, an inflated score, a
+// longer game, turns after the end, another seed), and checks every verdict against what
+// was done to the game. With --leaderboard-port, accepted scores are sent on to
+// snake_leaderboard_server as RESULTS.
+// Compile: g++ snake_verify_farm.cpp -std=c++20 -O2 -pthread -o snake_verify_farm
+// Run:     ./snake_verify_farm [--games 20000] [--cheats 0.3] [--threads 4] [--batch 256] [--write subs.snkv]
+//          ./snake_verify_farm subs.snkv [--leaderboard-port 7900]
+
+#include "snake_leaderboard.h"
+#include "snake_verify.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//
+// Config
+//
+struct FarmConfig {
+    std::vector<const char*> files;
+    int games = 20000;
+    double cheats = 0.3;     // share of generated games that are doctored
+    int width = 20;
+    int height = 20;
+    int fruits = 3;
+    int threads = 4;
+    int batch = 256;
+    uint64_t seed = 1;
+    const char* write = nullptr;
+    const char* leaderboardIp = "127.0.0.1";
+    int leaderboardPort = 0;
+};
+
+static FarmConfig parseArgs(int argc, char** argv) {
+    FarmConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--games") && i + 1 < argc) cfg.games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--cheats") && i + 1 < argc) cfg.cheats = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) cfg.width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--height") && i + 1 < argc) cfg.height = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fruits") && i + 1 < argc) cfg.fruits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) cfg.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--batch") && i + 1 < argc) cfg.batch = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) cfg.seed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--write") && i + 1 < argc) cfg.write = argv[++i];
+        else if (!strcmp(argv[i], "--leaderboard-ip") && i + 1 < argc) cfg.leaderboardIp = argv[++i];
+        else if (!strcmp(argv[i], "--leaderboard-port") && i + 1 < argc) cfg.leaderboardPort = atoi(argv[++i]);
+        else cfg.files.push_back(argv[i]);
+    }
+    return cfg;
+}
+
+using FarmClock = std::chrono::steady_clock;
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[1 << 16];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+//
+// Generated games
+//
+enum Doctored : uint8_t { HONEST, CHEAT_REVERSAL, CHEAT_MID_TICK, CHEAT_SCORE, CHEAT_LONGER, CHEAT_AFTER_END, CHEAT_SEED, DOCTORED_KINDS };
+
+static const char* doctoredName(int d) {
+    static const char* names[DOCTORED_KINDS] = { "honest", "reversal", "two turns in a tick", "inflated score", "longer game",
+        "turns after the end", "another seed" };
+    return names[d];
+}
+
+// What the farm must say about each kind; another seed may fail any check
+static const VerifyReason expectedReason[DOCTORED_KINDS] = { VERIFY_OK, VERIFY_REVERSAL, VERIFY_MID_TICK, VERIFY_SCORE,
+    VERIFY_ENDED_EARLY, VERIFY_AFTER_END, VERIFY_REASONS };
+
+// Towards the nearest fruit, never into a wall or the body, a little noise
+static int botAction(const SnakeSim& g, SimRng& rng) {
+    static const int dx[4] = { 0, 0, -1, 1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    int hx = (int)(g.head() % (uint32_t)g.w), hy = (int)(g.head() / (uint32_t)g.w);
+    int best = g.dir;
+    int bestScore = -1000000;
+    for (int a = 0; a < 4; a++) {
+        if (a == simOpposite(g.dir)) continue;
+        int x = hx + dx[a], y = hy + dy[a];
+        int score = (int)rng.below(3);
+        if (x < 0 || x >= g.w || y < 0 || y >= g.h || g.occupied((uint32_t)(y * g.w + x))) score -= 100000;
+        int nearest = 1000000;
+        for (int f = 0; f < g.foodCount; f++) {
+            int fx = (int)(g.food[f] % (uint32_t)g.w), fy = (int)(g.food[f] / (uint32_t)g.w);
+            nearest = (std::min)(nearest, abs(fx - x) + abs(fy - y));
+        }
+        score -= nearest * 4;
+        if (score > bestScore) {
+            bestScore = score;
+            best = a;
+        }
+    }
+    return best;
+}
+
+// One bot game to its end. Only turns are logged, as they reach the game; once the bot
+// stops finding fruit it goes straight on into whatever is ahead.
+static void playGame(const FarmConfig& cfg, SnakeSim& g, SimRng& rng, VerifyClaim& c, std::vector<VerifyTurn>& turns,
+    std::vector<uint8_t>& heading) {
+    c.width = (uint16_t)cfg.width;
+    c.height = (uint16_t)cfg.height;
+    c.fruits = (uint16_t)cfg.fruits;
+    c.seed = rng.next();
+    g.reset(cfg.width, cfg.height, cfg.fruits, c.seed);
+    turns.clear();
+    heading.clear();
+    while (!g.done()) {
+        int action = g.ticksSinceFood < (uint32_t)(g.cells * 2) ? botAction(g, rng) : (int)g.dir;
+        heading.push_back((uint8_t)g.dir); // heading[t - 1]: before tick t
+        if (action != g.dir) turns.push_back({ g.ticks + 1, (uint8_t)action });
+        g.step(action);
+    }
+    c.score = g.score;
+    c.length = (uint16_t)g.length;
+    c.ticks = g.ticks;
+}
+
+// A cheat of the given kind applied to an honest game; false if this game cannot take it
+static bool doctor(Doctored kind, SimRng& rng, VerifyClaim& c, std::vector<VerifyTurn>& turns, const std::vector<uint8_t>& heading) {
+    switch (kind) {
+    case CHEAT_REVERSAL: {
+        // A tick without a turn of its own, then straight back the way it came
+        for (int tries = 0; tries < 8; tries++) {
+            uint32_t t = 1 + rng.below(c.ticks);
+            auto it = std::lower_bound(turns.begin(), turns.end(), t, [](const VerifyTurn& a, uint32_t v) { return a.tick < v; });
+            if (it != turns.end() && it->tick == t) continue;
+            turns.insert(it, { t, (uint8_t)simOpposite((SimDir)heading[t - 1]) });
+            return true;
+        }
+        return false;
+    }
+    case CHEAT_MID_TICK: {
+        // A quick second turn after one that reached the game: the tick had already moved
+        if (turns.empty()) return false;
+        size_t i = rng.below((uint32_t)turns.size());
+        SimDir d = (SimDir)turns[i].dir;
+        uint8_t second = (uint8_t)(d == SIM_UP || d == SIM_DOWN ? SIM_LEFT + rng.below(2) : SIM_UP + rng.below(2));
+        turns.insert(turns.begin() + (ptrdiff_t)i + 1, { turns[i].tick, second });
+        return true;
+    }
+    case CHEAT_SCORE: {
+        uint32_t fruits = 1 + rng.below(5);
+        c.score += 10 * (int32_t)fruits;
+        c.length = (uint16_t)(c.length + fruits); // a length to match
+        return true;
+    }
+    case CHEAT_LONGER:
+        c.ticks += 1 + rng.below(200);
+        c.score += 10;
+        c.length++;
+        return true;
+    case CHEAT_AFTER_END:
+        turns.push_back({ c.ticks + 1 + rng.below(20), (uint8_t)rng.below(4) });
+        return true;
+    case CHEAT_SEED:
+        c.seed ^= (uint64_t)1 << rng.below(64);
+        return true;
+    default:
+        return true;
+    }
+}
+
+// Appends one submission to a submission file's bytes
+static void appendSubmission(std::vector<uint8_t>& out, const VerifyClaim& c, const std::vector<VerifyTurn>& turns) {
+    size_t at = out.size();
+    out.resize(at + 4);
+    verifyPut(out, c, turns.data(), (uint32_t)turns.size());
+    recordPutN(out.data() + at, out.size() - at - 4, 4);
+}
+
+//
+// Accepted scores on to the leaderboard, in full RESULTS datagrams
+//
+struct LeaderForward {
+    NetSocket sock = NET_INVALID_SOCKET;
+    NetAddr server;
+    uint8_t buf[NET_MAX_PACKET];
+    int count = 0;
+    uint64_t sent = 0;
+
+    void add(const VerifyClaim& c, uint64_t replay) {
+        uint8_t* p = buf + 2 + count * LEADER_RESULT_BYTES;
+        netPut32(p, leaderKey(0, c.width, c.height, c.fruits));
+        LeaderEntry e;
+        e.player = c.player;
+        e.score = c.score;
+        e.length = c.length;
+        e.replay = replay;
+        leaderPutEntry(p + 4, e);
+        if (++count == LEADER_MAX_RESULTS) flush();
+    }
+
+    void flush() {
+        if (count == 0) return;
+        buf[0] = LEADER_RESULTS;
+        buf[1] = (uint8_t)count;
+        netSend(sock, server, buf, 2 + count * LEADER_RESULT_BYTES);
+        sent += (uint64_t)count;
+        count = 0;
+    }
+};
+
+int main(int argc, char** argv) {
+    FarmConfig cfg = parseArgs(argc, argv);
+    if (!netInit()) return 1;
+    if (cfg.width < VERIFY_MIN_SIDE || cfg.height < VERIFY_MIN_SIDE || cfg.width > VERIFY_MAX_SIDE || cfg.height > VERIFY_MAX_SIDE) {
+        printf("board must be %d..%d on each side\n", VERIFY_MIN_SIDE, VERIFY_MAX_SIDE);
+        return 1;
+    }
+
+    // Submissions: from files, or generated with a note of what was done to each
+    std::vector<std::vector<uint8_t>> files;
+    std::vector<VerifyItem> items;
+    std::vector<uint8_t> kinds;
+    if (!cfg.files.empty()) {
+        for (const char* path : cfg.files) {
+            files.emplace_back();
+            if (!readFile(path, files.back()) || !verifySplit(files.back(), items)) {
+                printf("%s: not a submission file\n", path);
+                return 1;
+            }
+        }
+    }
+    else {
+        auto t0 = FarmClock::now();
+        int cells = cfg.width * cfg.height;
+        std::vector<uint32_t> storage(SnakeSim::storageWords(cells));
+        SnakeSim g;
+        g.bind(storage.data(), cells);
+        SimRng rng{ cfg.seed };
+        VerifyClaim c;
+        std::vector<VerifyTurn> turns;
+        std::vector<uint8_t> heading;
+        files.emplace_back();
+        verifyFileHeader(files[0]);
+        for (int i = 0; i < cfg.games; i++) {
+            playGame(cfg, g, rng, c, turns, heading);
+            c.player = 1 + rng.below(100000);
+            Doctored kind = HONEST;
+            if (rng.below(1000000) < (uint32_t)(cfg.cheats * 1000000)) {
+                kind = (Doctored)(1 + rng.below(DOCTORED_KINDS - 1));
+                if (!doctor(kind, rng, c, turns, heading)) kind = HONEST;
+            }
+            appendSubmission(files[0], c, turns);
+            kinds.push_back(kind);
+        }
+        verifySplit(files[0], items);
+        printf("%d bot games on %dx%d with %d fruits made in %.2f s, %.1f MB of submissions\n", cfg.games, cfg.width, cfg.height,
+            cfg.fruits, std::chrono::duration<double>(FarmClock::now() - t0).count(), files[0].size() / 1048576.0);
+        if (cfg.write) {
+            FILE* f = fopen(cfg.write, "wb");
+            if (!f || fwrite(files[0].data(), 1, files[0].size(), f) != files[0].size()) {
+                printf("cannot write %s\n", cfg.write);
+                return 1;
+            }
+            fclose(f);
+        }
+    }
+
+    LeaderForward forward;
+    if (cfg.leaderboardPort > 0) {
+        forward.sock = netOpenUdp("0.0.0.0", 0, 1 << 20);
+        forward.server = netAddr(cfg.leaderboardIp, cfg.leaderboardPort);
+    }
+
+    // Batches through the farm
+    VerifyFarm farm(cfg.threads);
+    std::vector<VerifyVerdict> verdicts(items.size());
+    uint64_t ticks = 0, claimedTicks = 0, rejectedTicks = 0, rejectedClaimed = 0;
+    uint64_t reasons[VERIFY_REASONS] = {};
+    double worstBatchMs = 0.0;
+    auto t0 = FarmClock::now();
+    int batch = (std::max)(cfg.batch, 1);
+    for (size_t at = 0; at < items.size(); at += (size_t)batch) {
+        int count = (int)(std::min)((size_t)batch, items.size() - at);
+        auto b0 = FarmClock::now();
+        ticks += farm.run(&items[at], count, &verdicts[at]);
+        worstBatchMs = (std::max)(worstBatchMs, std::chrono::duration<double, std::milli>(FarmClock::now() - b0).count());
+        for (int i = 0; i < count; i++) {
+            const VerifyVerdict& v = verdicts[at + (size_t)i];
+            VerifyClaim c;
+            uint32_t n;
+            bool parsed = verifyGetClaim(items[at + (size_t)i].data, items[at + (size_t)i].size, c, n);
+            reasons[v.reason]++;
+            if (parsed) claimedTicks += c.ticks;
+            if (v.reason != VERIFY_OK) {
+                rejectedTicks += v.tick;
+                if (parsed) rejectedClaimed += c.ticks;
+            }
+            else if (forward.sock != NET_INVALID_SOCKET) {
+                forward.add(c, (uint64_t)(at + (size_t)i));
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(FarmClock::now() - t0).count();
+    if (forward.sock != NET_INVALID_SOCKET) {
+        forward.flush();
+        netClose(forward.sock);
+    }
+
+    printf("%zu submissions in %.3f s on %d threads, batches of %d: %.0f verifications/s, %.1f M ticks/s, slowest batch %.2f ms\n",
+        items.size(), seconds, farm.threads(), batch, items.size() / seconds, ticks / seconds / 1e6, worstBatchMs);
+    printf("%llu ticks simulated of %llu claimed; rejections stopped after %.1f%% of the ticks they claimed\n",
+        (unsigned long long)ticks, (unsigned long long)claimedTicks, rejectedClaimed ? 100.0 * rejectedTicks / rejectedClaimed : 0.0);
+    for (int r = 0; r < VERIFY_REASONS; r++) {
+        if (reasons[r]) printf("  %-20s %8llu  %5.1f%%\n", verifyReasonName(r), (unsigned long long)reasons[r], 100.0 * reasons[r] / items.size());
+    }
+    if (forward.sock != NET_INVALID_SOCKET || forward.sent) {
+        printf("%llu accepted scores sent to the leaderboard at %s:%d\n", (unsigned long long)forward.sent, cfg.leaderboardIp, cfg.leaderboardPort);
+    }
+    if (kinds.empty()) return 0;
+
+    // Generated: every verdict against what was done to the game
+    uint64_t made[DOCTORED_KINDS] = {}, caught[DOCTORED_KINDS] = {}, wrongReason[DOCTORED_KINDS] = {};
+    for (size_t i = 0; i < items.size(); i++) {
+        int k = kinds[i];
+        made[k]++;
+        VerifyReason want = expectedReason[k];
+        bool ok = k == HONEST ? verdicts[i].reason == VERIFY_OK : verdicts[i].reason != VERIFY_OK;
+        caught[k] += ok;
+        wrongReason[k] += ok && want != VERIFY_REASONS && verdicts[i].reason != want;
+    }
+    uint64_t wrong = 0;
+    for (int k = 0; k < DOCTORED_KINDS; k++) {
+        if (!made[k]) continue;
+        printf("  %-20s %8llu  %s %llu", doctoredName(k), (unsigned long long)made[k], k == HONEST ? "accepted" : "rejected",
+            (unsigned long long)caught[k]);
+        if (wrongReason[k]) printf(" (%llu for another reason)", (unsigned long long)wrongReason[k]);
+        printf("\n");
+        wrong += made[k] - caught[k] + wrongReason[k];
+    }
+    printf("%s\n", wrong ? "VERDICTS DIFFER from what was done to the games" : "every verdict matches what was done to the game");
+    return wrong ? 1 : 0;
+}